@@ -13,6 +13,7 @@
 #include "esp_err.h"
 #include "audio_bsp.h"
 #include "ring_buffer.h"
+#include "xn_task_sched.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -58,6 +59,7 @@ typedef struct {
     int vad_mode;
     int min_speech_ms;
     int min_silence_ms;
+    int preroll_ms;             ///< 预录时长（录音开始时补发的历史音频，0 表示关闭）
 } afe_vad_config_t;
 
 /** AFE 功能配置 */
@@ -66,8 +68,34 @@ typedef struct {
     bool ns_enabled;
     bool agc_enabled;
     int afe_mode;
+    bool dynamic_profile;   ///< 是否启用动态档位（空闲时关闭 AEC/NS/AGC）
 } afe_feature_config_t;
 
+/** AFE 处理档位 */
+typedef enum {
+    AFE_PROFILE_IDLE = 0,       ///< 空闲/监听：仅唤醒词 + VAD
+    AFE_PROFILE_CONVERSATION,   ///< 对话/播放：启用 AEC + NS + AGC
+    AFE_PROFILE_MAX,
+} afe_profile_t;
+
+/** 单个档位的运行统计 */
+typedef struct {
+    uint32_t frames;            ///< 该档位下输出的帧数
+    uint64_t active_us;         ///< 处于该档位的累计时长（微秒）
+    uint64_t feed_cpu_us;       ///< Feed 任务累计 CPU 时间（微秒）
+    uint64_t fetch_cpu_us;      ///< Fetch 任务累计 CPU 时间（微秒）
+} afe_profile_stats_t;
+
+/** AFE 档位统计 */
+typedef struct {
+    afe_profile_t current;                      ///< 当前生效档位
+    uint32_t switch_count;                      ///< 档位切换次数
+    afe_profile_stats_t profile[AFE_PROFILE_MAX]; ///< 各档位统计
+    uint64_t mic_samples;                       ///< 送入 AFE 的麦克风采样点数
+    uint64_t out_samples;                       ///< AFE 输出的采样点数
+    uint64_t record_samples;                    ///< 交给录音回调的采样点数（含预录）
+} afe_wrapper_stats_t;
+
 /** AFE 包装器配置 */
 typedef struct {
     audio_bsp_handle_t bsp_handle;             ///< BSP 句柄
@@ -81,6 +109,7 @@ typedef struct {
     void *record_ctx;                           ///< 录音回调上下文
     bool *running_ptr;                          ///< 运行状态指针（外部管理）
     bool *recording_ptr;                        ///< 录音状态指针（外部管理）
+    const xn_sched_profile_t *sched_profile;    ///< 调度档案（Feed/Fetch 任务，NULL 使用均衡预设）
 } afe_wrapper_config_t;
 
 /** AFE 包装器句柄 */
@@ -117,6 +146,31 @@ esp_err_t afe_wrapper_update_wakeup_config(afe_wrapper_handle_t wrapper,
 esp_err_t afe_wrapper_get_wakeup_config(afe_wrapper_handle_t wrapper, 
                                          afe_wakeup_config_t *config);
 
+/**
+ * @brief 请求切换 AFE 处理档位
+ * @note 仅记录目标档位，实际切换在 Feed 任务下一帧开始前完成，不重建 AFE Manager
+ * @param wrapper AFE 包装器句柄
+ * @param profile 目标档位
+ * @return ESP_OK 成功，ESP_ERR_NOT_SUPPORTED 未启用动态档位
+ */
+esp_err_t afe_wrapper_set_profile(afe_wrapper_handle_t wrapper, afe_profile_t profile);
+
+/**
+ * @brief 获取当前生效的 AFE 处理档位
+ * @param wrapper AFE 包装器句柄
+ * @return 当前档位
+ */
+afe_profile_t afe_wrapper_get_profile(afe_wrapper_handle_t wrapper);
+
+/**
+ * @brief 获取各档位运行统计（时长、帧数、CPU 时间）
+ * @note CPU 时间依赖 CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS，未启用时为 0
+ * @param wrapper AFE 包装器句柄
+ * @param stats 输出统计
+ * @return ESP_OK 成功
+ */
+esp_err_t afe_wrapper_get_stats(afe_wrapper_handle_t wrapper, afe_wrapper_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,7 +9,10 @@
 #pragma once
 
 #include "esp_err.h"
+#include "sdkconfig.h"
+#if !CONFIG_IDF_TARGET_LINUX
 #include "driver/i2s_std.h"
+#endif
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -69,9 +72,11 @@ esp_err_t audio_bsp_write_speaker(audio_bsp_handle_t handle,
                                   size_t sample_count,
                                   uint8_t volume);
 
+#if !CONFIG_IDF_TARGET_LINUX
 i2s_chan_handle_t audio_bsp_get_rx(audio_bsp_handle_t handle);
 
 i2s_chan_handle_t audio_bsp_get_tx(audio_bsp_handle_t handle);
+#endif
 
 #ifdef __cplusplus
 }
@@ -12,6 +12,7 @@
 
 #include "esp_err.h"
 #include "audio_bsp.h"
+#include "xn_task_sched.h"
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -22,8 +23,6 @@ extern "C" {
 
 // ============ 调度与缓冲配置宏 ============
 
-#define AUDIO_MANAGER_TASK_STACK_SIZE        (6 * 1024)
-#define AUDIO_MANAGER_TASK_PRIORITY          7
 #define AUDIO_MANAGER_EVENT_QUEUE_LENGTH     16
 #define AUDIO_MANAGER_STEP_INTERVAL_MS       100
 #define AUDIO_MANAGER_DEFAULT_VOLUME         80
@@ -32,6 +31,8 @@ extern "C" {
 #define AUDIO_MANAGER_PLAYBACK_BUFFER_BYTES  (512 * 1024)
 #define AUDIO_MANAGER_REFERENCE_BUFFER_BYTES (16 * 1024)
 
+#define AUDIO_MANAGER_AFE_PROFILE_HOLD_MS    1500   ///< 对话结束后保持完整 AFE 档位的时长，避免频繁切换
+
 // ============ 状态机定义 ============
 
 typedef enum {
@@ -59,6 +60,7 @@ typedef enum {
 /** 音频管理器事件数据 */
 typedef struct {
     audio_mgr_event_type_t type;        ///< 事件类型
+    int64_t timestamp_us;               ///< 检测时刻（esp_timer_get_time），唤醒词/VAD 事件有效，用于统计响应延迟
     union {
         struct {
             int wake_word_index;        ///< 唤醒词索引
@@ -98,6 +100,7 @@ typedef struct {
     int vad_mode;                   ///< VAD模式 (0-3)
     int min_speech_ms;              ///< 最小语音持续时间
     int min_silence_ms;             ///< 最小静音持续时间
+    int preroll_ms;                 ///< 预录时长，录音开始时先补发这段历史音频（建议 300-500，0 关闭）
 } audio_mgr_vad_config_t;
 
 /** AFE功能配置（应用层提供） */
@@ -106,14 +109,52 @@ typedef struct {
     bool ns_enabled;                ///< 降噪
     bool agc_enabled;               ///< 自动增益
     int afe_mode;                   ///< AFE模式（0=LOW_COST, 1=HIGH_QUALITY）
+    bool dynamic_profile;           ///< 动态档位：空闲仅唤醒词+VAD，对话/播放时启用 AEC/NS/AGC
 } audio_mgr_afe_config_t;
 
+/** AFE 处理档位 */
+typedef enum {
+    AUDIO_MGR_AFE_PROFILE_IDLE = 0,     ///< 空闲/监听：仅唤醒词 + VAD
+    AUDIO_MGR_AFE_PROFILE_CONVERSATION, ///< 对话/播放：AEC + NS + AGC 全开
+    AUDIO_MGR_AFE_PROFILE_MAX,
+} audio_mgr_afe_profile_t;
+
+/** 单个 AFE 档位的运行统计 */
+typedef struct {
+    uint32_t frames;                ///< 该档位下处理的帧数
+    uint32_t active_ms;             ///< 处于该档位的累计时长
+    uint32_t cpu_ms;                ///< Feed + Fetch 任务累计 CPU 时间
+    float cpu_percent;              ///< 该档位下 AFE 占单核 CPU 百分比
+} audio_mgr_afe_profile_stats_t;
+
+/** AFE 档位统计 */
+typedef struct {
+    audio_mgr_afe_profile_t current;    ///< 当前生效档位
+    uint32_t switch_count;              ///< 档位切换次数
+    audio_mgr_afe_profile_stats_t profile[AUDIO_MGR_AFE_PROFILE_MAX]; ///< 各档位统计
+} audio_mgr_afe_stats_t;
+
+/** 音频管线统计（缓冲深度、丢样、AFE 滞后） */
+typedef struct {
+    size_t   playback_depth;            ///< 播放缓冲当前样本数
+    size_t   playback_peak;             ///< 播放缓冲峰值样本数
+    uint64_t playback_dropped;          ///< 播放缓冲溢出丢弃样本数
+    size_t   reference_depth;           ///< 回采缓冲当前样本数
+    size_t   reference_peak;            ///< 回采缓冲峰值样本数
+    uint64_t reference_dropped;         ///< 回采缓冲溢出丢弃样本数
+    uint64_t mic_samples;               ///< 送入 AFE 的麦克风样本数
+    uint64_t afe_out_samples;           ///< AFE 输出样本数
+    uint64_t record_samples;            ///< 交给录音回调的样本数
+    uint32_t afe_latency_ms;            ///< AFE 管线滞后（已送入未输出的样本折算，16kHz）
+} audio_mgr_pipeline_stats_t;
+
 /** 音频管理器配置（应用层组装） */
 typedef struct {
     audio_mgr_hw_config_t      hw_config;       ///< 硬件配置
     audio_mgr_wakeup_config_t  wakeup_config;   ///< 唤醒词配置
     audio_mgr_vad_config_t     vad_config;      ///< VAD配置
     audio_mgr_afe_config_t     afe_config;      ///< AFE配置
+    const xn_sched_profile_t  *sched_profile;   ///< 任务调度档案（NULL 使用均衡预设）
     audio_mgr_event_cb_t       event_callback;  ///< 事件回调
     audio_mgr_state_cb_t       state_callback;  ///< 状态机回调
     void                      *user_ctx;        ///< 用户上下文
@@ -150,6 +191,7 @@ typedef struct {
         .vad_mode = 2,                                               \
         .min_speech_ms = 200,                                        \
         .min_silence_ms = 400,                                       \
+        .preroll_ms = 400,                                           \
     }
 
 #define AUDIO_MANAGER_DEFAULT_AFE_CONFIG()                           \
@@ -158,6 +200,7 @@ typedef struct {
         .ns_enabled = true,                                          \
         .agc_enabled = true,                                         \
         .afe_mode = 1,                                               \
+        .dynamic_profile = true,                                     \
     }
 
 #define AUDIO_MANAGER_DEFAULT_CONFIG()                               \
@@ -166,6 +209,7 @@ typedef struct {
         .wakeup_config = AUDIO_MANAGER_DEFAULT_WAKEUP_CONFIG(),      \
         .vad_config = AUDIO_MANAGER_DEFAULT_VAD_CONFIG(),            \
         .afe_config = AUDIO_MANAGER_DEFAULT_AFE_CONFIG(),            \
+        .sched_profile = NULL,                                       \
         .event_callback = NULL,                                      \
         .state_callback = NULL,                                      \
         .user_ctx = NULL,                                            \
@@ -225,6 +269,27 @@ esp_err_t audio_manager_stop_recording(void);
  */
 esp_err_t audio_manager_play_audio(const int16_t *pcm_data, size_t sample_count);
 
+/**
+ * @brief 在播放缓冲区中预留写入空间（零拷贝播放接口）
+ * 
+ * 解码器直接把 PCM 写进播放缓冲区，空间不足时阻塞到播放任务消费，
+ * 由真实的播放速度节流，无需上层估算延时。
+ * 
+ * @param ptr 输出：可写地址
+ * @param samples 需要的采样点数
+ * @param timeout_ms 等待空闲空间的超时时间（毫秒）
+ * @return 可写的连续采样点数（缓冲区末尾处可能小于 samples），超时返回 0
+ * @note 与 audio_manager_play_audio() 不能同时写入
+ */
+size_t audio_manager_playback_reserve(int16_t **ptr, size_t samples, uint32_t timeout_ms);
+
+/**
+ * @brief 提交预留空间中已写入的数据
+ * @param samples 实际写入的采样点数
+ * @return ESP_OK 成功，ESP_ERR_INVALID_STATE 预留后缓冲区被清空（打断）
+ */
+esp_err_t audio_manager_playback_commit(size_t samples);
+
 /**
  * @brief 获取播放缓冲区可用空间（样本数）
  * 
@@ -303,6 +368,21 @@ bool audio_manager_is_playing(void);
  */
 audio_mgr_state_t audio_manager_get_state(void);
 
+/**
+ * @brief 获取 AFE 动态档位统计（各档位时长、帧数、CPU 占用）
+ * @note CPU 占用依赖 CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+ * @param stats 输出统计
+ * @return ESP_OK 成功
+ */
+esp_err_t audio_manager_get_afe_stats(audio_mgr_afe_stats_t *stats);
+
+/**
+ * @brief 获取音频管线统计（缓冲深度、丢样、帧延迟）
+ * @param stats 输出统计
+ * @return ESP_OK 成功
+ */
+esp_err_t audio_manager_get_pipeline_stats(audio_mgr_pipeline_stats_t *stats);
+
 // ============ 录音数据回调（应用层实现） ============
 
 /**
@@ -0,0 +1,88 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-03
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-03
+ * @FilePath: \xn_esp32_audio\components\xn_audio_manager\include\audio_mem.h
+ * @Description: 音频管线内存池 - 启动时按放置表一次性分配全部管线缓冲区
+ */
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** 内存放置位置 */
+typedef enum {
+    AUDIO_MEM_PLACE_PSRAM = 0,      ///< 外部 PSRAM（大容量、访问不频繁）
+    AUDIO_MEM_PLACE_INTERNAL,       ///< 内部 RAM（小而热的缓冲区）
+    AUDIO_MEM_PLACE_DMA,            ///< 内部 DMA 可用 RAM
+    AUDIO_MEM_PLACE_MAX,
+} audio_mem_place_t;
+
+/** 管线缓冲区标识 */
+typedef enum {
+    AUDIO_MEM_PLAYBACK_RING = 0,    ///< 播放环形缓冲区
+    AUDIO_MEM_REFERENCE_RING,       ///< 回采环形缓冲区
+    AUDIO_MEM_PLAYBACK_FRAME,       ///< 播放任务帧缓冲
+    AUDIO_MEM_MIC_RAW,              ///< I2S 麦克风 32bit 原始数据缓冲
+    AUDIO_MEM_SPK_STEREO,           ///< I2S 扬声器立体声转换缓冲
+    AUDIO_MEM_PREROLL,              ///< AFE 预录缓冲
+    AUDIO_MEM_BUTTON_STACK,         ///< 按键任务栈
+    AUDIO_MEM_ID_MAX,
+} audio_mem_id_t;
+
+/** 放置表条目 */
+typedef struct {
+    const char *name;               ///< 名称（用于预算报告）
+    size_t size;                    ///< 大小（字节），0 表示不预留
+    audio_mem_place_t place;        ///< 放置位置
+} audio_mem_region_t;
+
+/**
+ * @brief 按放置表一次性分配内存池
+ * @note 每种放置位置只分配一块连续内存，再按条目切分（16 字节对齐）
+ * @param table 放置表，按 audio_mem_id_t 索引，共 AUDIO_MEM_ID_MAX 项
+ * @return ESP_OK 成功，ESP_ERR_NO_MEM 内存不足
+ */
+esp_err_t audio_mem_init(const audio_mem_region_t table[AUDIO_MEM_ID_MAX]);
+
+/**
+ * @brief 释放内存池
+ * @note 调用前须确保所有区块已归还
+ */
+void audio_mem_deinit(void);
+
+/**
+ * @brief 领取一个预留区块
+ * 
+ * 内存池未初始化、区块未预留或容量不足时回退到 heap_caps_malloc，
+ * 并打印警告，便于发现放置表遗漏。
+ * 
+ * @param id 区块标识
+ * @param size 需要的字节数
+ * @param fallback_caps 回退分配时使用的 heap caps
+ * @return 内存指针，失败返回 NULL
+ */
+void *audio_mem_take(audio_mem_id_t id, size_t size, uint32_t fallback_caps);
+
+/**
+ * @brief 归还区块（内存池内的区块仅标记空闲，回退分配的区块直接释放）
+ * @param id 区块标识
+ * @param ptr audio_mem_take 返回的指针，可为 NULL
+ */
+void audio_mem_release(audio_mem_id_t id, void *ptr);
+
+/**
+ * @brief 打印内存预算报告（各区块大小、位置、地址以及堆余量）
+ */
+void audio_mem_print_report(void);
+
+#ifdef __cplusplus
+}
+#endif
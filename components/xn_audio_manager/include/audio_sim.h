@@ -0,0 +1,64 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-02
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-02
+ * @FilePath: \xn_esp32_audio\components\xn_audio_manager\include\audio_sim.h
+ * @Description: 主机仿真接口（仅 linux 目标）- WAV 文件 BSP、脚本按键、桩 AFE
+ */
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** 仿真 IO 配置 */
+typedef struct {
+    const char *mic_wav_path;       ///< 麦克风输入 WAV（16bit PCM，单声道，采样率与 mic 配置一致）
+    const char *speaker_wav_path;   ///< 扬声器输出 WAV（NULL 表示丢弃）
+    int speed;                      ///< 倍速：1 为实时，N 为 N 倍速，0 为尽快运行（每帧仅让出 1 tick）
+    bool loop;                      ///< 输入读完后是否从头循环
+    int16_t vad_threshold;          ///< 桩 AFE 能量 VAD 门限（帧平均绝对幅度）
+} audio_sim_io_config_t;
+
+#define AUDIO_SIM_DEFAULT_IO_CONFIG()                                \
+    (audio_sim_io_config_t){                                         \
+        .mic_wav_path = NULL,                                        \
+        .speaker_wav_path = NULL,                                    \
+        .speed = 1,                                                  \
+        .loop = false,                                               \
+        .vad_threshold = 500,                                        \
+    }
+
+/**
+ * @brief 设置仿真 IO（须在 audio_manager_init 之前调用）
+ * @param config IO 配置
+ * @return ESP_OK 成功
+ */
+esp_err_t audio_sim_set_io(const audio_sim_io_config_t *config);
+
+/**
+ * @brief 麦克风输入是否已读完（非循环模式）
+ * @return true 已读完
+ */
+bool audio_sim_mic_finished(void);
+
+/**
+ * @brief 获取已写入扬声器 WAV 的采样点数
+ * @return 采样点数
+ */
+uint64_t audio_sim_speaker_samples(void);
+
+/**
+ * @brief 设置仿真按键电平（模拟按下/松开，经过与真机相同的防抖流程）
+ * @param pressed true 按下
+ */
+void audio_sim_button_set(bool pressed);
+
+#ifdef __cplusplus
+}
+#endif
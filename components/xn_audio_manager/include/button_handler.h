@@ -11,7 +11,11 @@
 #pragma once
 
 #include "esp_err.h"
+#include "sdkconfig.h"
+#include "xn_task_sched.h"
+#if !CONFIG_IDF_TARGET_LINUX
 #include "driver/gpio.h"
+#endif
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -38,6 +42,7 @@ typedef struct {
     uint32_t debounce_ms;               ///< 防抖时间（毫秒）
     button_event_callback_t callback;   ///< 事件回调
     void *user_ctx;                     ///< 用户上下文
+    const xn_task_sched_t *task_sched;  ///< 按键任务调度参数（NULL 使用均衡预设）
 } button_handler_config_t;
 
 /**
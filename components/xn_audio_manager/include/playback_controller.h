@@ -13,6 +13,7 @@
 #include "esp_err.h"
 #include "ring_buffer.h"
 #include "audio_bsp.h"
+#include "xn_task_sched.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -35,6 +36,7 @@ typedef struct {
     playback_reference_callback_t reference_callback; ///< 回采数据回调（可选，用于AFE）
     void *reference_ctx;                             ///< 回采回调上下文
     uint8_t *volume_ptr;                             ///< 音量指针（外部管理）
+    const xn_task_sched_t *task_sched;               ///< 播放任务调度参数（NULL 使用均衡预设）
 } playback_controller_config_t;
 
 /**
@@ -74,6 +76,25 @@ esp_err_t playback_controller_stop(playback_controller_handle_t controller);
 esp_err_t playback_controller_write(playback_controller_handle_t controller, 
                                      const int16_t *pcm_data, size_t sample_count);
 
+/**
+ * @brief 在播放缓冲区中预留写入空间（解码器直接写入，按播放速度阻塞）
+ * @param controller 播放控制器句柄
+ * @param ptr 输出：可写地址
+ * @param samples 需要的采样点数
+ * @param timeout_ms 等待空闲空间的超时时间（毫秒）
+ * @return 可写的连续采样点数，超时返回 0
+ */
+size_t playback_controller_reserve(playback_controller_handle_t controller, int16_t **ptr,
+                                   size_t samples, uint32_t timeout_ms);
+
+/**
+ * @brief 提交预留空间中已写入的数据
+ * @param controller 播放控制器句柄
+ * @param samples 实际写入的采样点数
+ * @return ESP_OK 成功，ESP_ERR_INVALID_STATE 预留后缓冲区被清空
+ */
+esp_err_t playback_controller_commit(playback_controller_handle_t controller, size_t samples);
+
 /**
  * @brief 清空播放缓冲区
  * @param controller 播放控制器句柄
@@ -95,6 +116,24 @@ bool playback_controller_is_running(playback_controller_handle_t controller);
  */
 size_t playback_controller_get_free_space(playback_controller_handle_t controller);
 
+/**
+ * @brief 获取播放缓冲区中待播放的数据量（样本数）
+ * @param controller 播放控制器句柄
+ * @return 待播放样本数
+ */
+size_t playback_controller_get_buffered_samples(playback_controller_handle_t controller);
+
+/**
+ * @brief 获取播放/回采缓冲区运行统计
+ * @param controller 播放控制器句柄
+ * @param playback 输出播放缓冲区统计（可为 NULL）
+ * @param reference 输出回采缓冲区统计（可为 NULL）
+ * @return ESP_OK 成功
+ */
+esp_err_t playback_controller_get_stats(playback_controller_handle_t controller,
+                                        ring_buffer_stats_t *playback,
+                                        ring_buffer_stats_t *reference);
+
 /**
  * @brief 获取回采缓冲区（用于 AFE 读取）
  * @param controller 播放控制器句柄
@@ -23,6 +23,15 @@ extern "C" {
 /** 环形缓冲区句柄 */
 typedef struct ring_buffer_s *ring_buffer_handle_t;
 
+/** 环形缓冲区运行统计 */
+typedef struct {
+    size_t size;                ///< 容量（采样点数）
+    size_t available;           ///< 当前数据量
+    size_t peak;                ///< 历史峰值数据量
+    uint64_t written;           ///< 累计写入采样点数
+    uint64_t dropped;           ///< 溢出覆盖或加锁超时丢弃的采样点数
+} ring_buffer_stats_t;
+
 /**
  * @brief 创建环形缓冲区
  * @param samples 缓冲区容量（采样点数）
@@ -31,6 +40,16 @@ typedef struct ring_buffer_s *ring_buffer_handle_t;
  */
 ring_buffer_handle_t ring_buffer_create(size_t samples, bool with_sem);
 
+/**
+ * @brief 使用外部存储创建环形缓冲区
+ * @param samples 缓冲区容量（采样点数）
+ * @param with_sem 是否使用信号量（用于阻塞读取）
+ * @param storage 外部存储（至少 samples 个采样点），NULL 时内部分配
+ * @return 环形缓冲区句柄，失败返回NULL
+ * @note 外部存储在销毁时不释放，由调用方负责
+ */
+ring_buffer_handle_t ring_buffer_create_with_storage(size_t samples, bool with_sem, int16_t *storage);
+
 /**
  * @brief 销毁环形缓冲区
  * @param rb 环形缓冲区句柄
@@ -47,6 +66,31 @@ void ring_buffer_destroy(ring_buffer_handle_t rb);
  */
 size_t ring_buffer_write(ring_buffer_handle_t rb, const int16_t *data, size_t samples);
 
+/**
+ * @brief 预留写入空间，由调用方直接写入数据（零拷贝写入）
+ * 
+ * 等待缓冲区至少有 samples 个空闲采样点（读端消费后唤醒，不覆盖旧数据），
+ * 返回写位置起的连续空间；到达缓冲区末尾时连续空间可能小于 samples，
+ * 调用方提交后再次预留剩余部分即可。
+ * 
+ * @param rb 环形缓冲区句柄（须以 with_sem 创建）
+ * @param ptr 输出：可写地址
+ * @param samples 需要的采样点数
+ * @param timeout_ms 等待空闲空间的超时时间（毫秒），0表示不阻塞
+ * @return 可写的连续采样点数，超时或参数无效返回 0
+ * @note 仅支持单写者，预留期间不要调用 ring_buffer_write()
+ */
+size_t ring_buffer_reserve(ring_buffer_handle_t rb, int16_t **ptr, size_t samples, uint32_t timeout_ms);
+
+/**
+ * @brief 提交预留空间中已写入的数据
+ * 
+ * @param rb 环形缓冲区句柄
+ * @param samples 实际写入的采样点数（不超过预留返回值）
+ * @return ESP_OK 成功，ESP_ERR_INVALID_STATE 预留后缓冲区被清空（数据已丢弃）
+ */
+esp_err_t ring_buffer_commit(ring_buffer_handle_t rb, size_t samples);
+
 /**
  * @brief 从环形缓冲区读取数据
  * @param rb 环形缓冲区句柄
@@ -78,6 +122,14 @@ esp_err_t ring_buffer_clear(ring_buffer_handle_t rb);
  */
 size_t ring_buffer_get_size(ring_buffer_handle_t rb);
 
+/**
+ * @brief 获取环形缓冲区运行统计
+ * @param rb 环形缓冲区句柄
+ * @param stats 输出统计
+ * @return ESP_OK 成功
+ */
+esp_err_t ring_buffer_get_stats(ring_buffer_handle_t rb, ring_buffer_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,17 +9,25 @@
  * Copyright (c) 2025 by ${git_name_email}, All Rights Reserved. 
  */
 #include "afe_wrapper.h"
+#include "audio_mem.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_gmf_afe_manager.h"
 #include "esp_afe_sr_models.h"
 #include "esp_afe_sr_iface.h"
 #include "esp_afe_config.h"
 #include "model_path.h"
+#include "esp_heap_caps.h"
 #include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "AFE_WRAPPER";
 
+#define AFE_SAMPLE_RATE          16000   ///< AFE 输出采样率
+#define AFE_PREROLL_CHUNK        512     ///< 预录补发时每次回调的最大样本数
+
 /**
  * @brief AFE 包装器上下文结构体
  * 
@@ -41,12 +49,91 @@ typedef struct afe_wrapper_s {
     
     bool *running_ptr;                          ///< 指向运行状态标志的指针
     bool *recording_ptr;                        ///< 指向录音状态标志的指针
+
+    // 动态档位
+    afe_feature_config_t feature_config;        ///< 功能配置（决定对话档位可启用的模块）
+    volatile afe_profile_t active_profile;      ///< 当前生效档位（仅 Feed 任务修改）
+    volatile afe_profile_t pending_profile;     ///< 目标档位（帧边界生效）
+    int64_t profile_enter_us;                   ///< 进入当前档位的时间戳
+    uint32_t switch_count;                      ///< 档位切换次数
+    uint32_t feed_runtime_last;                 ///< Feed 任务上次运行时间计数
+    uint32_t fetch_runtime_last;                ///< Fetch 任务上次运行时间计数
+    afe_profile_stats_t profile_stats[AFE_PROFILE_MAX]; ///< 各档位统计
+
+    // 管线计数
+    uint64_t mic_samples;                       ///< 送入 AFE 的麦克风采样点数（Feed 任务）
+    uint64_t out_samples;                       ///< AFE 输出采样点数（Fetch 任务）
+    uint64_t record_samples;                    ///< 交给录音回调的采样点数（Fetch 任务）
+
+    // 预录（仅 Fetch 任务访问，无需加锁）
+    int16_t *preroll_buf;                       ///< 预录环形缓冲区（内存池区块）
+    size_t preroll_size;                        ///< 预录容量（采样点数）
+    size_t preroll_pos;                         ///< 下一次写入位置
+    size_t preroll_fill;                        ///< 已缓存采样点数
+    bool was_recording;                         ///< 上一帧是否处于录音状态
     
     // 静态缓冲区（避免频繁 malloc）
     int16_t mic_buffer[512];                    ///< 麦克风数据缓冲区
     int16_t ref_buffer[512];                    ///< 回采数据缓冲区
 } afe_wrapper_t;
 
+/**
+ * @brief 累计当前任务自上次调用以来消耗的 CPU 时间
+ *
+ * 在 Feed/Fetch 回调入口调用，两次调用之间的运行时间即该任务处理上一帧的开销，
+ * 阻塞等待不计入。
+ *
+ * @param last 上次运行时间计数
+ * @return 本次增量（微秒），未启用运行时统计时返回 0
+ */
+static uint32_t afe_task_runtime_delta(uint32_t *last)
+{
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    uint32_t now = (uint32_t)ulTaskGetRunTimeCounter(xTaskGetCurrentTaskHandle());
+    uint32_t delta = (*last != 0) ? (now - *last) : 0;
+    *last = now;
+    return delta;
+#else
+    (void)last;
+    return 0;
+#endif
+}
+
+/**
+ * @brief 在帧边界应用待切换的档位
+ *
+ * 由 Feed 任务在读取下一帧之前调用，通过 AFE Manager 开关 AEC/NS/AGC，
+ * 只操作初始化时已创建的模块，不重建 AFE。
+ *
+ * @param wrapper AFE 包装器
+ */
+static void afe_apply_pending_profile(afe_wrapper_t *wrapper)
+{
+    afe_profile_t target = wrapper->pending_profile;
+    if (target == wrapper->active_profile) {
+        return;
+    }
+
+    bool full = (target == AFE_PROFILE_CONVERSATION);
+    if (wrapper->feature_config.aec_enabled) {
+        esp_gmf_afe_manager_enable_features(wrapper->afe_manager, ESP_AFE_FEATURE_AEC, full);
+    }
+    if (wrapper->feature_config.ns_enabled) {
+        esp_gmf_afe_manager_enable_features(wrapper->afe_manager, ESP_AFE_FEATURE_NS, full);
+    }
+    if (wrapper->feature_config.agc_enabled) {
+        esp_gmf_afe_manager_enable_features(wrapper->afe_manager, ESP_AFE_FEATURE_AGC, full);
+    }
+
+    int64_t now = esp_timer_get_time();
+    wrapper->profile_stats[wrapper->active_profile].active_us += now - wrapper->profile_enter_us;
+    wrapper->profile_enter_us = now;
+    wrapper->active_profile = target;
+    wrapper->switch_count++;
+
+    ESP_LOGI(TAG, "🎚️ AFE 档位切换: %s", full ? "对话(AEC+NS+AGC)" : "空闲(唤醒+VAD)");
+}
+
 /**
  * @brief AFE 读取回调函数
  * 
@@ -64,6 +151,13 @@ static int32_t afe_read_callback(void *buffer, int buf_sz, void *user_ctx, TickT
     afe_wrapper_t *wrapper = (afe_wrapper_t *)user_ctx;
     if (!buffer || buf_sz == 0 || !wrapper) return 0;
 
+    // 上一帧的 Feed 开销计入当前档位，随后在帧边界切换档位
+    uint32_t feed_cpu = afe_task_runtime_delta(&wrapper->feed_runtime_last);
+    wrapper->profile_stats[wrapper->active_profile].feed_cpu_us += feed_cpu;
+    if (wrapper->feature_config.dynamic_profile) {
+        afe_apply_pending_profile(wrapper);
+    }
+
     int16_t *out_buf = (int16_t *)buffer;
     const size_t total_samples = buf_sz / sizeof(int16_t);
     const size_t channels = 2;  // MR: 麦克风+回采
@@ -97,6 +191,8 @@ static int32_t afe_read_callback(void *buffer, int buf_sz, void *user_ctx, TickT
             memset(wrapper->ref_buffer + ref_got, 0, (mic_got - ref_got) * sizeof(int16_t));
         }
 
+        wrapper->mic_samples += mic_got;
+
         // 交织数据: MR 格式（M=麦克风，R=回采）
         for (size_t i = 0; i < mic_got; i++) {
             out_buf[i * 2 + 0] = wrapper->mic_buffer[i];  // M: 麦克风
@@ -111,6 +207,66 @@ static int32_t afe_read_callback(void *buffer, int buf_sz, void *user_ctx, TickT
     return mic_got * channels * sizeof(int16_t);
 }
 
+/**
+ * @brief 缓存一帧 AFE 输出到预录环
+ * 
+ * 满时覆盖最旧数据，始终保留最近 preroll_size 个采样点。
+ * 
+ * @param wrapper AFE 包装器
+ * @param data AFE 输出数据
+ * @param samples 采样点数
+ */
+static void afe_preroll_push(afe_wrapper_t *wrapper, const int16_t *data, size_t samples)
+{
+    if (samples >= wrapper->preroll_size) {
+        data += samples - wrapper->preroll_size;
+        samples = wrapper->preroll_size;
+    }
+
+    size_t first = wrapper->preroll_size - wrapper->preroll_pos;
+    if (first > samples) {
+        first = samples;
+    }
+    memcpy(wrapper->preroll_buf + wrapper->preroll_pos, data, first * sizeof(int16_t));
+    memcpy(wrapper->preroll_buf, data + first, (samples - first) * sizeof(int16_t));
+
+    wrapper->preroll_pos = (wrapper->preroll_pos + samples) % wrapper->preroll_size;
+    wrapper->preroll_fill += samples;
+    if (wrapper->preroll_fill > wrapper->preroll_size) {
+        wrapper->preroll_fill = wrapper->preroll_size;
+    }
+}
+
+/**
+ * @brief 按时间顺序把预录内容补发给录音回调并清空
+ * 
+ * 在录音开始后的第一帧之前调用，保证补发数据与后续实时数据首尾相接。
+ * 
+ * @param wrapper AFE 包装器
+ */
+static void afe_preroll_flush(afe_wrapper_t *wrapper)
+{
+    size_t remain = wrapper->preroll_fill;
+    size_t pos = (wrapper->preroll_pos + wrapper->preroll_size - remain) % wrapper->preroll_size;
+
+    if (remain > 0) {
+        ESP_LOGD(TAG, "补发预录音频 %d ms", (int)(remain * 1000 / AFE_SAMPLE_RATE));
+    }
+
+    while (remain > 0) {
+        size_t chunk = wrapper->preroll_size - pos;
+        if (chunk > remain) chunk = remain;
+        if (chunk > AFE_PREROLL_CHUNK) chunk = AFE_PREROLL_CHUNK;
+
+        wrapper->record_callback(wrapper->preroll_buf + pos, chunk, wrapper->record_ctx);
+        wrapper->record_samples += chunk;
+        pos = (pos + chunk) % wrapper->preroll_size;
+        remain -= chunk;
+    }
+
+    wrapper->preroll_fill = 0;
+}
+
 /**
  * @brief AFE 结果回调函数
  * 
@@ -124,6 +280,10 @@ static void afe_result_callback(afe_fetch_result_t *result, void *user_ctx)
     afe_wrapper_t *wrapper = (afe_wrapper_t *)user_ctx;
     if (!result || !wrapper || !wrapper->event_callback) return;
 
+    afe_profile_stats_t *stats = &wrapper->profile_stats[wrapper->active_profile];
+    stats->fetch_cpu_us += afe_task_runtime_delta(&wrapper->fetch_runtime_last);
+    stats->frames++;
+
     afe_event_t event = {0};
 
     // 处理唤醒词检测事件
@@ -154,11 +314,22 @@ static void afe_result_callback(afe_fetch_result_t *result, void *user_ctx)
     }
 
     // 处理录音数据回调
-    if (wrapper->recording_ptr && *wrapper->recording_ptr && 
-        result->data && result->data_size > 0 && wrapper->record_callback) {
+    bool recording = wrapper->recording_ptr && *wrapper->recording_ptr;
+    if (result->data && result->data_size > 0 && wrapper->record_callback) {
         size_t samples = result->data_size / sizeof(int16_t);
-        wrapper->record_callback((const int16_t *)result->data, samples, wrapper->record_ctx);
+        wrapper->out_samples += samples;
+        if (recording) {
+            // 录音刚开始：先补发预录，找回 VAD 事件往返期间的语音起始
+            if (!wrapper->was_recording && wrapper->preroll_buf) {
+                afe_preroll_flush(wrapper);
+            }
+            wrapper->record_callback((const int16_t *)result->data, samples, wrapper->record_ctx);
+            wrapper->record_samples += samples;
+        } else if (wrapper->preroll_buf) {
+            afe_preroll_push(wrapper, (const int16_t *)result->data, samples);
+        }
     }
+    wrapper->was_recording = recording;
 }
 
 /**
@@ -193,6 +364,27 @@ afe_wrapper_handle_t afe_wrapper_create(const afe_wrapper_config_t *config)
     wrapper->record_ctx = config->record_ctx;
     wrapper->running_ptr = config->running_ptr;
     wrapper->recording_ptr = config->recording_ptr;
+    wrapper->feature_config = config->feature_config;
+
+    // 初始化时按完整功能创建 AFE，动态档位下首帧即切到空闲档位
+    wrapper->active_profile = AFE_PROFILE_CONVERSATION;
+    wrapper->pending_profile = config->feature_config.dynamic_profile ? AFE_PROFILE_IDLE
+                                                                       : AFE_PROFILE_CONVERSATION;
+    wrapper->profile_enter_us = esp_timer_get_time();
+
+    // 分配预录缓冲区
+    if (config->vad_config.preroll_ms > 0) {
+        wrapper->preroll_size = (size_t)config->vad_config.preroll_ms * AFE_SAMPLE_RATE / 1000;
+        wrapper->preroll_buf = (int16_t *)audio_mem_take(AUDIO_MEM_PREROLL,
+                                                         wrapper->preroll_size * sizeof(int16_t),
+                                                         MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!wrapper->preroll_buf) {
+            ESP_LOGE(TAG, "预录缓冲区分配失败");
+            free(wrapper);
+            return NULL;
+        }
+        ESP_LOGI(TAG, "预录缓冲: %d ms", config->vad_config.preroll_ms);
+    }
 
     // 加载唤醒词模型
     if (config->wakeup_config.enabled) {
@@ -200,6 +392,7 @@ afe_wrapper_handle_t afe_wrapper_create(const afe_wrapper_config_t *config)
         wrapper->models = esp_srmodel_init(config->wakeup_config.model_partition);
         if (!wrapper->models) {
             ESP_LOGE(TAG, "模型加载失败");
+            audio_mem_release(AUDIO_MEM_PREROLL, wrapper->preroll_buf);
             free(wrapper);
             return NULL;
         }
@@ -213,6 +406,7 @@ afe_wrapper_handle_t afe_wrapper_create(const afe_wrapper_config_t *config)
     if (!afe_config) {
         ESP_LOGE(TAG, "AFE 配置失败");
         if (wrapper->models) esp_srmodel_deinit(wrapper->models);
+        audio_mem_release(AUDIO_MEM_PREROLL, wrapper->preroll_buf);
         free(wrapper);
         return NULL;
     }
@@ -226,8 +420,10 @@ afe_wrapper_handle_t afe_wrapper_create(const afe_wrapper_config_t *config)
     afe_config->vad_min_noise_ms = config->vad_config.min_silence_ms;   // 最小静音时长
     afe_config->wakenet_init = config->wakeup_config.enabled;      // 唤醒词检测
     afe_config->wakenet_mode = config->wakeup_config.sensitivity;   // 唤醒词灵敏度
-    afe_config->afe_perferred_core = 0;                             // 优先运行在核心 0
-    afe_config->afe_perferred_priority = 8;                         // 任务优先级
+    const xn_task_sched_t *feed_sched = xn_sched_get(config->sched_profile, XN_TASK_AFE_FEED);
+    const xn_task_sched_t *fetch_sched = xn_sched_get(config->sched_profile, XN_TASK_AFE_FETCH);
+    afe_config->afe_perferred_core = fetch_sched->core == XN_TASK_CORE_ANY ? 0 : fetch_sched->core;
+    afe_config->afe_perferred_priority = fetch_sched->priority;     // 任务优先级
     afe_config->memory_alloc_mode = AFE_MEMORY_ALLOC_MORE_PSRAM;    // 优先使用 PSRAM
     afe_config->agc_init = config->feature_config.agc_enabled;     // 自动增益控制
     afe_config->ns_init = config->feature_config.ns_enabled;       // 噪声抑制
@@ -242,15 +438,16 @@ afe_wrapper_handle_t afe_wrapper_create(const afe_wrapper_config_t *config)
         .afe_cfg = afe_config,
         .read_cb = afe_read_callback,              // 数据读取回调
         .read_ctx = wrapper,                       // 读取回调上下文
+        // Feed/Fetch 任务参数来自调度档案（栈由 AFE Manager 内部分配，档案中的栈位置不生效）
         .feed_task_setting = {
-            .stack_size = 10 * 1024,               // Feed 任务栈大小（缩减以降低内部RAM占用）
-            .prio = 8,                             // Feed 任务优先级
-            .core = 1,                             // Feed 任务运行核心（保持在 CPU1）
+            .stack_size = (int)feed_sched->stack_size,
+            .prio = feed_sched->priority,
+            .core = feed_sched->core,
         },
         .fetch_task_setting = {
-            .stack_size = 10 * 1024,                // Fetch 任务栈大小（缩减占用）
-            .prio = 8,                             // Fetch 任务优先级（与Feed相同，时间片轮转）
-            .core = 0,                             // Fetch 任务运行在 CPU0，与 Feed 分核
+            .stack_size = (int)fetch_sched->stack_size,
+            .prio = fetch_sched->priority,
+            .core = fetch_sched->core,
         },
     };
 
@@ -260,6 +457,7 @@ afe_wrapper_handle_t afe_wrapper_create(const afe_wrapper_config_t *config)
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "AFE Manager 创建失败");
         if (wrapper->models) esp_srmodel_deinit(wrapper->models);
+        audio_mem_release(AUDIO_MEM_PREROLL, wrapper->preroll_buf);
         free(wrapper);
         return NULL;
     }
@@ -292,6 +490,9 @@ void afe_wrapper_destroy(afe_wrapper_handle_t wrapper)
         esp_srmodel_deinit(wrapper->models);
     }
 
+    // 归还预录缓冲区
+    audio_mem_release(AUDIO_MEM_PREROLL, wrapper->preroll_buf);
+
     // 释放包装器内存
     free(wrapper);
     ESP_LOGI(TAG, "AFE 包装器已销毁");
@@ -335,3 +536,59 @@ esp_err_t afe_wrapper_get_wakeup_config(afe_wrapper_handle_t wrapper,
     return ESP_OK;
 }
 
+/**
+ * @brief 请求切换 AFE 处理档位
+ * 
+ * @param wrapper AFE 包装器句柄
+ * @param profile 目标档位
+ * @return esp_err_t ESP_OK 成功，ESP_ERR_INVALID_ARG 参数无效，ESP_ERR_NOT_SUPPORTED 未启用动态档位
+ */
+esp_err_t afe_wrapper_set_profile(afe_wrapper_handle_t wrapper, afe_profile_t profile)
+{
+    if (!wrapper || profile >= AFE_PROFILE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!wrapper->feature_config.dynamic_profile) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    wrapper->pending_profile = profile;
+    return ESP_OK;
+}
+
+/**
+ * @brief 获取当前生效的 AFE 处理档位
+ * 
+ * @param wrapper AFE 包装器句柄
+ * @return afe_profile_t 当前档位，参数无效返回 AFE_PROFILE_CONVERSATION
+ */
+afe_profile_t afe_wrapper_get_profile(afe_wrapper_handle_t wrapper)
+{
+    return wrapper ? wrapper->active_profile : AFE_PROFILE_CONVERSATION;
+}
+
+/**
+ * @brief 获取各档位运行统计
+ * 
+ * @param wrapper AFE 包装器句柄
+ * @param stats 用于返回统计的缓冲区
+ * @return esp_err_t ESP_OK 成功，ESP_ERR_INVALID_ARG 参数无效
+ */
+esp_err_t afe_wrapper_get_stats(afe_wrapper_handle_t wrapper, afe_wrapper_stats_t *stats)
+{
+    if (!wrapper || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    afe_profile_t current = wrapper->active_profile;
+    stats->current = current;
+    stats->switch_count = wrapper->switch_count;
+    memcpy(stats->profile, wrapper->profile_stats, sizeof(stats->profile));
+    stats->mic_samples = wrapper->mic_samples;
+    stats->out_samples = wrapper->out_samples;
+    stats->record_samples = wrapper->record_samples;
+
+    // 当前档位的停留时长实时补齐
+    stats->profile[current].active_us += esp_timer_get_time() - wrapper->profile_enter_us;
+    return ESP_OK;
+}
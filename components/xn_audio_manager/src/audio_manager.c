@@ -13,7 +13,9 @@
 #include "playback_controller.h"
 #include "button_handler.h"
 #include "afe_wrapper.h"
+#include "audio_mem.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -34,6 +36,7 @@ typedef enum {
 
 typedef struct {
     audio_mgr_internal_event_t type;
+    int64_t timestamp_us;
     union {
         struct {
             int   wake_word_index;
@@ -75,6 +78,7 @@ typedef struct {
     audio_mgr_state_t state;                ///< 状态机
     bool wake_active;                       ///< 是否处于唤醒窗口
     TickType_t wake_deadline_tick;          ///< 唤醒超时tick
+    TickType_t afe_full_until_tick;         ///< 完整 AFE 档位保持截止tick
     
     // 回调
     audio_record_callback_t record_callback; ///< 录音数据回调函数
@@ -82,10 +86,59 @@ typedef struct {
 
     // 调度
     QueueHandle_t event_queue;
-    TaskHandle_t manager_task;
+    xn_task_t manager_task;
 
 } audio_manager_ctx_t;
 
+/**
+ * @brief 管线内存放置表
+ * 
+ * 容量大、按块顺序访问的缓冲放 PSRAM；每帧都要访问的小缓冲放内部 RAM。
+ * 各区块大小在初始化时按配置计算，调整放置只需修改此表。
+ */
+static const audio_mem_place_t s_mem_placement[AUDIO_MEM_ID_MAX] = {
+    [AUDIO_MEM_PLAYBACK_RING]  = AUDIO_MEM_PLACE_PSRAM,     ///< 512KB，仅播放任务与写入方访问
+    [AUDIO_MEM_REFERENCE_RING] = AUDIO_MEM_PLACE_INTERNAL,  ///< 16KB，每帧被 AFE Feed 读取
+    [AUDIO_MEM_PLAYBACK_FRAME] = AUDIO_MEM_PLACE_INTERNAL,  ///< 播放任务帧缓冲
+    [AUDIO_MEM_MIC_RAW]        = AUDIO_MEM_PLACE_INTERNAL,  ///< I2S 读出的 32bit 原始数据
+    [AUDIO_MEM_SPK_STEREO]     = AUDIO_MEM_PLACE_INTERNAL,  ///< I2S 写入前的立体声转换
+    [AUDIO_MEM_PREROLL]        = AUDIO_MEM_PLACE_PSRAM,     ///< 预录环，每帧仅一次顺序写
+    [AUDIO_MEM_BUTTON_STACK]   = AUDIO_MEM_PLACE_PSRAM,     ///< 按键任务栈，实际位置跟随调度档案
+};
+
+/**
+ * @brief 按配置计算各区块大小并初始化内存池
+ * 
+ * @param config 音频管理器配置
+ * @return ESP_OK 成功
+ */
+static esp_err_t audio_manager_mem_init(const audio_mgr_config_t *config)
+{
+    size_t mic_frame = config->hw_config.mic.max_frame_samples ? config->hw_config.mic.max_frame_samples : 512;
+    size_t spk_frame = config->hw_config.speaker.max_frame_samples ? config->hw_config.speaker.max_frame_samples : 1024;
+    const xn_task_sched_t *button = xn_sched_get(config->sched_profile, XN_TASK_BUTTON);
+    size_t preroll = config->vad_config.preroll_ms > 0
+                     ? (size_t)config->vad_config.preroll_ms * 16000 / 1000 * sizeof(int16_t) : 0;
+
+    audio_mem_region_t table[AUDIO_MEM_ID_MAX] = {
+        [AUDIO_MEM_PLAYBACK_RING]  = { "playback_ring",  AUDIO_MANAGER_PLAYBACK_BUFFER_BYTES },
+        [AUDIO_MEM_REFERENCE_RING] = { "reference_ring", AUDIO_MANAGER_REFERENCE_BUFFER_BYTES },
+        [AUDIO_MEM_PLAYBACK_FRAME] = { "playback_frame", AUDIO_MANAGER_PLAYBACK_FRAME_SAMPLES * sizeof(int16_t) },
+        [AUDIO_MEM_MIC_RAW]        = { "mic_raw",        mic_frame * sizeof(int32_t) },
+        [AUDIO_MEM_SPK_STEREO]     = { "spk_stereo",     spk_frame * 2 * sizeof(int16_t) },
+        [AUDIO_MEM_PREROLL]        = { "preroll",        preroll },
+        [AUDIO_MEM_BUTTON_STACK]   = { "button_stack",   button->stack_size },
+    };
+    for (int i = 0; i < AUDIO_MEM_ID_MAX; i++) {
+        table[i].place = s_mem_placement[i];
+    }
+    // 按键任务栈的位置跟随调度档案
+    table[AUDIO_MEM_BUTTON_STACK].place = (button->stack == XN_TASK_STACK_INTERNAL)
+                                          ? AUDIO_MEM_PLACE_INTERNAL : AUDIO_MEM_PLACE_PSRAM;
+
+    return audio_mem_init(table);
+}
+
 /**
  * @brief 音频管理器全局上下文实例
  * 使用静态变量存储，确保全局唯一性
@@ -101,6 +154,7 @@ static void audio_manager_task(void *arg);
 static void audio_manager_tick(void);
 static void audio_manager_arm_wake_timer(int duration_ms);
 static void audio_manager_clear_wake_timer(void);
+static void audio_manager_update_afe_profile(void);
 
 static void audio_manager_set_state(audio_mgr_state_t new_state)
 {
@@ -183,6 +237,30 @@ static void audio_manager_tick(void)
     }
 }
 
+/**
+ * @brief 根据会话活动选择 AFE 档位
+ * 
+ * 录音、唤醒窗口内或播放缓冲区有待播数据时使用完整档位（AEC/NS/AGC），
+ * 活动结束后保持 AUDIO_MANAGER_AFE_PROFILE_HOLD_MS 再回落到空闲档位。
+ * 仅在状态机任务中调用。
+ */
+static void audio_manager_update_afe_profile(void)
+{
+    if (!s_ctx.afe_wrapper || !s_ctx.config.afe_config.dynamic_profile) {
+        return;
+    }
+
+    TickType_t now = xTaskGetTickCount();
+    bool active = s_ctx.recording || s_ctx.wake_active ||
+                  playback_controller_get_buffered_samples(s_ctx.playback_ctrl) > 0;
+    if (active) {
+        s_ctx.afe_full_until_tick = now + pdMS_TO_TICKS(AUDIO_MANAGER_AFE_PROFILE_HOLD_MS);
+    }
+
+    bool full = active || (int32_t)(s_ctx.afe_full_until_tick - now) > 0;
+    afe_wrapper_set_profile(s_ctx.afe_wrapper, full ? AFE_PROFILE_CONVERSATION : AFE_PROFILE_IDLE);
+}
+
 // ============ 内部回调函数 ============
 
 /**
@@ -219,6 +297,7 @@ static void afe_event_handler(const afe_event_t *event, void *user_ctx)
     }
 
     audio_mgr_internal_msg_t msg = {0};
+    msg.timestamp_us = esp_timer_get_time();
 
     switch (event->type) {
         case AFE_EVENT_WAKEUP_DETECTED:
@@ -265,6 +344,7 @@ static void audio_manager_handle_internal_event(const audio_mgr_internal_msg_t *
     }
 
     audio_mgr_event_t evt = {0};
+    evt.timestamp_us = msg->timestamp_us;
 
     switch (msg->type) {
     case AUDIO_INT_EVT_START_LISTEN:
@@ -345,6 +425,7 @@ static void audio_manager_task(void *arg)
             audio_manager_handle_internal_event(&msg);
         }
         audio_manager_tick();
+        audio_manager_update_afe_profile();
     }
 }
 
@@ -385,6 +466,13 @@ esp_err_t audio_manager_init(const audio_mgr_config_t *config)
     s_ctx.volume = AUDIO_MANAGER_DEFAULT_VOLUME;
     s_ctx.state = AUDIO_MGR_STATE_DISABLED;
 
+    // 启动时一次性分配全部管线缓冲区，稳态运行不再有堆操作
+    ret = audio_manager_mem_init(&s_ctx.config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "音频内存池初始化失败");
+        return ret;
+    }
+
     audio_bsp_hw_config_t bsp_cfg = {
         .mic = s_ctx.config.hw_config.mic,
         .speaker = s_ctx.config.hw_config.speaker,
@@ -405,6 +493,7 @@ esp_err_t audio_manager_init(const audio_mgr_config_t *config)
         .reference_callback = NULL,
         .reference_ctx = NULL,
         .volume_ptr = &s_ctx.volume,
+        .task_sched = xn_sched_get(s_ctx.config.sched_profile, XN_TASK_PLAYBACK),
     };
 
     s_ctx.playback_ctrl = playback_controller_create(&playback_cfg);
@@ -423,15 +512,10 @@ esp_err_t audio_manager_init(const audio_mgr_config_t *config)
         goto fail;
     }
 
-    if (xTaskCreatePinnedToCore(audio_manager_task,
-                                "audio_mgr",
-                                AUDIO_MANAGER_TASK_STACK_SIZE,
-                                NULL,
-                                AUDIO_MANAGER_TASK_PRIORITY,
-                                &s_ctx.manager_task,
-                                0) != pdPASS) {
+    ret = xn_task_create(&s_ctx.manager_task, xn_sched_get(s_ctx.config.sched_profile, XN_TASK_AUDIO_MGR),
+                         audio_manager_task, "audio_mgr", NULL);
+    if (ret != ESP_OK) {
         ESP_LOGE(TAG, "状态机任务创建失败");
-        ret = ESP_ERR_NO_MEM;
         goto fail;
     }
 
@@ -449,12 +533,14 @@ esp_err_t audio_manager_init(const audio_mgr_config_t *config)
             .vad_mode = s_ctx.config.vad_config.vad_mode,
             .min_speech_ms = s_ctx.config.vad_config.min_speech_ms,
             .min_silence_ms = s_ctx.config.vad_config.min_silence_ms,
+            .preroll_ms = s_ctx.config.vad_config.preroll_ms,
         },
         .feature_config = (afe_feature_config_t){
             .aec_enabled = s_ctx.config.afe_config.aec_enabled,
             .ns_enabled = s_ctx.config.afe_config.ns_enabled,
             .agc_enabled = s_ctx.config.afe_config.agc_enabled,
             .afe_mode = s_ctx.config.afe_config.afe_mode,
+            .dynamic_profile = s_ctx.config.afe_config.dynamic_profile,
         },
         .event_callback = afe_event_handler,
         .event_ctx = NULL,
@@ -462,6 +548,7 @@ esp_err_t audio_manager_init(const audio_mgr_config_t *config)
         .record_ctx = NULL,
         .running_ptr = &s_ctx.running,
         .recording_ptr = &s_ctx.recording,
+        .sched_profile = s_ctx.config.sched_profile,
     };
 
     s_ctx.afe_wrapper = afe_wrapper_create(&afe_cfg);
@@ -477,6 +564,7 @@ esp_err_t audio_manager_init(const audio_mgr_config_t *config)
         .debounce_ms = 50,
         .callback = button_event_handler,
         .user_ctx = NULL,
+        .task_sched = xn_sched_get(s_ctx.config.sched_profile, XN_TASK_BUTTON),
     };
 
     s_ctx.button_handler = button_handler_create(&button_cfg);
@@ -489,6 +577,7 @@ esp_err_t audio_manager_init(const audio_mgr_config_t *config)
     s_ctx.initialized = true;
     s_ctx.state = AUDIO_MGR_STATE_IDLE;
     audio_manager_refresh_state();
+    audio_mem_print_report();
     ESP_LOGI(TAG, "✅ 音频管理器初始化完成");
     return ESP_OK;
 
@@ -507,6 +596,7 @@ void audio_manager_deinit(void)
 {
     // 检查是否已初始化
     if (!s_ctx.initialized && !s_ctx.bsp) {
+        audio_mem_deinit();
         return;
     }
 
@@ -514,10 +604,8 @@ void audio_manager_deinit(void)
     audio_manager_stop();
     audio_manager_stop_playback();
 
-    if (s_ctx.manager_task) {
-        vTaskDelete(s_ctx.manager_task);
-        s_ctx.manager_task = NULL;
-    }
+    // 状态机任务常驻循环，直接删除并回收任务栈
+    xn_task_join(&s_ctx.manager_task, 0);
 
     if (s_ctx.event_queue) {
         vQueueDelete(s_ctx.event_queue);
@@ -550,6 +638,9 @@ void audio_manager_deinit(void)
 
     // reference_rb 由播放控制器管理，不需要单独销毁
 
+    // 各模块已归还区块，释放内存池
+    audio_mem_deinit();
+
     // 清空上下文
     memset(&s_ctx, 0, sizeof(s_ctx));
     ESP_LOGI(TAG, "音频管理器已销毁");
@@ -674,6 +765,24 @@ esp_err_t audio_manager_play_audio(const int16_t *pcm_data, size_t sample_count)
     return playback_controller_write(s_ctx.playback_ctrl, pcm_data, sample_count);
 }
 
+size_t audio_manager_playback_reserve(int16_t **ptr, size_t samples, uint32_t timeout_ms)
+{
+    if (!s_ctx.initialized || !s_ctx.playback_ctrl) {
+        return 0;
+    }
+
+    return playback_controller_reserve(s_ctx.playback_ctrl, ptr, samples, timeout_ms);
+}
+
+esp_err_t audio_manager_playback_commit(size_t samples)
+{
+    if (!s_ctx.initialized || !s_ctx.playback_ctrl) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return playback_controller_commit(s_ctx.playback_ctrl, samples);
+}
+
 size_t audio_manager_get_playback_free_space(void)
 {
     // 检查是否已初始化
@@ -823,6 +932,82 @@ esp_err_t audio_manager_get_wakeup_config(audio_mgr_wakeup_config_t *config)
     return ESP_OK;
 }
 
+/**
+ * @brief 获取 AFE 动态档位统计
+ * 
+ * CPU 百分比 = 该档位下 Feed + Fetch 任务 CPU 时间 / 该档位停留时长，
+ * 以单核为基准。
+ * 
+ * @param stats 输出参数，用于存储统计
+ * @return 
+ *     - ESP_OK: 获取成功
+ *     - ESP_ERR_INVALID_ARG: 参数无效或未初始化
+ */
+esp_err_t audio_manager_get_afe_stats(audio_mgr_afe_stats_t *stats)
+{
+    if (!s_ctx.initialized || !stats) return ESP_ERR_INVALID_ARG;
+
+    afe_wrapper_stats_t raw = {0};
+    esp_err_t ret = afe_wrapper_get_stats(s_ctx.afe_wrapper, &raw);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->current = (audio_mgr_afe_profile_t)raw.current;
+    stats->switch_count = raw.switch_count;
+    for (int i = 0; i < AUDIO_MGR_AFE_PROFILE_MAX; i++) {
+        const afe_profile_stats_t *src = &raw.profile[i];
+        uint64_t cpu_us = src->feed_cpu_us + src->fetch_cpu_us;
+        stats->profile[i].frames = src->frames;
+        stats->profile[i].active_ms = (uint32_t)(src->active_us / 1000);
+        stats->profile[i].cpu_ms = (uint32_t)(cpu_us / 1000);
+        stats->profile[i].cpu_percent = src->active_us ? (float)cpu_us * 100.0f / (float)src->active_us : 0.0f;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief 获取音频管线统计
+ * 
+ * 汇总播放/回采缓冲区深度与丢样，以及 AFE 输入输出计数。
+ * AFE 滞后按已送入但尚未输出的样本数折算为毫秒。
+ * 
+ * @param stats 输出参数，用于存储统计
+ * @return 
+ *     - ESP_OK: 获取成功
+ *     - ESP_ERR_INVALID_ARG: 参数无效或未初始化
+ */
+esp_err_t audio_manager_get_pipeline_stats(audio_mgr_pipeline_stats_t *stats)
+{
+    if (!s_ctx.initialized || !stats) return ESP_ERR_INVALID_ARG;
+
+    ring_buffer_stats_t playback = {0};
+    ring_buffer_stats_t reference = {0};
+    afe_wrapper_stats_t afe = {0};
+
+    memset(stats, 0, sizeof(*stats));
+    playback_controller_get_stats(s_ctx.playback_ctrl, &playback, &reference);
+    afe_wrapper_get_stats(s_ctx.afe_wrapper, &afe);
+
+    stats->playback_depth = playback.available;
+    stats->playback_peak = playback.peak;
+    stats->playback_dropped = playback.dropped;
+    stats->reference_depth = reference.available;
+    stats->reference_peak = reference.peak;
+    stats->reference_dropped = reference.dropped;
+    stats->mic_samples = afe.mic_samples;
+    stats->afe_out_samples = afe.out_samples;
+    stats->record_samples = afe.record_samples;
+    if (afe.mic_samples > afe.out_samples) {
+        stats->afe_latency_ms = (uint32_t)((afe.mic_samples - afe.out_samples) * 1000 /
+                                           s_ctx.config.hw_config.mic.sample_rate);
+    }
+
+    return ESP_OK;
+}
+
 /**
  * @brief 检查是否正在运行
  * 
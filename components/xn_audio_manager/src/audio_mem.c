@@ -0,0 +1,191 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-03
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-03
+ * @FilePath: \xn_esp32_audio\components\xn_audio_manager\src\audio_mem.c
+ * @Description: 音频管线内存池实现
+ */
+#include "audio_mem.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+
+static const char *TAG = "AUDIO_MEM";
+
+#define AUDIO_MEM_ALIGN(x) (((x) + 15) & ~(size_t)15)
+
+/**
+ * @brief 内存池上下文
+ */
+typedef struct {
+    bool initialized;                                   ///< 是否已初始化
+    audio_mem_region_t table[AUDIO_MEM_ID_MAX];         ///< 放置表副本
+    uint8_t *pool[AUDIO_MEM_PLACE_MAX];                 ///< 各位置的整块内存
+    size_t pool_size[AUDIO_MEM_PLACE_MAX];              ///< 各位置的整块大小
+    uint8_t *slot[AUDIO_MEM_ID_MAX];                    ///< 各区块起始地址
+    bool taken[AUDIO_MEM_ID_MAX];                       ///< 区块是否已被领取
+    size_t fallback_bytes;                              ///< 回退到堆分配的字节数
+} audio_mem_ctx_t;
+
+static audio_mem_ctx_t s_mem = {0};
+
+static const char *s_place_name[AUDIO_MEM_PLACE_MAX] = {
+    [AUDIO_MEM_PLACE_PSRAM] = "PSRAM",
+    [AUDIO_MEM_PLACE_INTERNAL] = "INTERNAL",
+    [AUDIO_MEM_PLACE_DMA] = "DMA",
+};
+
+static uint32_t audio_mem_place_caps(audio_mem_place_t place)
+{
+    switch (place) {
+    case AUDIO_MEM_PLACE_INTERNAL:
+        return MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    case AUDIO_MEM_PLACE_DMA:
+        return MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    case AUDIO_MEM_PLACE_PSRAM:
+    default:
+        return MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+    }
+}
+
+esp_err_t audio_mem_init(const audio_mem_region_t table[AUDIO_MEM_ID_MAX])
+{
+    if (!table) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_mem.initialized) {
+        ESP_LOGW(TAG, "内存池已初始化");
+        return ESP_OK;
+    }
+
+    memset(&s_mem, 0, sizeof(s_mem));
+    memcpy(s_mem.table, table, sizeof(s_mem.table));
+
+    // 统计每种位置的总需求
+    for (int i = 0; i < AUDIO_MEM_ID_MAX; i++) {
+        if (table[i].place >= AUDIO_MEM_PLACE_MAX) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        s_mem.pool_size[table[i].place] += AUDIO_MEM_ALIGN(table[i].size);
+    }
+
+    // 每种位置只分配一次
+    for (int p = 0; p < AUDIO_MEM_PLACE_MAX; p++) {
+        if (s_mem.pool_size[p] == 0) {
+            continue;
+        }
+        s_mem.pool[p] = (uint8_t *)heap_caps_aligned_alloc(16, s_mem.pool_size[p], audio_mem_place_caps(p));
+        if (!s_mem.pool[p]) {
+            ESP_LOGE(TAG, "内存池分配失败: %s %d 字节", s_place_name[p], (int)s_mem.pool_size[p]);
+            audio_mem_deinit();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // 切分区块
+    size_t offset[AUDIO_MEM_PLACE_MAX] = {0};
+    for (int i = 0; i < AUDIO_MEM_ID_MAX; i++) {
+        if (table[i].size == 0) {
+            continue;
+        }
+        audio_mem_place_t p = table[i].place;
+        s_mem.slot[i] = s_mem.pool[p] + offset[p];
+        offset[p] += AUDIO_MEM_ALIGN(table[i].size);
+    }
+
+    s_mem.initialized = true;
+    ESP_LOGI(TAG, "✅ 内存池就绪: PSRAM %d B, INTERNAL %d B, DMA %d B",
+             (int)s_mem.pool_size[AUDIO_MEM_PLACE_PSRAM],
+             (int)s_mem.pool_size[AUDIO_MEM_PLACE_INTERNAL],
+             (int)s_mem.pool_size[AUDIO_MEM_PLACE_DMA]);
+    return ESP_OK;
+}
+
+void audio_mem_deinit(void)
+{
+    for (int i = 0; i < AUDIO_MEM_ID_MAX; i++) {
+        if (s_mem.taken[i]) {
+            ESP_LOGW(TAG, "区块 %s 未归还", s_mem.table[i].name ? s_mem.table[i].name : "?");
+        }
+    }
+
+    for (int p = 0; p < AUDIO_MEM_PLACE_MAX; p++) {
+        if (s_mem.pool[p]) {
+            heap_caps_free(s_mem.pool[p]);
+        }
+    }
+    memset(&s_mem, 0, sizeof(s_mem));
+}
+
+void *audio_mem_take(audio_mem_id_t id, size_t size, uint32_t fallback_caps)
+{
+    if (id >= AUDIO_MEM_ID_MAX || size == 0) {
+        return NULL;
+    }
+
+    if (s_mem.initialized && s_mem.slot[id] && !s_mem.taken[id] && s_mem.table[id].size >= size) {
+        s_mem.taken[id] = true;
+        return s_mem.slot[id];
+    }
+
+    // 未纳入预算：按放置表（若有）或调用方给定的 caps 回退分配
+    uint32_t caps = s_mem.initialized ? audio_mem_place_caps(s_mem.table[id].place) : fallback_caps;
+    void *ptr = heap_caps_malloc(size, caps);
+    if (s_mem.initialized) {
+        ESP_LOGW(TAG, "⚠️ 区块 %d 超出预算（需要 %d B，预留 %d B），回退堆分配",
+                 id, (int)size, (int)s_mem.table[id].size);
+        if (ptr) {
+            s_mem.fallback_bytes += size;
+        }
+    }
+    return ptr;
+}
+
+void audio_mem_release(audio_mem_id_t id, void *ptr)
+{
+    if (!ptr || id >= AUDIO_MEM_ID_MAX) {
+        return;
+    }
+
+    if (s_mem.initialized && ptr == s_mem.slot[id]) {
+        s_mem.taken[id] = false;
+        return;
+    }
+
+    heap_caps_free(ptr);
+}
+
+void audio_mem_print_report(void)
+{
+    ESP_LOGI(TAG, "======== 音频内存预算 ========");
+    ESP_LOGI(TAG, "%-16s %10s %-9s %-10s %s", "区块", "字节", "位置", "地址", "状态");
+
+    size_t used[AUDIO_MEM_PLACE_MAX] = {0};
+    for (int i = 0; i < AUDIO_MEM_ID_MAX; i++) {
+        const audio_mem_region_t *r = &s_mem.table[i];
+        if (!s_mem.initialized || r->size == 0) {
+            continue;
+        }
+        if (s_mem.taken[i]) {
+            used[r->place] += r->size;
+        }
+        ESP_LOGI(TAG, "%-16s %10d %-9s %p %s", r->name ? r->name : "?", (int)r->size,
+                 s_place_name[r->place], s_mem.slot[i], s_mem.taken[i] ? "在用" : "空闲");
+    }
+
+    for (int p = 0; p < AUDIO_MEM_PLACE_MAX; p++) {
+        ESP_LOGI(TAG, "%-9s 预留 %8d B, 在用 %8d B", s_place_name[p],
+                 (int)s_mem.pool_size[p], (int)used[p]);
+    }
+    if (s_mem.fallback_bytes > 0) {
+        ESP_LOGW(TAG, "预算外堆分配 %d B", (int)s_mem.fallback_bytes);
+    }
+
+    ESP_LOGI(TAG, "堆余量: INTERNAL %d B (最大块 %d B), DMA %d B, PSRAM %d B (最大块 %d B)",
+             (int)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+             (int)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL),
+             (int)heap_caps_get_free_size(MALLOC_CAP_DMA),
+             (int)heap_caps_get_free_size(MALLOC_CAP_SPIRAM),
+             (int)heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM));
+}
@@ -9,6 +9,7 @@
  * Copyright (c) 2025 by ${git_name_email}, All Rights Reserved. 
  */
 #include "button_handler.h"
+#include "audio_mem.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
@@ -40,6 +41,8 @@ typedef struct button_handler_s {
     QueueHandle_t button_queue;         ///< 按键事件队列句柄（用于 ISR 到任务通信）
     int64_t last_press_time;            ///< 上次按键事件时间戳（毫秒），用于防抖
     bool last_state;                    ///< 上次按键状态（true=按下，false=松开），用于检测状态变化
+    StaticTask_t *task_tcb;             ///< 任务控制块（内部 RAM）
+    StackType_t *task_stack;            ///< 任务栈（内存池区块）
 } button_handler_t;
 
 /**
@@ -207,13 +210,15 @@ button_handler_handle_t button_handler_create(const button_handler_config_t *con
     // 分配任务控制块（TCB），必须在内部 RAM
     StaticTask_t *btn_tcb = heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
     
-    // 分配任务栈，在 PSRAM 中分配 4KB
-    StackType_t *btn_stack = heap_caps_malloc(4096, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    // 从内存池领取任务栈（放置位置由调度档案决定，默认 PSRAM）
+    const xn_task_sched_t *sched = config->task_sched ? config->task_sched : xn_sched_get(NULL, XN_TASK_BUTTON);
+    StackType_t *btn_stack = audio_mem_take(AUDIO_MEM_BUTTON_STACK, sched->stack_size,
+                                            MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     
     if (!btn_tcb || !btn_stack) {
         ESP_LOGE(TAG, "❌ 按键任务内存分配失败");
         if (btn_tcb) heap_caps_free(btn_tcb);
-        if (btn_stack) heap_caps_free(btn_stack);
+        audio_mem_release(AUDIO_MEM_BUTTON_STACK, btn_stack);
         gpio_isr_handler_remove(config->gpio);
         vQueueDelete(handler->button_queue);
         free(handler);
@@ -221,27 +226,31 @@ button_handler_handle_t button_handler_create(const button_handler_config_t *con
     }
     
     // 创建静态任务
-    handler->button_task = xTaskCreateStatic(
+    handler->button_task = xTaskCreateStaticPinnedToCore(
         button_task,                    // 任务函数
         "button_task",                  // 任务名称
-        4096 / sizeof(StackType_t),     // 栈大小（以 StackType_t 为单位）
+        sched->stack_size / sizeof(StackType_t), // 栈大小（以 StackType_t 为单位）
         handler,                        // 任务参数
-        4,                              // 任务优先级
+        sched->priority,                // 任务优先级
         btn_stack,                      // 栈指针
-        btn_tcb                         // 任务控制块指针
+        btn_tcb,                        // 任务控制块指针
+        sched->core == XN_TASK_CORE_ANY ? tskNO_AFFINITY : sched->core
     );
     
     if (!handler->button_task) {
         ESP_LOGE(TAG, "❌ 创建按键任务失败");
         heap_caps_free(btn_tcb);
-        heap_caps_free(btn_stack);
+        audio_mem_release(AUDIO_MEM_BUTTON_STACK, btn_stack);
         gpio_isr_handler_remove(config->gpio);
         vQueueDelete(handler->button_queue);
         free(handler);
         return NULL;
     }
 
-    ESP_LOGI(TAG, "✅ 按键处理器创建成功（GPIO %d, 栈 4KB 在 PSRAM）", config->gpio);
+    handler->task_tcb = btn_tcb;
+    handler->task_stack = btn_stack;
+
+    ESP_LOGI(TAG, "✅ 按键处理器创建成功（GPIO %d, 栈 %dKB）", config->gpio, (int)(sched->stack_size / 1024));
     return handler;
 }
 
@@ -273,6 +282,12 @@ void button_handler_destroy(button_handler_handle_t handler)
         vQueueDelete(handler->button_queue);
     }
 
+    // 释放静态任务的 TCB 与栈（任务已删除）
+    if (handler->task_tcb) {
+        heap_caps_free(handler->task_tcb);
+    }
+    audio_mem_release(AUDIO_MEM_BUTTON_STACK, handler->task_stack);
+
     // 释放上下文内存
     free(handler);
     ESP_LOGI(TAG, "按键处理器已销毁");
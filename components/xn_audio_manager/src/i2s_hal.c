@@ -9,6 +9,7 @@
  * Copyright (c) 2025 by ${git_name_email}, All Rights Reserved. 
  */
 #include "i2s_hal.h"
+#include "audio_mem.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include "driver/gpio.h"
@@ -169,13 +170,14 @@ i2s_hal_handle_t i2s_hal_create(const i2s_mic_config_t *mic_config,
              mic_config->port, mic_config->bclk_gpio,
              mic_config->lrck_gpio, mic_config->din_gpio);
 
-    // ========== 分配麦克风临时缓冲区（PSRAM）==========
-    // 用于存储 32-bit 原始数据，避免频繁 malloc/free
+    // ========== 分配麦克风临时缓冲区（内存池）==========
+    // 用于存储 32-bit 原始数据，避免频繁 malloc/free；位置由 audio_mem 放置表决定
     hal->mic_temp_buffer_size = mic_config->max_frame_samples > 0 ? 
                                  mic_config->max_frame_samples : 512;  // 默认 512
-    hal->mic_temp_buffer = (int32_t *)heap_caps_malloc(
+    hal->mic_temp_buffer = (int32_t *)audio_mem_take(
+        AUDIO_MEM_MIC_RAW,
         hal->mic_temp_buffer_size * sizeof(int32_t),
-        MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);  // 使用 PSRAM
+        MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);  // 未纳入预算时回退 PSRAM
     
     if (!hal->mic_temp_buffer) {
         ESP_LOGE(TAG, "麦克风临时缓冲区分配失败");
@@ -192,22 +194,23 @@ i2s_hal_handle_t i2s_hal_create(const i2s_mic_config_t *mic_config,
     hal->mic_bit_shift = (mic_config->bit_shift >= 12 && mic_config->bit_shift <= 16) ? 
                           mic_config->bit_shift : 14;  // 默认 14
 
-    ESP_LOGI(TAG, "✅ 麦克风临时缓冲区初始化: %d samples (%.1f KB) at PSRAM, 右移 %d 位",
+    ESP_LOGI(TAG, "✅ 麦克风临时缓冲区初始化: %d samples (%.1f KB), 右移 %d 位",
              hal->mic_temp_buffer_size,
              (hal->mic_temp_buffer_size * sizeof(int32_t)) / 1024.0f,
              hal->mic_bit_shift);
 
-    // ========== 分配立体声转换缓冲区（PSRAM）==========
+    // ========== 分配立体声转换缓冲区（内存池）==========
     // 缓冲区大小：最大帧采样数 × 2（左右声道）× sizeof(int16_t)
     hal->stereo_buffer_size = speaker_config->max_frame_samples;
-    hal->stereo_buffer = (int16_t *)heap_caps_malloc(
+    hal->stereo_buffer = (int16_t *)audio_mem_take(
+        AUDIO_MEM_SPK_STEREO,
         hal->stereo_buffer_size * 2 * sizeof(int16_t), 
-        MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);  // 使用 PSRAM 分配，节省内部 RAM
+        MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);  // 未纳入预算时回退 PSRAM
     
     if (!hal->stereo_buffer) {
         ESP_LOGE(TAG, "立体声缓冲区分配失败");
         // 清理已创建的资源
-        if (hal->mic_temp_buffer) heap_caps_free(hal->mic_temp_buffer);
+        audio_mem_release(AUDIO_MEM_MIC_RAW, hal->mic_temp_buffer);
         i2s_channel_disable(hal->rx_handle);
         i2s_del_channel(hal->rx_handle);
         i2s_channel_disable(hal->tx_handle);
@@ -216,7 +219,7 @@ i2s_hal_handle_t i2s_hal_create(const i2s_mic_config_t *mic_config,
         return NULL;
     }
 
-    ESP_LOGI(TAG, "✅ 立体声缓冲区初始化: %d samples (%.1f KB) at PSRAM",
+    ESP_LOGI(TAG, "✅ 立体声缓冲区初始化: %d samples (%.1f KB)",
              hal->stereo_buffer_size * 2, 
              (hal->stereo_buffer_size * 2 * sizeof(int16_t)) / 1024.0f);
 
@@ -249,15 +252,11 @@ void i2s_hal_destroy(i2s_hal_handle_t hal)
         i2s_del_channel(hal->tx_handle);
     }
 
-    // 释放麦克风临时缓冲区（PSRAM）
-    if (hal->mic_temp_buffer) {
-        heap_caps_free(hal->mic_temp_buffer);
-    }
+    // 归还麦克风临时缓冲区
+    audio_mem_release(AUDIO_MEM_MIC_RAW, hal->mic_temp_buffer);
 
-    // 释放立体声转换缓冲区（PSRAM）
-    if (hal->stereo_buffer) {
-        heap_caps_free(hal->stereo_buffer);
-    }
+    // 归还立体声转换缓冲区
+    audio_mem_release(AUDIO_MEM_SPK_STEREO, hal->stereo_buffer);
 
     // 释放 HAL 上下文内存
     free(hal);
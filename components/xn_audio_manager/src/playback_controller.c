@@ -9,7 +9,9 @@
  * Copyright (c) 2025 by ${git_name_email}, All Rights Reserved. 
  */
 #include "playback_controller.h"
+#include "audio_mem.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <stdlib.h>
@@ -26,12 +28,16 @@ typedef struct playback_controller_s {
     audio_bsp_handle_t bsp_handle;                  ///< BSP 句柄，用于音频输出
     ring_buffer_handle_t playback_rb;               ///< 播放缓冲区，存储待播放的音频数据
     ring_buffer_handle_t reference_rb;              ///< 回采缓冲区，存储回采的音频数据供AFE使用
-    TaskHandle_t playback_task;                     ///< 播放任务句柄，用于管理播放任务
+    xn_task_t playback_task;                        ///< 播放任务，用于管理播放任务
+    xn_task_sched_t task_sched;                     ///< 播放任务调度参数
     bool running;                                   ///< 运行状态标志，true表示正在运行
     size_t frame_samples;                           ///< 每帧采样点数，用于分配帧缓冲区
     playback_reference_callback_t reference_callback; ///< 回采回调函数，用于将音频数据传递给AFE
     void *reference_ctx;                            ///< 回采回调上下文，传递给回调函数的用户数据
     uint8_t *volume_ptr;                            ///< 音量指针，指向音量值（0-100）
+    int16_t *playback_storage;                      ///< 播放缓冲区存储（内存池区块）
+    int16_t *reference_storage;                     ///< 回采缓冲区存储（内存池区块）
+    int16_t *frame;                                 ///< 播放帧缓冲（创建时分配，任务启停不再分配）
 } playback_controller_t;
 
 /**
@@ -44,14 +50,7 @@ typedef struct playback_controller_s {
 static void playback_task(void *arg)
 {
     playback_controller_t *ctrl = (playback_controller_t *)arg;
-    
-    // 分配帧缓冲区，用于存储从环形缓冲区读取的音频数据
-    int16_t *frame = (int16_t *)malloc(ctrl->frame_samples * sizeof(int16_t));
-    if (!frame) {
-        ESP_LOGE(TAG, "播放任务内存分配失败");
-        vTaskDelete(NULL);
-        return;
-    }
+    int16_t *frame = ctrl->frame;
 
     ESP_LOGI(TAG, "播放任务启动");
 
@@ -79,8 +78,6 @@ static void playback_task(void *arg)
         }
     }
 
-    // 清理资源
-    free(frame);
     ESP_LOGI(TAG, "播放任务结束");
     vTaskDelete(NULL);
 }
@@ -114,21 +111,38 @@ playback_controller_handle_t playback_controller_create(const playback_controlle
     ctrl->reference_callback = config->reference_callback;
     ctrl->reference_ctx = config->reference_ctx;
     ctrl->volume_ptr = config->volume_ptr;
+    ctrl->task_sched = config->task_sched ? *config->task_sched : *xn_sched_get(NULL, XN_TASK_PLAYBACK);
+
+    // 从内存池领取缓冲区（未纳入预算时回退堆分配）
+    ctrl->playback_storage = audio_mem_take(AUDIO_MEM_PLAYBACK_RING,
+                                            config->playback_buffer_samples * sizeof(int16_t),
+                                            MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    ctrl->reference_storage = audio_mem_take(AUDIO_MEM_REFERENCE_RING,
+                                             config->reference_buffer_samples * sizeof(int16_t),
+                                             MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    ctrl->frame = audio_mem_take(AUDIO_MEM_PLAYBACK_FRAME, config->frame_samples * sizeof(int16_t),
+                                 MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!ctrl->playback_storage || !ctrl->reference_storage || !ctrl->frame) {
+        ESP_LOGE(TAG, "播放缓冲内存分配失败");
+        playback_controller_destroy(ctrl);
+        return NULL;
+    }
 
     // 创建播放缓冲区（阻塞模式）
-    ctrl->playback_rb = ring_buffer_create(config->playback_buffer_samples, true);
+    ctrl->playback_rb = ring_buffer_create_with_storage(config->playback_buffer_samples, true,
+                                                        ctrl->playback_storage);
     if (!ctrl->playback_rb) {
         ESP_LOGE(TAG, "播放缓冲区创建失败");
-        free(ctrl);
+        playback_controller_destroy(ctrl);
         return NULL;
     }
 
     // 创建回采缓冲区（非阻塞模式）
-    ctrl->reference_rb = ring_buffer_create(config->reference_buffer_samples, false);
+    ctrl->reference_rb = ring_buffer_create_with_storage(config->reference_buffer_samples, false,
+                                                         ctrl->reference_storage);
     if (!ctrl->reference_rb) {
         ESP_LOGE(TAG, "回采缓冲区创建失败");
-        ring_buffer_destroy(ctrl->playback_rb);
-        free(ctrl);
+        playback_controller_destroy(ctrl);
         return NULL;
     }
 
@@ -160,6 +174,11 @@ void playback_controller_destroy(playback_controller_handle_t controller)
         ring_buffer_destroy(controller->reference_rb);
     }
 
+    // 归还内存池区块
+    audio_mem_release(AUDIO_MEM_PLAYBACK_RING, controller->playback_storage);
+    audio_mem_release(AUDIO_MEM_REFERENCE_RING, controller->reference_storage);
+    audio_mem_release(AUDIO_MEM_PLAYBACK_FRAME, controller->frame);
+
     // 释放控制器内存
     free(controller);
     ESP_LOGI(TAG, "播放控制器已销毁");
@@ -187,10 +206,13 @@ esp_err_t playback_controller_start(playback_controller_handle_t controller)
     ESP_LOGI(TAG, "▶️ 启动播放器");
     controller->running = true;
 
-    // 创建播放任务，固定到 Core 1
-    // 任务优先级7，栈大小5KB
-    xTaskCreatePinnedToCore(playback_task, "playback", 5 * 1024, controller, 
-                            7, &controller->playback_task, 1);
+    // 按调度档案创建播放任务（均衡预设：Core 1，优先级7，栈5KB）
+    esp_err_t ret = xn_task_create(&controller->playback_task, &controller->task_sched,
+                                   playback_task, "playback", controller);
+    if (ret != ESP_OK) {
+        controller->running = false;
+        return ret;
+    }
 
     return ESP_OK;
 }
@@ -212,11 +234,8 @@ esp_err_t playback_controller_stop(playback_controller_handle_t controller)
     ESP_LOGI(TAG, "⏹️ 停止播放器");
     controller->running = false;
 
-    // 等待任务结束
-    if (controller->playback_task) {
-        vTaskDelay(pdMS_TO_TICKS(300));
-        controller->playback_task = NULL;
-    }
+    // 等待任务结束（读超时 200ms）并回收任务栈
+    xn_task_join(&controller->playback_task, 300);
 
     return ESP_OK;
 }
@@ -243,6 +262,43 @@ esp_err_t playback_controller_write(playback_controller_handle_t controller,
     return ESP_OK;
 }
 
+/**
+ * @brief 在播放缓冲区中预留写入空间
+ * 
+ * 空间不足时阻塞到播放任务读走数据，调用方由此按真实播放速度被节流
+ * 
+ * @param controller 播放控制器句柄
+ * @param ptr 输出：可写地址
+ * @param samples 需要的采样点数
+ * @param timeout_ms 等待超时（毫秒）
+ * @return 可写的连续采样点数，超时或参数无效返回 0
+ */
+size_t playback_controller_reserve(playback_controller_handle_t controller, int16_t **ptr,
+                                   size_t samples, uint32_t timeout_ms)
+{
+    if (!controller) {
+        return 0;
+    }
+
+    return ring_buffer_reserve(controller->playback_rb, ptr, samples, timeout_ms);
+}
+
+/**
+ * @brief 提交预留空间中已写入的数据
+ * 
+ * @param controller 播放控制器句柄
+ * @param samples 实际写入的采样点数
+ * @return ESP_OK 成功，ESP_ERR_INVALID_STATE 预留后被清空（打断），ESP_ERR_INVALID_ARG 参数无效
+ */
+esp_err_t playback_controller_commit(playback_controller_handle_t controller, size_t samples)
+{
+    if (!controller) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return ring_buffer_commit(controller->playback_rb, samples);
+}
+
 /**
  * @brief 清空播放缓冲区
  * 
@@ -300,6 +356,47 @@ size_t playback_controller_get_free_space(playback_controller_handle_t controlle
     return (total_size > used_size) ? (total_size - used_size) : 0;
 }
 
+/**
+ * @brief 获取播放缓冲区中待播放的数据量
+ * 
+ * @param controller 播放控制器句柄
+ * @return 待播放样本数
+ */
+size_t playback_controller_get_buffered_samples(playback_controller_handle_t controller)
+{
+    if (!controller || !controller->playback_rb) {
+        return 0;
+    }
+
+    return ring_buffer_available(controller->playback_rb);
+}
+
+/**
+ * @brief 获取播放/回采缓冲区运行统计
+ * 
+ * @param controller 播放控制器句柄
+ * @param playback 输出播放缓冲区统计（可为 NULL）
+ * @param reference 输出回采缓冲区统计（可为 NULL）
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 参数无效
+ */
+esp_err_t playback_controller_get_stats(playback_controller_handle_t controller,
+                                        ring_buffer_stats_t *playback,
+                                        ring_buffer_stats_t *reference)
+{
+    if (!controller) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    if (playback) {
+        ret = ring_buffer_get_stats(controller->playback_rb, playback);
+    }
+    if (reference && ret == ESP_OK) {
+        ret = ring_buffer_get_stats(controller->reference_rb, reference);
+    }
+    return ret;
+}
+
 /**
  * @brief 获取回采缓冲区句柄
  * 
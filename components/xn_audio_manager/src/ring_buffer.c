@@ -9,8 +9,10 @@
  * Copyright (c) 2025 by ${git_name_email}, All Rights Reserved. 
  */
 #include "ring_buffer.h"
+#include "sdkconfig.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "freertos/task.h"
 #include <string.h>
 
 static const char *TAG = "RING_BUFFER";
@@ -32,6 +34,14 @@ typedef struct ring_buffer_s {
     volatile size_t read_pos;     ///< 读位置索引（消费者）
     SemaphoreHandle_t mutex;      ///< 互斥锁，保护读写位置的原子性
     SemaphoreHandle_t data_sem;   ///< 数据可用信号量（可选），用于阻塞读取
+    SemaphoreHandle_t space_sem;  ///< 空间释放信号量（与 data_sem 一同创建），用于阻塞预留
+    uint32_t clear_gen;           ///< 清空次数，用于识别预留期间发生的清空
+    uint32_t resv_gen;            ///< 预留时的清空次数
+    size_t resv_samples;          ///< 当前预留的连续采样点数
+    bool owns_buffer;             ///< 数据区是否由本模块分配（外部提供时销毁不释放）
+    size_t peak;                  ///< 历史峰值数据量
+    uint64_t written;             ///< 累计写入采样点数
+    uint64_t dropped;             ///< 累计丢弃采样点数
 } ring_buffer_t;
 
 /**
@@ -52,6 +62,23 @@ typedef struct ring_buffer_s {
  *       - 互斥锁/信号量创建失败
  */
 ring_buffer_handle_t ring_buffer_create(size_t samples, bool with_sem)
+{
+    return ring_buffer_create_with_storage(samples, with_sem, NULL);
+}
+
+/**
+ * @brief 使用外部存储创建环形缓冲区
+ * 
+ * storage 为 NULL 时行为与 ring_buffer_create() 相同（在 PSRAM 中分配）；
+ * 否则直接使用调用方提供的内存（如 audio_mem 内存池区块），销毁时不释放。
+ * 
+ * @param samples 缓冲区容量（采样点数）
+ * @param with_sem 是否创建信号量用于阻塞读取
+ * @param storage 外部存储，至少 samples 个采样点，可为 NULL
+ * 
+ * @return 环形缓冲区句柄，失败返回 NULL
+ */
+ring_buffer_handle_t ring_buffer_create_with_storage(size_t samples, bool with_sem, int16_t *storage)
 {
     if (samples == 0) {
         ESP_LOGE(TAG, "无效的缓冲区大小");
@@ -59,14 +86,16 @@ ring_buffer_handle_t ring_buffer_create(size_t samples, bool with_sem)
     }
 
     // 分配句柄结构体（使用 IRAM）
-    ring_buffer_t *rb = (ring_buffer_t *)malloc(sizeof(ring_buffer_t));
+    ring_buffer_t *rb = (ring_buffer_t *)calloc(1, sizeof(ring_buffer_t));
     if (!rb) {
         ESP_LOGE(TAG, "环形缓冲区句柄分配失败");
         return NULL;
     }
 
     // 分配缓冲区内存（优先使用 PSRAM，降低 IRAM 压力）
-    rb->buffer = (int16_t *)heap_caps_malloc(samples * sizeof(int16_t), MALLOC_CAP_SPIRAM);
+    rb->owns_buffer = (storage == NULL);
+    rb->buffer = storage ? storage
+                         : (int16_t *)heap_caps_malloc(samples * sizeof(int16_t), MALLOC_CAP_SPIRAM);
     if (!rb->buffer) {
         ESP_LOGE(TAG, "环形缓冲区分配失败: %d samples", (int)samples);
         free(rb);
@@ -82,7 +111,7 @@ ring_buffer_handle_t ring_buffer_create(size_t samples, bool with_sem)
     rb->mutex = xSemaphoreCreateMutex();
     if (!rb->mutex) {
         ESP_LOGE(TAG, "互斥锁创建失败");
-        heap_caps_free(rb->buffer);
+        if (rb->owns_buffer) heap_caps_free(rb->buffer);
         free(rb);
         return NULL;
     }
@@ -91,19 +120,27 @@ ring_buffer_handle_t ring_buffer_create(size_t samples, bool with_sem)
     rb->data_sem = NULL;
     if (with_sem) {
         rb->data_sem = xSemaphoreCreateBinary();
-        if (!rb->data_sem) {
+        rb->space_sem = xSemaphoreCreateBinary();
+        if (!rb->data_sem || !rb->space_sem) {
             ESP_LOGE(TAG, "信号量创建失败");
+            if (rb->data_sem) vSemaphoreDelete(rb->data_sem);
+            if (rb->space_sem) vSemaphoreDelete(rb->space_sem);
             vSemaphoreDelete(rb->mutex);
-            heap_caps_free(rb->buffer);
+            if (rb->owns_buffer) heap_caps_free(rb->buffer);
             free(rb);
             return NULL;
         }
     }
 
+#if CONFIG_IDF_TARGET_LINUX
+    ESP_LOGI(TAG, "环形缓冲区创建成功: %d samples (%.1f KB)",
+             (int)samples, (samples * sizeof(int16_t)) / 1024.0f);
+#else
     ESP_LOGI(TAG, "环形缓冲区创建成功: %d samples (%.1f KB) at %s",
              (int)samples, 
              (samples * sizeof(int16_t)) / 1024.0f,
              esp_ptr_external_ram(rb->buffer) ? "PSRAM" : "IRAM");
+#endif
 
     return rb;
 }
@@ -131,9 +168,12 @@ void ring_buffer_destroy(ring_buffer_handle_t rb)
     if (rb->data_sem) {
         vSemaphoreDelete(rb->data_sem);
     }
+    if (rb->space_sem) {
+        vSemaphoreDelete(rb->space_sem);
+    }
     
-    // 释放缓冲区内存
-    if (rb->buffer) {
+    // 释放缓冲区内存（外部存储由调用方归还）
+    if (rb->buffer && rb->owns_buffer) {
         heap_caps_free(rb->buffer);
     }
     
@@ -164,6 +204,7 @@ size_t ring_buffer_write(ring_buffer_handle_t rb, const int16_t *data, size_t sa
 
     // 获取互斥锁（超时 10ms）
     if (xSemaphoreTake(rb->mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        rb->dropped += samples;
         return 0;
     }
 
@@ -181,6 +222,16 @@ size_t ring_buffer_write(ring_buffer_handle_t rb, const int16_t *data, size_t sa
         }
     }
 
+    // 更新统计
+    size_t avail = (rb->write_pos >= rb->read_pos)
+                   ? (rb->write_pos - rb->read_pos)
+                   : (rb->size - rb->read_pos + rb->write_pos);
+    if (avail > rb->peak) {
+        rb->peak = avail;
+    }
+    rb->written += samples;
+    rb->dropped += overrun_count;
+
     xSemaphoreGive(rb->mutex);
 
     // 缓冲区溢出警告（假设 16kHz 采样率）
@@ -249,9 +300,113 @@ size_t ring_buffer_read(ring_buffer_handle_t rb, int16_t *out, size_t samples, u
 
     xSemaphoreGive(rb->mutex);
 
+    // 通知有空间释放（唤醒阻塞在预留中的写者）
+    if (rb->space_sem && samples > 0) {
+        xSemaphoreGive(rb->space_sem);
+    }
+
     return samples;
 }
 
+/**
+ * @brief 预留写入空间
+ * 
+ * 与 ring_buffer_write() 的覆盖策略不同，预留在空间不足时阻塞等待读端消费，
+ * 写者因此按真实的播放速度被节流。
+ * 
+ * @param rb 环形缓冲区句柄
+ * @param ptr 输出：可写地址
+ * @param samples 需要的采样点数
+ * @param timeout_ms 等待空闲空间的超时时间（毫秒）
+ * 
+ * @return 可写的连续采样点数（可能小于 samples），超时返回 0
+ * 
+ * @note 缓冲区最多存放 size - 1 个采样点（读写位置相等表示空）
+ */
+size_t ring_buffer_reserve(ring_buffer_handle_t rb, int16_t **ptr, size_t samples, uint32_t timeout_ms)
+{
+    if (!rb || !ptr || samples == 0 || samples >= rb->size || !rb->space_sem) {
+        return 0;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    TickType_t limit = pdMS_TO_TICKS(timeout_ms);
+
+    while (true) {
+        if (xSemaphoreTake(rb->mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+            return 0;
+        }
+
+        size_t avail = (rb->write_pos >= rb->read_pos)
+                       ? (rb->write_pos - rb->read_pos)
+                       : (rb->size - rb->read_pos + rb->write_pos);
+        if (rb->size - 1 - avail >= samples) {
+            size_t contiguous = rb->size - rb->write_pos;
+            rb->resv_samples = samples < contiguous ? samples : contiguous;
+            rb->resv_gen = rb->clear_gen;
+            *ptr = rb->buffer + rb->write_pos;
+            xSemaphoreGive(rb->mutex);
+            return rb->resv_samples;
+        }
+        xSemaphoreGive(rb->mutex);
+
+        // 空间不足：等待读端释放
+        TickType_t waited = xTaskGetTickCount() - start;
+        if (waited >= limit || xSemaphoreTake(rb->space_sem, limit - waited) != pdTRUE) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * @brief 提交预留空间中已写入的数据
+ * 
+ * @param rb 环形缓冲区句柄
+ * @param samples 实际写入的采样点数
+ * 
+ * @return 
+ *   - ESP_OK: 成功
+ *   - ESP_ERR_INVALID_ARG: 参数无效或超过预留大小
+ *   - ESP_ERR_INVALID_STATE: 预留期间缓冲区被清空，数据已丢弃
+ *   - ESP_ERR_TIMEOUT: 获取互斥锁超时
+ */
+esp_err_t ring_buffer_commit(ring_buffer_handle_t rb, size_t samples)
+{
+    if (!rb || samples > rb->resv_samples) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (xSemaphoreTake(rb->mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        rb->dropped += samples;
+        return ESP_ERR_TIMEOUT;
+    }
+
+    rb->resv_samples = 0;
+    if (rb->resv_gen != rb->clear_gen) {
+        // 预留后被清空（如打断），写入的数据作废
+        xSemaphoreGive(rb->mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    rb->write_pos = (rb->write_pos + samples) % rb->size;
+
+    size_t avail = (rb->write_pos >= rb->read_pos)
+                   ? (rb->write_pos - rb->read_pos)
+                   : (rb->size - rb->read_pos + rb->write_pos);
+    if (avail > rb->peak) {
+        rb->peak = avail;
+    }
+    rb->written += samples;
+
+    xSemaphoreGive(rb->mutex);
+
+    if (rb->data_sem && samples > 0) {
+        xSemaphoreGive(rb->data_sem);
+    }
+
+    return ESP_OK;
+}
+
 /**
  * @brief 获取环形缓冲区中可用的数据量
  * 
@@ -312,9 +467,14 @@ esp_err_t ring_buffer_clear(ring_buffer_handle_t rb)
     // 重置读写位置
     rb->read_pos = 0;
     rb->write_pos = 0;
+    rb->clear_gen++;
 
     xSemaphoreGive(rb->mutex);
 
+    if (rb->space_sem) {
+        xSemaphoreGive(rb->space_sem);
+    }
+
     return ESP_OK;
 }
 
@@ -335,3 +495,38 @@ size_t ring_buffer_get_size(ring_buffer_handle_t rb)
     }
     return rb->size;
 }
+
+/**
+ * @brief 获取环形缓冲区运行统计
+ * 
+ * 用于观察管线各级缓冲深度和丢样情况。
+ * 
+ * @param rb 环形缓冲区句柄
+ * @param stats 输出统计
+ * @return 
+ *   - ESP_OK: 成功
+ *   - ESP_ERR_INVALID_ARG: 参数无效
+ *   - ESP_ERR_TIMEOUT: 获取互斥锁超时
+ */
+esp_err_t ring_buffer_get_stats(ring_buffer_handle_t rb, ring_buffer_stats_t *stats)
+{
+    if (!rb || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (xSemaphoreTake(rb->mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    stats->size = rb->size;
+    stats->available = (rb->write_pos >= rb->read_pos)
+                       ? (rb->write_pos - rb->read_pos)
+                       : (rb->size - rb->read_pos + rb->write_pos);
+    stats->peak = rb->peak;
+    stats->written = rb->written;
+    stats->dropped = rb->dropped;
+
+    xSemaphoreGive(rb->mutex);
+
+    return ESP_OK;
+}
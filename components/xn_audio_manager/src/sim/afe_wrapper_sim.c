@@ -0,0 +1,324 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-02
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-02
+ * @FilePath: \xn_esp32_audio\components\xn_audio_manager\src\sim\afe_wrapper_sim.c
+ * @Description: AFE 包装器主机仿真桩 - 能量 VAD，直通输出，接口与真实实现一致
+ *
+ * 主机上没有 esp-sr，本文件用一个 Feed+Fetch 合一的任务代替 AFE Manager：
+ * 按真实节拍读取麦克风与回采缓冲，基于帧能量做带迟滞的 VAD，
+ * 预录、档位与统计逻辑与 afe_wrapper.c 保持一致。唤醒词不做仿真，用脚本按键代替。
+ */
+#include "afe_wrapper.h"
+#include "audio_mem.h"
+#include "audio_sim_internal.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "AFE_SIM";
+
+#define AFE_SIM_FRAME_SAMPLES   512     ///< 每帧采样点数（与真实 AFE feed chunk 一致）
+#define AFE_SIM_SAMPLE_RATE     16000
+#define AFE_SIM_FRAME_MS        (AFE_SIM_FRAME_SAMPLES * 1000 / AFE_SIM_SAMPLE_RATE)
+
+typedef struct afe_wrapper_s {
+    audio_bsp_handle_t bsp_handle;
+    ring_buffer_handle_t reference_rb;
+    afe_wakeup_config_t wakeup_config;
+    afe_vad_config_t vad_config;
+    afe_feature_config_t feature_config;
+    afe_event_callback_t event_callback;
+    void *event_ctx;
+    afe_record_callback_t record_callback;
+    void *record_ctx;
+    bool *running_ptr;
+    bool *recording_ptr;
+
+    TaskHandle_t task;
+    volatile bool task_exit;
+
+    // VAD 迟滞
+    bool vad_active;
+    int speech_ms;
+    int silence_ms;
+
+    // 档位
+    volatile afe_profile_t active_profile;
+    volatile afe_profile_t pending_profile;
+    int64_t profile_enter_us;
+    uint32_t switch_count;
+    uint32_t runtime_last;
+    afe_profile_stats_t profile_stats[AFE_PROFILE_MAX];
+
+    // 预录
+    int16_t *preroll_buf;
+    size_t preroll_size;
+    size_t preroll_pos;
+    size_t preroll_fill;
+    bool was_recording;
+
+    // 管线计数
+    uint64_t mic_samples;
+    uint64_t out_samples;
+    uint64_t record_samples;
+
+    int16_t mic_buffer[AFE_SIM_FRAME_SAMPLES];
+    int16_t ref_buffer[AFE_SIM_FRAME_SAMPLES];
+} afe_wrapper_t;
+
+static void afe_sim_apply_pending_profile(afe_wrapper_t *wrapper)
+{
+    afe_profile_t target = wrapper->pending_profile;
+    if (target == wrapper->active_profile) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    wrapper->profile_stats[wrapper->active_profile].active_us += now - wrapper->profile_enter_us;
+    wrapper->profile_enter_us = now;
+    wrapper->active_profile = target;
+    wrapper->switch_count++;
+    ESP_LOGI(TAG, "🎚️ AFE 档位切换: %s", target == AFE_PROFILE_CONVERSATION ? "对话" : "空闲");
+}
+
+static void afe_sim_preroll_push(afe_wrapper_t *wrapper, const int16_t *data, size_t samples)
+{
+    for (size_t i = 0; i < samples; i++) {
+        wrapper->preroll_buf[wrapper->preroll_pos] = data[i];
+        wrapper->preroll_pos = (wrapper->preroll_pos + 1) % wrapper->preroll_size;
+    }
+    wrapper->preroll_fill += samples;
+    if (wrapper->preroll_fill > wrapper->preroll_size) {
+        wrapper->preroll_fill = wrapper->preroll_size;
+    }
+}
+
+static void afe_sim_preroll_flush(afe_wrapper_t *wrapper)
+{
+    size_t remain = wrapper->preroll_fill;
+    size_t pos = (wrapper->preroll_pos + wrapper->preroll_size - remain) % wrapper->preroll_size;
+
+    while (remain > 0) {
+        size_t chunk = wrapper->preroll_size - pos;
+        if (chunk > remain) chunk = remain;
+        if (chunk > AFE_SIM_FRAME_SAMPLES) chunk = AFE_SIM_FRAME_SAMPLES;
+
+        wrapper->record_callback(wrapper->preroll_buf + pos, chunk, wrapper->record_ctx);
+        wrapper->record_samples += chunk;
+        pos = (pos + chunk) % wrapper->preroll_size;
+        remain -= chunk;
+    }
+    wrapper->preroll_fill = 0;
+}
+
+/**
+ * @brief 帧能量 VAD，min_speech_ms / min_silence_ms 迟滞与 esp-sr 语义一致
+ */
+static void afe_sim_vad(afe_wrapper_t *wrapper, const int16_t *frame, size_t samples)
+{
+    if (!wrapper->vad_config.enabled) {
+        return;
+    }
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < samples; i++) {
+        sum += (uint64_t)abs(frame[i]);
+    }
+    bool loud = (sum / samples) >= (uint64_t)audio_sim_get_io()->vad_threshold;
+
+    afe_event_t event = {0};
+    if (loud) {
+        wrapper->silence_ms = 0;
+        wrapper->speech_ms += AFE_SIM_FRAME_MS;
+        if (!wrapper->vad_active && wrapper->speech_ms >= wrapper->vad_config.min_speech_ms) {
+            wrapper->vad_active = true;
+            event.type = AFE_EVENT_VAD_START;
+            wrapper->event_callback(&event, wrapper->event_ctx);
+        }
+    } else {
+        wrapper->speech_ms = 0;
+        wrapper->silence_ms += AFE_SIM_FRAME_MS;
+        if (wrapper->vad_active && wrapper->silence_ms >= wrapper->vad_config.min_silence_ms) {
+            wrapper->vad_active = false;
+            event.type = AFE_EVENT_VAD_END;
+            wrapper->event_callback(&event, wrapper->event_ctx);
+        }
+    }
+}
+
+static void afe_sim_task(void *arg)
+{
+    afe_wrapper_t *wrapper = (afe_wrapper_t *)arg;
+
+    while (!wrapper->task_exit) {
+        if (!wrapper->running_ptr || !*wrapper->running_ptr) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            continue;
+        }
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+        uint32_t now_rt = (uint32_t)ulTaskGetRunTimeCounter(NULL);
+        if (wrapper->runtime_last != 0) {
+            wrapper->profile_stats[wrapper->active_profile].fetch_cpu_us += now_rt - wrapper->runtime_last;
+        }
+        wrapper->runtime_last = now_rt;
+#endif
+        if (wrapper->feature_config.dynamic_profile) {
+            afe_sim_apply_pending_profile(wrapper);
+        }
+
+        size_t got = 0;
+        if (audio_bsp_read_mic(wrapper->bsp_handle, wrapper->mic_buffer, AFE_SIM_FRAME_SAMPLES, &got) != ESP_OK ||
+            got == 0) {
+            continue;
+        }
+        wrapper->mic_samples += got;
+
+        // 与真实实现一样消费回采数据，保持回采缓冲区水位真实
+        ring_buffer_read(wrapper->reference_rb, wrapper->ref_buffer, got, 0);
+
+        wrapper->profile_stats[wrapper->active_profile].frames++;
+        afe_sim_vad(wrapper, wrapper->mic_buffer, got);
+
+        // 直通输出（桩 AFE 不做 AEC/NS/AGC）
+        wrapper->out_samples += got;
+        bool recording = wrapper->recording_ptr && *wrapper->recording_ptr;
+        if (wrapper->record_callback) {
+            if (recording) {
+                if (!wrapper->was_recording && wrapper->preroll_buf) {
+                    afe_sim_preroll_flush(wrapper);
+                }
+                wrapper->record_callback(wrapper->mic_buffer, got, wrapper->record_ctx);
+                wrapper->record_samples += got;
+            } else if (wrapper->preroll_buf) {
+                afe_sim_preroll_push(wrapper, wrapper->mic_buffer, got);
+            }
+        }
+        wrapper->was_recording = recording;
+    }
+
+    wrapper->task = NULL;
+    vTaskDelete(NULL);
+}
+
+afe_wrapper_handle_t afe_wrapper_create(const afe_wrapper_config_t *config)
+{
+    if (!config || !config->bsp_handle || !config->reference_rb || !config->event_callback) {
+        ESP_LOGE(TAG, "无效的配置参数");
+        return NULL;
+    }
+
+    afe_wrapper_t *wrapper = (afe_wrapper_t *)calloc(1, sizeof(afe_wrapper_t));
+    if (!wrapper) {
+        ESP_LOGE(TAG, "AFE 包装器分配失败");
+        return NULL;
+    }
+
+    wrapper->bsp_handle = config->bsp_handle;
+    wrapper->reference_rb = config->reference_rb;
+    wrapper->wakeup_config = config->wakeup_config;
+    wrapper->vad_config = config->vad_config;
+    wrapper->feature_config = config->feature_config;
+    wrapper->event_callback = config->event_callback;
+    wrapper->event_ctx = config->event_ctx;
+    wrapper->record_callback = config->record_callback;
+    wrapper->record_ctx = config->record_ctx;
+    wrapper->running_ptr = config->running_ptr;
+    wrapper->recording_ptr = config->recording_ptr;
+    wrapper->active_profile = AFE_PROFILE_CONVERSATION;
+    wrapper->pending_profile = config->feature_config.dynamic_profile ? AFE_PROFILE_IDLE
+                                                                       : AFE_PROFILE_CONVERSATION;
+    wrapper->profile_enter_us = esp_timer_get_time();
+
+    if (config->vad_config.preroll_ms > 0) {
+        wrapper->preroll_size = (size_t)config->vad_config.preroll_ms * AFE_SIM_SAMPLE_RATE / 1000;
+        wrapper->preroll_buf = (int16_t *)audio_mem_take(AUDIO_MEM_PREROLL,
+                                                         wrapper->preroll_size * sizeof(int16_t), 0);
+        if (!wrapper->preroll_buf) {
+            free(wrapper);
+            return NULL;
+        }
+    }
+
+    if (xTaskCreatePinnedToCore(afe_sim_task, "afe_sim", 4096, wrapper, 8, &wrapper->task, 0) != pdPASS) {
+        ESP_LOGE(TAG, "AFE 仿真任务创建失败");
+        audio_mem_release(AUDIO_MEM_PREROLL, wrapper->preroll_buf);
+        free(wrapper);
+        return NULL;
+    }
+
+    ESP_LOGI(TAG, "✅ AFE 仿真桩创建成功（VAD 门限 %d）", audio_sim_get_io()->vad_threshold);
+    return wrapper;
+}
+
+void afe_wrapper_destroy(afe_wrapper_handle_t wrapper)
+{
+    if (!wrapper) return;
+
+    wrapper->task_exit = true;
+    while (wrapper->task) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    audio_mem_release(AUDIO_MEM_PREROLL, wrapper->preroll_buf);
+    free(wrapper);
+}
+
+esp_err_t afe_wrapper_update_wakeup_config(afe_wrapper_handle_t wrapper,
+                                            const afe_wakeup_config_t *config)
+{
+    if (!wrapper || !config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    wrapper->wakeup_config = *config;
+    return ESP_OK;
+}
+
+esp_err_t afe_wrapper_get_wakeup_config(afe_wrapper_handle_t wrapper,
+                                         afe_wakeup_config_t *config)
+{
+    if (!wrapper || !config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *config = wrapper->wakeup_config;
+    return ESP_OK;
+}
+
+esp_err_t afe_wrapper_set_profile(afe_wrapper_handle_t wrapper, afe_profile_t profile)
+{
+    if (!wrapper || profile >= AFE_PROFILE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!wrapper->feature_config.dynamic_profile) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    wrapper->pending_profile = profile;
+    return ESP_OK;
+}
+
+afe_profile_t afe_wrapper_get_profile(afe_wrapper_handle_t wrapper)
+{
+    return wrapper ? wrapper->active_profile : AFE_PROFILE_CONVERSATION;
+}
+
+esp_err_t afe_wrapper_get_stats(afe_wrapper_handle_t wrapper, afe_wrapper_stats_t *stats)
+{
+    if (!wrapper || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    afe_profile_t current = wrapper->active_profile;
+    stats->current = current;
+    stats->switch_count = wrapper->switch_count;
+    memcpy(stats->profile, wrapper->profile_stats, sizeof(stats->profile));
+    stats->profile[current].active_us += esp_timer_get_time() - wrapper->profile_enter_us;
+    stats->mic_samples = wrapper->mic_samples;
+    stats->out_samples = wrapper->out_samples;
+    stats->record_samples = wrapper->record_samples;
+    return ESP_OK;
+}
@@ -0,0 +1,328 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-02
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-02
+ * @FilePath: \xn_esp32_audio\components\xn_audio_manager\src\sim\audio_bsp_sim.c
+ * @Description: 音频 BSP 主机仿真实现 - 麦克风读 WAV 文件，扬声器写 WAV 文件
+ */
+#include "audio_bsp.h"
+#include "audio_sim_internal.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "audio_bsp_sim";
+
+#define WAV_HEADER_SIZE 44
+
+struct audio_bsp_s {
+    FILE *mic_file;                 ///< 麦克风输入文件
+    long mic_data_offset;           ///< data 块起始偏移
+    uint32_t mic_data_bytes;        ///< data 块长度
+    uint32_t mic_read_bytes;        ///< 当前遍历已读取字节数
+    int mic_rate;                   ///< 麦克风采样率
+    uint64_t mic_samples;           ///< 累计读取采样点数（节拍时钟）
+    int64_t mic_start_us;           ///< 首次读取时间
+
+    FILE *spk_file;                 ///< 扬声器输出文件
+    int spk_rate;                   ///< 扬声器采样率
+    uint32_t spk_data_bytes;        ///< 已写入 data 字节数
+    int64_t spk_start_us;           ///< 首次写入时间
+};
+
+static audio_sim_io_config_t s_io = {0};
+static bool s_io_set = false;
+static volatile bool s_mic_finished = false;
+static volatile uint64_t s_spk_samples = 0;
+
+esp_err_t audio_sim_set_io(const audio_sim_io_config_t *config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_io = *config;
+    s_io_set = true;
+    s_mic_finished = false;
+    s_spk_samples = 0;
+    return ESP_OK;
+}
+
+const audio_sim_io_config_t *audio_sim_get_io(void)
+{
+    if (!s_io_set) {
+        s_io = AUDIO_SIM_DEFAULT_IO_CONFIG();
+        s_io_set = true;
+    }
+    return &s_io;
+}
+
+bool audio_sim_mic_finished(void)
+{
+    return s_mic_finished;
+}
+
+uint64_t audio_sim_speaker_samples(void)
+{
+    return s_spk_samples;
+}
+
+static uint32_t read_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void write_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; p[2] = (v >> 16) & 0xFF; p[3] = (v >> 24) & 0xFF;
+}
+
+static void write_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF;
+}
+
+/**
+ * @brief 解析 WAV 头，定位 data 块（仅支持 16bit PCM 单声道）
+ */
+static esp_err_t wav_open_input(struct audio_bsp_s *bsp, const char *path)
+{
+    bsp->mic_file = fopen(path, "rb");
+    if (!bsp->mic_file) {
+        ESP_LOGE(TAG, "无法打开输入 WAV: %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint8_t hdr[12];
+    if (fread(hdr, 1, sizeof(hdr), bsp->mic_file) != sizeof(hdr) ||
+        memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0) {
+        ESP_LOGE(TAG, "不是有效的 WAV 文件: %s", path);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t chunk[8];
+    while (fread(chunk, 1, sizeof(chunk), bsp->mic_file) == sizeof(chunk)) {
+        uint32_t len = read_le32(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (len < sizeof(fmt) || fread(fmt, 1, sizeof(fmt), bsp->mic_file) != sizeof(fmt)) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            uint16_t format = read_le16(fmt);
+            uint16_t channels = read_le16(fmt + 2);
+            uint32_t rate = read_le32(fmt + 4);
+            uint16_t bits = read_le16(fmt + 14);
+            if (format != 1 || channels != 1 || bits != 16) {
+                ESP_LOGE(TAG, "仅支持 16bit PCM 单声道 WAV（fmt=%u ch=%u bits=%u）", format, channels, bits);
+                return ESP_ERR_NOT_SUPPORTED;
+            }
+            if ((int)rate != bsp->mic_rate) {
+                ESP_LOGW(TAG, "WAV 采样率 %u 与麦克风配置 %d 不一致，按配置节拍读取", (unsigned)rate, bsp->mic_rate);
+            }
+            fseek(bsp->mic_file, (long)(len - sizeof(fmt) + (len & 1)), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            bsp->mic_data_offset = ftell(bsp->mic_file);
+            bsp->mic_data_bytes = len;
+            return ESP_OK;
+        } else {
+            fseek(bsp->mic_file, (long)(len + (len & 1)), SEEK_CUR);
+        }
+    }
+
+    ESP_LOGE(TAG, "WAV 缺少 data 块: %s", path);
+    return ESP_ERR_INVALID_ARG;
+}
+
+/**
+ * @brief 回填输出 WAV 头（关闭前调用）
+ */
+static void wav_finalize_output(struct audio_bsp_s *bsp)
+{
+    uint8_t hdr[WAV_HEADER_SIZE] = {0};
+    memcpy(hdr, "RIFF", 4);
+    write_le32(hdr + 4, 36 + bsp->spk_data_bytes);
+    memcpy(hdr + 8, "WAVEfmt ", 8);
+    write_le32(hdr + 16, 16);
+    write_le16(hdr + 20, 1);
+    write_le16(hdr + 22, 1);
+    write_le32(hdr + 24, (uint32_t)bsp->spk_rate);
+    write_le32(hdr + 28, (uint32_t)bsp->spk_rate * 2);
+    write_le16(hdr + 32, 2);
+    write_le16(hdr + 34, 16);
+    memcpy(hdr + 36, "data", 4);
+    write_le32(hdr + 40, bsp->spk_data_bytes);
+
+    fseek(bsp->spk_file, 0, SEEK_SET);
+    fwrite(hdr, 1, sizeof(hdr), bsp->spk_file);
+}
+
+/**
+ * @brief 按采样点节拍等待，模拟 I2S DMA 的时序
+ * 
+ * @param start_us 节拍起点
+ * @param samples 已处理的采样点数
+ * @param rate 采样率
+ * @param yield_when_fast 尽快模式下是否让出 1 tick（让低优先级任务得以运行）
+ */
+static void sim_pace(int64_t start_us, uint64_t samples, int rate, bool yield_when_fast)
+{
+    int speed = s_io.speed;
+    if (speed <= 0) {
+        if (yield_when_fast) {
+            vTaskDelay(1);
+        }
+        return;
+    }
+
+    int64_t target_us = start_us + (int64_t)(samples * 1000000ULL / (uint64_t)rate / (uint64_t)speed);
+    int64_t wait_us = target_us - esp_timer_get_time();
+    if (wait_us >= 1000) {
+        vTaskDelay(pdMS_TO_TICKS(wait_us / 1000));
+    }
+}
+
+audio_bsp_handle_t audio_bsp_create(const audio_bsp_hw_config_t *config)
+{
+    if (!config) {
+        return NULL;
+    }
+
+    const audio_sim_io_config_t *io = audio_sim_get_io();
+    audio_bsp_handle_t handle = (audio_bsp_handle_t)calloc(1, sizeof(struct audio_bsp_s));
+    if (!handle) {
+        ESP_LOGE(TAG, "alloc audio_bsp failed");
+        return NULL;
+    }
+
+    handle->mic_rate = config->mic.sample_rate > 0 ? config->mic.sample_rate : 16000;
+    handle->spk_rate = config->speaker.sample_rate > 0 ? config->speaker.sample_rate : 16000;
+
+    if (io->mic_wav_path && wav_open_input(handle, io->mic_wav_path) != ESP_OK) {
+        audio_bsp_destroy(handle);
+        return NULL;
+    }
+
+    if (io->speaker_wav_path) {
+        handle->spk_file = fopen(io->speaker_wav_path, "wb");
+        if (!handle->spk_file) {
+            ESP_LOGE(TAG, "无法创建输出 WAV: %s", io->speaker_wav_path);
+            audio_bsp_destroy(handle);
+            return NULL;
+        }
+        uint8_t placeholder[WAV_HEADER_SIZE] = {0};
+        fwrite(placeholder, 1, sizeof(placeholder), handle->spk_file);
+    }
+
+    ESP_LOGI(TAG, "audio BSP (sim) ready: mic=%s spk=%s speed=%d",
+             io->mic_wav_path ? io->mic_wav_path : "(静音)",
+             io->speaker_wav_path ? io->speaker_wav_path : "(丢弃)",
+             io->speed);
+    return handle;
+}
+
+void audio_bsp_destroy(audio_bsp_handle_t handle)
+{
+    if (!handle) {
+        return;
+    }
+
+    if (handle->mic_file) {
+        fclose(handle->mic_file);
+    }
+
+    if (handle->spk_file) {
+        wav_finalize_output(handle);
+        fclose(handle->spk_file);
+    }
+
+    free(handle);
+}
+
+esp_err_t audio_bsp_read_mic(audio_bsp_handle_t handle,
+                             int16_t *out_samples,
+                             size_t sample_count,
+                             size_t *out_got)
+{
+    if (!handle || !out_samples || sample_count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (handle->mic_samples == 0) {
+        handle->mic_start_us = esp_timer_get_time();
+    }
+
+    // 输入读完后以静音补齐，保持节拍不中断
+    size_t got = 0;
+    if (handle->mic_file) {
+        while (got < sample_count) {
+            uint32_t left = handle->mic_data_bytes - handle->mic_read_bytes;
+            if (left < sizeof(int16_t)) {
+                if (!s_io.loop) {
+                    s_mic_finished = true;
+                    break;
+                }
+                fseek(handle->mic_file, handle->mic_data_offset, SEEK_SET);
+                handle->mic_read_bytes = 0;
+                continue;
+            }
+            size_t want = sample_count - got;
+            if (want > left / sizeof(int16_t)) {
+                want = left / sizeof(int16_t);
+            }
+            size_t n = fread(out_samples + got, sizeof(int16_t), want, handle->mic_file);
+            if (n == 0) {
+                s_mic_finished = true;
+                break;
+            }
+            got += n;
+            handle->mic_read_bytes += n * sizeof(int16_t);
+        }
+    } else {
+        s_mic_finished = true;
+    }
+    memset(out_samples + got, 0, (sample_count - got) * sizeof(int16_t));
+
+    handle->mic_samples += sample_count;
+    sim_pace(handle->mic_start_us, handle->mic_samples, handle->mic_rate, true);
+
+    if (out_got) {
+        *out_got = sample_count;
+    }
+    return ESP_OK;
+}
+
+esp_err_t audio_bsp_write_speaker(audio_bsp_handle_t handle,
+                                  const int16_t *samples,
+                                  size_t sample_count,
+                                  uint8_t volume)
+{
+    if (!handle || !samples || sample_count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (s_spk_samples == 0) {
+        handle->spk_start_us = esp_timer_get_time();
+    }
+
+    if (handle->spk_file) {
+        float factor = volume / 100.0f;
+        for (size_t i = 0; i < sample_count; i++) {
+            int16_t v = (int16_t)(samples[i] * factor);
+            fwrite(&v, sizeof(v), 1, handle->spk_file);
+        }
+        handle->spk_data_bytes += sample_count * sizeof(int16_t);
+    }
+
+    s_spk_samples += sample_count;
+    sim_pace(handle->spk_start_us, s_spk_samples, handle->spk_rate, false);
+    return ESP_OK;
+}
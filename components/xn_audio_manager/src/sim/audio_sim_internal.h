@@ -0,0 +1,25 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-02
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-02
+ * @FilePath: \xn_esp32_audio\components\xn_audio_manager\src\sim\audio_sim_internal.h
+ * @Description: 主机仿真模块间共享的内部接口
+ */
+#pragma once
+
+#include "audio_sim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 获取当前仿真 IO 配置（供桩 AFE 读取 VAD 门限等参数）
+ * @return 配置指针
+ */
+const audio_sim_io_config_t *audio_sim_get_io(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,128 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-02
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-02
+ * @FilePath: \xn_esp32_audio\components\xn_audio_manager\src\sim\button_handler_sim.c
+ * @Description: 按键处理模块主机仿真实现 - 电平由 audio_sim_button_set() 脚本驱动
+ */
+#include "button_handler.h"
+#include "audio_sim.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <stdlib.h>
+
+static const char *TAG = "BUTTON_SIM";
+
+typedef struct button_handler_s {
+    bool active_low;
+    uint32_t debounce_ms;
+    button_event_callback_t callback;
+    void *user_ctx;
+    TaskHandle_t button_task;
+    QueueHandle_t button_queue;         ///< 电平变化队列（代替 GPIO 中断）
+    int64_t last_press_time;
+    bool last_state;
+    volatile bool pressed;              ///< 仿真电平（逻辑按下状态）
+} button_handler_t;
+
+static button_handler_t *s_sim_button = NULL;
+
+void audio_sim_button_set(bool pressed)
+{
+    button_handler_t *handler = s_sim_button;
+    if (!handler) {
+        return;
+    }
+    handler->pressed = pressed;
+    uint32_t edge = 1;
+    xQueueSend(handler->button_queue, &edge, 0);
+}
+
+/**
+ * @brief 按键任务，防抖与边沿判断与 button_handler.c 保持一致
+ */
+static void button_task(void *arg)
+{
+    button_handler_t *handler = (button_handler_t *)arg;
+    uint32_t edge;
+
+    while (1) {
+        if (xQueueReceive(handler->button_queue, &edge, portMAX_DELAY)) {
+            int64_t current_time = esp_timer_get_time() / 1000;
+            if (current_time - handler->last_press_time < handler->debounce_ms) {
+                continue;
+            }
+            handler->last_press_time = current_time;
+
+            bool pressed = handler->pressed;
+            if (pressed && !handler->last_state) {
+                ESP_LOGI(TAG, "🔘 按键按下");
+                handler->callback(BUTTON_EVENT_PRESS, handler->user_ctx);
+                handler->last_state = true;
+            } else if (!pressed && handler->last_state) {
+                ESP_LOGI(TAG, "🔘 按键松开");
+                handler->callback(BUTTON_EVENT_RELEASE, handler->user_ctx);
+                handler->last_state = false;
+            }
+        }
+    }
+}
+
+button_handler_handle_t button_handler_create(const button_handler_config_t *config)
+{
+    if (!config || !config->callback) {
+        ESP_LOGE(TAG, "无效的配置参数");
+        return NULL;
+    }
+
+    button_handler_t *handler = (button_handler_t *)calloc(1, sizeof(button_handler_t));
+    if (!handler) {
+        return NULL;
+    }
+
+    handler->active_low = config->active_low;
+    handler->debounce_ms = config->debounce_ms;
+    handler->callback = config->callback;
+    handler->user_ctx = config->user_ctx;
+
+    handler->button_queue = xQueueCreate(10, sizeof(uint32_t));
+    if (!handler->button_queue) {
+        free(handler);
+        return NULL;
+    }
+
+    if (xTaskCreate(button_task, "button_sim", 4096, handler, 4, &handler->button_task) != pdPASS) {
+        vQueueDelete(handler->button_queue);
+        free(handler);
+        return NULL;
+    }
+
+    s_sim_button = handler;
+    ESP_LOGI(TAG, "✅ 仿真按键就绪");
+    return handler;
+}
+
+void button_handler_destroy(button_handler_handle_t handler)
+{
+    if (!handler) return;
+
+    if (s_sim_button == handler) {
+        s_sim_button = NULL;
+    }
+    if (handler->button_task) {
+        vTaskDelete(handler->button_task);
+    }
+    if (handler->button_queue) {
+        vQueueDelete(handler->button_queue);
+    }
+    free(handler);
+}
+
+bool button_handler_is_pressed(button_handler_handle_t handler)
+{
+    return handler ? handler->last_state : false;
+}
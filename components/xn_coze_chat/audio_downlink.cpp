@@ -9,18 +9,38 @@
 #include "opus_buffer.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include <string.h>
 
 static const char *TAG = "AUDIO_DOWNLINK";
 
+#define DOWNLINK_OPUS_MAX_PACKET    512     ///< 单个 Opus 包上限（字节）
+#define DOWNLINK_PREBUFFER_POLL_MS  20      ///< 预缓冲期间检查结束标记的间隔
+#define DOWNLINK_SINK_POLL_MS       100     ///< 等待播放缓冲区空间时检查退出标志的间隔
+#define DOWNLINK_SINK_WAIT_MS       1000    ///< 等待播放缓冲区空间的上限，超时丢弃该帧
+#define DOWNLINK_PCM_MAX_PACKET_MS  200     ///< PCM 下行单包上限（时长），需不小于 pcm_frame_size_ms
+#define DOWNLINK_OPUS_MAX_FRAME_MS  120     ///< Opus 单帧上限（时长）：解码直接输出，缓冲须容纳整帧
+#define DOWNLINK_PCM_BUFFER_MS      30000   ///< PCM 下行缓冲时长（16kHz 单声道约 940KB，PSRAM）
+
 /**
  * @brief 音频下行结构体
  */
 typedef struct audio_downlink_s {
-    // Opus 解码器
+    // Opus 解码器（PCM 下行时为 NULL）
     CozeOpusDecoder *opus_decoder;
+    size_t max_packet_size;      // 单包上限（字节）
+    
+    // PCM 下行重采样（线性插值，解码任务使用）
+    // 下一个输出样本位于输入 s[index-1] 与 s[index] 之间，偏移 rem/out_rate；每输出一个样本 rem 加 in_rate，无累计漂移
+    uint32_t rs_in_rate;         // 服务器采样率，0 表示不重采样
+    uint32_t rs_out_rate;        // 输出采样率
+    uint32_t rs_recip;           // 2^32 / rs_out_rate（rem 换算为 Q16 权重）
+    uint32_t rs_index;
+    uint32_t rs_rem;
+    int16_t rs_last;             // 上一包的最后一个样本（s[-1]）
     
     // Opus包缓冲区（独立模块，环形缓冲区）
     opus_buffer_handle_t opus_buffer;
@@ -30,81 +50,531 @@ typedef struct audio_downlink_s {
     size_t pcm_buffer_size;  // 样本数
     
     // 解码任务
-    TaskHandle_t decode_task;
-    bool decode_running;
+    xn_task_t decode_task;
+    volatile bool decode_running;
     
     // 配置
     audio_downlink_config_t config;
     
-    // 统计信息
+    // 播放控制（解码任务写，接收端读）
+    volatile audio_downlink_state_t state;
+    SemaphoreHandle_t idle_sem;         // 回到 IDLE 时释放（audio_downlink_wait_idle 阻塞于此）
+    volatile bool end_marked;           // 本轮语音已下发完毕
+    volatile uint32_t play_deadline_ms; // 播放端 PCM 耗尽的时刻（esp_timer 毫秒）
+    volatile uint32_t flush_gen;        // 打断代数（audio_downlink_flush 递增）
+    uint32_t frame_gen;                 // 解码任务已处理到的打断代数
+    
+    // 接收端统计（WebSocket 解析任务写）
     uint32_t total_packets;
-    uint32_t error_count;
+    uint32_t total_bytes;
+    uint32_t error_count;        // Base64 格式错误
     uint32_t buffer_full_count;  // 缓冲区满次数
+    uint32_t oversize_count;     // 超过单包上限被拒绝的包数
+    uint32_t late_count;         // 到达时播放端已耗尽
+    uint32_t early_count;        // 到达时缓冲已超过早到阈值
+    uint32_t loss_unmarked;      // 已丢弃但丢包标记尚未写入（缓冲区满）
+    
+    // 解码端统计（解码任务写）
+    uint32_t decoded_frames;
+    uint32_t decode_errors;
+    uint32_t underruns;
+    uint32_t rebuffer_late;      // 欠载后收到的首包（同样是迟到）
+    uint32_t prebuffers;
+    uint64_t played_us;
+    uint64_t decode_us_total;
+    uint64_t decoded_us;         // 正常解码输出的音频时长
+    uint32_t decode_us_max;
+    uint32_t first_audio_ms;
+    uint32_t first_audio_ms_max;
+    
+    // 丢包隐藏（解码任务写）
+    uint32_t lost_pending;       // 等待下一个好包时一并隐藏的丢失帧数
+    size_t last_frame_samples;   // 最近一帧的样本数（估计丢失帧时长）
+    uint32_t lost_frames;
+    uint32_t plc_frames;
+    uint32_t fec_frames;
+    uint32_t unconcealed_frames;
+    uint64_t concealed_us;
+    
+    // PCM 直写统计（解码任务写）
+    uint32_t sink_frames;
+    uint32_t sink_timeouts;
+    uint64_t sink_wait_us;
+    
+    // 打断统计（调用 flush 的任务写）
+    uint32_t flushes;
+    uint32_t flushed_ms;
     
 } audio_downlink_t;
 
 /**
- * @brief Opus解码任务（从环形缓冲区读取Opus包→解码→回调PCM）
+ * @brief 帧输出方式
+ */
+typedef enum {
+    DOWNLINK_FRAME_DECODE = 0,  ///< 正常解码
+    DOWNLINK_FRAME_PLC,         ///< 丢包隐藏
+    DOWNLINK_FRAME_FEC,         ///< 用下一包的带内FEC恢复
+} downlink_frame_mode_t;
+
+static inline uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+/**
+ * @brief 在直写目标中预留空间，等待期间定期检查退出标志
+ * 
+ * @return 可写的连续样本数，超时或退出返回 0
+ */
+static size_t downlink_sink_reserve(audio_downlink_t *downlink, int16_t **ptr, size_t samples)
+{
+    const audio_downlink_sink_t *sink = &downlink->config.sink;
+    int64_t t0 = esp_timer_get_time();
+    size_t got = 0;
+    
+    for (uint32_t waited = 0; waited < DOWNLINK_SINK_WAIT_MS && downlink->decode_running;
+         waited += DOWNLINK_SINK_POLL_MS) {
+        got = sink->reserve(ptr, samples, DOWNLINK_SINK_POLL_MS, sink->ctx);
+        if (got > 0) {
+            break;
+        }
+    }
+    
+    downlink->sink_wait_us += esp_timer_get_time() - t0;
+    return got;
+}
+
+/**
+ * @brief 把解码缓冲中的 PCM 分段写入直写目标（缓冲区末尾处连续空间不足一帧时使用）
+ */
+static bool downlink_sink_write(audio_downlink_t *downlink, const int16_t *pcm, size_t samples)
+{
+    const audio_downlink_sink_t *sink = &downlink->config.sink;
+    
+    while (samples > 0) {
+        int16_t *ptr = NULL;
+        size_t got = downlink_sink_reserve(downlink, &ptr, samples);
+        if (got == 0) {
+            return false;
+        }
+        memcpy(ptr, pcm, got * sizeof(int16_t));
+        sink->commit(got, sink->ctx);
+        pcm += got;
+        samples -= got;
+    }
+    return true;
+}
+
+/**
+ * @brief 重置 PCM 重采样状态（新一轮播放开始时调用，下一个输出样本对齐到包的第一个样本）
+ */
+static void downlink_pcm_reset(audio_downlink_t *downlink)
+{
+    downlink->rs_index = 1;
+    downlink->rs_rem = 0;
+    downlink->rs_last = 0;
+}
+
+/**
+ * @brief PCM 包转换后的输出样本数
+ */
+static size_t downlink_pcm_out_samples(const audio_downlink_t *downlink, size_t len)
+{
+    size_t in_samples = len / sizeof(int16_t);
+    if (downlink->rs_in_rate == 0) {
+        return in_samples;
+    }
+    // 满足 index < n 的输出个数：位置（以 1/out_rate 为单位）从 index*out+rem 起每次加 in_rate
+    uint64_t end = (uint64_t)in_samples * downlink->rs_out_rate;
+    uint64_t pos = (uint64_t)downlink->rs_index * downlink->rs_out_rate + downlink->rs_rem;
+    if (pos >= end) {
+        return 0;
+    }
+    return (size_t)((end - pos + downlink->rs_in_rate - 1) / downlink->rs_in_rate);
+}
+
+/**
+ * @brief PCM 包转换为输出采样率（采样率相同时直接复制）
+ * 
+ * 线性插值，跨包保留上一包末尾样本与插值位置，包边界处连续。
+ * 
+ * @return 输出样本数
+ */
+static size_t downlink_pcm_convert(audio_downlink_t *downlink, const uint8_t *data, size_t len,
+                                   int16_t *out, size_t max_samples)
+{
+    const int16_t *in = (const int16_t *)data;
+    size_t n = len / sizeof(int16_t);
+    if (n == 0) {
+        return 0;
+    }
+    
+    if (downlink->rs_in_rate == 0) {
+        n = n < max_samples ? n : max_samples;
+        memcpy(out, in, n * sizeof(int16_t));
+        return n;
+    }
+    
+    const uint32_t in_rate = downlink->rs_in_rate;
+    const uint32_t out_rate = downlink->rs_out_rate;
+    uint32_t index = downlink->rs_index;
+    uint32_t rem = downlink->rs_rem;
+    size_t produced = 0;
+    while (index < n && produced < max_samples) {
+        int32_t a = index ? in[index - 1] : downlink->rs_last;
+        int32_t b = in[index];
+        int32_t w = (int32_t)(((uint64_t)rem * downlink->rs_recip) >> 16);  // Q16
+        out[produced++] = (int16_t)(a + (int32_t)(((int64_t)(b - a) * w) >> 16));
+        rem += in_rate;
+        while (rem >= out_rate) {
+            rem -= out_rate;
+            index++;
+        }
+    }
+    // 输出缓冲不足时（不应发生）丢弃本包剩余部分，下一包从头对齐
+    downlink->rs_index = index >= n ? index - (uint32_t)n : 0;
+    downlink->rs_rem = index >= n ? rem : 0;
+    downlink->rs_last = in[n - 1];
+    return produced;
+}
+
+/**
+ * @brief 解码或恢复一帧并输出 PCM（直写目标或回调），推进播放时钟
+ * 
+ * 设置了直写目标时先预留一整帧的连续空间，解码器直接写入播放缓冲区；
+ * 空间不足时阻塞到播放端消费，即按真实播放速度节流。
+ * PCM 下行不经解码器：包内 PCM 复制（或重采样）进同一块空间，丢失的包用静音补齐。
+ * 
+ * @return true 已输出一帧；false 解码失败
+ */
+static bool downlink_decode_frame(audio_downlink_t *downlink, downlink_frame_mode_t mode,
+                                  const uint8_t *data, size_t len, int64_t *played_us)
+{
+    const audio_downlink_sink_t *sink = &downlink->config.sink;
+    const bool use_sink = sink->reserve && sink->commit;
+    const bool pcm = downlink->config.codec == AUDIO_DOWNLINK_CODEC_PCM;
+    int16_t *out = downlink->pcm_buffer;
+    bool direct = false;
+    bool sink_ok = true;
+    
+    // 本帧输出上限：Opus 为一整帧缓冲，PCM 按包实际输出样本数预留
+    size_t frame_cap = downlink->pcm_buffer_size;
+    if (pcm) {
+        size_t need = (mode == DOWNLINK_FRAME_PLC) ? downlink->last_frame_samples
+                                                   : downlink_pcm_out_samples(downlink, len);
+        if (need > 0 && need < frame_cap) {
+            frame_cap = need;
+        }
+    }
+    
+    if (use_sink) {
+        int16_t *ptr = NULL;
+        size_t got = downlink_sink_reserve(downlink, &ptr, frame_cap);
+        if (got >= frame_cap) {
+            out = ptr;
+            direct = true;
+        } else if (got == 0) {
+            // 仍然解码以保持解码器状态连续，输出丢弃
+            sink_ok = false;
+        }
+    }
+    
+    size_t decoded_samples = 0;
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret;
+    if (pcm) {
+        // PCM 没有带内冗余，FEC 不可用（创建时已关闭）
+        if (mode == DOWNLINK_FRAME_PLC) {
+            memset(out, 0, frame_cap * sizeof(int16_t));
+            decoded_samples = frame_cap;
+        } else if (mode == DOWNLINK_FRAME_DECODE) {
+            decoded_samples = downlink_pcm_convert(downlink, data, len, out, frame_cap);
+        }
+        ret = ESP_OK;
+    } else {
+        switch (mode) {
+        case DOWNLINK_FRAME_PLC:
+            ret = downlink->opus_decoder->Conceal(out, downlink->pcm_buffer_size, &decoded_samples);
+            break;
+        case DOWNLINK_FRAME_FEC:
+            ret = downlink->opus_decoder->DecodeFec(data, len, out, downlink->pcm_buffer_size, &decoded_samples);
+            break;
+        default:
+            ret = downlink->opus_decoder->Decode(data, len, out, downlink->pcm_buffer_size, &decoded_samples);
+            break;
+        }
+    }
+    uint32_t cost_us = (uint32_t)(esp_timer_get_time() - t0);
+    
+    if (ret != ESP_OK || decoded_samples == 0) {
+        // 未提交的预留不占用播放缓冲区
+        return false;
+    }
+    
+    // 解码期间被打断：输出作废（未提交的预留不占用播放缓冲区）
+    if (downlink->flush_gen != downlink->frame_gen) {
+        return true;
+    }
+    
+    int64_t frame_us = (int64_t)decoded_samples * 1000000 /
+                       (downlink->config.sample_rate * downlink->config.channels);
+    
+    if (mode == DOWNLINK_FRAME_DECODE) {
+        downlink->decoded_frames++;
+        downlink->decode_us_total += cost_us;
+        downlink->decoded_us += frame_us;
+        if (cost_us > downlink->decode_us_max) {
+            downlink->decode_us_max = cost_us;
+        }
+        downlink->last_frame_samples = decoded_samples;
+    } else {
+        if (mode == DOWNLINK_FRAME_FEC) {
+            downlink->fec_frames++;
+        } else {
+            downlink->plc_frames++;
+        }
+        downlink->concealed_us += frame_us;
+    }
+    
+    // 输出 PCM：直写目标（提交或分段写入）或回调给播放器
+    if (direct) {
+        sink->commit(decoded_samples, sink->ctx);
+        downlink->sink_frames++;
+    } else if (use_sink) {
+        if (sink_ok) {
+            sink_ok = downlink_sink_write(downlink, out, decoded_samples);
+        }
+        if (!sink_ok) {
+            downlink->sink_timeouts++;
+        }
+    } else if (downlink->config.callback) {
+        downlink->config.callback(out, decoded_samples, downlink->config.callback_ctx);
+    }
+    
+    *played_us += frame_us;
+    downlink->played_us += frame_us;
+    return true;
+}
+
+/**
+ * @brief 等到已送出的 PCM 领先播放时钟不超过 lead_ms（连续输出多帧时使用）
+ */
+static void downlink_wait_lead(audio_downlink_t *downlink, int64_t play_start_us, int64_t played_us)
+{
+    int64_t lead_us = (int64_t)downlink->config.lead_ms * 1000;
+    if (lead_us == 0) {
+        return;
+    }
+    
+    int64_t over_us = play_start_us + played_us - esp_timer_get_time() - lead_us;
+    TickType_t ticks = over_us > 0 ? pdMS_TO_TICKS(over_us / 1000) : 0;
+    if (ticks > 0 && downlink->decode_running) {
+        vTaskDelay(ticks);
+    }
+}
+
+/**
+ * @brief 在好包之前补上丢失的帧
+ * 
+ * 最靠近好包的一帧优先用该包的带内FEC恢复（next_data 为 NULL 时全部用PLC）；
+ * 补齐时长不超过 plc_max_ms，超出部分直接跳过（避免长时间的合成音）。
+ */
+static void downlink_conceal_gap(audio_downlink_t *downlink, const uint8_t *next_data, size_t next_len,
+                                 int64_t play_start_us, int64_t *played_us)
+{
+    uint32_t lost = downlink->lost_pending;
+    downlink->lost_pending = 0;
+    
+    size_t frame_samples = downlink->last_frame_samples ? downlink->last_frame_samples
+                                                        : downlink->pcm_buffer_size;
+    uint32_t frame_ms = (uint32_t)(frame_samples * 1000 /
+                                   (downlink->config.sample_rate * downlink->config.channels));
+    uint32_t max_frames = frame_ms ? downlink->config.plc_max_ms / frame_ms : 0;
+    uint32_t conceal = lost < max_frames ? lost : max_frames;
+    downlink->unconcealed_frames += lost - conceal;
+    
+    for (uint32_t i = 0; i < conceal && downlink->flush_gen == downlink->frame_gen; i++) {
+        downlink_wait_lead(downlink, play_start_us, *played_us);
+        bool last = (i + 1 == conceal);
+        if (last && next_data && downlink->config.fec_enable &&
+            downlink_decode_frame(downlink, DOWNLINK_FRAME_FEC, next_data, next_len, played_us)) {
+            break;
+        }
+        if (!downlink_decode_frame(downlink, DOWNLINK_FRAME_PLC, NULL, 0, played_us)) {
+            downlink->unconcealed_frames += conceal - i;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 回到 IDLE 并唤醒等待播放结束的任务
+ */
+static void downlink_set_idle(audio_downlink_t *downlink)
+{
+    downlink->state = AUDIO_DOWNLINK_IDLE;
+    xSemaphoreGive(downlink->idle_sem);
+}
+
+/**
+ * @brief Opus解码任务（播放控制：预缓冲 → 按播放时钟节流解码 → 回调PCM）
+ * 
+ * 播放时钟从起播时刻开始按实时流逝，已送出的 PCM 时长超过时钟 lead_ms 时等待，
+ * 缓冲耗尽时等到播放端即将用完；仍无数据且未收到结束标记即为欠载，回到预缓冲。
+ * 丢包标记与解码失败的包在下一个好包到达时用FEC/PLC补齐，保持播放时钟连续。
  */
 static void opus_decode_task(void *arg)
 {
     audio_downlink_t *downlink = (audio_downlink_t *)arg;
     
     // 临时缓冲区（读取Opus数据）
-    uint8_t *opus_temp = (uint8_t *)heap_caps_malloc(512, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    uint8_t *opus_temp = (uint8_t *)heap_caps_malloc(downlink->max_packet_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     if (!opus_temp) {
         ESP_LOGE(TAG, "解码任务临时缓冲区分配失败");
         vTaskDelete(NULL);
         return;
     }
     
-    ESP_LOGI(TAG, "🚀 Opus解码任务启动");
+    ESP_LOGI(TAG, "🚀 %s任务启动", downlink->opus_decoder ? "Opus解码" : "PCM播放");
+    
+    const int64_t lead_us = (int64_t)downlink->config.lead_ms * 1000;
+    int64_t play_start_us = 0;  // 播放时钟起点
+    int64_t played_us = 0;      // 本次起播以来送出的 PCM 时长
+    int64_t wait_start_us = 0;  // 首包到达时刻
+    bool after_underrun = false;
     
     while (downlink->decode_running) {
-        // 从环形缓冲区读取Opus包（阻塞等待）
+        if (downlink->flush_gen != downlink->frame_gen) {
+            // 被打断：缓冲已由 flush 清空，丢弃本轮状态，新音频重新预缓冲起播
+            downlink->frame_gen = downlink->flush_gen;
+            downlink->lost_pending = 0;
+            after_underrun = false;
+            downlink_set_idle(downlink);
+            continue;
+        }
+        
+        if (downlink->state == AUDIO_DOWNLINK_IDLE) {
+            // 等待首包
+            if (opus_buffer_wait(downlink->opus_buffer, 0, portMAX_DELAY) != ESP_OK) {
+                continue;
+            }
+            if (after_underrun) {
+                downlink->rebuffer_late++;
+                after_underrun = false;
+            }
+            wait_start_us = esp_timer_get_time();
+            downlink_pcm_reset(downlink);
+            downlink->prebuffers++;
+            downlink->state = AUDIO_DOWNLINK_PREBUFFERING;
+        }
+        
+        if (downlink->state == AUDIO_DOWNLINK_PREBUFFERING) {
+            // 缓冲达到预缓冲时长或本轮已下发完毕后起播
+            if (opus_buffer_wait(downlink->opus_buffer, downlink->config.prebuffer_ms,
+                                 DOWNLINK_PREBUFFER_POLL_MS) != ESP_OK &&
+                !downlink->end_marked) {
+                continue;
+            }
+            play_start_us = esp_timer_get_time();
+            played_us = 0;
+            downlink->first_audio_ms = (uint32_t)((play_start_us - wait_start_us) / 1000);
+            if (downlink->first_audio_ms > downlink->first_audio_ms_max) {
+                downlink->first_audio_ms_max = downlink->first_audio_ms;
+            }
+            downlink->play_deadline_ms = (uint32_t)(play_start_us / 1000);
+            downlink->state = AUDIO_DOWNLINK_PLAYING;
+            ESP_LOGI(TAG, "▶️ 起播: 缓冲 %lu ms, 等待 %lu ms",
+                     opus_buffer_get_duration_ms(downlink->opus_buffer), downlink->first_audio_ms);
+        }
+        
+        // 节流：已送出的 PCM 领先播放时钟不超过 lead_ms
+        int64_t ahead_us = play_start_us + played_us - esp_timer_get_time();
+        if (lead_us > 0 && ahead_us > lead_us) {
+            TickType_t ticks = pdMS_TO_TICKS((ahead_us - lead_us) / 1000);
+            if (ticks > 0) {
+                vTaskDelay(ticks);
+                continue;
+            }
+        }
+        
         size_t opus_len = 0;
-        esp_err_t ret = opus_buffer_read(
-            downlink->opus_buffer,
-            opus_temp,
-            512,
-            &opus_len,
-            portMAX_DELAY
-        );
+        esp_err_t ret = opus_buffer_read(downlink->opus_buffer, opus_temp, downlink->max_packet_size, &opus_len, 0);
+        if (ret != ESP_OK && !downlink->end_marked && ahead_us > 0) {
+            // 缓冲为空：最多等到播放端耗尽
+            ret = opus_buffer_read(downlink->opus_buffer, opus_temp, downlink->max_packet_size, &opus_len,
+                                   (uint32_t)(ahead_us / 1000) + 1);
+        }
         
-        if (ret == ESP_OK && opus_len > 0) {
-            // 解码Opus → PCM
-            size_t decoded_samples = 0;
-            ret = downlink->opus_decoder->Decode(
-                opus_temp,
-                opus_len,
-                downlink->pcm_buffer,
-                downlink->pcm_buffer_size,
-                &decoded_samples
-            );
-            
-            if (ret == ESP_OK && decoded_samples > 0) {
-                // 回调PCM数据给播放器
-                if (downlink->config.callback) {
-                    downlink->config.callback(
-                        downlink->pcm_buffer,
-                        decoded_samples,
-                        downlink->config.callback_ctx
-                    );
-                }
+        if (ret == ESP_ERR_INVALID_SIZE) {
+            // 理论上不会出现（写入端已限制单包大小），跳过该包避免卡死
+            downlink->decode_errors++;
+            opus_buffer_clear(downlink->opus_buffer);
+            continue;
+        }
+        
+        if (ret != ESP_OK) {
+            if (!downlink->decode_running) {
+                break;
+            }
+            if (downlink->flush_gen != downlink->frame_gen) {
+                continue;  // 被打断清空，不计欠载
+            }
+            if (downlink->lost_pending > 0 && !downlink->end_marked) {
+                // 丢包后暂无后续包：先用PLC补上丢失的帧，保持播放不断
+                downlink_conceal_gap(downlink, NULL, 0, play_start_us, &played_us);
+                downlink->play_deadline_ms = (uint32_t)((play_start_us + played_us) / 1000);
+                continue;
+            }
+            // 结尾处的丢包不再隐藏
+            downlink->unconcealed_frames += downlink->lost_pending;
+            downlink->lost_pending = 0;
+            if (downlink->end_marked) {
+                downlink->end_marked = false;
+                ESP_LOGI(TAG, "⏹️ 本轮播放完毕: %lu ms", (uint32_t)(played_us / 1000));
             } else {
-                downlink->error_count++;
+                downlink->underruns++;
+                after_underrun = true;
+                ESP_LOGW(TAG, "⚠️ 播放欠载 (第 %lu 次)，重新预缓冲", downlink->underruns);
             }
+            downlink_set_idle(downlink);
+            continue;
         }
+        
+        if (opus_len == 0) {
+            // 丢包标记：等下一个好包到达时一并隐藏（以便使用其中的FEC）
+            downlink->lost_frames++;
+            downlink->lost_pending++;
+            continue;
+        }
+        
+        // 解码落后于播放时钟（播放端已断流）：计为欠载并重新对齐时钟
+        if (played_us > 0 && ahead_us < 0) {
+            downlink->underruns++;
+            play_start_us -= ahead_us;
+        }
+        
+        if (downlink->lost_pending > 0) {
+            downlink_conceal_gap(downlink, opus_temp, opus_len, play_start_us, &played_us);
+            downlink_wait_lead(downlink, play_start_us, played_us);
+        }
+        
+        if (!downlink_decode_frame(downlink, DOWNLINK_FRAME_DECODE, opus_temp, opus_len, &played_us)) {
+            // 坏包同样当作丢失，由下一包的FEC或PLC补上
+            downlink->decode_errors++;
+            downlink->lost_frames++;
+            downlink->lost_pending++;
+        }
+        downlink->play_deadline_ms = (uint32_t)((play_start_us + played_us) / 1000);
     }
     
     heap_caps_free(opus_temp);
-    ESP_LOGI(TAG, "Opus解码任务退出");
+    ESP_LOGI(TAG, "%s任务退出", downlink->opus_decoder ? "Opus解码" : "PCM播放");
     vTaskDelete(NULL);
 }
 
 audio_downlink_handle_t audio_downlink_create(const audio_downlink_config_t *config)
 {
-    if (!config || !config->callback) {
+    if (!config || (!config->callback && !(config->sink.reserve && config->sink.commit))) {
         ESP_LOGE(TAG, "无效的配置参数");
         return NULL;
     }
@@ -119,21 +589,46 @@ audio_downlink_handle_t audio_downlink_create(const audio_downlink_config_t *con
     // 复制配置
     memcpy(&downlink->config, config, sizeof(audio_downlink_config_t));
     
-    // 创建 Opus 解码器
-    downlink->opus_decoder = new CozeOpusDecoder(config->sample_rate, config->channels);
-    if (!downlink->opus_decoder || !downlink->opus_decoder->IsReady()) {
-        ESP_LOGE(TAG, "创建 Opus 解码器失败");
+    const bool pcm = config->codec == AUDIO_DOWNLINK_CODEC_PCM;
+    const int in_rate = (pcm && config->pcm_sample_rate > 0) ? config->pcm_sample_rate : config->sample_rate;
+    if (pcm && in_rate != config->sample_rate && config->channels != 1) {
+        ESP_LOGE(TAG, "PCM重采样仅支持单声道");
         delete downlink;
         return NULL;
     }
     
-    // 创建Opus缓冲区（环形缓冲区，2000包 ≈ 120秒音频）
-    // 每包~200字节（压缩后），总大小 ≈ 400KB（一次分配，PSRAM）
+    // 创建包缓冲区（按包实际大小占用，一次分配，PSRAM）
+    // Opus：256KB ≈ 16kbps 下 120秒音频；PCM：DOWNLINK_PCM_BUFFER_MS 的原始音频
     opus_buffer_config_t opus_buf_cfg = {
-        .capacity = 2000,           // 2000包
-        .max_packet_size = 512,     // 单包最大512字节
+        .buffer_size = 256 * 1024,
+        .max_packet_size = DOWNLINK_OPUS_MAX_PACKET,
+        .pcm_byte_rate = 0,
     };
     
+    if (pcm) {
+        // PCM 下行不创建解码器，FEC 不可用
+        uint32_t byte_rate = (uint32_t)(in_rate * config->channels * sizeof(int16_t));
+        opus_buf_cfg.pcm_byte_rate = byte_rate;
+        opus_buf_cfg.max_packet_size = byte_rate * DOWNLINK_PCM_MAX_PACKET_MS / 1000;
+        opus_buf_cfg.buffer_size = (size_t)byte_rate * DOWNLINK_PCM_BUFFER_MS / 1000;
+        downlink->config.fec_enable = false;
+        if (in_rate != config->sample_rate) {
+            downlink->rs_in_rate = (uint32_t)in_rate;
+            downlink->rs_out_rate = (uint32_t)config->sample_rate;
+            downlink->rs_recip = (uint32_t)((1ULL << 32) / (uint32_t)config->sample_rate);
+        }
+        downlink_pcm_reset(downlink);
+    } else {
+        downlink->opus_decoder = new CozeOpusDecoder(config->sample_rate, config->channels);
+        if (!downlink->opus_decoder || !downlink->opus_decoder->IsReady()) {
+            ESP_LOGE(TAG, "创建 Opus 解码器失败");
+            delete downlink->opus_decoder;
+            delete downlink;
+            return NULL;
+        }
+    }
+    downlink->max_packet_size = opus_buf_cfg.max_packet_size;
+    
     downlink->opus_buffer = opus_buffer_create(&opus_buf_cfg);
     if (!downlink->opus_buffer) {
         ESP_LOGE(TAG, "创建Opus缓冲区失败");
@@ -142,8 +637,9 @@ audio_downlink_handle_t audio_downlink_create(const audio_downlink_config_t *con
         return NULL;
     }
     
-    // 预分配 PCM 缓冲区（16kHz * 60ms = 960 样本）
-    downlink->pcm_buffer_size = 960;
+    // 预分配 PCM 缓冲区（Opus：最长帧 120ms，16kHz 为 1920 样本；PCM：单包上限重采样后的样本数）
+    downlink->pcm_buffer_size = pcm ? (size_t)config->sample_rate * config->channels * DOWNLINK_PCM_MAX_PACKET_MS / 1000 + 1
+                                    : (size_t)config->sample_rate * config->channels * DOWNLINK_OPUS_MAX_FRAME_MS / 1000;
     downlink->pcm_buffer = (int16_t *)heap_caps_malloc(
         downlink->pcm_buffer_size * sizeof(int16_t),
         MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT
@@ -157,16 +653,9 @@ audio_downlink_handle_t audio_downlink_create(const audio_downlink_config_t *con
         return NULL;
     }
     
-    // 启动解码任务（优先级5，栈8KB在PSRAM）
-    downlink->decode_running = true;
-    
-    StaticTask_t *decode_tcb = (StaticTask_t *)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-    StackType_t *decode_stack = (StackType_t *)heap_caps_malloc(8192, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    
-    if (!decode_tcb || !decode_stack) {
-        ESP_LOGE(TAG, "解码任务内存分配失败");
-        if (decode_tcb) heap_caps_free(decode_tcb);
-        if (decode_stack) heap_caps_free(decode_stack);
+    downlink->idle_sem = xSemaphoreCreateBinary();
+    if (!downlink->idle_sem) {
+        ESP_LOGE(TAG, "创建信号量失败");
         heap_caps_free(downlink->pcm_buffer);
         opus_buffer_destroy(downlink->opus_buffer);
         delete downlink->opus_decoder;
@@ -174,21 +663,14 @@ audio_downlink_handle_t audio_downlink_create(const audio_downlink_config_t *con
         return NULL;
     }
     
-    downlink->decode_task = xTaskCreateStaticPinnedToCore(
-        opus_decode_task,
-        "opus_decode",
-        8192 / sizeof(StackType_t),
-        downlink,
-        5,              // 优先级5
-        decode_stack,
-        decode_tcb,
-        0               // Core 0
-    );
+    // 按调度档案启动解码任务（均衡预设：Core 0，优先级5，栈8KB在PSRAM）
+    downlink->decode_running = true;
     
-    if (!downlink->decode_task) {
+    const xn_task_sched_t *decode_sched = config->task_sched ? config->task_sched
+                                                             : xn_sched_get(NULL, XN_TASK_OPUS_DECODE);
+    if (xn_task_create(&downlink->decode_task, decode_sched, opus_decode_task, "opus_decode", downlink) != ESP_OK) {
         ESP_LOGE(TAG, "创建解码任务失败");
-        heap_caps_free(decode_tcb);
-        heap_caps_free(decode_stack);
+        vSemaphoreDelete(downlink->idle_sem);
         heap_caps_free(downlink->pcm_buffer);
         opus_buffer_destroy(downlink->opus_buffer);
         delete downlink->opus_decoder;
@@ -199,8 +681,17 @@ audio_downlink_handle_t audio_downlink_create(const audio_downlink_config_t *con
     ESP_LOGI(TAG, "✅ 音频下行模块创建成功（环形缓冲区架构）");
     ESP_LOGI(TAG, "  采样率: %d Hz", config->sample_rate);
     ESP_LOGI(TAG, "  声道数: %d", config->channels);
-    ESP_LOGI(TAG, "  Opus缓冲: 2000 包 (~120秒)");
+    if (pcm) {
+        ESP_LOGI(TAG, "  下行编码: PCM %d Hz%s", in_rate, downlink->rs_in_rate ? "（线性插值重采样）" : "");
+        ESP_LOGI(TAG, "  PCM缓冲: %d KB (~%d秒)", (int)(opus_buf_cfg.buffer_size / 1024), DOWNLINK_PCM_BUFFER_MS / 1000);
+    } else {
+        ESP_LOGI(TAG, "  下行编码: Opus");
+        ESP_LOGI(TAG, "  Opus缓冲: %d KB (~120秒@16kbps)", (int)(opus_buf_cfg.buffer_size / 1024));
+    }
     ESP_LOGI(TAG, "  PCM缓冲: %d 样本 (PSRAM)", downlink->pcm_buffer_size);
+    ESP_LOGI(TAG, "  预缓冲: %lu ms, 解码领先: %lu ms", config->prebuffer_ms, config->lead_ms);
+    ESP_LOGI(TAG, "  丢包隐藏: 最长 %lu ms, FEC: %s", config->plc_max_ms, downlink->config.fec_enable ? "开" : "关");
+    ESP_LOGI(TAG, "  PCM输出: %s", (config->sink.reserve && config->sink.commit) ? "直接解码进播放缓冲区" : "回调");
     
     return downlink;
 }
@@ -209,11 +700,11 @@ void audio_downlink_destroy(audio_downlink_handle_t handle)
 {
     if (!handle) return;
     
-    // 停止解码任务
-    if (handle->decode_task) {
+    // 停止解码任务（唤醒阻塞在读取中的任务）
+    if (handle->decode_task.handle) {
         handle->decode_running = false;
-        vTaskDelay(pdMS_TO_TICKS(100));  // 等待任务退出
-        handle->decode_task = NULL;
+        opus_buffer_wake(handle->opus_buffer);
+        xn_task_join(&handle->decode_task, 200);  // 等待任务退出并回收任务栈
     }
     
     // 销毁Opus缓冲区（自动清空）
@@ -231,6 +722,10 @@ void audio_downlink_destroy(audio_downlink_handle_t handle)
         heap_caps_free(handle->pcm_buffer);
     }
     
+    if (handle->idle_sem) {
+        vSemaphoreDelete(handle->idle_sem);
+    }
+    
     delete handle;
     ESP_LOGI(TAG, "音频下行模块已销毁");
 }
@@ -241,24 +736,68 @@ esp_err_t audio_downlink_process(audio_downlink_handle_t handle, const char *bas
         return ESP_ERR_INVALID_ARG;
     }
     
-    handle->total_packets++;
+    return audio_downlink_process_len(handle, base64_audio, strlen(base64_audio));
+}
+
+/**
+ * @brief 为已丢弃的包写入丢包标记（缓冲区满时留到下一包再写）
+ */
+static void downlink_flush_loss(audio_downlink_t *handle)
+{
+    while (handle->loss_unmarked > 0 && opus_buffer_mark_loss(handle->opus_buffer) == ESP_OK) {
+        handle->loss_unmarked--;
+    }
+}
+
+esp_err_t audio_downlink_process_len(audio_downlink_handle_t handle, const char *base64_audio, size_t len)
+{
+    if (!handle || !base64_audio) {
+        return ESP_ERR_INVALID_ARG;
+    }
     
-    // 步骤1：Base64 解码（使用静态缓冲区，零拷贝）
-    size_t opus_len = 0;
-    uint8_t *opus_data = base64_decode_audio(base64_audio, &opus_len);
+    handle->total_packets++;
     
-    if (!opus_data || opus_len == 0) {
-        ESP_LOGE(TAG, "❌ Base64 解码失败 (包 #%lu)", handle->total_packets);
-        handle->error_count++;
-        return ESP_FAIL;
+    // 先补上之前未能写入的丢包标记，保持包序
+    if (handle->loss_unmarked > 0) {
+        downlink_flush_loss(handle);
     }
     
-    // 步骤2：写入环形缓冲区（内部自动复制）
-    esp_err_t ret = opus_buffer_write(handle->opus_buffer, opus_data, opus_len);
+    // 步骤1：在Opus缓冲区中预留一个包槽位
+    uint8_t *slot = NULL;
+    size_t slot_size = 0;
+    esp_err_t ret = opus_buffer_reserve(handle->opus_buffer, &slot, &slot_size);
+    
+    if (ret == ESP_OK) {
+        // 步骤2：Base64 直接解码进槽位（无中间缓冲区、无二次复制）
+        size_t opus_len = 0;
+        ret = base64_decode_to(base64_audio, len, slot, slot_size, &opus_len);
+        if (ret == ESP_ERR_INVALID_SIZE) {
+            handle->oversize_count++;
+            ESP_LOGE(TAG, "❌ 音频包超过上限 %d 字节，已丢弃 (包 #%lu, Base64 %d 字节)",
+                     (int)slot_size, handle->total_packets, (int)len);
+            handle->loss_unmarked++;
+            downlink_flush_loss(handle);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (ret != ESP_OK || opus_len == 0) {
+            ESP_LOGE(TAG, "❌ Base64 解码失败 (包 #%lu)", handle->total_packets);
+            handle->error_count++;
+            handle->loss_unmarked++;
+            downlink_flush_loss(handle);
+            return ESP_FAIL;
+        }
+        
+        // 步骤3：提交槽位
+        ret = opus_buffer_commit(handle->opus_buffer, opus_len);
+        if (ret == ESP_OK) {
+            handle->total_bytes += opus_len;
+        }
+    }
     
     if (ret != ESP_OK) {
         // 缓冲区满，丢弃这个包
         handle->buffer_full_count++;
+        handle->loss_unmarked++;
         
         // 每100次缓冲区满打印一次警告
         if (handle->buffer_full_count % 100 == 0) {
@@ -267,33 +806,125 @@ esp_err_t audio_downlink_process(audio_downlink_handle_t handle, const char *bas
         return ESP_FAIL;
     }
     
+    // 迟到：播放中到达时播放端已耗尽；早到：到达时缓冲已超过阈值
+    if (handle->state == AUDIO_DOWNLINK_PLAYING && (int32_t)(now_ms() - handle->play_deadline_ms) > 0) {
+        handle->late_count++;
+    }
+    if (handle->config.early_threshold_ms > 0 &&
+        opus_buffer_get_duration_ms(handle->opus_buffer) > handle->config.early_threshold_ms) {
+        handle->early_count++;
+    }
+    
     // 每100包打印一次统计（避免日志刷屏）
     if (handle->total_packets % 100 == 0) {
-        size_t buffer_count = opus_buffer_get_count(handle->opus_buffer);
-        float buffer_usage = (float)buffer_count / 2000 * 100.0f;
+        audio_downlink_stats_t st;
+        audio_downlink_get_stats(handle, &st);
         
-        ESP_LOGI(TAG, "📊 已接收 %lu 包 (错误: %lu, 缓冲区满: %lu, 缓冲区使用: %.1f%%)", 
-                 handle->total_packets,
-                 handle->error_count,
-                 handle->buffer_full_count,
-                 buffer_usage);
+        ESP_LOGI(TAG, "📊 已接收 %lu 包 (错误: %lu, 缓冲区满: %lu, 超长: %lu, 迟到: %lu, 早到: %lu, 欠载: %lu, "
+                 "丢失: %lu 帧/隐藏 %lu ms, 缓冲: %lu 包/%lu ms, 峰值: %lu KB, 解码: 平均 %lu us/最大 %lu us)",
+                 st.packets, st.format_errors, st.buffer_full, st.oversize,
+                 st.late_packets, st.early_packets, st.underruns,
+                 st.lost_frames, st.concealed_ms,
+                 st.buffer_packets, st.buffer_ms, st.buffer_peak_bytes / 1024,
+                 st.decode_us_avg, st.decode_us_max);
     }
     
     return ESP_OK;
 }
 
-void audio_downlink_get_stats(audio_downlink_handle_t handle, 
-                               uint32_t *total_packets, 
-                               uint32_t *error_count)
+void audio_downlink_mark_end(audio_downlink_handle_t handle)
 {
     if (!handle) return;
     
-    if (total_packets) {
-        *total_packets = handle->total_packets;
+    handle->end_marked = true;
+}
+
+uint32_t audio_downlink_flush(audio_downlink_handle_t handle)
+{
+    if (!handle) return 0;
+    
+    uint32_t dropped_ms = opus_buffer_get_duration_ms(handle->opus_buffer);
+    
+    // 先递增代数：解码中的帧不再提交，再清空两级缓冲
+    handle->flush_gen = handle->flush_gen + 1;
+    handle->end_marked = false;
+    opus_buffer_clear(handle->opus_buffer);
+    
+    const audio_downlink_sink_t *sink = &handle->config.sink;
+    if (sink->clear) {
+        sink->clear(sink->ctx);
     }
-    if (error_count) {
-        *error_count = handle->error_count;
+    
+    handle->flushes++;
+    handle->flushed_ms += dropped_ms;
+    return dropped_ms;
+}
+
+audio_downlink_state_t audio_downlink_get_state(audio_downlink_handle_t handle)
+{
+    return handle ? handle->state : AUDIO_DOWNLINK_IDLE;
+}
+
+esp_err_t audio_downlink_wait_idle(audio_downlink_handle_t handle, uint32_t timeout_ms)
+{
+    if (!handle) {
+        return ESP_OK;
     }
+    
+    // 信号量可能是之前某次回到 IDLE 留下的：取到后重新检查状态
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    while (handle->state != AUDIO_DOWNLINK_IDLE) {
+        int64_t remain_us = deadline_us - esp_timer_get_time();
+        if (remain_us <= 0 ||
+            xSemaphoreTake(handle->idle_sem, pdMS_TO_TICKS((remain_us + 999) / 1000)) != pdTRUE) {
+            return handle->state == AUDIO_DOWNLINK_IDLE ? ESP_OK : ESP_ERR_TIMEOUT;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t audio_downlink_get_stats(audio_downlink_handle_t handle, audio_downlink_stats_t *stats)
+{
+    if (!handle || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    opus_buffer_stats_t bs;
+    opus_buffer_get_stats(handle->opus_buffer, &bs);
+    
+    stats->packets = handle->total_packets;
+    stats->bytes = handle->total_bytes;
+    stats->format_errors = handle->error_count;
+    stats->oversize = handle->oversize_count;
+    stats->buffer_full = handle->buffer_full_count;
+    stats->late_packets = handle->late_count + handle->rebuffer_late;
+    stats->early_packets = handle->early_count;
+    stats->decoded_frames = handle->decoded_frames;
+    stats->decode_errors = handle->decode_errors;
+    stats->underruns = handle->underruns;
+    stats->prebuffers = handle->prebuffers;
+    stats->played_ms = (uint32_t)(handle->played_us / 1000);
+    stats->buffer_ms = bs.duration_ms;
+    stats->buffer_packets = (uint32_t)bs.packets;
+    stats->buffer_peak_bytes = (uint32_t)bs.peak_bytes;
+    stats->first_audio_ms = handle->first_audio_ms;
+    stats->first_audio_ms_max = handle->first_audio_ms_max;
+    stats->decode_us_avg = handle->decoded_frames ? (uint32_t)(handle->decode_us_total / handle->decoded_frames) : 0;
+    stats->decode_us_max = handle->decode_us_max;
+    stats->decode_us_per_s = handle->decoded_us ? (uint32_t)(handle->decode_us_total * 1000000 / handle->decoded_us) : 0;
+    stats->lost_frames = handle->lost_frames;
+    stats->plc_frames = handle->plc_frames;
+    stats->fec_frames = handle->fec_frames;
+    stats->unconcealed_frames = handle->unconcealed_frames;
+    stats->concealed_ms = (uint32_t)(handle->concealed_us / 1000);
+    stats->sink_frames = handle->sink_frames;
+    stats->sink_wait_ms = (uint32_t)(handle->sink_wait_us / 1000);
+    stats->sink_timeouts = handle->sink_timeouts;
+    stats->flushes = handle->flushes;
+    stats->flushed_ms = handle->flushed_ms;
+    stats->state = handle->state;
+    
+    return ESP_OK;
 }
 
 void audio_downlink_reset_stats(audio_downlink_handle_t handle)
@@ -301,7 +932,31 @@ void audio_downlink_reset_stats(audio_downlink_handle_t handle)
     if (!handle) return;
     
     handle->total_packets = 0;
+    handle->total_bytes = 0;
     handle->error_count = 0;
+    handle->buffer_full_count = 0;
+    handle->oversize_count = 0;
+    handle->late_count = 0;
+    handle->early_count = 0;
+    handle->decoded_frames = 0;
+    handle->decode_errors = 0;
+    handle->underruns = 0;
+    handle->rebuffer_late = 0;
+    handle->prebuffers = 0;
+    handle->played_us = 0;
+    handle->decode_us_total = 0;
+    handle->decoded_us = 0;
+    handle->decode_us_max = 0;
+    handle->first_audio_ms_max = 0;
+    handle->lost_frames = 0;
+    handle->plc_frames = 0;
+    handle->fec_frames = 0;
+    handle->unconcealed_frames = 0;
+    handle->concealed_us = 0;
+    handle->sink_frames = 0;
+    handle->sink_timeouts = 0;
+    handle->sink_wait_us = 0;
+    handle->flushes = 0;
+    handle->flushed_ms = 0;
     ESP_LOGI(TAG, "统计信息已重置");
 }
-
@@ -3,15 +3,18 @@
  * @Description: 音频下行模块 - 处理从服务器接收的音频
  * 
  * 功能：
- * - Base64 解码（使用静态缓冲区，零拷贝）
- * - Opus 解码为 PCM
- * - PCM 数据回调给用户
- * - 统计信息（包数、错误率等）
+ * - Base64 直接解码进 Opus 缓冲区槽位（无全局缓冲区，零拷贝）
+ * - PCM 下行：不经解码器，包内 PCM 直接（必要时线性插值重采样后）写入播放目标
+ * - 播放控制：预缓冲到指定时长后起播，按实时播放速率节流解码
+ * - Opus 解码为 PCM，丢失/损坏的包用 FEC 或 PLC 补齐
+ * - PCM 数据回调给用户，或直接解码进播放缓冲区（sink，按真实播放速度阻塞）
+ * - 统计信息（包数、字节、缓冲时长、欠载、迟到/早到、单帧解码耗时）
  */
 
 #pragma once
 
 #include "esp_err.h"
+#include "xn_task_sched.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -33,16 +36,92 @@ typedef struct audio_downlink_s *audio_downlink_handle_t;
  */
 typedef void (*audio_downlink_pcm_callback_t)(const int16_t *pcm, size_t samples, void *user_ctx);
 
+/**
+ * @brief PCM 直写目标（如播放环形缓冲区）
+ * 
+ * 设置后解码器直接输出到 reserve 返回的地址并 commit，不再经过 PCM 回调；
+ * reserve 在空间不足时阻塞，解码因此跟随真实播放速度。
+ */
+typedef struct {
+    size_t (*reserve)(int16_t **ptr, size_t samples, uint32_t timeout_ms, void *ctx); ///< 预留连续空间，返回可写样本数（超时返回0）
+    esp_err_t (*commit)(size_t samples, void *ctx);                                   ///< 提交已写入的样本
+    void (*clear)(void *ctx);                                                         ///< 丢弃已写入未播放的样本（打断时调用，可选）
+    void *ctx;                                                                        ///< 用户上下文
+} audio_downlink_sink_t;
+
+/**
+ * @brief 播放状态
+ */
+typedef enum {
+    AUDIO_DOWNLINK_IDLE = 0,        ///< 空闲：无待播音频
+    AUDIO_DOWNLINK_PREBUFFERING,    ///< 预缓冲：已收到音频，等待缓冲达到 prebuffer_ms
+    AUDIO_DOWNLINK_PLAYING,         ///< 播放中：按实时速率解码
+} audio_downlink_state_t;
+
+/**
+ * @brief 下行音频编码
+ */
+typedef enum {
+    AUDIO_DOWNLINK_CODEC_OPUS = 0,  ///< Opus 包：解码后输出
+    AUDIO_DOWNLINK_CODEC_PCM,       ///< 16-bit 小端 PCM：不经解码器直接输出，采样率不同时重采样
+} audio_downlink_codec_t;
+
 /**
  * @brief 音频下行配置
  */
 typedef struct {
     int sample_rate;                          ///< 输出采样率（16000 Hz）
     int channels;                             ///< 声道数（1=单声道）
-    audio_downlink_pcm_callback_t callback;   ///< PCM 回调函数
+    audio_downlink_pcm_callback_t callback;   ///< PCM 回调函数（未设置 sink 时使用）
     void *callback_ctx;                       ///< 回调的用户上下文
+    audio_downlink_sink_t sink;               ///< PCM 直写目标（可选，优先于回调）
+    const xn_task_sched_t *task_sched;        ///< 解码任务调度参数（NULL 使用均衡预设）
+    uint32_t prebuffer_ms;                    ///< 起播/欠载后重新起播前需缓冲的音频时长，0 表示收到即播
+    uint32_t lead_ms;                         ///< 解码领先播放时钟的时长（即播放端缓冲的 PCM 时长），0 表示不节流（使用 sink 时可由缓冲区容量节流）
+    uint32_t early_threshold_ms;              ///< 到达时缓冲已超过该时长的包计为早到，0 表示不统计
+    uint32_t plc_max_ms;                      ///< 每处丢包最多隐藏的时长，超出部分跳过，0 表示不做隐藏
+    bool fec_enable;                          ///< 丢包后优先用下一包的带内 FEC 恢复（仅 Opus）
+    audio_downlink_codec_t codec;             ///< 下行编码，默认 Opus
+    int pcm_sample_rate;                      ///< PCM 下行时服务器音频的采样率，0 表示与 sample_rate 相同（不同时仅支持单声道）
 } audio_downlink_config_t;
 
+/**
+ * @brief 下行统计信息
+ */
+typedef struct {
+    uint32_t packets;               ///< 接收并入缓冲的 Opus 包数
+    uint32_t bytes;                 ///< 接收的 Opus 字节数
+    uint32_t format_errors;         ///< Base64 格式错误包数
+    uint32_t oversize;              ///< 超过单包上限被拒绝的包数
+    uint32_t buffer_full;           ///< 缓冲区满被丢弃的包数
+    uint32_t late_packets;          ///< 迟到包：到达时播放端已耗尽
+    uint32_t early_packets;         ///< 早到包：到达时缓冲已超过 early_threshold_ms
+    uint32_t decoded_frames;        ///< 解码成功帧数
+    uint32_t decode_errors;         ///< 解码失败帧数
+    uint32_t underruns;             ///< 欠载次数：播放中缓冲耗尽且未收到结束标记
+    uint32_t prebuffers;            ///< 预缓冲次数（起播 + 欠载后重新缓冲）
+    uint32_t played_ms;             ///< 已送出的 PCM 时长
+    uint32_t buffer_ms;             ///< 当前缓冲的音频时长
+    uint32_t buffer_packets;        ///< 当前缓冲的包数
+    uint32_t buffer_peak_bytes;     ///< 缓冲占用峰值（字节）
+    uint32_t first_audio_ms;        ///< 最近一次首包到起播的等待
+    uint32_t first_audio_ms_max;    ///< 首包到起播等待的最大值
+    uint32_t decode_us_avg;         ///< 单帧平均解码耗时
+    uint32_t decode_us_max;         ///< 单帧最大解码耗时
+    uint32_t decode_us_per_s;       ///< 每秒音频的解码耗时（PCM 为复制/重采样耗时），用于比较两种下行的CPU开销
+    uint32_t lost_frames;           ///< 丢失帧数（接收端丢弃 + 解码失败）
+    uint32_t plc_frames;            ///< PLC 补齐帧数
+    uint32_t fec_frames;            ///< FEC 恢复帧数
+    uint32_t unconcealed_frames;    ///< 未补齐的丢失帧（超过隐藏上限或位于本轮结尾）
+    uint32_t concealed_ms;          ///< 补齐的音频时长
+    uint32_t sink_frames;           ///< 直接解码进播放缓冲区的帧数
+    uint32_t sink_wait_ms;          ///< 等待播放缓冲区空间的累计时长（背压）
+    uint32_t sink_timeouts;         ///< 等待空间超时而丢弃的帧数
+    uint32_t flushes;               ///< 打断清空次数
+    uint32_t flushed_ms;            ///< 打断时丢弃的未播音频时长（累计）
+    audio_downlink_state_t state;   ///< 当前播放状态
+} audio_downlink_stats_t;
+
 /**
  * @brief 创建音频下行模块
  * 
@@ -64,7 +143,7 @@ void audio_downlink_destroy(audio_downlink_handle_t handle);
  * @brief 处理音频数据（Base64 → Opus → PCM → 回调）
  * 
  * 这个函数会：
- * 1. Base64 解码（使用静态缓冲区，零拷贝）
+ * 1. Base64 直接解码进 Opus 缓冲区预留槽位（超过 max_packet_size 返回 ESP_ERR_INVALID_SIZE）
  * 2. Opus 解码为 PCM
  * 3. 通过回调函数返回 PCM 数据
  * 
@@ -76,16 +155,64 @@ void audio_downlink_destroy(audio_downlink_handle_t handle);
  */
 esp_err_t audio_downlink_process(audio_downlink_handle_t handle, const char *base64_audio);
 
+/**
+ * @brief 处理下行音频数据（指定长度的 Base64 片段）
+ * 
+ * 与 audio_downlink_process 相同，但 Base64 数据无需 '\0' 结尾，
+ * 可直接传入 JSON 接收缓冲区中的 content 字段片段（零拷贝）。
+ * 
+ * @param handle 模块句柄
+ * @param base64_audio Base64 数据起始地址
+ * @param len Base64 数据长度
+ * @return esp_err_t ESP_OK 成功
+ */
+esp_err_t audio_downlink_process_len(audio_downlink_handle_t handle, const char *base64_audio, size_t len);
+
+/**
+ * @brief 标记本轮语音下发结束
+ * 
+ * 缓冲中剩余的音频不再等待预缓冲直接播完，播完后缓冲为空不计为欠载。
+ * 
+ * @param handle 模块句柄
+ */
+void audio_downlink_mark_end(audio_downlink_handle_t handle);
+
+/**
+ * @brief 立即停止本轮播放（打断）
+ * 
+ * 丢弃 Opus 缓冲中的包、解码中的帧以及直写目标中未播放的 PCM，回到空闲状态，
+ * 之后收到的新音频重新预缓冲起播。可在任意任务中调用。
+ * 
+ * @param handle 模块句柄
+ * @return uint32_t 丢弃的 Opus 缓冲时长（毫秒）
+ */
+uint32_t audio_downlink_flush(audio_downlink_handle_t handle);
+
+/**
+ * @brief 获取当前播放状态
+ * 
+ * @param handle 模块句柄
+ * @return audio_downlink_state_t 播放状态（句柄为空时为 IDLE）
+ */
+audio_downlink_state_t audio_downlink_get_state(audio_downlink_handle_t handle);
+
+/**
+ * @brief 等待回到 IDLE（本轮播放完毕或被打断），阻塞而不轮询
+ * 
+ * @param handle 模块句柄
+ * @param timeout_ms 等待上限（毫秒）
+ * @return esp_err_t ESP_OK 已是 IDLE（句柄为空时直接返回）；ESP_ERR_TIMEOUT 超时
+ */
+esp_err_t audio_downlink_wait_idle(audio_downlink_handle_t handle, uint32_t timeout_ms);
+
 /**
  * @brief 获取统计信息
  * 
  * @param handle 模块句柄
- * @param total_packets 输出：总处理包数
- * @param error_count 输出：错误包数
+ * @param stats 输出统计
+ * @return esp_err_t ESP_OK 成功
  */
-void audio_downlink_get_stats(audio_downlink_handle_t handle, 
-                               uint32_t *total_packets, 
-                               uint32_t *error_count);
+esp_err_t audio_downlink_get_stats(audio_downlink_handle_t handle, audio_downlink_stats_t *stats);
 
 /**
  * @brief 重置统计信息
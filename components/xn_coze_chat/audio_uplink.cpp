@@ -17,14 +17,55 @@
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_random.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "encoder/impl/esp_opus_enc.h"
-#include "cJSON.h"
 #include <string.h>
 
 static const char *TAG = "AUDIO_UPLINK";
 
+#define UPLINK_OPUS_OUT_MAX     4000    ///< Opus 编码输出缓冲区大小
+#define UPLINK_READ_TIMEOUT_MS  200     ///< 无数据时的读取等待时间
+#define UPLINK_REPORT_MS        5000    ///< 统计打印间隔（按已发送音频时长）
+#define UPLINK_ADAPT_WINDOW     50      ///< 复杂度自适应评估窗口（帧）
+#define UPLINK_OPUS_MAX_COMPLEXITY 10   ///< Opus 最高复杂度
+#define UPLINK_OPUS_DTX_BYTES   2       ///< 不超过该长度的 Opus 包视为 DTX 帧
+#define UPLINK_OPUS_RETRY_MS    500     ///< 编码器重建失败后的重试间隔
+#define UPLINK_SEND_BLOCK_MS    1000    ///< 发送回调默认最长阻塞时长
+#define UPLINK_STOP_MARGIN_MS   300     ///< 停止等待的余量（编码一批 + 调度延迟）
+#define UPLINK_MSG_ID_DIGITS    8       ///< 消息 id 序号位数（十六进制定长）
+#define UPLINK_MSG_PREFIX_DIGITS 8      ///< 消息 id 会话前缀位数（十六进制定长）
+
+#define UPLINK_RATE_LEVELS_MAX      8       ///< 码率自适应最多档位数
+#define UPLINK_RATE_EVAL_MS         500     ///< 码率自适应评估间隔
+#define UPLINK_RATE_BACKLOG_HIGH_MS 150     ///< 积压超过该时长视为拥塞（缓冲区约 500ms 后开始覆盖）
+#define UPLINK_RATE_BACKLOG_LOW_MS  40      ///< 积压低于该时长视为通畅
+#define UPLINK_RATE_SEND_HIGH_PCT   80      ///< 平均发送耗时超过消息时长的该比例视为拥塞
+#define UPLINK_RATE_SEND_LOW_PCT    30      ///< 平均发送耗时低于消息时长的该比例视为通畅
+#define UPLINK_RATE_UP_HOLD_MS      5000    ///< 持续通畅该时长后才升一档（迟滞，避免来回切换）
+
+/**
+ * @brief 码率自适应的 Opus 码率阶梯（只取低于配置码率的部分）
+ */
+static const int UPLINK_RATE_STEPS[] = {32000, 24000, 16000, 12000};
+
+/**
+ * @brief input_audio_buffer.append 消息模板
+ * 
+ * 完整消息 = HEAD + 会话前缀 + '_' + id序号 + TAIL + Base64 + SUFFIX，
+ * 模板在任务启动时写入发送缓冲区一次，之后每帧只改写序号和 Base64 部分。
+ * 序号每次启动上行都从 0 开始，会话前缀取随机数，保证重连、重启后 id 不重复。
+ */
+static const char UPLINK_MSG_HEAD[] = "{\"id\":\"audio_";
+static const char UPLINK_MSG_TAIL[] = "\",\"event_type\":\"input_audio_buffer.append\",\"data\":{\"delta\":\"";
+static const char UPLINK_MSG_SUFFIX[] = "\"}}";
+
+#define UPLINK_MSG_PREFIX_OFFSET    (sizeof(UPLINK_MSG_HEAD) - 1)
+#define UPLINK_MSG_ID_OFFSET        (UPLINK_MSG_PREFIX_OFFSET + UPLINK_MSG_PREFIX_DIGITS + 1)
+#define UPLINK_MSG_PAYLOAD_OFFSET   (UPLINK_MSG_ID_OFFSET + UPLINK_MSG_ID_DIGITS + sizeof(UPLINK_MSG_TAIL) - 1)
+
 /**
  * @brief 音频上行结构体
  */
@@ -37,123 +78,762 @@ typedef struct audio_uplink_s {
     
     // Opus 编码器（可选）
     void *opus_encoder;
+    int opus_complexity;         // 当前复杂度
+    uint64_t adapt_us_total;     // 当前评估窗口累计编码耗时
+    int adapt_frames;            // 当前评估窗口帧数
+    int opus_bitrate;            // 当前码率
+    int64_t opus_retry_us;       // 编码器丢失（重建失败）的时刻，下次重试在其后 UPLINK_OPUS_RETRY_MS
+    
+    // 码率自适应档位：0 为配置档，逐档降码率，降到最低后增大每条消息时长
+    struct {
+        int bitrate;
+        int message_ms;
+    } rate_levels[UPLINK_RATE_LEVELS_MAX];
+    int rate_level_count;
+    int rate_level;
+    int64_t rate_eval_us;        // 上次评估时刻
+    int64_t rate_good_since_us;  // 持续通畅的起点，0 表示当前不通畅
+    int64_t rate_change_us;      // 上次换档时刻
+    
+    // VAD 静音门：按音频流字节位置判定，与上行任务的处理滞后无关
+    volatile uint32_t write_pos; // 已写入字节数（回绕计数）
+    uint32_t read_pos;           // 已读到的音频流位置（上行任务每次读取后按 write_pos 校准，清空时追到 write_pos）
+    volatile bool voice;         // 当前是否有人声（audio_uplink_set_voice 写入）
+    volatile uint32_t voice_start_pos; // 最近一次人声开始时的写入位置
+    volatile uint32_t voice_end_pos;   // 最近一次人声结束时的写入位置（拖尾起点）
+    uint32_t hangover_bytes;     // 拖尾字节数
+    bool gate_open;              // 门当前状态（仅上行任务访问）
+    uint8_t *preroll;            // 预录帧环（静音期间保留最近几帧）
+    size_t preroll_size;         // 预录缓冲区字节数（按最长帧分配，换档时重新划分）
+    int preroll_cap;             // 预录容量（帧，含触发帧）
+    int preroll_head;            // 下一个写入位置
+    int preroll_count;           // 已缓存帧数
+    int replay;                  // 待补发的预录帧数
+    size_t gate_frame_wire;      // 每帧平均线上字节（估算节省量）
     
     // 发送任务
-    TaskHandle_t task;
+    xn_task_t task;
+    xn_task_sched_t task_sched;
     bool running;
+    bool task_lost;              // 任务未按时退出被强制删除：其持有的资源不再安全，只能泄漏
+    
+    // 分包参数（创建时由配置校正）
+    int frame_ms;                // 帧时长
+    int frames_per_message;      // 每条消息聚合帧数
+    int max_batch_latency_ms;    // 聚合时延上限
+    size_t frame_bytes;          // 每帧 PCM 字节数
+    size_t bytes_per_ms;         // 每毫秒 PCM 字节数
+    
+    // 统计
+    uint32_t msg_seq;            // 消息序号（用作 id）
+    uint64_t build_us_total;     // 编码+组包累计耗时
+    audio_uplink_stats_t stats;  // 发送统计
     
 } audio_uplink_t;
 
+/**
+ * @brief 估算 WebSocket 客户端帧头长度（含 4 字节掩码，不含 TLS 记录开销）
+ */
+static size_t uplink_ws_header_len(size_t payload_len)
+{
+    if (payload_len < 126) {
+        return 2 + 4;
+    }
+    return (payload_len <= 0xFFFF) ? (4 + 4) : (10 + 4);
+}
+
+/**
+ * @brief Opus 帧时长转编码器枚举（仅支持 20~120ms 的 20ms 整数倍）
+ */
+static esp_opus_enc_frame_duration_t uplink_opus_duration(int ms)
+{
+    switch (ms) {
+    case 40:  return ESP_OPUS_ENC_FRAME_DURATION_40_MS;
+    case 60:  return ESP_OPUS_ENC_FRAME_DURATION_60_MS;
+    case 80:  return ESP_OPUS_ENC_FRAME_DURATION_80_MS;
+    case 100: return ESP_OPUS_ENC_FRAME_DURATION_100_MS;
+    case 120: return ESP_OPUS_ENC_FRAME_DURATION_120_MS;
+    default:  return ESP_OPUS_ENC_FRAME_DURATION_20_MS;
+    }
+}
+
+/**
+ * @brief 写入定长十六进制数
+ */
+static void uplink_hex_write(char *dst, uint32_t value, int digits)
+{
+    static const char hex[] = "0123456789abcdef";
+    for (int i = digits - 1; i >= 0; i--) {
+        dst[i] = hex[value & 0xF];
+        value >>= 4;
+    }
+}
+
+/**
+ * @brief 写入消息模板（任务启动时调用一次）
+ * 
+ * @param msg 发送缓冲区
+ * @param prefix 会话前缀（本次上行内所有消息 id 共用）
+ */
+static void uplink_msg_init(char *msg, uint32_t prefix)
+{
+    memcpy(msg, UPLINK_MSG_HEAD, sizeof(UPLINK_MSG_HEAD) - 1);
+    uplink_hex_write(msg + UPLINK_MSG_PREFIX_OFFSET, prefix, UPLINK_MSG_PREFIX_DIGITS);
+    msg[UPLINK_MSG_ID_OFFSET - 1] = '_';
+    memset(msg + UPLINK_MSG_ID_OFFSET, '0', UPLINK_MSG_ID_DIGITS);
+    memcpy(msg + UPLINK_MSG_ID_OFFSET + UPLINK_MSG_ID_DIGITS, UPLINK_MSG_TAIL, sizeof(UPLINK_MSG_TAIL) - 1);
+}
+
+/**
+ * @brief 组装一帧上行消息（无堆分配）
+ * 
+ * @param msg 发送缓冲区（已写入模板）
+ * @param msg_size 发送缓冲区大小
+ * @param seq 消息序号
+ * @param data 音频数据（PCM 或 Opus）
+ * @param len 音频数据长度
+ * @return size_t 消息总长度，失败返回 0
+ */
+static size_t uplink_msg_build(char *msg, size_t msg_size, uint32_t seq, const uint8_t *data, size_t len)
+{
+    // 定长十六进制序号
+    uplink_hex_write(msg + UPLINK_MSG_ID_OFFSET, seq, UPLINK_MSG_ID_DIGITS);
+    
+    // Base64 直接编码进模板
+    size_t b64_len = 0;
+    size_t room = msg_size - UPLINK_MSG_PAYLOAD_OFFSET - (sizeof(UPLINK_MSG_SUFFIX) - 1);
+    if (base64_encode_to(data, len, msg + UPLINK_MSG_PAYLOAD_OFFSET, room, &b64_len) != ESP_OK) {
+        return 0;
+    }
+    
+    memcpy(msg + UPLINK_MSG_PAYLOAD_OFFSET + b64_len, UPLINK_MSG_SUFFIX, sizeof(UPLINK_MSG_SUFFIX) - 1);
+    return UPLINK_MSG_PAYLOAD_OFFSET + b64_len + sizeof(UPLINK_MSG_SUFFIX) - 1;
+}
+
+/**
+ * @brief 按当前配置和指定复杂度打开 Opus 编码器
+ */
+static esp_audio_err_t uplink_opus_open(audio_uplink_t *uplink, int complexity)
+{
+    const audio_uplink_config_t *config = &uplink->config;
+    esp_opus_enc_config_t opus_cfg = {
+        .sample_rate = config->sample_rate,
+        .channel = config->channels,
+        .bits_per_sample = config->bit_depth,
+        .bitrate = uplink->opus_bitrate,
+        .frame_duration = uplink_opus_duration(uplink->frame_ms),
+        .application_mode = ESP_OPUS_ENC_APPLICATION_VOIP,
+        .complexity = complexity,
+        .enable_fec = config->opus_fec,
+        .enable_dtx = config->opus_dtx,
+        .enable_vbr = config->opus_vbr,
+    };
+    
+    esp_audio_err_t ret = esp_opus_enc_open(&opus_cfg, sizeof(opus_cfg), &uplink->opus_encoder);
+    if (ret == ESP_AUDIO_ERR_OK) {
+        uplink->opus_complexity = complexity;
+        uplink->stats.opus_complexity = complexity;
+    }
+    return ret;
+}
+
+/**
+ * @brief 编码器重建失败：记录时刻，由上行任务在之后的帧边界重试
+ */
+static void uplink_opus_lost(audio_uplink_t *uplink)
+{
+    uplink->opus_retry_us = esp_timer_get_time();
+    ESP_LOGE(TAG, "❌ 重建 Opus 编码器失败，%d ms 后重试（期间丢弃音频帧）", UPLINK_OPUS_RETRY_MS);
+}
+
+/**
+ * @brief 编码器丢失时按间隔重试打开（在帧边界调用）
+ * 
+ * @return true 编码器可用
+ */
+static bool uplink_opus_retry(audio_uplink_t *uplink)
+{
+    if (uplink->opus_encoder) {
+        return true;
+    }
+    int64_t now = esp_timer_get_time();
+    if (now - uplink->opus_retry_us < (int64_t)UPLINK_OPUS_RETRY_MS * 1000) {
+        return false;
+    }
+    if (uplink_opus_open(uplink, uplink->opus_complexity) != ESP_AUDIO_ERR_OK) {
+        uplink_opus_lost(uplink);
+        return false;
+    }
+    ESP_LOGI(TAG, "✅ Opus 编码器已恢复 (复杂度 %d, %d bps, 丢弃 %lu 帧)",
+             uplink->opus_complexity, uplink->opus_bitrate, uplink->stats.encoder_lost_frames);
+    return true;
+}
+
+/**
+ * @brief 复杂度自适应：按编码耗时与 CPU 预算调整复杂度
+ * 
+ * 每 UPLINK_ADAPT_WINDOW 帧评估一次：平均耗时超出预算降 2 级，低于预算一半升 1 级；
+ * 任意一帧耗时超过帧时长（无法实时）立即降到最低。
+ * esp_opus_enc 不支持运行时修改复杂度，调整时在帧边界重建编码器。
+ * 
+ * @param uplink 模块句柄
+ * @param encode_us 本帧编码耗时
+ */
+static void uplink_opus_adapt(audio_uplink_t *uplink, uint32_t encode_us)
+{
+    uint32_t frame_us = (uint32_t)uplink->frame_ms * 1000;
+    uint32_t budget_us = frame_us * uplink->config.opus_cpu_budget_pct / 100;
+    int target = uplink->opus_complexity;
+    
+    uplink->adapt_us_total += encode_us;
+    uplink->adapt_frames++;
+    
+    if (encode_us >= frame_us) {
+        target = 0;
+    } else if (uplink->adapt_frames >= UPLINK_ADAPT_WINDOW) {
+        uint32_t avg_us = (uint32_t)(uplink->adapt_us_total / uplink->adapt_frames);
+        if (avg_us > budget_us) {
+            target = uplink->opus_complexity - 2;
+        } else if (avg_us < budget_us / 2) {
+            target = uplink->opus_complexity + 1;
+        }
+    } else {
+        return;
+    }
+    
+    uplink->adapt_us_total = 0;
+    uplink->adapt_frames = 0;
+    
+    target = target < 0 ? 0 : (target > UPLINK_OPUS_MAX_COMPLEXITY ? UPLINK_OPUS_MAX_COMPLEXITY : target);
+    if (target == uplink->opus_complexity) {
+        return;
+    }
+    
+    int prev = uplink->opus_complexity;
+    esp_opus_enc_close(uplink->opus_encoder);
+    uplink->opus_encoder = NULL;
+    if (uplink_opus_open(uplink, target) != ESP_AUDIO_ERR_OK &&
+        uplink_opus_open(uplink, prev) != ESP_AUDIO_ERR_OK) {
+        uplink_opus_lost(uplink);
+        return;
+    }
+    uplink->stats.complexity_changes++;
+    ESP_LOGI(TAG, "🎚️ Opus 复杂度 %d → %d (本帧编码 %lu us, 预算 %lu us)",
+             prev, uplink->opus_complexity, encode_us, budget_us);
+}
+
+/**
+ * @brief 发送一条聚合消息并更新统计
+ * 
+ * @param uplink 模块句柄
+ * @param msg 发送缓冲区（已写入模板）
+ * @param msg_size 发送缓冲区大小
+ * @param payload 音频负载（PCM 或 Opus）
+ * @param payload_len 负载长度
+ * @param frames 负载包含的帧数
+ */
+static void uplink_send_batch(audio_uplink_t *uplink, char *msg, size_t msg_size,
+                              const uint8_t *payload, size_t payload_len, int frames)
+{
+    // 组装消息：Base64 直接编码进预格式化模板
+    int64_t t0 = esp_timer_get_time();
+    size_t msg_len = uplink_msg_build(msg, msg_size, uplink->msg_seq++, payload, payload_len);
+    uplink->build_us_total += esp_timer_get_time() - t0;
+    
+    if (msg_len == 0) {
+        ESP_LOGE(TAG, "❌ 组装消息失败 (负载 %d 字节)", (int)payload_len);
+        return;
+    }
+    
+    // 通过回调函数发送（指针 + 长度）；回调阻塞时长即链路拥塞程度
+    audio_uplink_stats_t *st = &uplink->stats;
+    t0 = esp_timer_get_time();
+    bool sent = uplink->config.send_callback(msg, msg_len, uplink->config.send_callback_ctx);
+    uint32_t send_us = (uint32_t)(esp_timer_get_time() - t0);
+    st->send_us_last = send_us;
+    st->send_us_avg = st->send_us_avg ? st->send_us_avg - st->send_us_avg / 8 + send_us / 8 : send_us;
+    if (send_us > st->send_us_max) {
+        st->send_us_max = send_us;
+    }
+    if (!sent) {
+        st->send_fail++;
+        ESP_LOGW(TAG, "⚠️ 音频消息 #%lu 发送失败", st->messages + 1);
+        return;
+    }
+    
+    st->messages++;
+    st->frames += frames;
+    st->audio_ms += (uint64_t)frames * uplink->frame_ms;
+    st->payload_bytes += payload_len;
+    st->wire_bytes += msg_len + uplink_ws_header_len(msg_len);
+}
+
+/**
+ * @brief 按每条消息时长设置分包参数（创建时和换档时在批边界调用）
+ * 
+ * Opus 改变单帧时长（需随后重建编码器），PCM 改变每条消息的聚合帧数。
+ */
+static void uplink_set_geometry(audio_uplink_t *uplink, int message_ms)
+{
+    const audio_uplink_config_t *config = &uplink->config;
+    
+    if (config->format == AUDIO_UPLINK_FORMAT_OPUS) {
+        uplink->frame_ms = message_ms;
+        uplink->frames_per_message = 1;
+    } else {
+        uplink->frames_per_message = message_ms / uplink->frame_ms;
+    }
+    uplink->frame_bytes = uplink->bytes_per_ms * uplink->frame_ms;
+    uplink->max_batch_latency_ms = config->max_batch_latency_ms > 0 ? config->max_batch_latency_ms
+                                                                    : message_ms + uplink->frame_ms;
+    
+    // 静音门：预录环按帧向上取整，另加一帧存放触发开门的当前帧；帧长变化后旧内容作废
+    if (uplink->preroll) {
+        int frames = (config->preroll_ms + uplink->frame_ms - 1) / uplink->frame_ms + 1;
+        int fit = (int)(uplink->preroll_size / uplink->frame_bytes);
+        uplink->preroll_cap = frames < fit ? frames : fit;
+        uplink->preroll_head = 0;
+        uplink->preroll_count = 0;
+    }
+    
+    // 估算每帧线上字节：负载（PCM 原样，Opus 按码率）→ Base64 → 消息模板与帧头按批均摊
+    size_t frame_payload = config->format == AUDIO_UPLINK_FORMAT_OPUS
+                           ? (size_t)uplink->opus_bitrate / 8 * uplink->frame_ms / 1000
+                           : uplink->frame_bytes;
+    size_t msg_len = UPLINK_MSG_PAYLOAD_OFFSET + sizeof(UPLINK_MSG_SUFFIX) - 1 +
+                     base64_get_encode_length(frame_payload * uplink->frames_per_message);
+    uplink->gate_frame_wire = (msg_len + uplink_ws_header_len(msg_len)) / uplink->frames_per_message;
+    
+    uplink->stats.bitrate = config->format == AUDIO_UPLINK_FORMAT_OPUS ? uplink->opus_bitrate
+                                                                        : (int)uplink->bytes_per_ms * 8000;
+    uplink->stats.message_ms = message_ms;
+}
+
+/**
+ * @brief 生成码率自适应档位
+ * 
+ * 档 0 为配置的码率与消息时长；之后先按 UPLINK_RATE_STEPS 逐档降低 Opus 码率（不低于 min_bitrate），
+ * 再逐档把每条消息时长翻倍（不超过 max_message_ms，Opus 最长 120ms）以减少消息数和帧头开销。
+ */
+static void uplink_rate_build(audio_uplink_t *uplink)
+{
+    const audio_uplink_config_t *config = &uplink->config;
+    const bool is_opus = (config->format == AUDIO_UPLINK_FORMAT_OPUS);
+    int bitrate = uplink->opus_bitrate;
+    int message_ms = uplink->frame_ms * uplink->frames_per_message;
+    int n = 0;
+    
+    uplink->rate_levels[n].bitrate = bitrate;
+    uplink->rate_levels[n].message_ms = message_ms;
+    n++;
+    
+    if (config->adaptive_rate) {
+        int min_bitrate = config->min_bitrate > 0 ? config->min_bitrate : 12000;
+        for (size_t i = 0; is_opus && i < sizeof(UPLINK_RATE_STEPS) / sizeof(UPLINK_RATE_STEPS[0]); i++) {
+            if (UPLINK_RATE_STEPS[i] < bitrate && UPLINK_RATE_STEPS[i] >= min_bitrate && n < UPLINK_RATE_LEVELS_MAX) {
+                bitrate = UPLINK_RATE_STEPS[i];
+                uplink->rate_levels[n].bitrate = bitrate;
+                uplink->rate_levels[n].message_ms = message_ms;
+                n++;
+            }
+        }
+        
+        int max_ms = config->max_message_ms > 0 ? config->max_message_ms : 120;
+        int unit = is_opus ? 20 : uplink->frame_ms;
+        if (is_opus && max_ms > 120) {
+            max_ms = 120;
+        }
+        while (n < UPLINK_RATE_LEVELS_MAX) {
+            int next = (message_ms * 2 < max_ms ? message_ms * 2 : max_ms) / unit * unit;
+            if (next <= message_ms) {
+                break;
+            }
+            message_ms = next;
+            uplink->rate_levels[n].bitrate = bitrate;
+            uplink->rate_levels[n].message_ms = message_ms;
+            n++;
+        }
+    }
+    uplink->rate_level_count = n;
+}
+
+/**
+ * @brief 切换到指定档位（在批边界调用）
+ */
+static void uplink_rate_apply(audio_uplink_t *uplink, int level)
+{
+    int prev = uplink->rate_level;
+    int prev_bitrate = uplink->opus_bitrate;
+    int prev_ms = uplink->stats.message_ms;
+    
+    uplink->rate_level = level;
+    uplink->opus_bitrate = uplink->rate_levels[level].bitrate;
+    uplink_set_geometry(uplink, uplink->rate_levels[level].message_ms);
+    
+    // 码率或帧长变化：在帧边界重建编码器（与复杂度自适应相同）
+    if (uplink->opus_encoder &&
+        (uplink->opus_bitrate != prev_bitrate || uplink->rate_levels[level].message_ms != prev_ms)) {
+        esp_opus_enc_close(uplink->opus_encoder);
+        uplink->opus_encoder = NULL;
+        if (uplink_opus_open(uplink, uplink->opus_complexity) != ESP_AUDIO_ERR_OK) {
+            ESP_LOGE(TAG, "❌ 重建 Opus 编码器失败，回到原档位");
+            uplink->rate_level = prev;
+            uplink->opus_bitrate = prev_bitrate;
+            uplink_set_geometry(uplink, prev_ms);
+            if (uplink_opus_open(uplink, uplink->opus_complexity) != ESP_AUDIO_ERR_OK) {
+                // 原档位也打不开：编码器保持为空，上行任务丢帧并按间隔重试
+                uplink_opus_lost(uplink);
+            }
+            return;
+        }
+    }
+    
+    audio_uplink_stats_t *st = &uplink->stats;
+    st->rate_level = level;
+    if (level > prev) {
+        st->rate_downs++;
+    } else {
+        st->rate_ups++;
+    }
+    uplink->rate_change_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "📶 上行%s档 %d → %d: %d → %d bps, 每条 %d → %d ms (积压 %lu ms, 发送平均 %lu us)",
+             level > prev ? "降" : "升", prev, level, prev_bitrate, uplink->opus_bitrate,
+             prev_ms, st->message_ms, st->backlog_ms, st->send_us_avg);
+}
+
+/**
+ * @brief 码率自适应：每条消息发送后统计积压，按评估间隔决定是否换档
+ * 
+ * 平均发送耗时接近消息时长或积压超过 UPLINK_RATE_BACKLOG_HIGH_MS 时立即降一档；
+ * 两者都低于下限且持续 UPLINK_RATE_UP_HOLD_MS 后才升一档。
+ */
+static void uplink_rate_adapt(audio_uplink_t *uplink)
+{
+    audio_uplink_stats_t *st = &uplink->stats;
+    st->backlog_ms = (uint32_t)(simple_ring_buffer_available(uplink->rb) / uplink->bytes_per_ms);
+    if (st->backlog_ms > st->backlog_ms_max) {
+        st->backlog_ms_max = st->backlog_ms;
+    }
+    
+    // 预录补发中帧长不能变
+    if (uplink->rate_level_count <= 1 || uplink->replay > 0) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    if (now - uplink->rate_eval_us < UPLINK_RATE_EVAL_MS * 1000) {
+        return;
+    }
+    uplink->rate_eval_us = now;
+    
+    uint32_t message_us = (uint32_t)st->message_ms * 1000;
+    bool congested = st->backlog_ms > UPLINK_RATE_BACKLOG_HIGH_MS ||
+                     st->send_us_avg > message_us / 100 * UPLINK_RATE_SEND_HIGH_PCT;
+    bool clear = st->backlog_ms < UPLINK_RATE_BACKLOG_LOW_MS &&
+                 st->send_us_avg < message_us / 100 * UPLINK_RATE_SEND_LOW_PCT;
+    
+    if (congested) {
+        uplink->rate_good_since_us = 0;
+        if (uplink->rate_level + 1 < uplink->rate_level_count) {
+            uplink_rate_apply(uplink, uplink->rate_level + 1);
+        }
+    } else if (clear && uplink->rate_level > 0) {
+        if (uplink->rate_good_since_us == 0) {
+            uplink->rate_good_since_us = now;
+        } else if (now - uplink->rate_good_since_us >= UPLINK_RATE_UP_HOLD_MS * 1000 &&
+                   now - uplink->rate_change_us >= UPLINK_RATE_UP_HOLD_MS * 1000) {
+            uplink->rate_good_since_us = now;
+            uplink_rate_apply(uplink, uplink->rate_level - 1);
+        }
+    } else {
+        uplink->rate_good_since_us = 0;
+    }
+}
+
+/**
+ * @brief 静音门：判断一帧是否发送
+ * 
+ * 门关闭时帧存入预录环并丢弃；由关到开时连同当前帧一起进入补发（replay），
+ * 之后由任务按时间顺序从预录环取出发送。
+ * 
+ * @param uplink 模块句柄
+ * @param frame 完整一帧 PCM
+ * @return true 立即处理本帧，false 本帧已丢弃或转入补发
+ */
+static bool uplink_gate_pass(audio_uplink_t *uplink, const uint8_t *frame)
+{
+    if (!uplink->config.vad_gate) {
+        return true;
+    }
+    
+    // 本帧在音频流中的结束位置 > 人声起点，且（仍有人声或本帧起点 < 人声终点 + 拖尾）
+    uint32_t frame_end = uplink->read_pos;
+    bool voice = uplink->voice;
+    bool open = (int32_t)(frame_end - uplink->voice_start_pos) > 0 &&
+                (voice || (int32_t)(frame_end - (uint32_t)uplink->frame_bytes -
+                                    (uplink->voice_end_pos + uplink->hangover_bytes)) < 0);
+    if (open && uplink->gate_open) {
+        return true;
+    }
+    
+    audio_uplink_stats_t *st = &uplink->stats;
+    if (!open && uplink->gate_open) {
+        uplink->gate_open = false;
+        ESP_LOGD(TAG, "🔇 静音门关闭");
+    }
+    
+    if (uplink->preroll_cap == 0) {
+        if (!open) {
+            st->gated_frames++;
+            st->gated_ms += uplink->frame_ms;
+            st->saved_bytes += uplink->gate_frame_wire;
+            return false;
+        }
+        uplink->gate_open = true;
+        st->gate_opens++;
+        return true;
+    }
+    
+    // 存入预录环（满时覆盖最旧的一帧，被覆盖的帧才算真正抑制）
+    memcpy(uplink->preroll + (size_t)uplink->preroll_head * uplink->frame_bytes, frame, uplink->frame_bytes);
+    uplink->preroll_head = (uplink->preroll_head + 1) % uplink->preroll_cap;
+    if (uplink->preroll_count < uplink->preroll_cap) {
+        uplink->preroll_count++;
+    } else {
+        st->gated_frames++;
+        st->gated_ms += uplink->frame_ms;
+        st->saved_bytes += uplink->gate_frame_wire;
+    }
+    
+    if (open) {
+        uplink->gate_open = true;
+        uplink->replay = uplink->preroll_count;
+        uplink->preroll_count = 0;
+        st->gate_opens++;
+        ESP_LOGD(TAG, "🔊 静音门打开，补发 %d ms 预录", (uplink->replay - 1) * uplink->frame_ms);
+    }
+    return false;
+}
+
+/**
+ * @brief 取出下一帧待补发的预录帧
+ */
+static void uplink_gate_replay(audio_uplink_t *uplink, uint8_t *frame)
+{
+    int idx = (uplink->preroll_head - uplink->replay + uplink->preroll_cap) % uplink->preroll_cap;
+    memcpy(frame, uplink->preroll + (size_t)idx * uplink->frame_bytes, uplink->frame_bytes);
+    uplink->replay--;
+}
+
+/**
+ * @brief 打印上行统计（条/秒、线上码率、负载码率）
+ */
+static void uplink_report(audio_uplink_t *uplink, audio_uplink_stats_t *last, int64_t *last_us)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t dt_ms = (now - *last_us) / 1000;
+    if (dt_ms <= 0) {
+        return;
+    }
+    
+    const audio_uplink_stats_t *st = &uplink->stats;
+    uint32_t msgs = st->messages - last->messages;
+    uint64_t wire = st->wire_bytes - last->wire_bytes;
+    uint64_t payload = st->payload_bytes - last->payload_bytes;
+    
+    ESP_LOGI(TAG, "📊 上行: %lu 条消息/%llu ms 音频 (%.1f 条/秒, 线上 %.1f kbps, 负载 %.1f kbps, 组包平均 %lu us, 失败 %lu, 空闲堆 %lu)",
+             st->messages, st->audio_ms,
+             msgs * 1000.0f / dt_ms, wire * 8.0f / dt_ms, payload * 8.0f / dt_ms,
+             (unsigned long)(uplink->build_us_total / (uplink->msg_seq ? uplink->msg_seq : 1)),
+             st->send_fail, (unsigned long)esp_get_free_heap_size());
+    if (uplink->config.format == AUDIO_UPLINK_FORMAT_OPUS && st->encoded_frames > 0) {
+        ESP_LOGI(TAG, "📊 Opus: 复杂度 %d (调整 %lu 次), 编码平均 %lu us/最大 %lu us, 本期码率 %.1f kbps, DTX 帧 %lu/%lu, 编码器丢失丢帧 %lu",
+                 st->opus_complexity, st->complexity_changes,
+                 (unsigned long)(st->encode_us_total / st->encoded_frames), st->encode_us_max,
+                 payload * 8.0f / (st->audio_ms - last->audio_ms ? st->audio_ms - last->audio_ms : 1),
+                 st->dtx_frames, st->encoded_frames, st->encoder_lost_frames);
+    }
+    if (uplink->rate_level_count > 1) {
+        ESP_LOGI(TAG, "📊 码率自适应: 档位 %d/%d (%d bps, 每条 %d ms), 发送平均 %lu us/最大 %lu us, 积压最大 %lu ms, 降档 %lu/升档 %lu",
+                 st->rate_level, uplink->rate_level_count - 1, st->bitrate, st->message_ms,
+                 st->send_us_avg, st->send_us_max, st->backlog_ms_max, st->rate_downs, st->rate_ups);
+    }
+    if (uplink->config.vad_gate) {
+        ESP_LOGI(TAG, "📊 静音门: 人声段 %lu, 抑制 %lu 帧/%llu ms, 节省约 %llu 字节",
+                 st->gate_opens, st->gated_frames, st->gated_ms, st->saved_bytes);
+    }
+    
+    *last = *st;
+    *last_us = now;
+}
+
 /**
  * @brief 音频发送任务
+ * 
+ * 按 frame_ms 切帧，每 frames_per_message 帧组成一条消息发送；
+ * 聚合中的音频等待超过 max_batch_latency_ms 时（例如说话结束、输入中断）立即发送已有部分。
  */
 static void audio_uplink_task(void *arg)
 {
     audio_uplink_t *uplink = (audio_uplink_t *)arg;
+    const bool is_opus = (uplink->config.format == AUDIO_UPLINK_FORMAT_OPUS);
+    const int max_message_ms = uplink->rate_levels[uplink->rate_level_count - 1].message_ms;
     
     ESP_LOGI(TAG, "🚀 音频上行任务启动");
-    ESP_LOGI(TAG, "  格式: %s", uplink->config.format == AUDIO_UPLINK_FORMAT_OPUS ? "Opus" : "PCM");
+    ESP_LOGI(TAG, "  格式: %s", is_opus ? "Opus" : "PCM");
     ESP_LOGI(TAG, "  采样率: %d Hz", uplink->config.sample_rate);
+    ESP_LOGI(TAG, "  分包: %d ms × %d 帧/消息 (时延上限 %d ms)",
+             uplink->frame_ms, uplink->frames_per_message, uplink->max_batch_latency_ms);
+    if (uplink->rate_level_count > 1) {
+        ESP_LOGI(TAG, "  码率自适应: %d 档, 最低 %d bps/每条 %d ms",
+                 uplink->rate_level_count, uplink->rate_levels[uplink->rate_level_count - 1].bitrate, max_message_ms);
+    }
+    if (uplink->config.vad_gate) {
+        ESP_LOGI(TAG, "  静音门: 预录 %d ms, 拖尾 %d ms",
+                 (uplink->preroll_cap > 0 ? uplink->preroll_cap - 1 : 0) * uplink->frame_ms, uplink->config.hangover_ms);
+    }
     
-    // 固定读取 640 字节（320样本 × 2字节 = 20ms@16kHz）
-    const size_t FRAME_SIZE = 640;
-    uint32_t packet_count = 0;  // 移到这里，避免 goto 跨越初始化
+    // 负载缓冲区：PCM 直接读入（N 帧），Opus 存放编码结果；按最低档（最长消息）分配，换档不重新分配
+    size_t payload_size = is_opus ? UPLINK_OPUS_OUT_MAX : uplink->bytes_per_ms * max_message_ms;
+    size_t payload_len = 0;
+    int batch_frames = 0;
+    size_t fill = 0;                 // 当前帧已读入字节
+    int64_t batch_start_us = 0;      // 本批第一个字节到达时间
+    audio_uplink_stats_t last_stats = uplink->stats;
+    int64_t last_report_us = esp_timer_get_time();
+    uint64_t next_report_ms = uplink->stats.audio_ms + UPLINK_REPORT_MS;
     
-    uint8_t *pcm_frame = (uint8_t *)heap_caps_malloc(FRAME_SIZE, MALLOC_CAP_SPIRAM);
-    uint8_t *opus_buffer = NULL;
+    // 发送缓冲区：模板 + 最大负载的 Base64，启动时分配一次，每帧复用
+    size_t msg_size = UPLINK_MSG_PAYLOAD_OFFSET + base64_get_encode_length(payload_size) + sizeof(UPLINK_MSG_SUFFIX);
     
-    if (uplink->config.format == AUDIO_UPLINK_FORMAT_OPUS) {
-        opus_buffer = (uint8_t *)heap_caps_malloc(4000, MALLOC_CAP_SPIRAM);
-    }
+    uint8_t *payload = (uint8_t *)heap_caps_malloc(payload_size, MALLOC_CAP_SPIRAM);
+    uint8_t *pcm_frame = is_opus ? (uint8_t *)heap_caps_malloc(uplink->bytes_per_ms * max_message_ms, MALLOC_CAP_SPIRAM) : NULL;
+    char *msg = (char *)heap_caps_malloc(msg_size, MALLOC_CAP_SPIRAM);
     
-    if (!pcm_frame || (uplink->config.format == AUDIO_UPLINK_FORMAT_OPUS && !opus_buffer)) {
+    if (!payload || !msg || (is_opus && !pcm_frame)) {
         ESP_LOGE(TAG, "❌ 分配缓冲区失败");
         goto cleanup;
     }
     
+    uplink_msg_init(msg, esp_random());
+    
     while (uplink->running) {
-        // 从环形缓冲区读取固定大小的音频帧
-        size_t got = simple_ring_buffer_read(uplink->rb, pcm_frame, FRAME_SIZE, 200);
-        
-        if (got != FRAME_SIZE) {
-            // 数据不够，继续等待
-            continue;
-        }
+        const size_t frame_bytes = uplink->frame_bytes;
         
-        const uint8_t *send_data = pcm_frame;
-        size_t send_len = FRAME_SIZE;
-        
-        // 如果启用 Opus 编码
-        if (uplink->config.format == AUDIO_UPLINK_FORMAT_OPUS && uplink->opus_encoder) {
-            esp_audio_enc_in_frame_t in_frame = {
-                .buffer = pcm_frame,
-                .len = FRAME_SIZE,
-            };
-            
-            esp_audio_enc_out_frame_t out_frame = {
-                .buffer = opus_buffer,
-                .len = 4000,
-                .encoded_bytes = 0,
-                .pts = 0,
-            };
+        // 读取当前帧剩余部分：PCM 直接读入负载缓冲区，Opus 读入帧缓冲区
+        uint8_t *frame = is_opus ? pcm_frame : payload + payload_len;
+        bool replayed = false;
+        if (uplink->replay > 0 && fill == 0) {
+            // 静音门刚打开：先按时间顺序补发预录帧（最后一帧即触发开门的当前帧）
+            uplink_gate_replay(uplink, frame);
+            if (batch_frames == 0) {
+                batch_start_us = esp_timer_get_time();
+            }
+            fill = frame_bytes;
+            replayed = true;
+        } else {
+            uint32_t timeout_ms = UPLINK_READ_TIMEOUT_MS;
+            if (fill > 0 || batch_frames > 0) {
+                int64_t waited_ms = (esp_timer_get_time() - batch_start_us) / 1000;
+                int64_t remain_ms = uplink->max_batch_latency_ms - waited_ms;
+                timeout_ms = remain_ms > 0 ? (remain_ms < UPLINK_READ_TIMEOUT_MS ? remain_ms : UPLINK_READ_TIMEOUT_MS) : 1;
+            }
             
-            esp_audio_err_t ret = esp_opus_enc_process(uplink->opus_encoder, &in_frame, &out_frame);
-            if (ret == ESP_AUDIO_ERR_OK && out_frame.encoded_bytes > 0) {
-                send_data = opus_buffer;
-                send_len = out_frame.encoded_bytes;
-            } else {
-                ESP_LOGE(TAG, "❌ Opus 编码失败: %d", ret);
-                continue;
+            size_t got = simple_ring_buffer_read(uplink->rb, frame + fill, frame_bytes - fill, timeout_ms);
+            if (got > 0 && fill == 0 && batch_frames == 0) {
+                batch_start_us = esp_timer_get_time();
+            }
+            fill += got;
+            if (got > 0) {
+                // 缓冲区满时写入会覆盖最旧的数据，已读字节数会落后于写入位置：
+                // 按"写入位置 - 剩余未读"校准（并发写入时最多偏差一次写入的长度，下次读取即纠正）
+                uint32_t wp = uplink->write_pos;
+                uplink->read_pos = wp - (uint32_t)simple_ring_buffer_available(uplink->rb);
             }
         }
         
-        // Base64 编码
-        size_t base64_len = 0;
-        char *base64_str = base64_encode_audio(send_data, send_len, &base64_len);
-        
-        if (!base64_str) {
-            ESP_LOGE(TAG, "❌ Base64 编码失败");
-            continue;
+        // 聚合超时：说话结束或输入中断，不足一帧的部分补静音
+        bool expired = (fill > 0 || batch_frames > 0) &&
+                       (esp_timer_get_time() - batch_start_us) / 1000 >= uplink->max_batch_latency_ms;
+        if (fill > 0 && fill < frame_bytes && expired) {
+            memset(frame + fill, 0, frame_bytes - fill);
+            fill = frame_bytes;
         }
         
-        // 构建 JSON 消息
-        cJSON *root = cJSON_CreateObject();
-        char event_id[64];
-        snprintf(event_id, sizeof(event_id), "audio_%lld", esp_timer_get_time() / 1000);
-        
-        cJSON_AddStringToObject(root, "id", event_id);
-        cJSON_AddStringToObject(root, "event_type", "input_audio_buffer.append");
-        
-        cJSON *data = cJSON_CreateObject();
-        cJSON_AddStringToObject(data, "delta", base64_str);
-        cJSON_AddItemToObject(root, "data", data);
-        
-        char *json_str = cJSON_PrintUnformatted(root);
-        
-        // 通过回调函数发送
-        if (uplink->config.send_callback && json_str) {
-            packet_count++;
-            bool success = uplink->config.send_callback(json_str, uplink->config.send_callback_ctx);
-            
-            if (!success) {
-                ESP_LOGW(TAG, "⚠️ 音频包 #%lu 发送失败", packet_count);
+        // 完整一帧：经静音门后加入本批（静音帧不编码、不发送）
+        if (fill == frame_bytes) {
+            fill = 0;
+            if (!replayed && !uplink_gate_pass(uplink, frame)) {
+                continue;
             }
-            // 每100包打印一次统计
-            else if (packet_count % 100 == 0) {
-                ESP_LOGI(TAG, "📊 已发送 %lu 包 (缓冲区: %d bytes)", 
-                         packet_count, simple_ring_buffer_available(uplink->rb));
+            if (is_opus) {
+                // 编码器重建失败：丢弃该帧（不能把 PCM 当 Opus 发出），到点重试
+                if (!uplink_opus_retry(uplink)) {
+                    uplink->stats.encoder_lost_frames++;
+                    continue;
+                }
+                
+                esp_audio_enc_in_frame_t in_frame = {
+                    .buffer = pcm_frame,
+                    .len = (uint32_t)frame_bytes,
+                };
+                
+                esp_audio_enc_out_frame_t out_frame = {
+                    .buffer = payload,
+                    .len = (uint32_t)payload_size,
+                    .encoded_bytes = 0,
+                    .pts = 0,
+                };
+                
+                int64_t t0 = esp_timer_get_time();
+                esp_audio_err_t ret = esp_opus_enc_process(uplink->opus_encoder, &in_frame, &out_frame);
+                uint32_t encode_us = (uint32_t)(esp_timer_get_time() - t0);
+                if (ret != ESP_AUDIO_ERR_OK || out_frame.encoded_bytes == 0) {
+                    ESP_LOGE(TAG, "❌ Opus 编码失败: %d", ret);
+                    continue;
+                }
+                payload_len = out_frame.encoded_bytes;
+                
+                // 编码统计
+                audio_uplink_stats_t *st = &uplink->stats;
+                st->encode_us_last = encode_us;
+                st->encode_us_total += encode_us;
+                if (encode_us > st->encode_us_max) {
+                    st->encode_us_max = encode_us;
+                }
+                st->encoded_frames++;
+                if (out_frame.encoded_bytes <= UPLINK_OPUS_DTX_BYTES) {
+                    st->dtx_frames++;
+                }
+                
+                if (uplink->config.opus_adaptive_complexity) {
+                    uplink_opus_adapt(uplink, encode_us);
+                }
+            } else {
+                payload_len += frame_bytes;
             }
+            batch_frames++;
         }
         
-        // 清理 JSON
-        if (json_str) free(json_str);
-        cJSON_Delete(root);
-        // base64_str 指向静态缓冲区，不需要释放
+        // 凑满一批或超时：发送
+        if (batch_frames > 0 && (batch_frames >= uplink->frames_per_message || expired)) {
+            uplink_send_batch(uplink, msg, msg_size, payload, payload_len, batch_frames);
+            payload_len = 0;
+            batch_frames = 0;
+            
+            // 批边界：按发送耗时与积压调整档位
+            uplink_rate_adapt(uplink);
+            
+            if (uplink->stats.audio_ms >= next_report_ms) {
+                uplink_report(uplink, &last_stats, &last_report_us);
+                next_report_ms = uplink->stats.audio_ms + UPLINK_REPORT_MS;
+            }
+        }
     }
     
 cleanup:
+    if (payload) heap_caps_free(payload);
     if (pcm_frame) heap_caps_free(pcm_frame);
-    if (opus_buffer) heap_caps_free(opus_buffer);
+    if (msg) heap_caps_free(msg);
     
     ESP_LOGI(TAG, "音频上行任务退出");
     vTaskDelete(NULL);
@@ -175,6 +855,38 @@ audio_uplink_handle_t audio_uplink_create(const audio_uplink_config_t *config)
     
     // 复制配置
     memcpy(&uplink->config, config, sizeof(audio_uplink_config_t));
+    uplink->task_sched = config->task_sched ? *config->task_sched : *xn_sched_get(NULL, XN_TASK_AUDIO_UPLINK);
+    
+    // 校正分包参数
+    uplink->frame_ms = config->frame_ms;
+    if (uplink->frame_ms != 20 && uplink->frame_ms != 40 && uplink->frame_ms != 60) {
+        if (uplink->frame_ms != 0) {
+            ESP_LOGW(TAG, "不支持的帧时长 %d ms，使用 20 ms", uplink->frame_ms);
+        }
+        uplink->frame_ms = 20;
+    }
+    uplink->frames_per_message = config->frames_per_message > 0 ? config->frames_per_message : 1;
+    
+    // Opus 包之间没有分隔，不能直接拼接：把 N 帧合并为一个更长的 Opus 帧（最长 120ms）
+    if (config->format == AUDIO_UPLINK_FORMAT_OPUS && uplink->frames_per_message > 1) {
+        int total_ms = uplink->frame_ms * uplink->frames_per_message;
+        total_ms = total_ms > 120 ? 120 : total_ms / 20 * 20;
+        ESP_LOGI(TAG, "Opus 聚合 %d×%d ms → 单个 %d ms 帧", uplink->frames_per_message, uplink->frame_ms, total_ms);
+        uplink->frame_ms = total_ms;
+        uplink->frames_per_message = 1;
+    }
+    
+    uplink->bytes_per_ms = (size_t)config->sample_rate / 1000 * config->channels * (config->bit_depth / 8);
+    uplink->opus_bitrate = config->opus_bitrate > 0 ? config->opus_bitrate : 16000;
+    
+    int batch_ms = uplink->frame_ms * uplink->frames_per_message;
+    if (config->max_batch_latency_ms > 0 && config->max_batch_latency_ms < batch_ms) {
+        ESP_LOGW(TAG, "聚合时延上限 %d ms 小于批时长 %d ms，每批将提前发送", config->max_batch_latency_ms, batch_ms);
+    }
+    
+    // 码率自适应档位（未启用时只有配置档）
+    uplink_rate_build(uplink);
+    int max_message_ms = uplink->rate_levels[uplink->rate_level_count - 1].message_ms;
     
     // 创建环形缓冲区（16KB，约 250ms@16kHz）
     uplink->rb = simple_ring_buffer_create(16384);
@@ -184,29 +896,46 @@ audio_uplink_handle_t audio_uplink_create(const audio_uplink_config_t *config)
         return NULL;
     }
     
+    // 静音门：预录缓冲按最长帧分配（预录时长 + 两帧），各档位在其中划分帧环
+    if (config->vad_gate) {
+        uplink->config.preroll_ms = config->preroll_ms > 0 ? config->preroll_ms : 0;
+        uplink->config.hangover_ms = config->hangover_ms > 0 ? config->hangover_ms : 0;
+        uplink->hangover_bytes = (uint32_t)(uplink->bytes_per_ms * uplink->config.hangover_ms);
+        uplink->voice_start_pos = 0u - uplink->hangover_bytes;  // 初始为关门状态
+        uplink->voice_end_pos = uplink->voice_start_pos;
+        if (uplink->config.preroll_ms > 0) {
+            int max_frame_ms = config->format == AUDIO_UPLINK_FORMAT_OPUS ? max_message_ms : uplink->frame_ms;
+            uplink->preroll_size = uplink->bytes_per_ms * (uplink->config.preroll_ms + 2 * max_frame_ms);
+            uplink->preroll = (uint8_t *)heap_caps_malloc(uplink->preroll_size, MALLOC_CAP_SPIRAM);
+            if (!uplink->preroll) {
+                ESP_LOGW(TAG, "⚠️ 分配预录缓冲失败，静音门不补发预录");
+            }
+        }
+    }
+    
+    uplink_set_geometry(uplink, batch_ms);
+    
     // 如果需要 Opus 编码，创建编码器
     if (config->format == AUDIO_UPLINK_FORMAT_OPUS) {
-        esp_opus_enc_config_t opus_cfg = {
-            .sample_rate = config->sample_rate,
-            .channel = config->channels,
-            .bits_per_sample = config->bit_depth,
-            .bitrate = config->opus_bitrate > 0 ? config->opus_bitrate : 16000,
-            .frame_duration = ESP_OPUS_ENC_FRAME_DURATION_20_MS,
-            .application_mode = ESP_OPUS_ENC_APPLICATION_VOIP,
-            .complexity = 0,  // 最低复杂度
-            .enable_fec = false,
-            .enable_dtx = false,
-            .enable_vbr = false,
-        };
+        if (uplink->config.opus_cpu_budget_pct <= 0 || uplink->config.opus_cpu_budget_pct > 100) {
+            uplink->config.opus_cpu_budget_pct = 25;
+        }
+        int complexity = config->opus_complexity;
+        complexity = complexity < 0 ? 0 : (complexity > UPLINK_OPUS_MAX_COMPLEXITY ? UPLINK_OPUS_MAX_COMPLEXITY : complexity);
         
-        esp_audio_err_t ret = esp_opus_enc_open(&opus_cfg, sizeof(opus_cfg), &uplink->opus_encoder);
+        esp_audio_err_t ret = uplink_opus_open(uplink, complexity);
         if (ret != ESP_AUDIO_ERR_OK) {
             ESP_LOGE(TAG, "创建 Opus 编码器失败: %d", ret);
+            if (uplink->preroll) heap_caps_free(uplink->preroll);
             simple_ring_buffer_destroy(uplink->rb);
             free(uplink);
             return NULL;
         }
-        ESP_LOGI(TAG, "✅ Opus 编码器创建成功 (码率: %d bps)", opus_cfg.bitrate);
+        ESP_LOGI(TAG, "✅ Opus 编码器创建成功 (码率: %d bps%s, 复杂度: %d%s, %s, DTX: %s, FEC: %s)",
+                 uplink->opus_bitrate, uplink->rate_level_count > 1 ? " 自适应" : "", complexity,
+                 config->opus_adaptive_complexity ? " 自适应" : "",
+                 config->opus_vbr ? "VBR" : "CBR",
+                 config->opus_dtx ? "开" : "关", config->opus_fec ? "开" : "关");
     }
     
     ESP_LOGI(TAG, "✅ 音频上行模块创建成功");
@@ -218,7 +947,11 @@ void audio_uplink_destroy(audio_uplink_handle_t handle)
     if (!handle) return;
     
     // 停止任务
-    audio_uplink_stop(handle);
+    if (audio_uplink_stop(handle) != ESP_OK || handle->task_lost) {
+        // 被强制删除的任务可能正持有缓冲区互斥锁或在使用编码器，释放这些资源不安全
+        ESP_LOGE(TAG, "❌ 上行任务未正常退出，泄漏模块资源");
+        return;
+    }
     
     // 销毁编码器
     if (handle->opus_encoder) {
@@ -229,6 +962,9 @@ void audio_uplink_destroy(audio_uplink_handle_t handle)
     if (handle->rb) {
         simple_ring_buffer_destroy(handle->rb);
     }
+    if (handle->preroll) {
+        heap_caps_free(handle->preroll);
+    }
     
     free(handle);
     ESP_LOGI(TAG, "音频上行模块已销毁");
@@ -245,19 +981,18 @@ esp_err_t audio_uplink_start(audio_uplink_handle_t handle)
         return ESP_OK;
     }
     
+    if (handle->task_lost) {
+        ESP_LOGE(TAG, "上行任务曾被强制删除，模块不可再启动");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
     handle->running = true;
     
-    // 创建任务（栈在 PSRAM）
-    BaseType_t ret = xTaskCreate(
-        audio_uplink_task,
-        "audio_uplink",
-        12288*2,  // 12KB 栈（增加至12KB，确保足够处理Base64+JSON+WebSocket）
-        handle,
-        6,     // 优先级
-        &handle->task
-    );
-    
-    if (ret != pdPASS) {
+    // 按调度档案创建任务（均衡预设：不绑核，优先级6，24KB 栈，确保足够处理Base64+JSON+WebSocket）
+    esp_err_t ret = xn_task_create(&handle->task, &handle->task_sched,
+                                   audio_uplink_task, "audio_uplink", handle);
+    
+    if (ret != ESP_OK) {
         ESP_LOGE(TAG, "创建任务失败");
         handle->running = false;
         return ESP_FAIL;
@@ -275,10 +1010,17 @@ esp_err_t audio_uplink_stop(audio_uplink_handle_t handle)
     
     handle->running = false;
     
-    // 等待任务退出
-    if (handle->task) {
-        vTaskDelay(pdMS_TO_TICKS(200));
-        handle->task = NULL;
+    // 唤醒阻塞在读取上的任务；发送回调最多阻塞 send_block_ms，等待上限覆盖"读取 + 发送"的最坏情况
+    simple_ring_buffer_wake(handle->rb);
+    int send_block_ms = handle->config.send_block_ms > 0 ? handle->config.send_block_ms : UPLINK_SEND_BLOCK_MS;
+    uint32_t wait_ms = UPLINK_READ_TIMEOUT_MS + (uint32_t)send_block_ms + UPLINK_STOP_MARGIN_MS;
+    
+    // 等待任务退出并回收任务栈
+    if (xn_task_join(&handle->task, wait_ms) != ESP_OK) {
+        // 任务已被强制删除：跳过了自身清理，可能还持有缓冲区互斥锁，此后模块只能泄漏
+        handle->task_lost = true;
+        ESP_LOGE(TAG, "❌ 音频上行任务 %lu ms 内未退出，已强制删除", (unsigned long)wait_ms);
+        return ESP_ERR_TIMEOUT;
     }
     
     ESP_LOGI(TAG, "音频上行任务已停止");
@@ -291,9 +1033,39 @@ esp_err_t audio_uplink_write(audio_uplink_handle_t handle,
     if (!handle || !data || len == 0) {
         return ESP_ERR_INVALID_ARG;
     }
+    if (handle->task_lost) {
+        return ESP_ERR_INVALID_STATE;  // 缓冲区互斥锁可能仍被已删除的任务持有
+    }
     
     // 直接写入环形缓冲区（零拷贝）
-    return simple_ring_buffer_write(handle->rb, data, len);
+    esp_err_t ret = simple_ring_buffer_write(handle->rb, data, len);
+    if (ret == ESP_OK) {
+        handle->write_pos = handle->write_pos + (uint32_t)len;
+    }
+    return ret;
+}
+
+void audio_uplink_set_voice(audio_uplink_handle_t handle, bool speech)
+{
+    if (!handle) return;
+    
+    // 先记位置再改状态：上行任务看到新状态时位置已就绪
+    if (speech && !handle->voice) {
+        handle->voice_start_pos = handle->write_pos;
+    } else if (!speech && handle->voice) {
+        handle->voice_end_pos = handle->write_pos;  // 拖尾从此处起算
+    }
+    handle->voice = speech;
+}
+
+esp_err_t audio_uplink_get_stats(audio_uplink_handle_t handle, audio_uplink_stats_t *stats)
+{
+    if (!handle || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    *stats = handle->stats;
+    return ESP_OK;
 }
 
 void audio_uplink_clear(audio_uplink_handle_t handle)
@@ -301,6 +1073,8 @@ void audio_uplink_clear(audio_uplink_handle_t handle)
     if (!handle) return;
     
     simple_ring_buffer_clear(handle->rb);
+    // write_pos 保持单调（人声起止位置以它为基准），读位置追到写位置：清空的音频视为已读过
+    handle->read_pos = handle->write_pos;
     ESP_LOGI(TAG, "音频缓冲区已清空");
 }
 
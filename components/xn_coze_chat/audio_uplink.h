@@ -4,8 +4,10 @@
  * 
  * 功能：
  * - 接收 PCM 音频数据（通过环形缓冲区）
+ * - 可选 VAD 静音门：只发送人声段（含预录与拖尾），静音帧不编码不发送
  * - 可选 Opus 编码（节省带宽）
- * - Base64 编码
+ * - 可选码率自适应：按发送耗时与积压分级降低码率/增大聚合，链路恢复后逐级回升
+ * - Base64 编码（直接编码进预格式化消息模板，每帧无堆分配）
  * - JSON 封装
  * - WebSocket 发送
  */
@@ -14,6 +16,7 @@
 
 #include "esp_err.h"
 #include "simple_ring_buffer.h"
+#include "xn_task_sched.h"
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -36,11 +39,14 @@ typedef enum {
 /**
  * @brief WebSocket 发送回调函数
  * 
- * @param json_str JSON 格式的消息字符串
+ * @param msg JSON 格式的消息（不以 '\0' 结尾，指向模块内部复用的发送缓冲区）
+ * @param len 消息长度
  * @param user_ctx 用户上下文
  * @return true 发送成功，false 发送失败
+ * 
+ * @note msg 仅在回调期间有效
  */
-typedef bool (*audio_uplink_send_callback_t)(const char *json_str, void *user_ctx);
+typedef bool (*audio_uplink_send_callback_t)(const char *msg, size_t len, void *user_ctx);
 
 /**
  * @brief 音频上行配置
@@ -53,13 +59,78 @@ typedef struct {
     
     // Opus 编码配置（仅在 format=OPUS 时有效）
     int opus_bitrate;                    ///< Opus 码率（推荐 16000）
+    int opus_complexity;                 ///< 编码复杂度 0~10（开启自适应时为初始值）
+    bool opus_vbr;                       ///< 可变码率
+    bool opus_dtx;                       ///< 不连续传输：静音段只输出极短的 DTX 包
+    bool opus_fec;                       ///< 带内前向纠错
+    bool opus_adaptive_complexity;       ///< 按实测编码耗时自动调整复杂度
+    int opus_cpu_budget_pct;             ///< 编码耗时预算：占帧时长的百分比（0 使用 25）
+    
+    // 分包配置
+    int frame_ms;                        ///< 帧时长：20/40/60 ms（0 使用 20）
+    int frames_per_message;              ///< 每条消息聚合帧数（0/1 不聚合；Opus 合并为单个更长的帧，最长 120ms）
+    int max_batch_latency_ms;            ///< 聚合时延上限：本批首个采样到发送的最长等待（0 使用批时长 + 1 帧）
+    
+    // VAD 静音门（人声状态由 audio_uplink_set_voice 输入）
+    bool vad_gate;                       ///< 启用静音门：无人声时丢弃音频帧
+    int preroll_ms;                      ///< 预录：门打开时先补发之前这段音频，弥补 VAD 起点检测延迟
+    int hangover_ms;                     ///< 拖尾：人声结束后继续发送的时长，避免切掉尾音
+    
+    // 码率自适应（发送变慢或积压增长时分级降档：先降 Opus 码率，再增大每条消息时长）
+    bool adaptive_rate;                  ///< 启用码率自适应
+    int min_bitrate;                     ///< 最低 Opus 码率（0 使用 12000）
+    int max_message_ms;                  ///< 降档时每条消息最长时长（0 使用 120）
     
     // WebSocket 发送回调
     audio_uplink_send_callback_t send_callback;  ///< 发送回调函数
     void *send_callback_ctx;             ///< 发送回调的用户上下文
+    int send_block_ms;                   ///< 发送回调最长阻塞时长：停止时据此等待任务退出（0 使用 1000）
+    
+    // 任务调度
+    const xn_task_sched_t *task_sched;   ///< 上行任务调度参数（NULL 使用均衡预设）
     
 } audio_uplink_config_t;
 
+/**
+ * @brief 上行统计
+ */
+typedef struct {
+    uint32_t messages;                   ///< 已发送消息数
+    uint32_t frames;                     ///< 已发送帧数
+    uint32_t send_fail;                  ///< 发送失败次数
+    uint64_t audio_ms;                   ///< 已发送音频时长
+    uint64_t payload_bytes;              ///< 音频负载字节数（Base64 前）
+    uint64_t wire_bytes;                 ///< 线上字节数（JSON + WebSocket 帧头，不含 TLS 开销）
+    
+    // Opus 编码（仅 format=OPUS）
+    uint32_t encoded_frames;             ///< 已编码帧数
+    uint32_t dtx_frames;                 ///< DTX 帧数（静音段）
+    uint32_t encode_us_last;             ///< 最近一帧编码耗时
+    uint32_t encode_us_max;              ///< 最大单帧编码耗时
+    uint64_t encode_us_total;            ///< 累计编码耗时
+    int opus_complexity;                 ///< 当前复杂度
+    uint32_t complexity_changes;         ///< 复杂度调整次数
+    uint32_t encoder_lost_frames;        ///< 编码器重建失败期间丢弃的帧数
+    
+    // VAD 静音门（仅 vad_gate）
+    uint32_t gate_opens;                 ///< 门打开次数（人声段数）
+    uint32_t gated_frames;               ///< 被抑制的静音帧数
+    uint64_t gated_ms;                   ///< 被抑制的音频时长
+    uint64_t saved_bytes;                ///< 估算节省的线上字节数（按平均每帧线上字节）
+    
+    // 发送时延与码率自适应
+    uint32_t send_us_last;               ///< 最近一条消息的发送耗时（发送回调阻塞时长）
+    uint32_t send_us_avg;                ///< 发送耗时滑动平均
+    uint32_t send_us_max;                ///< 最大发送耗时
+    uint32_t backlog_ms;                 ///< 最近一次发送后的待发积压（环形缓冲区中的音频时长）
+    uint32_t backlog_ms_max;             ///< 最大积压
+    int bitrate;                         ///< 当前 Opus 码率（PCM 为原始码率）
+    int message_ms;                      ///< 当前每条消息的音频时长
+    int rate_level;                      ///< 当前档位（0 为配置档，越大越省带宽）
+    uint32_t rate_downs;                 ///< 降档次数
+    uint32_t rate_ups;                   ///< 升档次数
+} audio_uplink_stats_t;
+
 /**
  * @brief 创建音频上行模块
  * 
@@ -87,7 +158,7 @@ esp_err_t audio_uplink_start(audio_uplink_handle_t handle);
  * @brief 停止音频上行任务
  * 
  * @param handle 模块句柄
- * @return esp_err_t ESP_OK 成功
+ * @return esp_err_t ESP_OK 成功；ESP_ERR_TIMEOUT 任务未按时退出已被强制删除（模块不可再启动）
  */
 esp_err_t audio_uplink_stop(audio_uplink_handle_t handle);
 
@@ -102,6 +173,25 @@ esp_err_t audio_uplink_stop(audio_uplink_handle_t handle);
 esp_err_t audio_uplink_write(audio_uplink_handle_t handle, 
                               const uint8_t *data, size_t len);
 
+/**
+ * @brief 输入人声状态（驱动 VAD 静音门，通常来自 AFE 的 VAD 开始/结束事件）
+ * 
+ * 可在任意任务中调用；未启用 vad_gate 时无效果。
+ * 
+ * @param handle 模块句柄
+ * @param speech true 人声开始，false 人声结束（拖尾后关门）
+ */
+void audio_uplink_set_voice(audio_uplink_handle_t handle, bool speech);
+
+/**
+ * @brief 获取上行统计
+ * 
+ * @param handle 模块句柄
+ * @param stats 输出统计
+ * @return esp_err_t ESP_OK 成功
+ */
+esp_err_t audio_uplink_get_stats(audio_uplink_handle_t handle, audio_uplink_stats_t *stats);
+
 /**
  * @brief 清空音频缓冲区
  * 
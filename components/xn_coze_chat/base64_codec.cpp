@@ -17,14 +17,33 @@ static const char *TAG = "BASE64_CODEC";
 // Opus 20ms@16kHz = 320样本 = 640字节，Base64编码后约 853字节
 // 预分配 2KB 足够覆盖大部分场景
 #define BASE64_ENCODE_BUFFER_SIZE (2048)
-#define BASE64_DECODE_BUFFER_SIZE (1536)  // 2048 * 3 / 4 = 1536
 
 static char *g_encode_buffer = NULL;
-static uint8_t *g_decode_buffer = NULL;
 
 // 🔒 互斥锁保护静态缓冲区（线程安全）
 static SemaphoreHandle_t g_encode_mutex = NULL;
-static SemaphoreHandle_t g_decode_mutex = NULL;
+
+/**
+ * @brief Base64 解码查表（编译期生成，非法字符为 0xFF）
+ */
+struct base64_decode_table_t {
+    uint8_t v[256];
+};
+
+static constexpr base64_decode_table_t base64_make_decode_table()
+{
+    constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    base64_decode_table_t table = {};
+    for (int i = 0; i < 256; i++) {
+        table.v[i] = 0xFF;
+    }
+    for (int i = 0; i < 64; i++) {
+        table.v[(uint8_t)alphabet[i]] = (uint8_t)i;
+    }
+    return table;
+}
+
+static constexpr base64_decode_table_t s_decode_table = base64_make_decode_table();
 
 char* base64_encode_audio(const uint8_t *data, size_t len, size_t *out_len)
 {
@@ -108,82 +127,107 @@ char* base64_encode_audio(const uint8_t *data, size_t len, size_t *out_len)
     return g_encode_buffer;
 }
 
-uint8_t* base64_decode_audio(const char *base64_str, size_t *out_len)
+esp_err_t base64_encode_to(const uint8_t *src, size_t len, char *dst, size_t dst_size, size_t *out_len)
 {
-    // 参数检查
-    if (!base64_str || !out_len) {
-        ESP_LOGE(TAG, "无效的参数");
-        return NULL;
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    if (!src || !dst || !out_len) {
+        return ESP_ERR_INVALID_ARG;
     }
+    *out_len = 0;
 
-    size_t len = strlen(base64_str);
-    if (len == 0) {
-        ESP_LOGE(TAG, "Base64 字符串为空");
-        return NULL;
+    size_t need = base64_get_encode_length(len);
+    if (need > dst_size) {
+        return ESP_ERR_INVALID_SIZE;
     }
 
-    // 第一次调用时创建互斥锁
-    if (!g_decode_mutex) {
-        SemaphoreHandle_t temp_mutex = xSemaphoreCreateMutex();
-        if (!temp_mutex) {
-            ESP_LOGE(TAG, "创建解码互斥锁失败");
-            return NULL;
-        }
-        if (!g_decode_mutex) {
-            g_decode_mutex = temp_mutex;
-        } else {
-            vSemaphoreDelete(temp_mutex);
+    // 每 3 字节编码为 4 个字符
+    char *p = dst;
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3) {
+        uint32_t v = ((uint32_t)src[i] << 16) | ((uint32_t)src[i + 1] << 8) | src[i + 2];
+        p[0] = alphabet[(v >> 18) & 0x3F];
+        p[1] = alphabet[(v >> 12) & 0x3F];
+        p[2] = alphabet[(v >> 6) & 0x3F];
+        p[3] = alphabet[v & 0x3F];
+        p += 4;
+    }
+
+    // 尾部 1~2 字节，补 '='
+    size_t rest = len - i;
+    if (rest > 0) {
+        uint32_t v = (uint32_t)src[i] << 16;
+        if (rest == 2) {
+            v |= (uint32_t)src[i + 1] << 8;
         }
+        p[0] = alphabet[(v >> 18) & 0x3F];
+        p[1] = alphabet[(v >> 12) & 0x3F];
+        p[2] = (rest == 2) ? alphabet[(v >> 6) & 0x3F] : '=';
+        p[3] = '=';
+        p += 4;
     }
 
-    // 🔒 获取互斥锁
-    if (xSemaphoreTake(g_decode_mutex, pdMS_TO_TICKS(500)) != pdTRUE) {
-        ESP_LOGE(TAG, "获取解码互斥锁超时");
-        return NULL;
+    *out_len = (size_t)(p - dst);
+    return ESP_OK;
+}
+
+esp_err_t base64_decode_to(const char *src, size_t len, uint8_t *dst, size_t dst_size, size_t *out_len)
+{
+    if (!src || !dst || !out_len) {
+        return ESP_ERR_INVALID_ARG;
     }
+    *out_len = 0;
 
-    // 第一次调用时分配静态缓冲区（PSRAM）
-    if (!g_decode_buffer) {
-        g_decode_buffer = (uint8_t *)heap_caps_malloc(BASE64_DECODE_BUFFER_SIZE, 
-                                                       MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-        if (!g_decode_buffer) {
-            ESP_LOGE(TAG, "分配解码缓冲区失败: %d bytes", BASE64_DECODE_BUFFER_SIZE);
-            xSemaphoreGive(g_decode_mutex);  // 🔓 释放锁
-            return NULL;
-        }
-        ESP_LOGI(TAG, "✅ Base64 解码缓冲区已分配: %d bytes (PSRAM)", BASE64_DECODE_BUFFER_SIZE);
+    // 去掉末尾填充（最多两个 '='）
+    size_t pad = 0;
+    while (len > 0 && src[len - 1] == '=' && pad < 2) {
+        len--;
+        pad++;
+    }
+    if (len == 0 || len % 4 == 1) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    // 第一步：计算解码后的长度
-    size_t decode_len = 0;
-    int ret = mbedtls_base64_decode(NULL, 0, &decode_len, 
-                                     (const uint8_t *)base64_str, len);
-    if (ret != MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL) {
-        ESP_LOGE(TAG, "计算解码长度失败: %d", ret);
-        xSemaphoreGive(g_decode_mutex);  // 🔓 释放锁
-        return NULL;
+    // 先计算输出长度，超限直接拒绝（不写入半个包）
+    size_t tail = len % 4;
+    size_t need = len / 4 * 3 + (tail ? tail - 1 : 0);
+    if (need > dst_size) {
+        return ESP_ERR_INVALID_SIZE;
     }
-    
-    // 检查缓冲区是否足够
-    if (decode_len > BASE64_DECODE_BUFFER_SIZE) {
-        ESP_LOGE(TAG, "输入数据过大: 需要 %d bytes, 缓冲区只有 %d bytes", 
-                 decode_len, BASE64_DECODE_BUFFER_SIZE);
-        xSemaphoreGive(g_decode_mutex);  // 🔓 释放锁
-        return NULL;
+
+    const uint8_t *s = (const uint8_t *)src;
+    const uint8_t *t = s_decode_table.v;
+    uint8_t *d = dst;
+    size_t i = 0;
+
+    // 每 4 个字符解出 3 字节
+    for (; i + 4 <= len; i += 4) {
+        uint32_t a = t[s[i]], b = t[s[i + 1]], c = t[s[i + 2]], e = t[s[i + 3]];
+        if ((a | b | c | e) & 0x80) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        uint32_t n = (a << 18) | (b << 12) | (c << 6) | e;
+        d[0] = (uint8_t)(n >> 16);
+        d[1] = (uint8_t)(n >> 8);
+        d[2] = (uint8_t)n;
+        d += 3;
     }
-    
-    // 第二步：执行 Base64 解码（使用静态缓冲区）
-    ret = mbedtls_base64_decode(g_decode_buffer, BASE64_DECODE_BUFFER_SIZE, out_len, 
-                                (const uint8_t *)base64_str, len);
-    if (ret != 0) {
-        ESP_LOGE(TAG, "Base64 解码失败: %d", ret);
-        xSemaphoreGive(g_decode_mutex);  // 🔓 释放锁
-        return NULL;
+
+    // 尾部 2 或 3 个字符
+    if (tail) {
+        uint32_t a = t[s[i]], b = t[s[i + 1]], c = (tail == 3) ? t[s[i + 2]] : 0;
+        if ((a | b | c) & 0x80) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        uint32_t n = (a << 18) | (b << 12) | (c << 6);
+        *d++ = (uint8_t)(n >> 16);
+        if (tail == 3) {
+            *d++ = (uint8_t)(n >> 8);
+        }
     }
-    
-    // 返回静态缓冲区指针（调用者需要在下次调用前使用完毕）
-    xSemaphoreGive(g_decode_mutex);  // 🔓 释放锁
-    return g_decode_buffer;
+
+    *out_len = d - dst;
+    return ESP_OK;
 }
 
 size_t base64_get_encode_length(size_t data_len)
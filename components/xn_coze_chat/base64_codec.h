@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "esp_err.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -39,18 +40,39 @@ extern "C" {
 char* base64_encode_audio(const uint8_t *data, size_t len, size_t *out_len);
 
 /**
- * @brief Base64 解码音频数据
+ * @brief Base64 编码到调用者提供的缓冲区（查表实现）
  * 
- * 将 Base64 编码的字符串解码为原始二进制音频数据。
+ * 无全局状态、无堆分配，可多任务并发调用；输出不追加 '\0'，
+ * 便于直接编码进预先格式化好的消息模板中。
  * 
- * @param base64_str Base64 编码的字符串（以 '\0' 结尾）
- * @param out_len 输出参数，返回解码后的数据长度
- * @return uint8_t* 解码后的音频数据，失败返回 NULL
+ * @param src 原始数据
+ * @param len 原始数据长度
+ * @param dst 输出缓冲区
+ * @param dst_size 输出缓冲区大小（需 >= base64_get_encode_length(len)）
+ * @param out_len 输出参数，返回编码后的长度
+ * @return ESP_OK 成功
+ *         ESP_ERR_INVALID_SIZE 输出缓冲区不足（不写入任何数据）
+ *         ESP_ERR_INVALID_ARG 参数错误
+ */
+esp_err_t base64_encode_to(const uint8_t *src, size_t len, char *dst, size_t dst_size, size_t *out_len);
+
+/**
+ * @brief Base64 解码到调用者提供的缓冲区（查表实现）
+ * 
+ * 直接解码 (指针, 长度) 片段，无需 '\0' 结尾；无全局状态，可多任务并发调用。
+ * 先按输入长度算出输出长度，超过 dst_size 时不写入任何数据并返回错误。
+ * 支持带或不带 '=' 填充的输入。
  * 
- * @note 返回的数据使用 PSRAM 分配，调用者需要使用 heap_caps_free() 释放
- * @note 解码公式：输出长度 ≈ (输入长度 * 3 / 4)
+ * @param src Base64 数据起始地址
+ * @param len Base64 数据长度
+ * @param dst 输出缓冲区（例如 Opus 缓冲区中预留的包槽位）
+ * @param dst_size 输出缓冲区大小
+ * @param out_len 输出参数，返回解码后的数据长度
+ * @return ESP_OK 成功
+ *         ESP_ERR_INVALID_SIZE 解码结果超过 dst_size
+ *         ESP_ERR_INVALID_ARG 参数错误或包含非法字符
  */
-uint8_t* base64_decode_audio(const char *base64_str, size_t *out_len);
+esp_err_t base64_decode_to(const char *src, size_t len, uint8_t *dst, size_t dst_size, size_t *out_len);
 
 /**
  * @brief 计算 Base64 编码后的长度（不执行实际编码）
@@ -13,14 +13,20 @@
 
 #include "coze_chat.h"
 #include "coze_websocket.h"
+#include "coze_event_table.h"
+#include "coze_json_scan.h"
 #include "base64_codec.h"
 #include "audio_uplink.h"
 #include "audio_downlink.h"
-#include "simple_ring_buffer.h"
+#include "ws_msg_queue.h"
+#include "xn_tts_stream.h"
 #include "esp_log.h"
 #include "esp_check.h"
 #include "esp_timer.h"
 #include "esp_heap_caps.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "cJSON.h"
 #include <string.h>
 #include <string>
@@ -30,6 +36,9 @@ static const char *TAG = "COZE_CHAT";
 
 // Coze WebSocket服务器地址（双向流式语音对话）
 #define COZE_WEBSOCKET_URL "wss://ws.coze.cn/v1/chat"
+#define COZE_GATE_HANGOVER_MARGIN_MS 200    ///< 服务器端判停时静音门拖尾在服务器静音阈值之上的余量
+#define COZE_WS_MSG_MAX_LEN (64 * 1024)     ///< 单条下行消息保证可接收的长度（与改用消息队列前的上限一致）
+#define COZE_TTS_WAIT_MS 20                 ///< 本地TTS等待播放缓冲区空间/服务器语音播完时检查停止标志的间隔
 
 /**
  * @brief Coze聊天内部结构
@@ -52,12 +61,16 @@ struct coze_chat_t {
     audio_downlink_handle_t audio_downlink;
     
     // JSON解析任务句柄
-    TaskHandle_t parser_task;
+    xn_task_t parser_task;
     // JSON解析任务运行标志
     bool parser_running;
     
-    // WebSocket数据接收环形缓冲区（替代队列，零拷贝架构）
-    simple_ring_buffer_handle_t ws_ring_buffer;
+    // WebSocket接收消息队列（分片直接写入记录，解析任务原地消费）
+    ws_msg_queue_handle_t ws_msg_queue;
+    
+    // 消息分发统计
+    uint32_t fast_path_count;    // 走快速路径的音频包数（不构建cJSON）
+    uint32_t dom_path_count;     // 走通用cJSON路径的消息数
     
     // 配置参数（从用户传入的config复制）
     coze_chat_config_t config;
@@ -66,263 +79,937 @@ struct coze_chat_t {
     bool connected;              // WebSocket是否已连接
     bool session_created;        // 会话是否已创建
     char session_id[64];         // 会话ID
-    char conversation_id[64];    // 对话ID
+    char conversation_id[64];    // 对话ID（服务器分配，重连时沿用；chat_lock 保护）
+    
+    // 连接管理：断线按抖动指数退避重连，唤醒时预连接（connecting 由 chat_lock 保护）
+    std::string ws_url;              // 连接地址（start 时生成）
+    esp_timer_handle_t reconnect_timer;
+    esp_timer_handle_t idle_timer;
+    bool link_wanted;            // start 之后、stop 之前：断线需要重连
+    bool idle_closed;            // 因空闲主动断开，等待预连接
+    volatile bool idle_close_request; // 空闲断开请求：空闲定时器置位，解析任务执行断开
+    bool connecting;             // 建连进行中
+    bool session_ready;          // 本次连接的 chat.update 已确认
+    uint32_t reconnect_attempt;  // 连续失败次数（会话就绪后清零）
+    int64_t connect_start_us;    // 本次建连开始时刻
+    int64_t prewarm_us;          // 等待会话就绪的预连接触发时刻，0 表示无
+    volatile int64_t last_activity_us; // 最近一次收发活动
+    coze_conn_stats_t conn_stats;
+    
+    // 缓存的 chat.update：配置不变，只在 conversation_id 变化时重建
+    std::string chat_update_cache;
+    char cache_conversation_id[64];
+    
+    // 打断（barge-in）：解析任务与调用 coze_chat_interrupt 的任务共享，chat_lock 保护
+    portMUX_TYPE chat_lock;
+    bool chat_active;            // 有进行中的回复（conversation.chat.created 之后、结束之前）
+    char current_chat_id[64];    // 进行中的回复ID
+    char cancelled_chat_id[64];  // 最近被打断的回复ID，其迟到音频丢弃
+    coze_barge_in_stats_t barge_in; // 打断统计
+    int64_t barge_in_trigger_us; // 最近一次打断的触发时刻，收到 canceled 确认后清零
+    
+    // 文本回复+本地TTS（reply_mode 为 COZE_REPLY_MODE_TEXT_TTS 时创建，否则为 NULL）
+    xn_tts_stream_handle_t tts_stream;
+    volatile bool tts_stopping;  // 正在停止本地TTS，PCM回调立即返回
+    bool audio_fallback;         // 本轮已回退到服务器语音
+    uint32_t fallback_units;     // 回退时本地已朗读完的发音字符数，此前的句子不再播放服务器语音
+    uint32_t sentence_units;     // 本轮 sentence_start 累计的发音字符数
+    bool sentence_skip;          // 当前句子本地已朗读过，丢弃其服务器语音
+    uint32_t fallback_dropped;   // 因本地已朗读而丢弃的服务器音频包数
+    
+    // 单轮回复统计
+    coze_turn_stats_t turn;      // 进行中的一轮
+    coze_turn_stats_t last_turn; // 最近结束的一轮
+    int64_t turn_start_us;
+    bool turn_reported;          // last_turn 有效
     
     // 回调函数
     coze_audio_callback_t audio_callback;      // 音频数据回调
     coze_event_callback_t event_callback;       // 事件回调
     coze_ws_event_callback_t ws_event_callback; // WebSocket事件回调
+    
+    // 按事件注册的应用处理函数（chat_lock 保护）
+    struct {
+        coze_server_event_handler_t handler;
+        void *ctx;
+    } event_handlers[COZE_SERVER_EVENT_MAX];
 };
 
 // ============ 内部辅助函数 ============
 
+static void conn_on_session_ready(coze_chat_handle_t handle);
+static void conn_idle_close(coze_chat_handle_t handle);
+
 /**
- * @brief 处理Coze服务器消息
+ * @brief 判断该转检测模式下是否由服务器按静音判断说话结束
+ * 
+ * 为 true 时 coze_chat_send_audio_complete 不发送提交，静音门拖尾需覆盖服务器静音阈值；
+ * 两处都以此为准，避免一处按服务器判停、另一处又手动提交。
+ */
+static constexpr bool turn_ends_on_server_silence(coze_turn_detection_type_t type)
+{
+    return type == COZE_TURN_DETECTION_SERVER_VAD || type == COZE_TURN_DETECTION_SEMANTIC_VAD;
+}
+
+/**
+ * @brief 服务器判停所需的静音时长（客户端提交模式为 0）
+ */
+static constexpr int turn_server_silence_ms(coze_turn_detection_type_t type, int vad_silence_ms,
+                                            int semantic_silence_ms, int semantic_wait_ms)
+{
+    if (!turn_ends_on_server_silence(type)) {
+        return 0;
+    }
+    if (type == COZE_TURN_DETECTION_SEMANTIC_VAD) {
+        return semantic_silence_ms > semantic_wait_ms ? semantic_silence_ms : semantic_wait_ms;
+    }
+    return vad_silence_ms;
+}
+
+/**
+ * @brief 拖尾时长：服务器判停时至少取静音阈值加余量，配置值更大时沿用配置值
+ */
+static constexpr int gate_hangover_ms(bool vad_gate, int hangover_ms, int server_silence_ms)
+{
+    if (!vad_gate || server_silence_ms <= 0 || hangover_ms >= server_silence_ms + COZE_GATE_HANGOVER_MARGIN_MS) {
+        return hangover_ms;
+    }
+    return server_silence_ms + COZE_GATE_HANGOVER_MARGIN_MS;
+}
+
+/**
+ * @brief 模式矩阵：拖尾被延长当且仅当该模式不手动提交（默认阈值 500/300/500 ms，配置拖尾 300 ms）
+ */
+static constexpr bool gate_hangover_matches_commit()
+{
+    constexpr coze_turn_detection_type_t modes[] = {
+        COZE_TURN_DETECTION_SERVER_VAD,
+        COZE_TURN_DETECTION_CLIENT_INTERRUPT,
+        COZE_TURN_DETECTION_SEMANTIC_VAD,
+    };
+    for (coze_turn_detection_type_t mode : modes) {
+        int silence_ms = turn_server_silence_ms(mode, 500, 300, 500);
+        bool extended = gate_hangover_ms(true, 300, silence_ms) > 300;
+        if (extended != turn_ends_on_server_silence(mode) || gate_hangover_ms(false, 300, silence_ms) != 300) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(gate_hangover_matches_commit(), "静音门拖尾与手动提交必须按同一转检测模式判断");
+static_assert(gate_hangover_ms(true, 300, turn_server_silence_ms(COZE_TURN_DETECTION_SERVER_VAD, 500, 300, 500)) == 700,
+              "服务器VAD：拖尾取静音阈值 + 余量");
+static_assert(gate_hangover_ms(true, 300, turn_server_silence_ms(COZE_TURN_DETECTION_SEMANTIC_VAD, 500, 300, 800)) == 1000,
+              "语义VAD：拖尾取两个阈值中较大者 + 余量");
+static_assert(gate_hangover_ms(true, 300, turn_server_silence_ms(COZE_TURN_DETECTION_CLIENT_INTERRUPT, 500, 300, 500)) == 300,
+              "客户端提交：拖尾沿用配置值");
+
+/**
+ * @brief 计算上行静音门实际使用的拖尾时长
  * 
- * 解析并处理从Coze服务器接收到的JSON消息，根据event_type字段分发到不同的处理逻辑。
+ * 服务器VAD/语义VAD由服务器按收到的静音判断说话结束，且此时 coze_chat_send_audio_complete 不发送提交；
+ * 静音门在本地VAD结束后只多发拖尾这段音频，拖尾短于服务器的静音阈值时服务器永远等不到足够的静音，本轮挂起。
+ * 
+ * @param config 配置
+ * @return int 拖尾时长（ms）
+ */
+static int uplink_gate_hangover_ms(const coze_chat_config_t *config)
+{
+    int server_silence_ms = turn_server_silence_ms(config->turn_detection_type, config->vad_silence_duration_ms,
+                                                   config->semantic_vad_silence_threshold_ms,
+                                                   config->semantic_vad_unfinished_wait_time_ms);
+    int hangover_ms = gate_hangover_ms(config->uplink_vad_gate, config->uplink_hangover_ms, server_silence_ms);
+    if (hangover_ms != config->uplink_hangover_ms) {
+        ESP_LOGI(TAG, "静音门拖尾 %d → %d ms（服务器端判停需要 %d ms 静音）",
+                 config->uplink_hangover_ms, hangover_ms, server_silence_ms);
+    }
+    return hangover_ms;
+}
+
+/**
+ * @brief 判断回复ID是否属于已打断的回复
  * 
  * @param handle Coze Chat句柄
- * @param message 接收到的JSON消息字符串
+ * @param chat_id 回复ID（无需 '\0' 结尾）
+ * @param len 回复ID长度
+ * @return true 该回复已被打断，其音频应丢弃
  */
-static void handle_coze_message(coze_chat_handle_t handle, const std::string &message)
+static bool is_cancelled_chat(coze_chat_handle_t handle, const char *chat_id, size_t len)
 {
-    // ⚠️ 屏蔽高频日志：每个JSON包都打印会导致UART溢出
-    // ESP_LOGI(TAG, "📨 收到消息: %.*s", message.length() > 200 ? 200 : (int)message.length(), message.c_str());
+    taskENTER_CRITICAL(&handle->chat_lock);
+    bool match = handle->cancelled_chat_id[0] != '\0' &&
+                 len == strlen(handle->cancelled_chat_id) &&
+                 memcmp(chat_id, handle->cancelled_chat_id, len) == 0;
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    return match;
+}
+
+/**
+ * @brief 记一个被丢弃的迟到音频包（打断统计由 chat_lock 保护）
+ */
+static void barge_in_count_dropped(coze_chat_handle_t handle)
+{
+    taskENTER_CRITICAL(&handle->chat_lock);
+    handle->barge_in.dropped_packets++;
+    taskEXIT_CRITICAL(&handle->chat_lock);
+}
+
+/**
+ * @brief 本轮回复结束（完成/失败/中断）
+ */
+static void chat_set_inactive(coze_chat_handle_t handle)
+{
+    taskENTER_CRITICAL(&handle->chat_lock);
+    handle->chat_active = false;
+    taskEXIT_CRITICAL(&handle->chat_lock);
+}
+
+/**
+ * @brief 判断事件的 data.chat_id 是否属于已打断的回复
+ */
+static bool event_chat_cancelled(coze_chat_handle_t handle, cJSON *data_item)
+{
+    cJSON *chat_id = data_item ? cJSON_GetObjectItem(data_item, "chat_id") : NULL;
+    return chat_id && cJSON_IsString(chat_id) &&
+           is_cancelled_chat(handle, chat_id->valuestring, strlen(chat_id->valuestring));
+}
+
+/**
+ * @brief 本地TTS的PCM输出：写入与下行解码相同的播放目标
+ * 
+ * 服务器语音仍在播放时（上一轮回退）先等它播完，保证播放缓冲区只有一个写入者。
+ */
+static bool tts_pcm_callback(const int16_t *data, int len, void *ctx)
+{
+    coze_chat_handle_t handle = (coze_chat_handle_t)ctx;
     
-    // 解析JSON
-    cJSON *root = cJSON_Parse(message.c_str());
-    if (!root) {
-        // 理论上不应该再出现JSON解析失败（已修复消息分片问题）
-        ESP_LOGE(TAG, "❌ JSON解析失败 (长度: %d)", (int)message.length());
-        ESP_LOGD(TAG, "数据前缀: %.*s...", 100, message.c_str());
-        return;
+    // 阻塞等待服务器语音播完；超时只用于检查停止标志
+    while (audio_downlink_wait_idle(handle->audio_downlink, COZE_TTS_WAIT_MS) != ESP_OK) {
+        if (handle->tts_stopping) {
+            return false;
+        }
     }
     
-    // 获取事件类型（Coze使用 "event_type" 字段）
-    cJSON *event_type_item = cJSON_GetObjectItem(root, "event_type");
-    if (!event_type_item || !cJSON_IsString(event_type_item)) {
-        cJSON_Delete(root);
+    const coze_pcm_sink_t *sink = &handle->config.pcm_sink;
+    if (sink->reserve && sink->commit) {
+        size_t done = 0;
+        while (done < (size_t)len) {
+            if (handle->tts_stopping) {
+                return false;
+            }
+            int16_t *ptr = NULL;
+            // 播放缓冲区满时阻塞在预留上，由播放端消费唤醒
+            size_t got = sink->reserve(&ptr, (size_t)len - done, COZE_TTS_WAIT_MS, sink->ctx);
+            if (got == 0) {
+                continue;
+            }
+            memcpy(ptr, data + done, got * sizeof(int16_t));
+            sink->commit(got, sink->ctx);
+            done += got;
+        }
+    } else if (handle->audio_callback) {
+        handle->audio_callback((char *)data, len * sizeof(int16_t), NULL);
+    }
+    return !handle->tts_stopping;
+}
+
+/**
+ * @brief 立即停止本地TTS（丢弃未朗读的分句）
+ */
+static void tts_stop(coze_chat_handle_t handle)
+{
+    if (!handle->tts_stream) return;
+    
+    handle->tts_stopping = true;
+    xn_tts_stream_stop(handle->tts_stream);
+    handle->tts_stopping = false;
+}
+
+/**
+ * @brief 构建 event_subscriptions：组件处理的全部下行事件
+ * 
+ * 文本回复模式下不订阅 conversation.audio.delta，服务器不再下发语音；
+ * conversation.audio.sentence_start 仍然订阅，回退到服务器语音时据此对齐句子。
+ */
+static cJSON *build_event_subscriptions(bool with_audio)
+{
+    static const char *const EVENTS[] = {
+        "chat.created",
+        "chat.updated",
+        "conversation.chat.created",
+        "conversation.chat.completed",
+        "conversation.chat.failed",
+        "conversation.chat.canceled",
+        "conversation.message.delta",
+        "conversation.message.completed",
+        "conversation.audio.sentence_start",
+        "conversation.audio.completed",
+        "conversation.audio_transcript.update",
+        "conversation.audio_transcript.completed",
+        "conversation.cleared",
+        "input_audio_buffer.speech_started",
+        "input_audio_buffer.speech_stopped",
+        "input_audio_buffer.completed",
+        "input_audio_buffer.cleared",
+        "error",
+    };
+    
+    cJSON *list = cJSON_CreateArray();
+    for (size_t i = 0; i < sizeof(EVENTS) / sizeof(EVENTS[0]); i++) {
+        cJSON_AddItemToArray(list, cJSON_CreateString(EVENTS[i]));
+    }
+    if (with_audio) {
+        cJSON_AddItemToArray(list, cJSON_CreateString("conversation.audio.delta"));
+    }
+    return list;
+}
+
+/**
+ * @brief 只更新事件订阅（chat.update 只带 event_subscriptions，其余配置不变）
+ */
+static bool send_event_subscriptions(coze_chat_handle_t handle, bool with_audio)
+{
+    if (!handle->connected || !handle->websocket) {
+        return false;
+    }
+    
+    cJSON *root = cJSON_CreateObject();
+    
+    char event_id[64];
+    snprintf(event_id, sizeof(event_id), "subscribe_%lld", esp_timer_get_time() / 1000);
+    
+    cJSON_AddStringToObject(root, "id", event_id);
+    cJSON_AddStringToObject(root, "event_type", "chat.update");
+    cJSON *data = cJSON_CreateObject();
+    cJSON_AddItemToObject(data, "event_subscriptions", build_event_subscriptions(with_audio));
+    cJSON_AddItemToObject(root, "data", data);
+    
+    char *json_str = cJSON_PrintUnformatted(root);
+    bool success = handle->websocket->Send(json_str);
+    
+    free(json_str);
+    cJSON_Delete(root);
+    return success;
+}
+
+/**
+ * @brief 本轮剩余部分回退到服务器语音
+ * 
+ * 停止本地TTS并订阅 conversation.audio.delta。已在本地朗读完的句子按 sentence_start
+ * 累计的发音字符数对齐，其服务器语音丢弃，从第一个未朗读完的句子开始播放。
+ */
+static void reply_fallback_to_audio(coze_chat_handle_t handle)
+{
+    tts_stop(handle);
+    
+    xn_tts_stream_stats_t tts_stats;
+    xn_tts_stream_get_stats(handle->tts_stream, &tts_stats);
+    handle->audio_fallback = true;
+    handle->fallback_units = tts_stats.spoken_units;
+    handle->sentence_skip = handle->sentence_units > 0 && handle->sentence_units <= handle->fallback_units;
+    handle->turn.audio_fallback = true;
+    
+    bool success = send_event_subscriptions(handle, true);
+    ESP_LOGW(TAG, "🔁 回复含本地无法朗读的内容，本轮改用服务器语音 (本地已朗读 %lu 字, 订阅%s)",
+             handle->fallback_units, success ? "已更新" : "更新失败");
+}
+
+/**
+ * @brief 一轮回复开始（conversation.chat.created）
+ */
+static void reply_turn_begin(coze_chat_handle_t handle)
+{
+    memset(&handle->turn, 0, sizeof(handle->turn));
+    handle->turn.mode = handle->config.reply_mode;
+    handle->turn_start_us = esp_timer_get_time();
+    
+    handle->audio_fallback = false;
+    handle->fallback_units = 0;
+    handle->sentence_units = 0;
+    handle->sentence_skip = false;
+    if (handle->tts_stream) {
+        xn_tts_stream_begin(handle->tts_stream);
+    }
+}
+
+/**
+ * @brief 一轮回复结束：记录并打印本轮统计，回退过的恢复文本订阅
+ */
+static void reply_turn_end(coze_chat_handle_t handle, const char *reason)
+{
+    if (handle->turn_start_us == 0) {
         return;
     }
     
-    std::string event_type = event_type_item->valuestring;
+    handle->turn.duration_ms = (uint32_t)((esp_timer_get_time() - handle->turn_start_us) / 1000);
+    handle->turn_start_us = 0;
+    handle->last_turn = handle->turn;
+    handle->turn_reported = true;
     
-    // 只对非 delta 事件打印事件类型（避免刷屏）
-    if (event_type != "conversation.message.delta" && 
-        event_type != "conversation.audio.delta" &&
-        event_type != "conversation.audio_transcript.update") {
-        ESP_LOGI(TAG, "📩 事件类型: %s", event_type.c_str());
+    ESP_LOGI(TAG, "📊 本轮%s: %s%s, %lu 条消息 %lu 字节 (语音 %lu, 文本 %lu), 用时 %lu ms, 处理 %lu us",
+             reason,
+             handle->turn.mode == COZE_REPLY_MODE_TEXT_TTS ? "文本+本地TTS" : "服务器语音",
+             handle->turn.audio_fallback ? "（已回退服务器语音）" : "",
+             handle->turn.messages, handle->turn.bytes_total,
+             handle->turn.bytes_audio, handle->turn.bytes_text, handle->turn.duration_ms,
+             handle->turn.process_us);
+    
+    if (handle->audio_fallback) {
+        ESP_LOGI(TAG, "   回退后丢弃本地已朗读句子的语音 %lu 包 (累计)", handle->fallback_dropped);
+        handle->audio_fallback = false;
+        handle->sentence_skip = false;
+        send_event_subscriptions(handle, false);
+    }
+}
+
+/**
+ * @brief conversation.audio.delta 快速路径
+ * 
+ * 音频增量是最频繁的下行消息，且大部分字节是 Base64 音频。
+ * 直接在接收缓冲区中定位 content，把 content 片段交给下行解码，
+ * 不构建cJSON、不复制字符串，全程无堆分配。事件类型已由调用方查表确认。
+ * 
+ * @param handle Coze Chat句柄
+ * @param json JSON缓冲区
+ * @param len 缓冲区长度
+ * @param accepted 输出：音频属于本轮回复（已打断回复的迟到音频、回退后跳过的句子为 false）
+ * @return true 已处理；false 格式不符，交给通用路径
+ */
+static bool handle_audio_delta_fast(coze_chat_handle_t handle, const char *json, size_t len, bool *accepted)
+{
+    *accepted = false;
+    
+    // 已打断回复的迟到音频直接丢弃（未打断过时不扫描）
+    taskENTER_CRITICAL(&handle->chat_lock);
+    bool any_cancelled = handle->cancelled_chat_id[0] != '\0';
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    const char *chat_id = NULL;
+    size_t chat_id_len = 0;
+    if (any_cancelled &&
+        json_scan_string(json, len, "chat_id", &chat_id, &chat_id_len) &&
+        is_cancelled_chat(handle, chat_id, chat_id_len)) {
+        barge_in_count_dropped(handle);
+        return true;
+    }
+    
+    const char *content = NULL;
+    size_t content_len = 0;
+    if (!json_scan_string(json, len, "content", &content, &content_len)) {
+        return false;
+    }
+    // 含转义字符（如 "\/"）时需要反转义，交给通用路径
+    if (memchr(content, '\\', content_len)) {
+        return false;
     }
     
-    // 处理不同类型的事件
-    if (event_type == "chat.created") {
-        // 对话连接成功
-        ESP_LOGI(TAG, "✅ 对话连接成功");
-        handle->session_created = true;
-        
-        if (handle->event_callback) {
-            handle->event_callback(COZE_CHAT_EVENT_CHAT_CREATE, NULL, NULL);
-        }
+    // 交给通用路径的消息由 on_audio_delta 计数，这里只计快速路径处理的本轮音频
+    handle->turn.bytes_audio += len;
+    // 回退到服务器语音后，本地已朗读过的句子不再重复播放
+    if (handle->sentence_skip) {
+        handle->fallback_dropped++;
+        return true;
     }
-    else if (event_type == "chat.updated") {
-        // 对话配置成功
-        ESP_LOGI(TAG, "✅ 对话配置成功");
-        if (handle->event_callback) {
-            handle->event_callback(COZE_CHAT_EVENT_CHAT_UPDATE, NULL, NULL);
-        }
+
+    // 使用音频下行模块处理（Base64解码 → Opus缓冲）
+    if (handle->audio_downlink) {
+        audio_downlink_process_len(handle->audio_downlink, content, content_len);
     }
-    else if (event_type == "conversation.chat.created") {
-        // 对话开始
-        ESP_LOGI(TAG, "✅ 对话开始");
-        if (handle->event_callback) {
-            handle->event_callback(COZE_CHAT_EVENT_CHAT_CREATE, NULL, NULL);
-        }
+    *accepted = true;
+    return true;
+}
+
+// ============ 下行事件处理（每个事件一个函数，经 EVENT_HANDLERS 查表分发） ============
+
+typedef void (*event_handler_fn)(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info);
+
+static void on_chat_created(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 对话连接成功
+    ESP_LOGI(TAG, "✅ 对话连接成功");
+    handle->session_created = true;
+    
+    if (handle->event_callback) {
+        handle->event_callback(COZE_CHAT_EVENT_CHAT_CREATE, NULL, NULL);
     }
-    else if (event_type == "conversation.audio.delta") {
-        // 增量音频数据（Opus编码，Base64）
-        // ⚠️ 屏蔽高频日志：每个音频包（60ms）打印会导致UART溢出
-        
-        cJSON *data_item = cJSON_GetObjectItem(root, "data");
-        if (!data_item) {
-            ESP_LOGW(TAG, "⚠️ 音频事件缺少data字段");
-            return;
-        }
-        
-        cJSON *content = cJSON_GetObjectItem(data_item, "content");
-        if (!content || !cJSON_IsString(content)) {
-            ESP_LOGW(TAG, "⚠️ 音频事件缺少content字段");
-            return;
+}
+
+static void on_chat_updated(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 对话配置成功
+    ESP_LOGI(TAG, "✅ 对话配置成功");
+    conn_on_session_ready(handle);
+    if (handle->event_callback) {
+        handle->event_callback(COZE_CHAT_EVENT_CHAT_UPDATE, NULL, NULL);
+    }
+}
+
+static void on_conversation_chat_created(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 对话开始：记录回复ID，打断时据此丢弃迟到音频
+    ESP_LOGI(TAG, "✅ 对话开始");
+    taskENTER_CRITICAL(&handle->chat_lock);
+    snprintf(handle->current_chat_id, sizeof(handle->current_chat_id), "%s",
+             info->chat_id ? info->chat_id : "");
+    // 记下服务器分配的对话ID，重连后沿用，对话上下文不丢失
+    if (info->conversation_id && info->conversation_id[0]) {
+        snprintf(handle->conversation_id, sizeof(handle->conversation_id), "%s", info->conversation_id);
+    }
+    handle->chat_active = true;
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    reply_turn_begin(handle);
+    if (handle->event_callback) {
+        handle->event_callback(COZE_CHAT_EVENT_CHAT_CREATE, NULL, NULL);
+    }
+}
+
+static void on_conversation_chat_completed(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 对话完成
+    ESP_LOGI(TAG, "✅ 对话完成");
+    chat_set_inactive(handle);
+    reply_turn_end(handle, "完成");
+    if (handle->event_callback) {
+        handle->event_callback(COZE_CHAT_EVENT_CHAT_COMPLETED, NULL, NULL);
+    }
+}
+
+static void on_conversation_chat_failed(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 对话失败
+    ESP_LOGE(TAG, "❌ 对话失败");
+    chat_set_inactive(handle);
+    reply_turn_end(handle, "失败");
+    if (handle->event_callback) {
+        handle->event_callback(COZE_CHAT_EVENT_CHAT_ERROR, NULL, NULL);
+    }
+}
+
+static void on_conversation_chat_canceled(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 智能体输出中断：统计在锁内更新并取快照，锁外打印
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&handle->chat_lock);
+    if (handle->barge_in_trigger_us > 0) {
+        handle->barge_in.ack_ms_last = (uint32_t)((now - handle->barge_in_trigger_us) / 1000);
+        handle->barge_in_trigger_us = 0;
+    }
+    handle->chat_active = false;
+    uint32_t ack_ms = handle->barge_in.ack_ms_last;
+    uint32_t dropped = handle->barge_in.dropped_packets;
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    ESP_LOGI(TAG, "⚠️  对话已中断 (触发到确认 %lu ms, 已丢弃迟到音频 %lu 包)", ack_ms, dropped);
+    reply_turn_end(handle, "已中断");
+}
+
+static void on_message_delta(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 增量消息（文本）- Coze流式返回的文本片段
+    handle->turn.bytes_text += info->json_len;
+    cJSON *data_item = cJSON_GetObjectItem(root, "data");
+    if (!data_item || !info->text) {
+        return;
+    }
+    cJSON *type = cJSON_GetObjectItem(data_item, "type");
+    bool answer = !type || !cJSON_IsString(type) || strcmp(type->valuestring, "answer") == 0;
+    
+    // 打印文本内容（不换行，模拟流式输出效果）
+    printf("%s", info->text);
+    fflush(stdout);
+    
+    // 文本回复模式：按分句送本地TTS
+    if (handle->tts_stream && answer && !handle->audio_fallback &&
+        !event_chat_cancelled(handle, data_item)) {
+        esp_err_t ret = xn_tts_stream_feed(handle->tts_stream, info->text, strlen(info->text));
+        if (ret == ESP_ERR_NOT_SUPPORTED && handle->config.tts_fallback_audio) {
+            reply_fallback_to_audio(handle);
         }
-        
-        const char *audio_base64 = content->valuestring;
-        
+    }
+}
+
+static void on_message_completed(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 消息完成 - 换行结束流式输出
+    printf("\n");
+    ESP_LOGI(TAG, "✅ 消息完成");
+    // 文本回复模式：朗读末尾不带标点的剩余文本
+    if (handle->tts_stream && !handle->audio_fallback &&
+        xn_tts_stream_finish(handle->tts_stream) == ESP_ERR_NOT_SUPPORTED &&
+        handle->config.tts_fallback_audio) {
+        reply_fallback_to_audio(handle);
+    }
+}
+
+static void on_audio_delta(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 增量音频数据（Opus编码，Base64）
+    // ⚠️ 屏蔽高频日志：每个音频包（60ms）打印会导致UART溢出
+    
+    // 通常已由快速路径处理，这里只处理含转义字符等少见格式
+    cJSON *data_item = cJSON_GetObjectItem(root, "data");
+    if (event_chat_cancelled(handle, data_item)) {
+        barge_in_count_dropped(handle);
+        return;
+    }
+    
+    handle->turn.bytes_audio += info->json_len;
+    cJSON *content = data_item ? cJSON_GetObjectItem(data_item, "content") : NULL;
+    if (!content || !cJSON_IsString(content)) {
+        ESP_LOGW(TAG, "⚠️ 音频事件缺少content字段");
+    } else if (handle->sentence_skip) {
+        handle->fallback_dropped++;
+    } else if (handle->audio_downlink) {
         // 使用音频下行模块处理（Base64解码 → Opus解码 → PCM回调）
-        if (handle->audio_downlink) {
-            audio_downlink_process(handle->audio_downlink, audio_base64);
-        }
+        audio_downlink_process(handle->audio_downlink, content->valuestring);
     }
-    else if (event_type == "input_audio_buffer.speech_started") {
-        // 用户开始说话（server_vad模式）
-        ESP_LOGI(TAG, "🗣️  用户开始说话");
-        if (handle->event_callback) {
-            handle->event_callback(COZE_CHAT_EVENT_CHAT_SPEECH_STARTED, NULL, NULL);
-        }
+}
+
+static void on_audio_sentence_start(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 增量语音字幕
+    if (!info->text) {
+        return;
     }
-    else if (event_type == "input_audio_buffer.speech_stopped") {
-        // 用户结束说话（server_vad模式）
-        ESP_LOGI(TAG, "🔇 用户结束说话");
-        if (handle->event_callback) {
-            handle->event_callback(COZE_CHAT_EVENT_CHAT_SPEECH_STOPED, NULL, NULL);
-        }
+    // 累计句子位置：回退到服务器语音后，本地已朗读完的句子丢弃其语音
+    handle->sentence_units += (uint32_t)xn_tts_count_units(info->text, strlen(info->text));
+    handle->sentence_skip = handle->audio_fallback && handle->sentence_units <= handle->fallback_units;
+    if (handle->config.enable_subtitle && handle->event_callback) {
+        ESP_LOGI(TAG, "📝 字幕: %s", info->text);
+        handle->event_callback(COZE_CHAT_EVENT_CHAT_SUBTITLE_EVENT, (char *)info->text, NULL);
     }
-    else if (event_type == "input_audio_buffer.completed") {
-        // input_audio_buffer 提交成功
-        ESP_LOGI(TAG, "✅ 音频提交成功");
-        if (handle->event_callback) {
-            handle->event_callback(COZE_CHAT_EVENT_INPUT_AUDIO_BUFFER_COMPLETED, NULL, NULL);
-        }
+}
+
+static void on_audio_completed(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 语音回复完成
+    ESP_LOGI(TAG, "✅ 语音回复完成");
+    // 被打断回复的结束标记不能作用到下一轮
+    if (handle->audio_downlink && !event_chat_cancelled(handle, cJSON_GetObjectItem(root, "data"))) {
+        // 剩余缓冲直接播完，不再等待预缓冲
+        audio_downlink_mark_end(handle->audio_downlink);
     }
-    else if (event_type == "conversation.message.delta") {
-        // 增量消息（文本）- Coze流式返回的文本片段
-        cJSON *data_item = cJSON_GetObjectItem(root, "data");
-        if (data_item) {
-            cJSON *delta = cJSON_GetObjectItem(data_item, "delta");
-            if (delta && cJSON_IsString(delta)) {
-                // 打印文本内容（不换行，模拟流式输出效果）
-                printf("%s", delta->valuestring);
-                fflush(stdout);
-            }
-        }
+}
+
+static void on_transcript_update(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 用户语音识别字幕（中间值）- 实时显示识别结果
+    if (info->text) {
+        ESP_LOGI(TAG, "🎤 识别中: %s", info->text);
     }
-    else if (event_type == "conversation.message.completed") {
-        // 消息完成 - 换行结束流式输出
-        printf("\n");
-        ESP_LOGI(TAG, "✅ 消息完成");
+}
+
+static void on_transcript_completed(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 用户语音识别完成
+    ESP_LOGI(TAG, "✅ 用户语音识别完成");
+    if (info->text) {
+        ESP_LOGI(TAG, "📝 识别内容: %s", info->text);
     }
-    else if (event_type == "conversation.audio.completed") {
-        // 语音回复完成
-        ESP_LOGI(TAG, "✅ 语音回复完成");
+    
+    cJSON *detail_item = cJSON_GetObjectItem(root, "detail");
+    cJSON *logid = detail_item ? cJSON_GetObjectItem(detail_item, "logid") : NULL;
+    if (logid && cJSON_IsString(logid)) {
+        ESP_LOGI(TAG, "🔑 logid: %s", logid->valuestring);
     }
-    else if (event_type == "conversation.chat.completed") {
-        // 对话完成
-        ESP_LOGI(TAG, "✅ 对话完成");
-        if (handle->event_callback) {
-            handle->event_callback(COZE_CHAT_EVENT_CHAT_COMPLETED, NULL, NULL);
-        }
+}
+
+static void on_conversation_cleared(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 上下文清除完成
+    ESP_LOGI(TAG, "✅ 上下文已清除");
+}
+
+static void on_speech_started(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 用户开始说话（server_vad模式）
+    ESP_LOGI(TAG, "🗣️  用户开始说话");
+    if (handle->config.barge_in_enable) {
+        // 机器人正在说话时立即打断（无进行中的回复时返回 INVALID_STATE，忽略）
+        coze_chat_interrupt(handle, 0);
     }
-    else if (event_type == "conversation.chat.failed") {
-        // 对话失败
-        ESP_LOGE(TAG, "❌ 对话失败");
-        if (handle->event_callback) {
-            handle->event_callback(COZE_CHAT_EVENT_CHAT_ERROR, NULL, NULL);
-        }
+    if (handle->event_callback) {
+        handle->event_callback(COZE_CHAT_EVENT_CHAT_SPEECH_STARTED, NULL, NULL);
     }
-    else if (event_type == "conversation.audio.sentence_start") {
-        // 增量语音字幕
-        cJSON *data_item = cJSON_GetObjectItem(root, "data");
-        if (data_item && handle->config.enable_subtitle) {
-            cJSON *text = cJSON_GetObjectItem(data_item, "text");
-            if (text && cJSON_IsString(text) && handle->event_callback) {
-                ESP_LOGI(TAG, "📝 字幕: %s", text->valuestring);
-                handle->event_callback(COZE_CHAT_EVENT_CHAT_SUBTITLE_EVENT, text->valuestring, NULL);
-            }
-        }
+}
+
+static void on_speech_stopped(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 用户结束说话（server_vad模式）
+    ESP_LOGI(TAG, "🔇 用户结束说话");
+    if (handle->event_callback) {
+        handle->event_callback(COZE_CHAT_EVENT_CHAT_SPEECH_STOPED, NULL, NULL);
     }
-    else if (event_type == "conversation.audio_transcript.update") {
-        // 用户语音识别字幕（中间值）- 实时显示识别结果
-        cJSON *data_item = cJSON_GetObjectItem(root, "data");
-        if (data_item) {
-            cJSON *transcript = cJSON_GetObjectItem(data_item, "transcript");
-            if (transcript && cJSON_IsString(transcript)) {
-                ESP_LOGI(TAG, "🎤 识别中: %s", transcript->valuestring);
-            }
-        }
+}
+
+static void on_input_audio_completed(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // input_audio_buffer 提交成功
+    ESP_LOGI(TAG, "✅ 音频提交成功");
+    if (handle->event_callback) {
+        handle->event_callback(COZE_CHAT_EVENT_INPUT_AUDIO_BUFFER_COMPLETED, NULL, NULL);
     }
-    else if (event_type == "conversation.audio_transcript.completed") {
-        // 用户语音识别完成
-        ESP_LOGI(TAG, "✅ 用户语音识别完成");
-        
-        // 打印识别结果的详细信息
-        cJSON *data_item = cJSON_GetObjectItem(root, "data");
-        cJSON *detail_item = cJSON_GetObjectItem(root, "detail");
-        
-        if (data_item) {
-            cJSON *content = cJSON_GetObjectItem(data_item, "content");
-            if (content && cJSON_IsString(content)) {
-                ESP_LOGI(TAG, "📝 识别内容: %s", content->valuestring);
-            }
+}
+
+static void on_input_audio_cleared(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // input_audio_buffer 清除成功
+    ESP_LOGI(TAG, "✅ 音频缓冲区已清除");
+}
+
+static void on_error(coze_chat_handle_t handle, cJSON *root, const coze_server_event_info_t *info)
+{
+    // 错误事件 - 打印详细错误信息
+    ESP_LOGE(TAG, "❌ 收到错误事件 (code=%d): %s", info->error_code, info->text ? info->text : "");
+    
+    cJSON *error = cJSON_GetObjectItem(root, "error");
+    if (error) {
+        // 打印完整的error对象
+        char *error_str = cJSON_Print(error);
+        if (error_str) {
+            ESP_LOGE(TAG, "错误详情: %s", error_str);
+            free(error_str);
         }
         
-        if (detail_item) {
-            cJSON *logid = cJSON_GetObjectItem(detail_item, "logid");
-            if (logid && cJSON_IsString(logid)) {
-                ESP_LOGI(TAG, "🔑 logid: %s", logid->valuestring);
-            }
+        cJSON *type = cJSON_GetObjectItem(error, "type");
+        if (type && cJSON_IsString(type)) {
+            ESP_LOGE(TAG, "错误类型: %s", type->valuestring);
         }
+    } else if (!info->text) {
+        // 打印整个消息
+        ESP_LOGE(TAG, "完整错误消息: %.*s", (int)info->json_len, info->json);
     }
-    else if (event_type == "conversation.chat.canceled") {
-        // 智能体输出中断
-        ESP_LOGI(TAG, "⚠️  对话已中断");
-    }
-    else if (event_type == "input_audio_buffer.cleared") {
-        // input_audio_buffer 清除成功
-        ESP_LOGI(TAG, "✅ 音频缓冲区已清除");
+    
+    if (handle->event_callback) {
+        handle->event_callback(COZE_CHAT_EVENT_CHAT_ERROR, NULL, NULL);
     }
-    else if (event_type == "conversation.cleared") {
-        // 上下文清除完成
-        ESP_LOGI(TAG, "✅ 上下文已清除");
+}
+
+/**
+ * @brief 组件内部的事件处理表（按 coze_server_event_t 顺序，编译期检查）
+ */
+static constexpr struct {
+    coze_server_event_t event;
+    event_handler_fn fn;
+} EVENT_HANDLERS[] = {
+    { COZE_SERVER_EVENT_CHAT_CREATED,                on_chat_created },
+    { COZE_SERVER_EVENT_CHAT_UPDATED,                on_chat_updated },
+    { COZE_SERVER_EVENT_CONVERSATION_CHAT_CREATED,   on_conversation_chat_created },
+    { COZE_SERVER_EVENT_CONVERSATION_CHAT_COMPLETED, on_conversation_chat_completed },
+    { COZE_SERVER_EVENT_CONVERSATION_CHAT_FAILED,    on_conversation_chat_failed },
+    { COZE_SERVER_EVENT_CONVERSATION_CHAT_CANCELED,  on_conversation_chat_canceled },
+    { COZE_SERVER_EVENT_MESSAGE_DELTA,               on_message_delta },
+    { COZE_SERVER_EVENT_MESSAGE_COMPLETED,           on_message_completed },
+    { COZE_SERVER_EVENT_AUDIO_DELTA,                 on_audio_delta },
+    { COZE_SERVER_EVENT_AUDIO_SENTENCE_START,        on_audio_sentence_start },
+    { COZE_SERVER_EVENT_AUDIO_COMPLETED,             on_audio_completed },
+    { COZE_SERVER_EVENT_TRANSCRIPT_UPDATE,           on_transcript_update },
+    { COZE_SERVER_EVENT_TRANSCRIPT_COMPLETED,        on_transcript_completed },
+    { COZE_SERVER_EVENT_CONVERSATION_CLEARED,        on_conversation_cleared },
+    { COZE_SERVER_EVENT_SPEECH_STARTED,              on_speech_started },
+    { COZE_SERVER_EVENT_SPEECH_STOPPED,              on_speech_stopped },
+    { COZE_SERVER_EVENT_INPUT_AUDIO_COMPLETED,       on_input_audio_completed },
+    { COZE_SERVER_EVENT_INPUT_AUDIO_CLEARED,         on_input_audio_cleared },
+    { COZE_SERVER_EVENT_ERROR,                       on_error },
+};
+
+static constexpr bool event_handlers_ordered()
+{
+    for (size_t i = 0; i < sizeof(EVENT_HANDLERS) / sizeof(EVENT_HANDLERS[0]); i++) {
+        if (EVENT_HANDLERS[i].event != (coze_server_event_t)i || !EVENT_HANDLERS[i].fn) {
+            return false;
+        }
     }
-    else if (event_type == "error") {
-        // 错误事件 - 打印详细错误信息
-        ESP_LOGE(TAG, "❌ 收到错误事件");
-        
+    return true;
+}
+
+static_assert(sizeof(EVENT_HANDLERS) / sizeof(EVENT_HANDLERS[0]) == COZE_SERVER_EVENT_MAX,
+              "EVENT_HANDLERS 必须覆盖全部 coze_server_event_t");
+static_assert(event_handlers_ordered(), "EVENT_HANDLERS 必须按 coze_server_event_t 顺序排列");
+
+/**
+ * @brief 取 cJSON 对象的字符串字段，不存在或不是字符串时返回 NULL
+ */
+static const char *json_get_string(cJSON *obj, const char *key)
+{
+    cJSON *item = obj ? cJSON_GetObjectItem(obj, key) : NULL;
+    return (item && cJSON_IsString(item)) ? item->valuestring : NULL;
+}
+
+/**
+ * @brief 从消息中提取事件公共字段（回复ID、对话ID、文本、错误码）
+ */
+static void build_event_info(cJSON *root, coze_server_event_info_t *info)
+{
+    cJSON *data = cJSON_GetObjectItem(root, "data");
+    
+    switch (info->event) {
+    case COZE_SERVER_EVENT_CONVERSATION_CHAT_CREATED:
+    case COZE_SERVER_EVENT_CONVERSATION_CHAT_COMPLETED:
+    case COZE_SERVER_EVENT_CONVERSATION_CHAT_FAILED:
+    case COZE_SERVER_EVENT_CONVERSATION_CHAT_CANCELED:
+        // conversation.chat.* 的 data 就是 chat 对象本身
+        info->chat_id = json_get_string(data, "id");
+        break;
+    default:
+        info->chat_id = json_get_string(data, "chat_id");
+        break;
+    }
+    info->conversation_id = json_get_string(data, "conversation_id");
+    
+    switch (info->event) {
+    case COZE_SERVER_EVENT_MESSAGE_DELTA:
+        // 文本在 content 字段（兼容旧格式的 delta 字段）
+        info->text = json_get_string(data, "content");
+        if (!info->text) {
+            info->text = json_get_string(data, "delta");
+        }
+        break;
+    case COZE_SERVER_EVENT_MESSAGE_COMPLETED:
+    case COZE_SERVER_EVENT_TRANSCRIPT_COMPLETED:
+        info->text = json_get_string(data, "content");
+        break;
+    case COZE_SERVER_EVENT_TRANSCRIPT_UPDATE:
+        info->text = json_get_string(data, "transcript");
+        break;
+    case COZE_SERVER_EVENT_AUDIO_SENTENCE_START:
+        info->text = json_get_string(data, "text");
+        break;
+    case COZE_SERVER_EVENT_ERROR: {
+        // 标准格式为 data.code/data.msg，兼容 error.code/error.message
         cJSON *error = cJSON_GetObjectItem(root, "error");
-        if (error) {
-            // 打印完整的error对象
-            char *error_str = cJSON_Print(error);
-            if (error_str) {
-                ESP_LOGE(TAG, "错误详情: %s", error_str);
-                free(error_str);
-            }
-            
-            // 提取常见字段
-            cJSON *code = cJSON_GetObjectItem(error, "code");
-            cJSON *message = cJSON_GetObjectItem(error, "message");
-            cJSON *type = cJSON_GetObjectItem(error, "type");
-            
-            if (code && cJSON_IsString(code)) {
-                ESP_LOGE(TAG, "错误代码: %s", code->valuestring);
-            }
-            if (message && cJSON_IsString(message)) {
-                ESP_LOGE(TAG, "错误消息: %s", message->valuestring);
-            }
-            if (type && cJSON_IsString(type)) {
-                ESP_LOGE(TAG, "错误类型: %s", type->valuestring);
+        cJSON *code = data ? cJSON_GetObjectItem(data, "code") : NULL;
+        if (!code && error) {
+            code = cJSON_GetObjectItem(error, "code");
+        }
+        if (code && cJSON_IsNumber(code)) {
+            info->error_code = code->valueint;
+        } else if (code && cJSON_IsString(code)) {
+            info->error_code = atoi(code->valuestring);
+        }
+        info->text = json_get_string(data, "msg");
+        if (!info->text) {
+            info->text = json_get_string(error, "message");
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief 调用应用注册的事件处理函数（未注册时直接返回）
+ */
+static void notify_event_handler(coze_chat_handle_t handle, const coze_server_event_info_t *info)
+{
+    taskENTER_CRITICAL(&handle->chat_lock);
+    coze_server_event_handler_t handler = handle->event_handlers[info->event].handler;
+    void *ctx = handle->event_handlers[info->event].ctx;
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    
+    if (handler) {
+        handler(info, ctx);
+    }
+}
+
+/**
+ * @brief 处理Coze服务器消息
+ * 
+ * 在接收缓冲区中定位 event_type，查事件表（有序常量表，二分查找）得到事件：
+ * 音频增量先走快速路径；未知事件不构建cJSON直接丢弃；
+ * 其余事件构建cJSON，经 EVENT_HANDLERS 分发给组件内部处理，再交给应用注册的处理函数。
+ * 
+ * @param handle Coze Chat句柄
+ * @param json 接收到的JSON消息（无需 '\0' 结尾）
+ * @param len 消息长度
+ */
+static void handle_coze_message(coze_chat_handle_t handle, const char *json, size_t len)
+{
+    // ⚠️ 屏蔽高频日志：每个JSON包都打印会导致UART溢出
+    // ESP_LOGI(TAG, "📨 收到消息: %.*s", len > 200 ? 200 : (int)len, json);
+    
+    handle->turn.messages++;
+    handle->turn.bytes_total += len;
+    handle->last_activity_us = esp_timer_get_time();
+    
+    coze_server_event_info_t info = {};
+    info.json = json;
+    info.json_len = len;
+    
+    // 获取事件类型（Coze使用 "event_type" 字段），直接在缓冲区中查找，不复制
+    const char *type = NULL;
+    size_t type_len = 0;
+    const coze_event_entry_t *entry = NULL;
+    bool scanned = json_scan_string(json, len, "event_type", &type, &type_len);
+    if (scanned) {
+        entry = coze_event_lookup(std::string_view(type, type_len));
+        if (!entry) {
+            ESP_LOGI(TAG, "未处理的事件类型: %.*s", (int)type_len, type);
+            return;
+        }
+        bool accepted = false;
+        if (entry->event == COZE_SERVER_EVENT_AUDIO_DELTA && handle_audio_delta_fast(handle, json, len, &accepted)) {
+            handle->fast_path_count++;
+            if (accepted) {
+                // 与通用路径一样提供回复ID与对话ID（复制到栈上以 '\0' 结尾，不分配内存）
+                char chat_id[64];
+                char conversation_id[64];
+                info.event = COZE_SERVER_EVENT_AUDIO_DELTA;
+                info.chat_id = json_scan_copy(json, len, "chat_id", chat_id, sizeof(chat_id));
+                info.conversation_id = json_scan_copy(json, len, "conversation_id", conversation_id, sizeof(conversation_id));
+                notify_event_handler(handle, &info);
             }
-        } else {
-            // 打印整个消息
-            ESP_LOGE(TAG, "完整错误消息: %s", message.c_str());
+            return;
         }
-        
-        if (handle->event_callback) {
-            handle->event_callback(COZE_CHAT_EVENT_CHAT_ERROR, NULL, NULL);
+    }
+    handle->dom_path_count++;
+    
+    // 解析JSON
+    cJSON *root = cJSON_ParseWithLength(json, len);
+    if (!root) {
+        // 理论上不应该再出现JSON解析失败（已修复消息分片问题）
+        ESP_LOGE(TAG, "❌ JSON解析失败 (长度: %d)", (int)len);
+        ESP_LOGD(TAG, "数据前缀: %.*s...", len > 100 ? 100 : (int)len, json);
+        return;
+    }
+    
+    // 快速扫描失败（event_type 不是第一个同名字符串字段等少见格式）时从cJSON取
+    if (!scanned) {
+        cJSON *event_type_item = cJSON_GetObjectItem(root, "event_type");
+        if (!event_type_item || !cJSON_IsString(event_type_item)) {
+            cJSON_Delete(root);
+            return;
+        }
+        entry = coze_event_lookup(event_type_item->valuestring);
+        if (!entry) {
+            ESP_LOGI(TAG, "未处理的事件类型: %s", event_type_item->valuestring);
+            cJSON_Delete(root);
+            return;
         }
     }
-    else {
-        ESP_LOGI(TAG, "未处理的事件类型: %s", event_type.c_str());
+    
+    // 只对非高频事件打印事件类型（避免刷屏）
+    if (!entry->quiet) {
+        ESP_LOGI(TAG, "📩 事件类型: %.*s", (int)entry->name.size(), entry->name.data());
     }
     
+    info.event = entry->event;
+    build_event_info(root, &info);
+    EVENT_HANDLERS[info.event].fn(handle, root, &info);
+    notify_event_handler(handle, &info);
+    
     cJSON_Delete(root);
 }
 
 /**
  * @brief WebSocket 发送回调（给 audio_uplink 使用）
  * 
- * @param json_str JSON 字符串
+ * @param msg JSON 消息
+ * @param len 消息长度
  * @param user_ctx 用户上下文（coze_chat_handle_t）
  * @return true 发送成功
  */
-static bool websocket_send_callback(const char *json_str, void *user_ctx)
+static bool websocket_send_callback(const char *msg, size_t len, void *user_ctx)
 {
     coze_chat_handle_t handle = (coze_chat_handle_t)user_ctx;
     
@@ -330,15 +1017,15 @@ static bool websocket_send_callback(const char *json_str, void *user_ctx)
         return false;
     }
     
-    return handle->websocket->Send(json_str);
+    // 入队即返回；队列满时阻塞到音频截止时间，拥塞仍反映到上行的发送耗时
+    return handle->websocket->SendAudio(msg, len, (uint32_t)handle->config.ws_audio_max_age_ms);
 }
 
 
 /**
- * @brief JSON解析任务（环形缓冲区架构）
+ * @brief JSON解析任务（消息队列架构）
  * 
- * 从环形缓冲区读取JSON消息并解析。
- * 消息格式：[长度2字节][JSON数据][长度2字节][JSON数据]...
+ * 从消息队列取出完整的JSON消息，直接在队列记录中解析，处理完释放记录。
  * 
  * @param param 任务参数（coze_chat_handle_t）
  */
@@ -346,70 +1033,46 @@ static void json_parser_task(void *param)
 {
     coze_chat_handle_t handle = (coze_chat_handle_t)param;
     
-    ESP_LOGI(TAG, "🚀🚀🚀 JSON解析任务启动（环形缓冲区架构）🚀🚀🚀");
+    ESP_LOGI(TAG, "🚀🚀🚀 JSON解析任务启动（消息队列架构）🚀🚀🚀");
     
     uint32_t packet_count = 0;
     
-    // 预分配临时缓冲区（最大支持32KB的JSON消息）
-    const size_t MAX_JSON_SIZE = 32 * 1024;
-    uint8_t *json_buffer = (uint8_t *)heap_caps_malloc(MAX_JSON_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!json_buffer) {
-        ESP_LOGE(TAG, "❌ JSON临时缓冲区分配失败");
-        vTaskDelete(NULL);
-        return;
-    }
-    
     while (handle->parser_running) {
-        // ✅ 步骤1：读取消息长度（2字节，阻塞等待）
-        uint16_t msg_len = 0;
-        size_t got = simple_ring_buffer_read(
-            handle->ws_ring_buffer,
-            (uint8_t *)&msg_len,
-            sizeof(uint16_t),
-            portMAX_DELAY  // 阻塞等待
-        );
-        
-        if (got != sizeof(uint16_t)) {
-            // ESP_LOGW(TAG, "⚠️ 读取消息长度失败");
-            continue;
+        // 空闲断开在本任务执行：Disconnect 最长阻塞约 1 s，不能占用 esp_timer 任务
+        if (handle->idle_close_request) {
+            handle->idle_close_request = false;
+            conn_idle_close(handle);
         }
         
-        // 检查长度合法性
-        if (msg_len == 0 || msg_len > MAX_JSON_SIZE) {
-            ESP_LOGE(TAG, "❌ 非法的消息长度: %d", msg_len);
+        // ✅ 步骤1：取出一条完整消息（超时用于检查退出标志与空闲断开请求）
+        ws_msg_t msg;
+        if (ws_msg_queue_receive(handle->ws_msg_queue, &msg, 100) != ESP_OK) {
             continue;
         }
         
-        // ✅ 步骤2：读取JSON数据（阻塞等待）
-        got = simple_ring_buffer_read(
-            handle->ws_ring_buffer,
-            json_buffer,
-            msg_len,
-            portMAX_DELAY  // 阻塞等待
-        );
-        
-        if (got != msg_len) {
-            ESP_LOGW(TAG, "⚠️ JSON数据读取不完整: %d/%d", got, msg_len);
-            continue;
+        // ✅ 步骤2：在队列记录中原地解析（无复制）
+        if (msg.len > 0) {
+            packet_count++;
+            int64_t t0 = esp_timer_get_time();
+            handle_coze_message(handle, msg.data, msg.len);
+            if (handle->turn_start_us != 0) {
+                handle->turn.process_us += (uint32_t)(esp_timer_get_time() - t0);
+            }
         }
         
-        packet_count++;
-        
-        // ✅ 步骤3：解析JSON
-        std::string message((char *)json_buffer, msg_len);
-        handle_coze_message(handle, message);
+        // ✅ 步骤3：释放记录
+        ws_msg_queue_release(handle->ws_msg_queue, &msg);
         
         // 每100包打印统计（避免刷屏）
-        if (packet_count % 100 == 0) {
-            size_t available = simple_ring_buffer_available(handle->ws_ring_buffer);
-            ESP_LOGI(TAG, "📊 已处理 %lu 包，缓冲区剩余: %d 字节", 
-                     packet_count, available);
+        if (packet_count % 100 == 0 && msg.len > 0) {
+            ws_msg_queue_stats_t qs;
+            ws_msg_queue_get_stats(handle->ws_msg_queue, &qs);
+            ESP_LOGI(TAG, "📊 已处理 %lu 包（快速路径: %lu, cJSON: %lu），待解析: %d 条/%d 字节（峰值 %d），等待: %lu 次，丢弃: %lu 条", 
+                     packet_count, handle->fast_path_count, handle->dom_path_count,
+                     (int)qs.pending, (int)qs.used_bytes, (int)qs.peak_bytes, qs.blocked, qs.dropped);
         }
     }
     
-    // 清理
-    heap_caps_free(json_buffer);
-    
     ESP_LOGI(TAG, "JSON解析任务退出");
     vTaskDelete(NULL);
 }
@@ -424,11 +1087,13 @@ static void json_parser_task(void *param)
  * - ASR配置（热词、语言、敏感词过滤等）
  * - 语音处理配置（ANS、PDNS）
  * - 声纹识别配置
+ * - 事件订阅（仅文本回复模式）
  * 
  * @param config 用户配置
+ * @param conversation_id 对话ID（重连时为服务器之前分配的ID），NULL 表示新对话
  * @return 构建好的JSON字符串
  */
-static std::string build_chat_update_event(const coze_chat_config_t *config)
+static std::string build_chat_update_event(const coze_chat_config_t *config, const char *conversation_id)
 {
     cJSON *root = cJSON_CreateObject();
     cJSON_AddStringToObject(root, "id", "event_init_001");
@@ -439,8 +1104,8 @@ static std::string build_chat_update_event(const coze_chat_config_t *config)
     // ========== 对话配置 ==========
     cJSON *chat_config = cJSON_CreateObject();
     cJSON_AddStringToObject(chat_config, "user_id", config->user_id);
-    if (config->conversation_id) {
-        cJSON_AddStringToObject(chat_config, "conversation_id", config->conversation_id);
+    if (conversation_id) {
+        cJSON_AddStringToObject(chat_config, "conversation_id", conversation_id);
     }
     cJSON_AddBoolToObject(chat_config, "auto_save_history", config->auto_save_history);
     
@@ -514,7 +1179,9 @@ static std::string build_chat_update_event(const coze_chat_config_t *config)
     } else {
         cJSON_AddStringToObject(output_audio, "codec", "pcm");
         cJSON *pcm_config = cJSON_CreateObject();
-        cJSON_AddNumberToObject(pcm_config, "sample_rate", config->output_sample_rate);
+        cJSON_AddNumberToObject(pcm_config, "sample_rate",
+                                config->pcm_server_sample_rate > 0 ? config->pcm_server_sample_rate
+                                                                   : config->output_sample_rate);
         cJSON_AddNumberToObject(pcm_config, "frame_size_ms", config->pcm_frame_size_ms);
         cJSON_AddItemToObject(output_audio, "pcm_config", pcm_config);
     }
@@ -637,83 +1304,328 @@ static std::string build_chat_update_event(const coze_chat_config_t *config)
     cJSON_AddBoolToObject(asr_config, "enable_itn", config->asr_enable_itn);
     cJSON_AddBoolToObject(asr_config, "enable_punc", config->asr_enable_punc);
     
-    // ASR模式
-    if (config->asr_stream_mode) {
-        cJSON_AddStringToObject(asr_config, "stream_mode", config->asr_stream_mode);
+    // ASR模式
+    if (config->asr_stream_mode) {
+        cJSON_AddStringToObject(asr_config, "stream_mode", config->asr_stream_mode);
+    }
+    
+    // 二次识别
+    if (config->asr_enable_nostream) {
+        cJSON_AddBoolToObject(asr_config, "enable_nostream", true);
+    }
+    
+    // 情绪识别
+    if (config->asr_enable_emotion) {
+        cJSON_AddBoolToObject(asr_config, "enable_emotion", true);
+    }
+    
+    // 性别识别
+    if (config->asr_enable_gender) {
+        cJSON_AddBoolToObject(asr_config, "enable_gender", true);
+    }
+    
+    // 敏感词过滤
+    if (config->asr_system_reserved_filter || 
+        (config->asr_filter_with_empty && config->asr_filter_with_empty_count > 0) ||
+        (config->asr_filter_with_signed && config->asr_filter_with_signed_count > 0)) {
+        cJSON *sensitive_filter = cJSON_CreateObject();
+        
+        if (config->asr_system_reserved_filter) {
+            cJSON_AddBoolToObject(sensitive_filter, "system_reserved_filter", true);
+        }
+        
+        if (config->asr_filter_with_empty && config->asr_filter_with_empty_count > 0) {
+            cJSON *empty_arr = cJSON_CreateArray();
+            for (int i = 0; i < config->asr_filter_with_empty_count; i++) {
+                cJSON_AddItemToArray(empty_arr, cJSON_CreateString(config->asr_filter_with_empty[i]));
+            }
+            cJSON_AddItemToObject(sensitive_filter, "filter_with_empty", empty_arr);
+        }
+        
+        if (config->asr_filter_with_signed && config->asr_filter_with_signed_count > 0) {
+            cJSON *signed_arr = cJSON_CreateArray();
+            for (int i = 0; i < config->asr_filter_with_signed_count; i++) {
+                cJSON_AddItemToArray(signed_arr, cJSON_CreateString(config->asr_filter_with_signed[i]));
+            }
+            cJSON_AddItemToObject(sensitive_filter, "filter_with_signed", signed_arr);
+        }
+        
+        cJSON_AddItemToObject(asr_config, "sensitive_words_filter", sensitive_filter);
+    }
+    
+    cJSON_AddItemToObject(data, "asr_config", asr_config);
+    
+    // ========== 开场白配置 ==========
+    if (config->need_play_prologue) {
+        cJSON_AddBoolToObject(data, "need_play_prologue", true);
+        if (config->prologue_content) {
+            cJSON_AddStringToObject(data, "prologue_content", config->prologue_content);
+        }
+    }
+    
+    // ========== 声纹识别配置 ==========
+    if (config->voice_print_group_id) {
+        cJSON *voice_print = cJSON_CreateObject();
+        cJSON_AddStringToObject(voice_print, "group_id", config->voice_print_group_id);
+        cJSON_AddNumberToObject(voice_print, "score", config->voice_print_score);
+        cJSON_AddBoolToObject(voice_print, "reuse_voice_info", config->voice_print_reuse_info);
+        cJSON_AddItemToObject(data, "voice_print_config", voice_print);
+    }
+    
+    // ========== 事件订阅 ==========
+    // 文本回复模式不订阅语音增量，下行只有文本（需要时再单独订阅）
+    if (config->reply_mode == COZE_REPLY_MODE_TEXT_TTS) {
+        cJSON_AddItemToObject(data, "event_subscriptions", build_event_subscriptions(false));
+    }
+    
+    cJSON_AddItemToObject(root, "data", data);
+    
+    char *json_str = cJSON_PrintUnformatted(root);
+    std::string result(json_str);
+    
+    free(json_str);
+    cJSON_Delete(root);
+    
+    return result;
+}
+
+/**
+ * @brief 取本次连接要发送的 chat.update（缓存，conversation_id 变化时才重建）
+ */
+static const std::string &chat_update_payload(coze_chat_handle_t handle)
+{
+    char conversation_id[64];
+    taskENTER_CRITICAL(&handle->chat_lock);
+    memcpy(conversation_id, handle->conversation_id, sizeof(conversation_id));
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    
+    bool resumed = conversation_id[0] != '\0';
+    if (!resumed && handle->config.conversation_id) {
+        snprintf(conversation_id, sizeof(conversation_id), "%s", handle->config.conversation_id);
+    }
+    handle->conn_stats.resumed_conversation = resumed;
+    
+    if (handle->chat_update_cache.empty() || strcmp(conversation_id, handle->cache_conversation_id) != 0) {
+        handle->chat_update_cache = build_chat_update_event(&handle->config,
+                                                            conversation_id[0] ? conversation_id : NULL);
+        memcpy(handle->cache_conversation_id, conversation_id, sizeof(conversation_id));
+        ESP_LOGI(TAG, "📦 chat.update 已缓存: %d 字节", (int)handle->chat_update_cache.size());
+        ESP_LOGI(TAG, "配置内容: %s", handle->chat_update_cache.c_str());  // 暂时用INFO级别，方便调试
+    }
+    return handle->chat_update_cache;
+}
+
+/**
+ * @brief 计算下一次重连的等待时间（指数退避 + 等比抖动）
+ * 
+ * 上限 = min(reconnect_max_ms, reconnect_min_ms × 2^失败次数)，实际等待在上限的一半到上限之间随机，
+ * 避免多台设备在服务器恢复后同时重连。
+ */
+static uint32_t reconnect_delay_ms(coze_chat_handle_t handle)
+{
+    uint32_t min_ms = handle->config.reconnect_min_ms > 0 ? (uint32_t)handle->config.reconnect_min_ms : 500;
+    uint32_t max_ms = handle->config.reconnect_max_ms > (int)min_ms ? (uint32_t)handle->config.reconnect_max_ms : min_ms;
+    uint32_t shift = handle->reconnect_attempt < 16 ? handle->reconnect_attempt : 16;
+    uint64_t ceiling = (uint64_t)min_ms << shift;
+    if (ceiling > max_ms) {
+        ceiling = max_ms;
+    }
+    handle->reconnect_attempt++;
+    
+    uint32_t half = (uint32_t)(ceiling / 2);
+    return half + esp_random() % (half + 1);
+}
+
+/**
+ * @brief 重启一次性定时器
+ */
+static void timer_restart(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (!timer) return;
+    esp_timer_stop(timer);
+    esp_timer_start_once(timer, timeout_us);
+}
+
+/**
+ * @brief 安排退避重连
+ */
+static void conn_schedule_reconnect(coze_chat_handle_t handle)
+{
+    uint32_t delay_ms = reconnect_delay_ms(handle);
+    ESP_LOGW(TAG, "🔁 %lu ms 后重连 (连续失败 %lu 次)", delay_ms, handle->reconnect_attempt);
+    timer_restart(handle->reconnect_timer, (uint64_t)delay_ms * 1000);
+}
+
+/**
+ * @brief 开始建连（已连接或正在建连时直接返回）
+ * 
+ * 复用同一个 WebSocket 客户端，TLS 会话票据随之复用；启动失败时安排退避重连。
+ */
+static esp_err_t conn_begin(coze_chat_handle_t handle)
+{
+    taskENTER_CRITICAL(&handle->chat_lock);
+    bool busy = handle->connecting || handle->connected;
+    if (!busy) {
+        handle->connecting = true;
+    }
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    if (busy) {
+        return ESP_OK;
+    }
+    
+    esp_timer_stop(handle->reconnect_timer);
+    handle->session_ready = false;
+    handle->connect_start_us = esp_timer_get_time();
+    if (handle->websocket->Connect(handle->ws_url)) {
+        return ESP_OK;
+    }
+    
+    taskENTER_CRITICAL(&handle->chat_lock);
+    handle->connecting = false;
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    handle->conn_stats.failures++;
+    conn_schedule_reconnect(handle);
+    return ESP_FAIL;
+}
+
+/**
+ * @brief 重连定时器回调（esp_timer 任务）
+ */
+static void reconnect_timer_cb(void *arg)
+{
+    coze_chat_handle_t handle = (coze_chat_handle_t)arg;
+    
+    if (handle->link_wanted && !handle->idle_closed) {
+        conn_begin(handle);
+    }
+}
+
+/**
+ * @brief 空闲定时器回调（esp_timer 任务）：无对话、无上行、无播放超过 idle_close_ms 时请求断开
+ * 
+ * 只置位请求，断开由解析任务执行（conn_idle_close）。
+ */
+static void idle_timer_cb(void *arg)
+{
+    coze_chat_handle_t handle = (coze_chat_handle_t)arg;
+    
+    if (!handle->link_wanted || !handle->session_ready) {
+        return;
     }
     
-    // 二次识别
-    if (config->asr_enable_nostream) {
-        cJSON_AddBoolToObject(asr_config, "enable_nostream", true);
+    int64_t limit_us = (int64_t)handle->config.idle_close_ms * 1000;
+    int64_t idle_us = esp_timer_get_time() - handle->last_activity_us;
+    bool busy = handle->chat_active ||
+                audio_downlink_get_state(handle->audio_downlink) != AUDIO_DOWNLINK_IDLE ||
+                (handle->tts_stream && xn_tts_stream_is_busy(handle->tts_stream));
+    if (busy || idle_us < limit_us) {
+        timer_restart(handle->idle_timer, busy ? limit_us : limit_us - idle_us);
+        return;
     }
     
-    // 情绪识别
-    if (config->asr_enable_emotion) {
-        cJSON_AddBoolToObject(asr_config, "enable_emotion", true);
+    ESP_LOGI(TAG, "💤 空闲 %lu ms，请求断开连接（唤醒时预连接）", (uint32_t)(idle_us / 1000));
+    handle->idle_close_request = true;
+}
+
+/**
+ * @brief 执行空闲断开（解析任务）：请求发出后已唤醒或已停止则放弃
+ */
+static void conn_idle_close(coze_chat_handle_t handle)
+{
+    if (!handle->link_wanted || !handle->session_ready) {
+        return;
+    }
+    int64_t limit_us = (int64_t)handle->config.idle_close_ms * 1000;
+    int64_t idle_us = esp_timer_get_time() - handle->last_activity_us;
+    if (handle->chat_active || idle_us < limit_us) {
+        timer_restart(handle->idle_timer, limit_us);  // 请求发出后又有活动：重新计时
+        return;
     }
+    handle->idle_closed = true;
+    handle->websocket->Disconnect();
+}
+
+/**
+ * @brief WebSocket 已连接：发送缓存的 chat.update
+ */
+static void conn_on_connected(coze_chat_handle_t handle)
+{
+    taskENTER_CRITICAL(&handle->chat_lock);
+    handle->connected = true;
+    handle->connecting = false;
+    taskEXIT_CRITICAL(&handle->chat_lock);
     
-    // 性别识别
-    if (config->asr_enable_gender) {
-        cJSON_AddBoolToObject(asr_config, "enable_gender", true);
+    uint32_t connect_ms = handle->websocket->LastConnectMs();
+    handle->conn_stats.connects++;
+    handle->conn_stats.connect_ms_last = connect_ms;
+    if (handle->conn_stats.connects == 1) {
+        handle->conn_stats.connect_ms_first = connect_ms;
     }
     
-    // 敏感词过滤
-    if (config->asr_system_reserved_filter || 
-        (config->asr_filter_with_empty && config->asr_filter_with_empty_count > 0) ||
-        (config->asr_filter_with_signed && config->asr_filter_with_signed_count > 0)) {
-        cJSON *sensitive_filter = cJSON_CreateObject();
-        
-        if (config->asr_system_reserved_filter) {
-            cJSON_AddBoolToObject(sensitive_filter, "system_reserved_filter", true);
-        }
-        
-        if (config->asr_filter_with_empty && config->asr_filter_with_empty_count > 0) {
-            cJSON *empty_arr = cJSON_CreateArray();
-            for (int i = 0; i < config->asr_filter_with_empty_count; i++) {
-                cJSON_AddItemToArray(empty_arr, cJSON_CreateString(config->asr_filter_with_empty[i]));
-            }
-            cJSON_AddItemToObject(sensitive_filter, "filter_with_empty", empty_arr);
-        }
-        
-        if (config->asr_filter_with_signed && config->asr_filter_with_signed_count > 0) {
-            cJSON *signed_arr = cJSON_CreateArray();
-            for (int i = 0; i < config->asr_filter_with_signed_count; i++) {
-                cJSON_AddItemToArray(signed_arr, cJSON_CreateString(config->asr_filter_with_signed[i]));
-            }
-            cJSON_AddItemToObject(sensitive_filter, "filter_with_signed", signed_arr);
-        }
-        
-        cJSON_AddItemToObject(asr_config, "sensitive_words_filter", sensitive_filter);
+    if (handle->ws_event_callback) {
+        coze_ws_event_t evt = {.handle = handle, .event_id = COZE_WS_EVENT_CONNECTED};
+        handle->ws_event_callback(&evt);
     }
     
-    cJSON_AddItemToObject(data, "asr_config", asr_config);
+    ESP_LOGI(TAG, "📤 发送chat.update配置");
+    handle->websocket->Send(chat_update_payload(handle));
+}
+
+/**
+ * @brief WebSocket 断开或建连失败：需要时安排退避重连
+ */
+static void conn_on_disconnected(coze_chat_handle_t handle)
+{
+    taskENTER_CRITICAL(&handle->chat_lock);
+    bool was_up = handle->connected || handle->connecting;
+    handle->connected = false;
+    handle->connecting = false;
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    handle->session_ready = false;
     
-    // ========== 开场白配置 ==========
-    if (config->need_play_prologue) {
-        cJSON_AddBoolToObject(data, "need_play_prologue", true);
-        if (config->prologue_content) {
-            cJSON_AddStringToObject(data, "prologue_content", config->prologue_content);
-        }
+    if (handle->ws_event_callback) {
+        coze_ws_event_t evt = {.handle = handle, .event_id = COZE_WS_EVENT_DISCONNECTED};
+        handle->ws_event_callback(&evt);
     }
     
-    // ========== 声纹识别配置 ==========
-    if (config->voice_print_group_id) {
-        cJSON *voice_print = cJSON_CreateObject();
-        cJSON_AddStringToObject(voice_print, "group_id", config->voice_print_group_id);
-        cJSON_AddNumberToObject(voice_print, "score", config->voice_print_score);
-        cJSON_AddBoolToObject(voice_print, "reuse_voice_info", config->voice_print_reuse_info);
-        cJSON_AddItemToObject(data, "voice_print_config", voice_print);
+    // 同一次断开可能同时收到 CLOSED 与 DISCONNECTED，只处理一次
+    if (!was_up || !handle->link_wanted || handle->idle_closed) {
+        return;
     }
+    handle->conn_stats.failures++;
+    conn_schedule_reconnect(handle);
+}
+
+/**
+ * @brief 会话就绪（本次连接首个 chat.updated）：退避清零，打印建连与唤醒到就绪耗时
+ */
+static void conn_on_session_ready(coze_chat_handle_t handle)
+{
+    // 事件订阅等局部 chat.update 也会回 chat.updated，只处理连接后的第一个
+    if (handle->session_ready) {
+        return;
+    }
+    handle->session_ready = true;
+    handle->reconnect_attempt = 0;
     
-    cJSON_AddItemToObject(root, "data", data);
-    
-    char *json_str = cJSON_PrintUnformatted(root);
-    std::string result(json_str);
+    int64_t now = esp_timer_get_time();
+    uint32_t ready_ms = (uint32_t)((now - handle->connect_start_us) / 1000);
+    uint32_t connect_ms = handle->conn_stats.connect_ms_last;
+    handle->conn_stats.ready_ms_last = ready_ms;
+    ESP_LOGI(TAG, "✅ 会话就绪: %lu ms (建连 %lu ms + 配置 %lu ms, 第 %lu 次连接%s)",
+             ready_ms, connect_ms, ready_ms > connect_ms ? ready_ms - connect_ms : 0,
+             handle->conn_stats.connects, handle->conn_stats.resumed_conversation ? ", 沿用对话" : "");
     
-    free(json_str);
-    cJSON_Delete(root);
+    if (handle->prewarm_us > 0) {
+        handle->conn_stats.wake_to_ready_ms_last = (uint32_t)((now - handle->prewarm_us) / 1000);
+        handle->prewarm_us = 0;
+        ESP_LOGI(TAG, "⏱️ 唤醒到会话就绪: %lu ms", handle->conn_stats.wake_to_ready_ms_last);
+    }
     
-    return result;
+    handle->last_activity_us = now;
+    if (handle->config.idle_close_ms > 0) {
+        timer_restart(handle->idle_timer, (uint64_t)handle->config.idle_close_ms * 1000);
+    }
 }
 
 // ============ 公共API实现 ============
@@ -747,15 +1659,20 @@ extern "C" esp_err_t coze_chat_init(const coze_chat_config_t *config, coze_chat_
     ESP_LOGI(TAG, "  上行: %s, %dHz, %dbit, %d声道", 
              config->uplink_audio_type == COZE_CHAT_AUDIO_TYPE_OPUS ? "Opus" : "PCM",
              config->input_sample_rate, config->input_bit_depth, config->input_channel);
-    ESP_LOGI(TAG, "  下行: %s, %dHz, 比特率=%d", 
-             config->downlink_audio_type == COZE_CHAT_AUDIO_TYPE_OPUS ? "Opus" : "PCM",
-             config->output_sample_rate, config->opus_bitrate);
+    if (config->downlink_audio_type == COZE_CHAT_AUDIO_TYPE_OPUS) {
+        ESP_LOGI(TAG, "  下行: Opus, %dHz, 比特率=%d", config->output_sample_rate, config->opus_bitrate);
+    } else {
+        ESP_LOGI(TAG, "  下行: PCM, 服务器 %dHz → 输出 %dHz",
+                 config->pcm_server_sample_rate > 0 ? config->pcm_server_sample_rate : config->output_sample_rate,
+                 config->output_sample_rate);
+    }
     if (config->speech_rate != 0) {
         ESP_LOGI(TAG, "语速: %+d", config->speech_rate);
     }
     if (config->asr_hot_word_count > 0) {
         ESP_LOGI(TAG, "ASR热词数量: %d", config->asr_hot_word_count);
     }
+    ESP_LOGI(TAG, "回复模式: %s", config->reply_mode == COZE_REPLY_MODE_TEXT_TTS ? "文本+本地TTS" : "服务器语音");
     
     // 分配句柄
     coze_chat_handle_t h = new coze_chat_t();
@@ -766,6 +1683,7 @@ extern "C" esp_err_t coze_chat_init(const coze_chat_config_t *config, coze_chat_
     
     // 复制配置
     memcpy(&h->config, config, sizeof(coze_chat_config_t));
+    portMUX_INITIALIZE(&h->chat_lock);
     h->audio_callback = config->audio_callback;
     h->event_callback = config->event_callback;
     h->ws_event_callback = config->ws_event_callback;
@@ -775,10 +1693,18 @@ extern "C" esp_err_t coze_chat_init(const coze_chat_config_t *config, coze_chat_
     h->session_created = false;
     h->session_id[0] = '\0';
     h->conversation_id[0] = '\0';
-    h->parser_task = NULL;
+    h->parser_task.handle = NULL;
     h->parser_running = false;
     h->audio_uplink = NULL;
-    h->ws_ring_buffer = NULL;
+    h->ws_msg_queue = NULL;
+    h->tts_stream = NULL;
+    h->link_wanted = false;
+    h->idle_closed = false;
+    h->idle_close_request = false;
+    h->connecting = false;
+    h->session_ready = false;
+    h->prewarm_us = 0;
+    h->cache_conversation_id[0] = '\0';
     
     // ========== 1. 创建音频模块 ==========
     
@@ -789,9 +1715,26 @@ extern "C" esp_err_t coze_chat_init(const coze_chat_config_t *config, coze_chat_
         .sample_rate = config->input_sample_rate,
         .channels = config->input_channel,
         .bit_depth = config->input_bit_depth,
-        .opus_bitrate = 16000,
+        .opus_bitrate = config->opus_bitrate,
+        .opus_complexity = config->opus_complexity,
+        .opus_vbr = !config->opus_use_cbr,
+        .opus_dtx = config->opus_dtx,
+        .opus_fec = config->opus_fec,
+        .opus_adaptive_complexity = config->opus_adaptive_complexity,
+        .opus_cpu_budget_pct = config->opus_cpu_budget_pct,
+        .frame_ms = config->uplink_frame_ms,
+        .frames_per_message = config->uplink_frames_per_message,
+        .max_batch_latency_ms = config->uplink_max_batch_ms,
+        .vad_gate = config->uplink_vad_gate,
+        .preroll_ms = config->uplink_preroll_ms,
+        .hangover_ms = uplink_gate_hangover_ms(config),
+        .adaptive_rate = config->uplink_adaptive_rate,
+        .min_bitrate = config->uplink_min_bitrate,
+        .max_message_ms = config->uplink_max_message_ms,
         .send_callback = websocket_send_callback,
         .send_callback_ctx = h,
+        .send_block_ms = config->ws_audio_max_age_ms,
+        .task_sched = xn_sched_get(config->sched_profile, XN_TASK_AUDIO_UPLINK),
     };
     
     h->audio_uplink = audio_uplink_create(&uplink_cfg);
@@ -813,6 +1756,21 @@ extern "C" esp_err_t coze_chat_init(const coze_chat_config_t *config, coze_chat_
             }
         },
         .callback_ctx = h,
+        .sink = {
+            .reserve = config->pcm_sink.reserve,
+            .commit = config->pcm_sink.commit,
+            .clear = config->pcm_sink.clear,
+            .ctx = config->pcm_sink.ctx,
+        },
+        .task_sched = xn_sched_get(config->sched_profile, XN_TASK_OPUS_DECODE),
+        .prebuffer_ms = (uint32_t)config->downlink_prebuffer_ms,
+        .lead_ms = (uint32_t)config->downlink_lead_ms,
+        .early_threshold_ms = (uint32_t)config->downlink_early_ms,
+        .plc_max_ms = (uint32_t)config->downlink_plc_max_ms,
+        .fec_enable = config->downlink_fec,
+        .codec = config->downlink_audio_type == COZE_CHAT_AUDIO_TYPE_PCM ? AUDIO_DOWNLINK_CODEC_PCM
+                                                                         : AUDIO_DOWNLINK_CODEC_OPUS,
+        .pcm_sample_rate = config->pcm_server_sample_rate,
     };
     
     h->audio_downlink = audio_downlink_create(&downlink_cfg);
@@ -823,6 +1781,44 @@ extern "C" esp_err_t coze_chat_init(const coze_chat_config_t *config, coze_chat_
         return ESP_ERR_NO_MEM;
     }
     
+    // 文本回复模式：创建本地流式TTS（与下行解码共用播放目标）
+    if (config->reply_mode == COZE_REPLY_MODE_TEXT_TTS) {
+        if (config->output_sample_rate != 16000) {
+            ESP_LOGW(TAG, "⚠️ 本地TTS输出固定16000Hz，与输出采样率 %dHz 不符，改用服务器语音",
+                     config->output_sample_rate);
+        } else {
+            xn_tts_stream_config_t tts_cfg = XN_TTS_STREAM_DEFAULT_CONFIG();
+            tts_cfg.speed = (uint8_t)config->tts_speed;
+            tts_cfg.callback = tts_pcm_callback;
+            tts_cfg.user_ctx = h;
+            tts_cfg.task_sched = xn_sched_get(config->sched_profile, XN_TASK_TTS_SYNTH);
+            h->tts_stream = xn_tts_stream_create(&tts_cfg);
+            if (!h->tts_stream) {
+                ESP_LOGW(TAG, "⚠️ 创建本地TTS失败，改用服务器语音");
+            }
+        }
+        if (!h->tts_stream) {
+            h->config.reply_mode = COZE_REPLY_MODE_AUDIO;
+        }
+    }
+    
+    // 重连与空闲断开定时器（回调在 esp_timer 任务中执行）
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = reconnect_timer_cb;
+    timer_args.arg = h;
+    timer_args.name = "coze_reconnect";
+    esp_err_t timer_ret = esp_timer_create(&timer_args, &h->reconnect_timer);
+    timer_args.callback = idle_timer_cb;
+    timer_args.name = "coze_idle";
+    if (timer_ret == ESP_OK) {
+        timer_ret = esp_timer_create(&timer_args, &h->idle_timer);
+    }
+    if (timer_ret != ESP_OK) {
+        ESP_LOGE(TAG, "创建连接管理定时器失败");
+        coze_chat_deinit(h);
+        return ESP_ERR_NO_MEM;
+    }
+    
     // 统一网络架构：4G通过USB RNDIS虚拟网卡，与WiFi使用相同的网络栈
     ESP_LOGI(TAG, "✅ 网络初始化成功（统一使用标准TCP/IP栈）");
     
@@ -850,70 +1846,62 @@ extern "C" esp_err_t coze_chat_start(coze_chat_handle_t handle)
     
     ESP_LOGI(TAG, "启动Coze WebSocket连接...");
     
-    // ========== 步骤1：创建环形缓冲区和任务（在设置回调之前）==========
+    // ========== 步骤1：创建消息队列和任务（在设置回调之前）==========
     
-    // ✅ 创建JSON消息环形缓冲区（256KB，PSRAM）
-    // 容量分析：平均JSON ~500字节，256KB可存512个包（约30秒音频）
-    handle->ws_ring_buffer = simple_ring_buffer_create(256 * 1024);
-    if (!handle->ws_ring_buffer) {
-        ESP_LOGE(TAG, "❌ 创建WebSocket环形缓冲区失败");
+    // ✅ 创建接收消息队列（PSRAM），WebSocket分片直接写入变长记录
+    ws_msg_queue_config_t queue_cfg = {
+        .size = handle->config.ws_rx_queue_size > 0 ? (size_t)handle->config.ws_rx_queue_size : 256 * 1024,
+        .policy = handle->config.ws_rx_block_ms > 0 ? WS_MSG_QUEUE_BLOCK : WS_MSG_QUEUE_DROP_NEWEST,
+        .block_timeout_ms = (uint32_t)handle->config.ws_rx_block_ms,
+        .min_msg_len = COZE_WS_MSG_MAX_LEN,
+    };
+    handle->ws_msg_queue = ws_msg_queue_create(&queue_cfg);
+    if (!handle->ws_msg_queue) {
+        ESP_LOGE(TAG, "❌ 创建WebSocket消息队列失败");
         return ESP_ERR_NO_MEM;
     }
-    ESP_LOGI(TAG, "✅ WebSocket环形缓冲区创建成功（256KB PSRAM）");
     
-    // 启动JSON解析任务（栈使用PSRAM，优先级提高到6确保快速处理）
+    // 按调度档案启动JSON解析任务（均衡预设：Core 0，优先级6，栈在PSRAM，确保快速消费队列）
     handle->parser_running = true;
     
-    StaticTask_t *parser_tcb = (StaticTask_t *)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-    StackType_t *parser_stack = (StackType_t *)heap_caps_malloc(handle->config.pull_task_stack_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    
-    if (!parser_tcb || !parser_stack) {
-        ESP_LOGE(TAG, "❌ JSON解析任务内存分配失败");
-        if (parser_tcb) heap_caps_free(parser_tcb);
-        if (parser_stack) heap_caps_free(parser_stack);
-        simple_ring_buffer_destroy(handle->ws_ring_buffer);
-        handle->ws_ring_buffer = NULL;
-        return ESP_FAIL;
+    xn_task_sched_t parser_sched = *xn_sched_get(handle->config.sched_profile, XN_TASK_COZE_PARSER);
+    if (handle->config.pull_task_stack_size > 0) {
+        parser_sched.stack_size = handle->config.pull_task_stack_size;
+    }
+    if (handle->config.pull_task_caps & MALLOC_CAP_INTERNAL) {
+        parser_sched.stack = XN_TASK_STACK_INTERNAL;
     }
     
-    handle->parser_task = xTaskCreateStaticPinnedToCore(
-        json_parser_task,
-        "coze_parser",
-        handle->config.pull_task_stack_size / sizeof(StackType_t),
-        handle,
-        6,              // 优先级6（高优先级，确保快速消费队列）
-        parser_stack,   // PSRAM栈
-        parser_tcb,     // 内部RAM TCB
-        0               // Core 0
-    );
-    
-    if (!handle->parser_task) {
+    if (xn_task_create(&handle->parser_task, &parser_sched, json_parser_task, "coze_parser", handle) != ESP_OK) {
         ESP_LOGE(TAG, "❌ 创建JSON解析任务失败");
-        heap_caps_free(parser_tcb);
-        heap_caps_free(parser_stack);
-        simple_ring_buffer_destroy(handle->ws_ring_buffer);
-        handle->ws_ring_buffer = NULL;
+        handle->parser_running = false;
+        ws_msg_queue_destroy(handle->ws_msg_queue);
+        handle->ws_msg_queue = NULL;
         return ESP_FAIL;
     }
     
-    ESP_LOGI(TAG, "✅ JSON解析任务创建成功（栈%dKB在PSRAM，优先级6）", handle->config.pull_task_stack_size / 1024);
+    ESP_LOGI(TAG, "✅ JSON解析任务创建成功（核心%d，优先级%d，栈%dKB在%s）",
+             parser_sched.core, parser_sched.priority, (int)(parser_sched.stack_size / 1024),
+             parser_sched.stack == XN_TASK_STACK_PSRAM ? "PSRAM" : "内部RAM");
     
     // ========== 步骤2：创建WebSocket实现 ==========
     
     // 统一网络架构：4G通过USB RNDIS虚拟网卡，与WiFi使用相同的网络栈
     ESP_LOGI(TAG, "✅ 网络初始化成功（统一使用标准TCP/IP栈）");
     
-    // 创建WebSocket客户端（WiFi和4G统一使用）
-    handle->websocket = std::make_unique<CozeWebSocket>();
+    // 创建WebSocket客户端（WiFi和4G统一使用）；再次启动时复用，保留TLS会话
+    if (!handle->websocket) {
+        handle->websocket = std::make_unique<CozeWebSocket>();
+    }
     
     if (!handle->websocket) {
         ESP_LOGE(TAG, "创建WebSocket失败");
         
         // 清理已创建的资源
         handle->parser_running = false;
-        vTaskDelete(handle->parser_task);
-        simple_ring_buffer_destroy(handle->ws_ring_buffer);
-        handle->ws_ring_buffer = NULL;
+        xn_task_join(&handle->parser_task, 200);
+        ws_msg_queue_destroy(handle->ws_msg_queue);
+        handle->ws_msg_queue = NULL;
         return ESP_FAIL;
     }
     
@@ -922,82 +1910,36 @@ extern "C" esp_err_t coze_chat_start(coze_chat_handle_t handle)
     handle->websocket->SetHeader("Authorization", auth_header.c_str());
     handle->websocket->SetHeader("User-Agent", "ESP32-Coze/1.0");
     
+    const xn_task_sched_t *ws_sched = xn_sched_get(handle->config.sched_profile, XN_TASK_WEBSOCKET);
+    handle->websocket->SetTaskConfig(ws_sched->priority, (int)ws_sched->stack_size);
+    handle->websocket->SetSendQueue(xn_sched_get(handle->config.sched_profile, XN_TASK_WS_SEND),
+                                    handle->config.ws_send_queue_len > 0 ? (size_t)handle->config.ws_send_queue_len : 0);
+    
     // ========== 步骤3：设置WebSocket回调 ==========
     
     handle->websocket->OnConnected([handle]() {
-        ESP_LOGI(TAG, "✅ WebSocket已连接");
-        handle->connected = true;
-        
-        if (handle->ws_event_callback) {
-            coze_ws_event_t evt = {.handle = handle, .event_id = COZE_WS_EVENT_CONNECTED};
-            handle->ws_event_callback(&evt);
-        }
-        
-        // 发送chat.update配置
-        std::string config_json = build_chat_update_event(&handle->config);
-        ESP_LOGI(TAG, "📤 发送chat.update配置");
-        ESP_LOGI(TAG, "配置内容: %s", config_json.c_str());  // 暂时用INFO级别，方便调试
-        handle->websocket->Send(config_json);
+        conn_on_connected(handle);
     });
     
-    handle->websocket->OnData([handle](const char *data, size_t length, bool binary) {
-        // 只处理文本数据（JSON消息）
-        if (!binary && data && length > 0) {
-            // ✅ 防御性检查：确保环形缓冲区已创建
-            if (!handle->ws_ring_buffer) {
-                ESP_LOGW(TAG, "⚠️ 环形缓冲区未初始化，丢弃数据 %d bytes", (int)length);
-                return;
-            }
-            
-            // 检查消息长度（最大支持64KB）
-            if (length > 65535) {
-                ESP_LOGE(TAG, "❌ JSON消息过大: %d bytes", (int)length);
-                return;
+    // 零拷贝接收：按整条消息长度预留队列记录，分片由WebSocket任务直接写入
+    handle->websocket->OnMessage(
+        [handle](size_t len, bool binary) -> char * {
+            // 只处理文本数据（JSON消息）
+            if (binary || !handle->ws_msg_queue) {
+                return nullptr;
             }
-            
-            // ✅ 零拷贝写入环形缓冲区（格式：[长度2字节][数据]）
-            uint16_t msg_len = (uint16_t)length;
-            
-            // 写入长度（2字节）
-            esp_err_t ret = simple_ring_buffer_write(
-                handle->ws_ring_buffer,
-                (const uint8_t *)&msg_len,
-                sizeof(uint16_t)
-            );
-            
-            if (ret != ESP_OK) {
-                ESP_LOGW(TAG, "⚠️ 写入消息长度失败（缓冲区满？）");
-                return;
-            }
-            
-            // 写入JSON数据
-            ret = simple_ring_buffer_write(
-                handle->ws_ring_buffer,
-                (const uint8_t *)data,
-                length
-            );
-            
-            if (ret != ESP_OK) {
-                ESP_LOGW(TAG, "⚠️ 写入JSON数据失败（缓冲区满？）");
-                // ⚠️ 这里如果失败，会导致长度和数据不匹配
-                // 需要清空缓冲区避免数据混乱
-                simple_ring_buffer_clear(handle->ws_ring_buffer);
-                ESP_LOGE(TAG, "❌ 缓冲区已清空以避免数据混乱");
-                return;
+            return ws_msg_queue_acquire(handle->ws_msg_queue, len);
+        },
+        [handle](char *buf, size_t len, bool complete) {
+            if (complete) {
+                ws_msg_queue_commit(handle->ws_msg_queue, buf, len);
+            } else {
+                ws_msg_queue_abort(handle->ws_msg_queue, buf);
             }
-            
-            // 注意：不打印日志，避免高频刷屏
-        }
-    });
+        });
     
     handle->websocket->OnDisconnected([handle]() {
-        ESP_LOGW(TAG, "WebSocket已断开");
-        handle->connected = false;
-        
-        if (handle->ws_event_callback) {
-            coze_ws_event_t evt = {.handle = handle, .event_id = COZE_WS_EVENT_DISCONNECTED};
-            handle->ws_event_callback(&evt);
-        }
+        conn_on_disconnected(handle);
     });
     
     handle->websocket->OnError([handle](int error) {
@@ -1014,21 +1956,26 @@ extern "C" esp_err_t coze_chat_start(coze_chat_handle_t handle)
     // 连接到Coze服务器（URL中必须包含 bot_id 和 device_id）
     char url_buffer[512];
     snprintf(url_buffer, sizeof(url_buffer), "%s?bot_id=%s&device_id=%s",
-             COZE_WEBSOCKET_URL,
+             handle->config.server_url ? handle->config.server_url : COZE_WEBSOCKET_URL,
              handle->config.bot_id,
              handle->config.user_id);
-    std::string url = url_buffer;
+    handle->ws_url = url_buffer;
     
-    ESP_LOGI(TAG, "连接到: %s", url.c_str());
+    ESP_LOGI(TAG, "连接到: %s", handle->ws_url.c_str());
     
-    if (!handle->websocket->Connect(url)) {
+    handle->link_wanted = true;
+    handle->idle_closed = false;
+    handle->reconnect_attempt = 0;
+    if (conn_begin(handle) != ESP_OK) {
         ESP_LOGE(TAG, "WebSocket连接失败");
         
         // 清理已创建的资源
+        handle->link_wanted = false;
+        esp_timer_stop(handle->reconnect_timer);
         handle->parser_running = false;
-        vTaskDelete(handle->parser_task);
-        simple_ring_buffer_destroy(handle->ws_ring_buffer);
-        handle->ws_ring_buffer = NULL;
+        xn_task_join(&handle->parser_task, 200);
+        ws_msg_queue_destroy(handle->ws_msg_queue);
+        handle->ws_msg_queue = NULL;
         return ESP_FAIL;
     }
     
@@ -1056,32 +2003,45 @@ extern "C" esp_err_t coze_chat_stop(coze_chat_handle_t handle)
 {
     ESP_RETURN_ON_FALSE(handle != NULL, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
     
-    // 停止音频上行任务
+    // 停止音频上行任务：先清空待发音频，让阻塞在发送队列上的上行任务立即返回
     if (handle->audio_uplink) {
+        if (handle->websocket) {
+            handle->websocket->DropAudio();
+        }
         audio_uplink_stop(handle->audio_uplink);
     }
     
     // 停止JSON解析任务
-    if (handle->parser_task) {
+    if (handle->parser_task.handle) {
         handle->parser_running = false;
-        vTaskDelay(pdMS_TO_TICKS(100)); // 等待任务退出
-        handle->parser_task = NULL;
+        xn_task_join(&handle->parser_task, 200); // 等待任务退出并回收任务栈
     }
     
-    // ✅ 销毁WebSocket环形缓冲区
-    if (handle->ws_ring_buffer) {
-        simple_ring_buffer_destroy(handle->ws_ring_buffer);
-        handle->ws_ring_buffer = NULL;
-        ESP_LOGI(TAG, "环形缓冲区已销毁");
-    }
+    // 停止重连与空闲断开
+    handle->link_wanted = false;
+    esp_timer_stop(handle->reconnect_timer);
+    esp_timer_stop(handle->idle_timer);
     
-    // 关闭WebSocket
+    // 断开WebSocket（先于消息队列销毁，确保接收回调不再写入记录）；客户端保留以复用TLS会话
     if (handle->websocket) {
-        handle->websocket->Close();
-        handle->websocket.reset();
+        handle->websocket->Disconnect();
+    }
+    taskENTER_CRITICAL(&handle->chat_lock);
+    handle->connecting = false;
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    handle->idle_close_request = false;
+    handle->session_ready = false;
+    
+    // ✅ 销毁WebSocket消息队列
+    if (handle->ws_msg_queue) {
+        ws_msg_queue_destroy(handle->ws_msg_queue);
+        handle->ws_msg_queue = NULL;
+        ESP_LOGI(TAG, "消息队列已销毁");
     }
     
+    taskENTER_CRITICAL(&handle->chat_lock);
     handle->connected = false;
+    taskEXIT_CRITICAL(&handle->chat_lock);
     ESP_LOGI(TAG, "Coze WebSocket已停止");
     
     return ESP_OK;
@@ -1092,7 +2052,7 @@ extern "C" esp_err_t coze_chat_stop(coze_chat_handle_t handle)
  * 
  * 释放所有资源并删除句柄：
  * - 停止WebSocket连接
- * - 释放环形缓冲区
+ * - 释放消息队列
  * - 释放Opus解码器
  * - 释放4G模组
  * - 删除句柄
@@ -1115,12 +2075,30 @@ extern "C" esp_err_t coze_chat_deinit(coze_chat_handle_t handle)
         handle->audio_uplink = NULL;
     }
     
+    // 销毁本地TTS（其PCM回调依赖下行模块，先于下行销毁）
+    if (handle->tts_stream) {
+        handle->tts_stopping = true;
+        xn_tts_stream_destroy(handle->tts_stream);
+        handle->tts_stream = NULL;
+    }
+    
     // 销毁音频下行模块
     if (handle->audio_downlink) {
         audio_downlink_destroy(handle->audio_downlink);
         handle->audio_downlink = NULL;
     }
     
+    // 删除连接管理定时器（stop 已停止），再销毁WebSocket客户端与TLS会话
+    if (handle->reconnect_timer) {
+        esp_timer_delete(handle->reconnect_timer);
+        handle->reconnect_timer = NULL;
+    }
+    if (handle->idle_timer) {
+        esp_timer_delete(handle->idle_timer);
+        handle->idle_timer = NULL;
+    }
+    handle->websocket.reset();
+    
     // 注意：USB RNDIS统一网络架构下，不再需要modem对象
     
     // 释放句柄
@@ -1149,10 +2127,27 @@ extern "C" esp_err_t coze_chat_send_audio_data(coze_chat_handle_t handle, char *
     ESP_RETURN_ON_FALSE(handle->connected, ESP_FAIL, TAG, "WebSocket未连接");
     ESP_RETURN_ON_FALSE(handle->audio_uplink != NULL, ESP_FAIL, TAG, "音频上行模块未初始化");
     
+    handle->last_activity_us = esp_timer_get_time();
+    
     // 直接写入环形缓冲区（零拷贝）
     return audio_uplink_write(handle->audio_uplink, (const uint8_t *)audio_data, len);
 }
 
+/**
+ * @brief 输入人声状态（驱动上行静音门）
+ * 
+ * @param handle Coze Chat句柄
+ * @param speech true 人声开始，false 人声结束
+ * @return ESP_OK成功
+ */
+extern "C" esp_err_t coze_chat_set_voice_activity(coze_chat_handle_t handle, bool speech)
+{
+    ESP_RETURN_ON_FALSE(handle != NULL, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
+    
+    audio_uplink_set_voice(handle->audio_uplink, speech);
+    return ESP_OK;
+}
+
 /**
  * @brief 发送音频完成信号
  * 
@@ -1167,8 +2162,8 @@ extern "C" esp_err_t coze_chat_send_audio_complete(coze_chat_handle_t handle)
     ESP_RETURN_ON_FALSE(handle != NULL, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
     ESP_RETURN_ON_FALSE(handle->connected, ESP_FAIL, TAG, "WebSocket未连接");
     
-    // VAD模式下无需手动发送完成信号
-    if (handle->config.turn_detection_type == COZE_TURN_DETECTION_SERVER_VAD) {
+    // 服务器VAD/语义VAD由服务器判断说话结束，无需手动发送完成信号（静音门拖尾也按此延长）
+    if (turn_ends_on_server_silence(handle->config.turn_detection_type)) {
         ESP_LOGI(TAG, "VAD模式，跳过手动完成信号");
         return ESP_OK;
     }
@@ -1183,8 +2178,9 @@ extern "C" esp_err_t coze_chat_send_audio_complete(coze_chat_handle_t handle)
     cJSON_AddStringToObject(root, "id", event_id);
     cJSON_AddStringToObject(root, "event_type", "input_audio_buffer.complete");
     
+    // 与音频同队列，保证排在已入队的音频之后
     char *json_str = cJSON_PrintUnformatted(root);
-    bool success = handle->websocket->Send(json_str);
+    bool success = handle->websocket->SendOrdered(json_str);
     
     ESP_LOGI(TAG, "📤 已发送音频完成信号");
     
@@ -1217,8 +2213,10 @@ extern "C" esp_err_t coze_chat_send_audio_cancel(coze_chat_handle_t handle)
     cJSON_AddStringToObject(root, "id", event_id);
     cJSON_AddStringToObject(root, "event_type", "input_audio_buffer.clear");
     
+    // 未发出的音频不再需要，先丢弃再排队发送清除
+    handle->websocket->DropAudio();
     char *json_str = cJSON_PrintUnformatted(root);
-    bool success = handle->websocket->Send(json_str);
+    bool success = handle->websocket->SendOrdered(json_str);
     
     ESP_LOGI(TAG, "📤 已发送音频取消信号");
     
@@ -1227,3 +2225,285 @@ extern "C" esp_err_t coze_chat_send_audio_cancel(coze_chat_handle_t handle)
     
     return success ? ESP_OK : ESP_FAIL;
 }
+
+/**
+ * @brief 打断当前回复（barge-in）
+ * 
+ * 先在本地静音（丢弃Opus缓冲与播放缓冲区），再发送 conversation.chat.cancel；
+ * 网络发送不计入打断延迟。被打断回复的ID记下后，解析任务丢弃其迟到的音频增量。
+ * 
+ * @param handle Coze Chat句柄
+ * @param trigger_us 触发时刻（esp_timer_get_time），0 表示当前时刻
+ * @return ESP_OK成功，ESP_ERR_INVALID_STATE 无需打断，其他值表示取消消息发送失败
+ */
+extern "C" esp_err_t coze_chat_interrupt(coze_chat_handle_t handle, int64_t trigger_us)
+{
+    ESP_RETURN_ON_FALSE(handle != NULL, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
+    
+    if (trigger_us <= 0) {
+        trigger_us = esp_timer_get_time();
+    }
+    
+    // 回复已结束且下行（或本地TTS）已播完时无需打断
+    bool playing = audio_downlink_get_state(handle->audio_downlink) != AUDIO_DOWNLINK_IDLE ||
+                   (handle->tts_stream && xn_tts_stream_is_busy(handle->tts_stream));
+    taskENTER_CRITICAL(&handle->chat_lock);
+    bool active = handle->chat_active;
+    if (active || playing) {
+        memcpy(handle->cancelled_chat_id, handle->current_chat_id, sizeof(handle->cancelled_chat_id));
+        handle->chat_active = false;
+    }
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    if (!active && !playing) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    // 步骤1：本地静音（本地TTS分句 + 待播Opus包 + 播放缓冲区中的PCM）
+    tts_stop(handle);
+    uint32_t dropped_ms = audio_downlink_flush(handle->audio_downlink);
+    if (handle->event_callback) {
+        // 未使用 pcm_sink 的应用在此清空自己的播放缓冲
+        handle->event_callback(COZE_CHAT_EVENT_CHAT_INTERRUPTED, NULL, NULL);
+    }
+    
+    // 打断统计由 chat_lock 保护（解析任务同时在更新丢包数与确认耗时）
+    coze_barge_in_stats_t *st = &handle->barge_in;
+    uint32_t cleared_us = (uint32_t)(esp_timer_get_time() - trigger_us);
+    taskENTER_CRITICAL(&handle->chat_lock);
+    st->count++;
+    st->cleared_us_last = cleared_us;
+    if (cleared_us > st->cleared_us_max) {
+        st->cleared_us_max = cleared_us;
+    }
+    st->flushed_ms_last = dropped_ms;
+    st->cancel_us_last = 0;
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    
+    // 步骤2：通知服务器取消本轮回复
+    bool success = true;
+    if (active && handle->connected && handle->websocket) {
+        cJSON *root = cJSON_CreateObject();
+        
+        char event_id[64];
+        snprintf(event_id, sizeof(event_id), "cancel_%lld", esp_timer_get_time() / 1000);
+        
+        cJSON_AddStringToObject(root, "id", event_id);
+        cJSON_AddStringToObject(root, "event_type", "conversation.chat.cancel");
+        
+        char *json_str = cJSON_PrintUnformatted(root);
+        success = handle->websocket->Send(json_str);
+        
+        free(json_str);
+        cJSON_Delete(root);
+        
+        uint32_t cancel_us = (uint32_t)(esp_timer_get_time() - trigger_us);
+        taskENTER_CRITICAL(&handle->chat_lock);
+        if (success) {
+            st->cancel_us_last = cancel_us;
+            if (cancel_us > st->cancel_us_max) {
+                st->cancel_us_max = cancel_us;
+            }
+            handle->barge_in_trigger_us = trigger_us;
+        } else {
+            st->cancel_fail++;
+        }
+        taskEXIT_CRITICAL(&handle->chat_lock);
+    }
+    
+    taskENTER_CRITICAL(&handle->chat_lock);
+    coze_barge_in_stats_t snap = *st;
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    ESP_LOGI(TAG, "🛑 已打断 (第 %lu 次): 触发到静音 %lu us (最大 %lu us), 到取消发出 %lu us, 丢弃缓冲 %lu ms, 取消%s",
+             snap.count, cleared_us, snap.cleared_us_max, snap.cancel_us_last, dropped_ms,
+             !active ? "无需发送" : (success ? "已发送" : "发送失败"));
+    
+    return success ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief 预连接：唤醒/按键时提前建立连接
+ * 
+ * @param handle Coze Chat句柄
+ * @param trigger_us 触发时刻（esp_timer_get_time），用于统计唤醒到会话就绪耗时
+ * @return ESP_OK成功，ESP_ERR_INVALID_STATE 未启动
+ */
+extern "C" esp_err_t coze_chat_prewarm(coze_chat_handle_t handle, int64_t trigger_us)
+{
+    ESP_RETURN_ON_FALSE(handle != NULL, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
+    ESP_RETURN_ON_FALSE(handle->link_wanted, ESP_ERR_INVALID_STATE, TAG, "未启动");
+    
+    handle->last_activity_us = esp_timer_get_time();
+    handle->idle_close_request = false;  // 已唤醒：撤销尚未执行的空闲断开
+    if (handle->session_ready) {
+        handle->conn_stats.wake_to_ready_ms_last = 0;  // 连接保持中，无需等待
+        return ESP_OK;
+    }
+    
+    if (handle->prewarm_us == 0) {
+        handle->prewarm_us = trigger_us > 0 ? trigger_us : esp_timer_get_time();
+    }
+    handle->idle_closed = false;
+    handle->reconnect_attempt = 0;  // 用户在等：跳过退避立即建连
+    ESP_LOGI(TAG, "🔥 预连接");
+    return conn_begin(handle);
+}
+
+/**
+ * @brief 获取连接统计
+ * 
+ * @param handle Coze Chat句柄
+ * @param stats 输出统计
+ * @return ESP_OK成功
+ */
+extern "C" esp_err_t coze_chat_get_conn_stats(coze_chat_handle_t handle, coze_conn_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(handle != NULL, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
+    ESP_RETURN_ON_FALSE(stats != NULL, ESP_ERR_INVALID_ARG, TAG, "stats is NULL");
+    
+    *stats = handle->conn_stats;
+    return ESP_OK;
+}
+
+/**
+ * @brief 获取上行统计
+ * 
+ * @param handle Coze Chat句柄
+ * @param stats 输出统计
+ * @return ESP_OK成功
+ */
+extern "C" esp_err_t coze_chat_get_uplink_stats(coze_chat_handle_t handle, coze_uplink_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(handle != NULL, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
+    ESP_RETURN_ON_FALSE(stats != NULL, ESP_ERR_INVALID_ARG, TAG, "stats is NULL");
+    
+    audio_uplink_stats_t st;
+    esp_err_t ret = audio_uplink_get_stats(handle->audio_uplink, &st);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    stats->messages = st.messages;
+    stats->send_fail = st.send_fail;
+    stats->audio_ms = st.audio_ms;
+    stats->wire_bytes = st.wire_bytes;
+    stats->send_ms_avg = st.send_us_avg / 1000;
+    stats->send_ms_max = st.send_us_max / 1000;
+    stats->backlog_ms = st.backlog_ms;
+    stats->backlog_ms_max = st.backlog_ms_max;
+    stats->bitrate = st.bitrate;
+    stats->message_ms = st.message_ms;
+    stats->rate_level = st.rate_level;
+    stats->rate_downs = st.rate_downs;
+    stats->rate_ups = st.rate_ups;
+    stats->gated_ms = (uint32_t)st.gated_ms;
+    stats->saved_bytes = st.saved_bytes;
+    
+    CozeWebSocket::SendStats ws = {};
+    if (handle->websocket) {
+        handle->websocket->GetSendStats(&ws);
+    }
+    stats->queue_depth = ws.data_depth;
+    stats->queue_depth_max = ws.data_depth_max;
+    stats->queue_ms_avg = ws.latency_us_avg / 1000;
+    stats->queue_ms_max = ws.latency_us_max / 1000;
+    stats->dropped_expired = ws.dropped_expired;
+    stats->dropped_full = ws.dropped_full;
+    return ESP_OK;
+}
+
+/**
+ * @brief 获取下行统计
+ * 
+ * @param handle Coze Chat句柄
+ * @param stats 输出统计
+ * @return ESP_OK成功
+ */
+extern "C" esp_err_t coze_chat_get_downlink_stats(coze_chat_handle_t handle, coze_downlink_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(handle != NULL, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
+    ESP_RETURN_ON_FALSE(stats != NULL, ESP_ERR_INVALID_ARG, TAG, "stats is NULL");
+    
+    memset(stats, 0, sizeof(*stats));
+    if (handle->ws_msg_queue) {
+        ws_msg_queue_stats_t qs;
+        ws_msg_queue_get_stats(handle->ws_msg_queue, &qs);
+        stats->rx_messages = qs.committed;
+        stats->rx_dropped = qs.dropped;
+        stats->rx_blocked = qs.blocked;
+    }
+    
+    audio_downlink_stats_t st;
+    if (handle->audio_downlink && audio_downlink_get_stats(handle->audio_downlink, &st) == ESP_OK) {
+        stats->packets = st.packets;
+        stats->buffer_full = st.buffer_full;
+        stats->late_packets = st.late_packets;
+        stats->lost_frames = st.lost_frames;
+        stats->plc_frames = st.plc_frames;
+        stats->fec_frames = st.fec_frames;
+        stats->underruns = st.underruns;
+        stats->played_ms = st.played_ms;
+        stats->first_audio_ms = st.first_audio_ms;
+        stats->decode_us_avg = st.decode_us_avg;
+        stats->decode_us_per_s = st.decode_us_per_s;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 获取打断统计
+ * 
+ * @param handle Coze Chat句柄
+ * @param stats 输出统计
+ * @return ESP_OK成功
+ */
+extern "C" esp_err_t coze_chat_get_barge_in_stats(coze_chat_handle_t handle, coze_barge_in_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(handle != NULL, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
+    ESP_RETURN_ON_FALSE(stats != NULL, ESP_ERR_INVALID_ARG, TAG, "stats is NULL");
+    
+    taskENTER_CRITICAL(&handle->chat_lock);
+    *stats = handle->barge_in;
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    return ESP_OK;
+}
+
+/**
+ * @brief 获取最近一轮回复的统计
+ * 
+ * @param handle Coze Chat句柄
+ * @param stats 输出统计
+ * @return ESP_OK成功，ESP_ERR_NOT_FOUND 尚无已结束的回复
+ */
+extern "C" esp_err_t coze_chat_get_turn_stats(coze_chat_handle_t handle, coze_turn_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(handle != NULL, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
+    ESP_RETURN_ON_FALSE(stats != NULL, ESP_ERR_INVALID_ARG, TAG, "stats is NULL");
+    
+    if (!handle->turn_reported) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *stats = handle->last_turn;
+    return ESP_OK;
+}
+
+/**
+ * @brief 注册服务器下行事件处理函数
+ * 
+ * @param handle Coze Chat句柄
+ * @param event 事件
+ * @param handler 处理函数，NULL 表示注销
+ * @param ctx 用户上下文
+ * @return ESP_OK成功
+ */
+extern "C" esp_err_t coze_chat_register_event_handler(coze_chat_handle_t handle, coze_server_event_t event,
+                                                      coze_server_event_handler_t handler, void *ctx)
+{
+    ESP_RETURN_ON_FALSE(handle != NULL, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
+    ESP_RETURN_ON_FALSE(event >= 0 && event < COZE_SERVER_EVENT_MAX, ESP_ERR_INVALID_ARG, TAG, "invalid event");
+    
+    taskENTER_CRITICAL(&handle->chat_lock);
+    handle->event_handlers[event].handler = handler;
+    handle->event_handlers[event].ctx = handler ? ctx : NULL;
+    taskEXIT_CRITICAL(&handle->chat_lock);
+    return ESP_OK;
+}
@@ -16,7 +16,10 @@
 #pragma once
 
 #include "esp_err.h"
+#include "xn_task_sched.h"
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -111,6 +114,117 @@ typedef enum {
     COZE_CHAT_AUDIO_TYPE_OPUS = 1,    ///< Opus格式：压缩音频，需要配置比特率和帧长
 } coze_chat_audio_type_t;
 
+/**
+ * @brief 回复模式枚举
+ * 
+ * @details 定义机器人回复的下行形式
+ */
+typedef enum {
+    COZE_REPLY_MODE_AUDIO = 0,        ///< 服务器语音：下行 conversation.audio.delta（Opus/PCM）
+    COZE_REPLY_MODE_TEXT_TTS,         ///< 文本+本地TTS：只订阅文本事件，按分句在本地合成，下行流量只有文本
+} coze_reply_mode_t;
+
+/**
+ * @brief 单轮回复统计
+ * 
+ * @details 一轮为 conversation.chat.created 到 completed/failed/canceled
+ */
+typedef struct {
+    coze_reply_mode_t mode;         ///< 本轮使用的回复模式
+    bool audio_fallback;            ///< 本轮是否因文本无法本地朗读而回退到服务器语音
+    uint32_t messages;              ///< 本轮收到的下行消息数
+    uint32_t bytes_total;           ///< 本轮收到的下行消息总字节数
+    uint32_t bytes_audio;           ///< 其中 conversation.audio.delta 的字节数
+    uint32_t bytes_text;            ///< 其中 conversation.message.delta 的字节数
+    uint32_t duration_ms;           ///< 本轮时长
+    uint32_t process_us;            ///< 解析任务处理本轮消息的累计耗时（JSON解析与分发，含Base64解码），用于计算解析吞吐
+} coze_turn_stats_t;
+
+/**
+ * @brief 连接统计
+ * 
+ * @details 会话就绪指 chat.update 已被服务器确认（chat.updated），此后才能开始对话
+ */
+typedef struct {
+    uint32_t connects;              ///< 成功建连次数（含重连）
+    uint32_t failures;              ///< 建连失败或断线次数
+    uint32_t connect_ms_first;      ///< 首次建连耗时（TCP+完整TLS握手+升级）
+    uint32_t connect_ms_last;       ///< 最近一次建连耗时（重连复用TLS会话）
+    uint32_t ready_ms_last;         ///< 最近一次建连开始到会话就绪的耗时
+    uint32_t wake_to_ready_ms_last; ///< 最近一次预连接触发（唤醒/按键）到会话就绪的耗时，已在线为0
+    bool resumed_conversation;      ///< 最近一次会话是否沿用了之前的 conversation_id
+} coze_conn_stats_t;
+
+/**
+ * @brief 上行统计
+ * 
+ * @details 发送耗时为发送回调阻塞的时长（发送队列满、链路拥塞时增大），积压为尚未发送的麦克风音频；
+ *          队列统计来自 WebSocket 发送任务
+ */
+typedef struct {
+    uint32_t messages;              ///< 已发送音频消息数
+    uint32_t send_fail;             ///< 发送失败次数
+    uint64_t audio_ms;              ///< 已发送音频时长
+    uint64_t wire_bytes;            ///< 线上字节数（JSON + WebSocket 帧头）
+    uint32_t send_ms_avg;           ///< 发送耗时滑动平均
+    uint32_t send_ms_max;           ///< 最大发送耗时
+    uint32_t backlog_ms;            ///< 当前积压
+    uint32_t backlog_ms_max;        ///< 最大积压
+    int bitrate;                    ///< 当前码率（Opus 为编码码率，PCM 为原始码率）
+    int message_ms;                 ///< 当前每条消息的音频时长
+    int rate_level;                 ///< 当前码率档位（0 为配置档）
+    uint32_t rate_downs;            ///< 降档次数
+    uint32_t rate_ups;              ///< 升档次数
+    uint32_t gated_ms;              ///< 静音门抑制的音频时长
+    uint64_t saved_bytes;           ///< 静音门估算节省的线上字节数
+    uint32_t queue_depth;           ///< 当前 WebSocket 发送队列中的音频消息数
+    uint32_t queue_depth_max;       ///< 发送队列最大深度
+    uint32_t queue_ms_avg;          ///< 消息入队到发出的耗时滑动平均
+    uint32_t queue_ms_max;          ///< 消息入队到发出的最大耗时
+    uint32_t dropped_expired;       ///< 排队超过 ws_audio_max_age_ms 被丢弃的音频消息数
+    uint32_t dropped_full;          ///< 队列满被丢弃的消息数
+} coze_uplink_stats_t;
+
+/**
+ * @brief 下行统计
+ * 
+ * @details 接收队列计数来自 WebSocket 任务到解析任务之间的消息队列，其余来自下行解码与播放
+ */
+typedef struct {
+    uint32_t rx_messages;           ///< 已进入接收队列的消息数
+    uint32_t rx_dropped;            ///< 接收队列满或消息过大而丢弃的消息数
+    uint32_t rx_blocked;            ///< WebSocket 任务因接收队列满而等待的次数
+    uint32_t packets;               ///< 接收的音频包数
+    uint32_t buffer_full;           ///< 下行缓冲满丢弃的音频包数
+    uint32_t late_packets;          ///< 迟到包数
+    uint32_t lost_frames;           ///< 丢失帧数
+    uint32_t plc_frames;            ///< PLC 补齐帧数
+    uint32_t fec_frames;            ///< FEC 恢复帧数
+    uint32_t underruns;             ///< 播放欠载次数
+    uint32_t played_ms;             ///< 已送出播放的音频时长
+    uint32_t first_audio_ms;        ///< 最近一次首包到起播的等待
+    uint32_t decode_us_avg;         ///< 单帧平均解码耗时
+    uint32_t decode_us_per_s;       ///< 每秒音频的解码耗时（PCM下行为复制/重采样耗时），可比较两种下行的CPU开销
+} coze_downlink_stats_t;
+
+/**
+ * @brief 打断（barge-in）统计
+ * 
+ * @details 各阶段均从触发时刻（本地VAD开始/唤醒词，服务器VAD为收到 speech_started）起算：
+ *          播放缓冲清空 → conversation.chat.cancel 交给发送队列 → 收到 conversation.chat.canceled
+ */
+typedef struct {
+    uint32_t count;                 ///< 打断次数
+    uint32_t cleared_us_last;       ///< 最近一次触发到本地静音（Opus缓冲与播放缓冲区已清空）的耗时
+    uint32_t cleared_us_max;        ///< 触发到本地静音的最大耗时
+    uint32_t cancel_us_last;        ///< 最近一次触发到取消消息交给发送队列的耗时，无需发送时为0
+    uint32_t cancel_us_max;         ///< 触发到取消消息交给发送队列的最大耗时
+    uint32_t ack_ms_last;           ///< 最近一次触发到收到服务器 conversation.chat.canceled 的耗时
+    uint32_t flushed_ms_last;       ///< 最近一次丢弃的待播音频时长
+    uint32_t cancel_fail;           ///< 取消消息发送失败次数
+    uint32_t dropped_packets;       ///< 丢弃的被打断回复的迟到音频包数
+} coze_barge_in_stats_t;
+
 /**
  * @brief Coze聊天事件类型枚举
  * 
@@ -126,6 +240,7 @@ typedef enum {
     COZE_CHAT_EVENT_INPUT_AUDIO_BUFFER_COMPLETED,     ///< 音频缓冲区处理完成：上行音频缓冲区处理完成
     COZE_CHAT_EVENT_CHAT_SUBTITLE_EVENT,              ///< 字幕事件：收到字幕数据，data字段包含字幕内容
     COZE_CHAT_EVENT_CHAT_CUSTOMER_DATA,               ///< 自定义数据：收到自定义数据，data字段包含数据内容
+    COZE_CHAT_EVENT_CHAT_INTERRUPTED,                 ///< 已打断：本地已停止播放并请求服务器取消本轮回复
 } coze_chat_event_t;
 
 /**
@@ -150,6 +265,61 @@ typedef struct {
     coze_ws_event_id_t event_id;      ///< 事件ID
 } coze_ws_event_t;
 
+/**
+ * @brief 服务器下行事件枚举
+ * 
+ * @details 与 event_type 一一对应，用于按事件注册处理函数（coze_chat_register_event_handler）
+ */
+typedef enum {
+    COZE_SERVER_EVENT_CHAT_CREATED = 0,               ///< chat.created
+    COZE_SERVER_EVENT_CHAT_UPDATED,                   ///< chat.updated
+    COZE_SERVER_EVENT_CONVERSATION_CHAT_CREATED,      ///< conversation.chat.created
+    COZE_SERVER_EVENT_CONVERSATION_CHAT_COMPLETED,    ///< conversation.chat.completed
+    COZE_SERVER_EVENT_CONVERSATION_CHAT_FAILED,       ///< conversation.chat.failed
+    COZE_SERVER_EVENT_CONVERSATION_CHAT_CANCELED,     ///< conversation.chat.canceled
+    COZE_SERVER_EVENT_MESSAGE_DELTA,                  ///< conversation.message.delta
+    COZE_SERVER_EVENT_MESSAGE_COMPLETED,              ///< conversation.message.completed
+    COZE_SERVER_EVENT_AUDIO_DELTA,                    ///< conversation.audio.delta
+    COZE_SERVER_EVENT_AUDIO_SENTENCE_START,           ///< conversation.audio.sentence_start
+    COZE_SERVER_EVENT_AUDIO_COMPLETED,                ///< conversation.audio.completed
+    COZE_SERVER_EVENT_TRANSCRIPT_UPDATE,              ///< conversation.audio_transcript.update
+    COZE_SERVER_EVENT_TRANSCRIPT_COMPLETED,           ///< conversation.audio_transcript.completed
+    COZE_SERVER_EVENT_CONVERSATION_CLEARED,           ///< conversation.cleared
+    COZE_SERVER_EVENT_SPEECH_STARTED,                 ///< input_audio_buffer.speech_started
+    COZE_SERVER_EVENT_SPEECH_STOPPED,                 ///< input_audio_buffer.speech_stopped
+    COZE_SERVER_EVENT_INPUT_AUDIO_COMPLETED,          ///< input_audio_buffer.completed
+    COZE_SERVER_EVENT_INPUT_AUDIO_CLEARED,            ///< input_audio_buffer.cleared
+    COZE_SERVER_EVENT_ERROR,                          ///< error
+    COZE_SERVER_EVENT_MAX,
+} coze_server_event_t;
+
+/**
+ * @brief 服务器下行事件内容
+ * 
+ * @details 字符串字段指向本条消息的解析结果，只在处理函数内有效；消息中没有的字段为 NULL。
+ *          conversation.audio.delta 由组件解码播放，通常不构建 JSON 树，只提供 event、原始消息与 chat_id/conversation_id；
+ *          已打断回复的迟到音频与回退后跳过的句子不通知。
+ */
+typedef struct {
+    coze_server_event_t event;      ///< 事件
+    const char *json;               ///< 原始消息（不保证 '\0' 结尾）
+    size_t json_len;                ///< 原始消息长度
+    const char *chat_id;            ///< 回复ID：data.chat_id（conversation.chat.* 为 data.id）
+    const char *conversation_id;    ///< 对话ID：data.conversation_id
+    const char *text;               ///< 文本：消息增量/完成的 content、识别的 content/transcript、字幕的 text、错误的 msg
+    int error_code;                 ///< 错误码：error 事件的 data.code（或 error.code），其他事件为 0
+} coze_server_event_info_t;
+
+/**
+ * @brief 服务器下行事件处理函数类型
+ * 
+ * @details 在JSON解析任务中、组件自身处理之后调用；不要在其中阻塞
+ * 
+ * @param info 事件内容
+ * @param ctx 注册时传入的用户上下文
+ */
+typedef void (*coze_server_event_handler_t)(const coze_server_event_info_t *info, void *ctx);
+
 /**
  * @brief Coze聊天句柄类型
  * 
@@ -168,6 +338,19 @@ typedef struct coze_chat_t *coze_chat_handle_t;
  */
 typedef void (*coze_audio_callback_t)(char *data, int len, void *ctx);
 
+/**
+ * @brief 下行PCM直写目标（播放缓冲区）
+ * 
+ * @details 设置后下行Opus直接解码进播放缓冲区：reserve 预留连续空间（空间不足时阻塞，
+ *          即按真实播放速度背压），解码器写入后 commit。此时不再调用 audio_callback。
+ */
+typedef struct {
+    size_t (*reserve)(int16_t **ptr, size_t samples, uint32_t timeout_ms, void *ctx); ///< 预留空间，返回可写的连续样本数，超时返回0
+    esp_err_t (*commit)(size_t samples, void *ctx);                                   ///< 提交已写入的样本
+    void (*clear)(void *ctx);                                                         ///< 丢弃未播放的PCM（打断时调用，可选）
+    void *ctx;                                                                        ///< 用户上下文
+} coze_pcm_sink_t;
+
 /**
  * @brief 事件回调函数类型
  * 
@@ -210,10 +393,11 @@ typedef struct {
     const char *user_id;            ///< 用户ID：标识当前用户
     const char *voice_id;           ///< 语音ID：指定TTS使用的语音类型
     const char *conversation_id;    ///< 会话ID：可选，用于恢复历史会话
+    const char *server_url;         ///< 服务器地址：NULL 使用 wss://ws.coze.cn/v1/chat；可指向本地模拟服务器（ws:// 不走TLS）
 
     // ========== 音频格式 ==========
     coze_chat_audio_type_t uplink_audio_type;    ///< 上行音频格式：发送到服务器的音频编码格式（PCM）
-    coze_chat_audio_type_t downlink_audio_type;  ///< 下行音频格式：从服务器接收的音频编码格式（Opus）
+    coze_chat_audio_type_t downlink_audio_type;  ///< 下行音频格式：默认Opus；PCM不经解码直接播放，带宽约为Opus的16倍，适合局域网/高速WiFi
     int input_sample_rate;          ///< 输入采样率：麦克风采集的音频采样率，支持16000Hz
     int input_channel;              ///< 输入声道数：音频声道数，默认1（单声道）
     int input_bit_depth;            ///< 输入位深：音频位深，默认16bit
@@ -222,15 +406,45 @@ typedef struct {
     // ========== Opus高级配置 ==========
     int opus_bitrate;               ///< Opus比特率：音频压缩比特率，默认16000bps
     float opus_frame_size_ms;       ///< Opus帧长：每帧音频的时长，默认60ms
-    bool opus_use_cbr;              ///< Opus是否使用CBR：固定比特率模式，默认false（使用VBR）
+    bool opus_use_cbr;              ///< Opus是否使用CBR：固定比特率模式，默认false（使用VBR），上下行均生效
+    int opus_complexity;            ///< 上行Opus编码复杂度：0~10，开启自适应时为初始值，默认3
+    bool opus_dtx;                  ///< 上行Opus DTX：静音段只发极短的DTX包，默认true
+    bool opus_fec;                  ///< 上行Opus带内FEC：默认false
+    bool opus_adaptive_complexity;  ///< 上行Opus复杂度自适应：按编码耗时与CPU预算调整，默认true
+    int opus_cpu_budget_pct;        ///< 上行Opus编码CPU预算：占帧时长的百分比，默认25
 
     // ========== PCM高级配置 ==========
-    float pcm_frame_size_ms;        ///< PCM帧长：每帧音频的时长，默认20ms
+    float pcm_frame_size_ms;        ///< PCM帧长：每帧音频的时长，默认20ms，不超过200ms
+    int pcm_server_sample_rate;     ///< PCM下行时向服务器请求的采样率：0 表示与 output_sample_rate 相同；不同时本地线性插值重采样到 output_sample_rate
+
+    // ========== 上行分包配置 ==========
+    int uplink_frame_ms;            ///< 上行帧长：20/40/60ms，默认20ms（opus/pcm_frame_size_ms 仅作用于下行）
+    int uplink_frames_per_message;  ///< 每条上行消息聚合帧数：默认1；增大可减少消息数和空口占用，代价是时延
+    int uplink_max_batch_ms;        ///< 聚合时延上限：本批首个采样到发送的最长等待，0为批时长+1帧
+    bool uplink_vad_gate;           ///< 上行静音门：只发送人声段，静音帧不编码不发送（需 coze_chat_set_voice_activity 输入VAD状态），默认true
+    int uplink_preroll_ms;          ///< 静音门预录：开门时补发之前这段音频，弥补VAD起点延迟，默认300ms
+    int uplink_hangover_ms;         ///< 静音门拖尾：人声结束后继续发送的时长，默认0（客户端打断模式下AFE的VAD结束已含min_silence_ms静音，VAD结束即提交）；
+                                    ///< 服务器VAD/语义VAD模式由服务器按静音判停，拖尾自动增大到服务器静音阈值+200ms，否则关门后服务器收不到足够静音，本轮不会结束
+    bool uplink_adaptive_rate;      ///< 上行码率自适应：发送变慢或积压时先逐档降Opus码率（32/24/16/12kbps），再增大每条消息时长，默认true
+    int uplink_min_bitrate;         ///< 自适应最低Opus码率，默认12000
+    int uplink_max_message_ms;      ///< 自适应每条消息最长时长，默认120ms
+    int ws_send_queue_len;          ///< WebSocket 音频发送队列深度（条），队列满时上行最多等待到音频截止时间，默认16
+    int ws_audio_max_age_ms;        ///< 音频消息最长排队时间：超过仍未发出则丢弃，0表示不过期，默认1000ms
+
+    // ========== 下行播放配置 ==========
+    int downlink_prebuffer_ms;      ///< 起播预缓冲：缓冲到该时长才开始播放，默认180ms；越小首包越快，越大越不易断续
+    int downlink_lead_ms;           ///< 解码领先播放的时长：不超过播放端PCM缓冲容量，默认120ms，0表示不节流
+    int downlink_early_ms;          ///< 早到阈值：包到达时缓冲已超过该时长计为早到，默认3000ms，0表示不统计
+    int downlink_plc_max_ms;        ///< 丢包隐藏上限：每处丢包最多补齐的时长，默认120ms，0表示不做隐藏
+    bool downlink_fec;              ///< 下行带内FEC：丢包后优先用下一包携带的冗余恢复，默认true
 
     // ========== TTS配置 ==========
     int speech_rate;                ///< 语速：-50~50，0为正常速度，负值变慢，正值变快
     coze_emotion_type_t emotion_type;     ///< 情感类型：TTS语音的情感表达，默认中性
     float emotion_scale;            ///< 情感值：1.0~5.0，默认4.0，值越高情感越强烈
+    coze_reply_mode_t reply_mode;   ///< 回复模式：服务器语音或文本+本地TTS，默认服务器语音（本地TTS要求输出16000Hz）
+    int tts_speed;                  ///< 本地TTS语速：0(最慢)~5(最快)，默认3，仅文本回复模式
+    bool tts_fallback_audio;        ///< 文本含本地TTS无法朗读的内容（英文、表情等）时本轮剩余部分改用服务器语音，默认true
 
     // ========== 工作模式 ==========
     coze_chat_mode_t mode;          ///< 聊天模式：按键模式或VAD模式
@@ -241,13 +455,14 @@ typedef struct {
 
     // ========== VAD配置 ==========
     coze_turn_detection_type_t turn_detection_type;  ///< 转检测类型：选择VAD检测策略
-    int vad_silence_duration_ms;    ///< VAD静音持续时间：检测到静音后持续多长时间才认为语音结束，默认500ms
+    int vad_silence_duration_ms;    ///< VAD静音持续时间：检测到静音后持续多长时间才认为语音结束，默认500ms（开启 uplink_vad_gate 时同时决定静音门最短拖尾）
     int vad_prefix_padding_ms;      ///< VAD前填充时间：在检测到语音开始前保留的音频时长，默认300ms
 
     // ========== 打断配置 ==========
     coze_interrupt_mode_t interrupt_mode;  ///< 打断模式：关键词匹配模式（contains或prefix）
     const char **interrupt_keywords; ///< 打断关键词数组：用于触发打断的关键词列表
     int interrupt_keyword_count;    ///< 打断关键词数量：关键词数组的长度
+    bool barge_in_enable;           ///< 本地打断：服务器VAD检测到用户说话时自动停止播放并取消回复，默认true
 
     // ========== 语义VAD配置 ==========
     int semantic_vad_silence_threshold_ms;    ///< 语义VAD静音阈值：语义VAD模式下，静音多长时间触发转检测，默认300ms
@@ -293,7 +508,8 @@ typedef struct {
     bool voice_print_reuse_info;       ///< 未命中时是否沿用历史声纹：是否在未匹配时使用历史声纹信息
 
     // ========== 回调函数 ==========
-    coze_audio_callback_t audio_callback;        ///< 音频数据回调：接收下行音频数据时调用
+    coze_audio_callback_t audio_callback;        ///< 音频数据回调：接收下行音频数据时调用（未设置 pcm_sink 时）
+    coze_pcm_sink_t pcm_sink;                    ///< 下行PCM直写目标：可选，设置后解码直接写入播放缓冲区
     coze_event_callback_t event_callback;         ///< 事件回调：发生聊天事件时调用
     coze_ws_event_callback_t ws_event_callback;   ///< WebSocket事件回调：发生WebSocket事件时调用
 
@@ -302,10 +518,18 @@ typedef struct {
     int push_task_stack_size;       ///< WebSocket发送任务栈大小：默认8192字节
     int pull_task_caps;             ///< 接收任务内存分配属性：0表示使用默认属性
     int push_task_caps;             ///< 发送任务内存分配属性：0表示使用默认属性
+    const xn_sched_profile_t *sched_profile; ///< 任务调度档案：核心/优先级/栈位置，NULL使用均衡预设
 
     // ========== 缓冲区配置 ==========
     int websocket_buffer_size;      ///< WebSocket缓冲区大小：默认8192字节
     int ring_buffer_size;           ///< 环形缓冲区大小：默认2MB，用于音频数据缓冲
+    int ws_rx_queue_size;           ///< 接收消息队列大小：默认256KB（PSRAM），单条消息最大约为其一半；小于约130KB时自动增大，保证64KB消息可接收
+    int ws_rx_block_ms;             ///< 接收队列满时WebSocket任务最长等待：默认200ms，0表示立即丢弃新消息
+
+    // ========== 连接管理 ==========
+    int reconnect_min_ms;           ///< 断线重连退避下限：默认500ms，每次失败翻倍（带随机抖动）
+    int reconnect_max_ms;           ///< 断线重连退避上限：默认30000ms
+    int idle_close_ms;              ///< 空闲断开：无对话与上行音频超过该时长关闭连接，唤醒时再预连接；默认0（常连）
 } coze_chat_config_t;
 
 /**
@@ -331,6 +555,7 @@ typedef struct {
         .user_id = NULL,                                    \
         .voice_id = NULL,                                   \
         .conversation_id = NULL,                            \
+        .server_url = NULL,                                 \
         /* ========== 音频格式配置 ========== */            \
         .uplink_audio_type = COZE_CHAT_AUDIO_TYPE_PCM,      \
         .downlink_audio_type = COZE_CHAT_AUDIO_TYPE_OPUS,   \
@@ -344,12 +569,39 @@ typedef struct {
         .opus_bitrate = 16000,                              \
         .opus_frame_size_ms = 60.0f,                        \
         .opus_use_cbr = false,                              \
+        .opus_complexity = 3,                               \
+        .opus_dtx = true,                                   \
+        .opus_fec = false,                                  \
+        .opus_adaptive_complexity = true,                   \
+        .opus_cpu_budget_pct = 25,                          \
         /* ========== PCM帧配置 ========== */               \
         .pcm_frame_size_ms = 20.0f,                         \
+        .pcm_server_sample_rate = 0,                        \
+        /* ========== 上行分包配置 ========== */            \
+        .uplink_frame_ms = 20,                              \
+        .uplink_frames_per_message = 1,                     \
+        .uplink_max_batch_ms = 0,                           \
+        .uplink_vad_gate = true,                            \
+        .uplink_preroll_ms = 300,                           \
+        .uplink_hangover_ms = 0,                            \
+        .uplink_adaptive_rate = true,                       \
+        .uplink_min_bitrate = 12000,                        \
+        .uplink_max_message_ms = 120,                       \
+        .ws_send_queue_len = 16,                            \
+        .ws_audio_max_age_ms = 1000,                        \
+        /* ========== 下行播放配置 ========== */            \
+        .downlink_prebuffer_ms = 180,                       \
+        .downlink_lead_ms = 120,                            \
+        .downlink_early_ms = 3000,                          \
+        .downlink_plc_max_ms = 120,                         \
+        .downlink_fec = true,                               \
         /* ========== TTS语音配置 ========== */             \
         .speech_rate = 0,                                   \
         .emotion_type = COZE_EMOTION_NEUTRAL,               \
         .emotion_scale = 4.0f,                              \
+        .reply_mode = COZE_REPLY_MODE_AUDIO,                \
+        .tts_speed = 3,                                     \
+        .tts_fallback_audio = true,                         \
         /* ========== 交互模式配置 ========== */            \
         .mode = COZE_CHAT_VAD_MODE,                         \
         /* ========== 字幕和历史配置 ========== */          \
@@ -366,6 +618,7 @@ typedef struct {
         .interrupt_mode = COZE_INTERRUPT_MODE_CONTAINS,     \
         .interrupt_keywords = NULL,                         \
         .interrupt_keyword_count = 0,                       \
+        .barge_in_enable = true,                            \
         /* ========== 语义VAD配置 ========== */             \
         .semantic_vad_silence_threshold_ms = 300,           \
         .semantic_vad_unfinished_wait_time_ms = 500,        \
@@ -408,6 +661,7 @@ typedef struct {
         .voice_print_reuse_info = false,                    \
         /* ========== 回调函数 ========== */                \
         .audio_callback = NULL,                             \
+        .pcm_sink = { NULL, NULL, NULL, NULL },                   \
         .event_callback = NULL,                             \
         .ws_event_callback = NULL,                          \
         /* ========== 任务栈配置 ========== */              \
@@ -415,9 +669,16 @@ typedef struct {
         .push_task_stack_size = 8192,                       \
         .pull_task_caps = 0,                                \
         .push_task_caps = 0,                                \
+        .sched_profile = NULL,                              \
         /* ========== 缓冲区配置 ========== */              \
         .websocket_buffer_size = 8192,                      \
         .ring_buffer_size = 2 * 1024 * 1024,                \
+        .ws_rx_queue_size = 256 * 1024,                     \
+        .ws_rx_block_ms = 200,                              \
+        /* ========== 连接管理 ========== */                \
+        .reconnect_min_ms = 500,                            \
+        .reconnect_max_ms = 30000,                          \
+        .idle_close_ms = 0,                                 \
     }
 
 /**
@@ -444,6 +705,7 @@ typedef struct {
         .user_id = NULL,                                    \
         .voice_id = NULL,                                   \
         .conversation_id = NULL,                            \
+        .server_url = NULL,                                 \
         /* ========== 音频格式配置 ========== */            \
         .uplink_audio_type = COZE_CHAT_AUDIO_TYPE_PCM,      \
         .downlink_audio_type = COZE_CHAT_AUDIO_TYPE_OPUS,   \
@@ -457,12 +719,39 @@ typedef struct {
         .opus_bitrate = 16000,                              \
         .opus_frame_size_ms = 60.0f,                        \
         .opus_use_cbr = false,                              \
+        .opus_complexity = 3,                               \
+        .opus_dtx = true,                                   \
+        .opus_fec = false,                                  \
+        .opus_adaptive_complexity = true,                   \
+        .opus_cpu_budget_pct = 25,                          \
         /* ========== PCM帧配置 ========== */               \
         .pcm_frame_size_ms = 20.0f,                         \
+        .pcm_server_sample_rate = 0,                        \
+        /* ========== 上行分包配置 ========== */            \
+        .uplink_frame_ms = 20,                              \
+        .uplink_frames_per_message = 1,                     \
+        .uplink_max_batch_ms = 0,                           \
+        .uplink_vad_gate = true,                            \
+        .uplink_preroll_ms = 300,                           \
+        .uplink_hangover_ms = 0,                            \
+        .uplink_adaptive_rate = true,                       \
+        .uplink_min_bitrate = 12000,                        \
+        .uplink_max_message_ms = 120,                       \
+        .ws_send_queue_len = 16,                            \
+        .ws_audio_max_age_ms = 1000,                        \
+        /* ========== 下行播放配置 ========== */            \
+        .downlink_prebuffer_ms = 180,                       \
+        .downlink_lead_ms = 120,                            \
+        .downlink_early_ms = 3000,                          \
+        .downlink_plc_max_ms = 120,                         \
+        .downlink_fec = true,                               \
         /* ========== TTS语音配置 ========== */             \
         .speech_rate = 0,                                   \
         .emotion_type = COZE_EMOTION_NEUTRAL,               \
         .emotion_scale = 4.0f,                              \
+        .reply_mode = COZE_REPLY_MODE_AUDIO,                \
+        .tts_speed = 3,                                     \
+        .tts_fallback_audio = true,                         \
         /* ========== 交互模式配置 ========== */            \
         .mode = COZE_CHAT_VAD_MODE,                         \
         /* ========== 字幕和历史配置 ========== */          \
@@ -479,6 +768,7 @@ typedef struct {
         .interrupt_mode = COZE_INTERRUPT_MODE_CONTAINS,     \
         .interrupt_keywords = NULL,                         \
         .interrupt_keyword_count = 0,                       \
+        .barge_in_enable = true,                            \
         /* ========== 语义VAD配置 ========== */             \
         .semantic_vad_silence_threshold_ms = 300,           \
         .semantic_vad_unfinished_wait_time_ms = 500,        \
@@ -521,6 +811,7 @@ typedef struct {
         .voice_print_reuse_info = false,                    \
         /* ========== 回调函数 ========== */                \
         .audio_callback = NULL,                             \
+        .pcm_sink = { NULL, NULL, NULL, NULL },                   \
         .event_callback = NULL,                             \
         .ws_event_callback = NULL,                          \
         /* ========== 任务栈配置 ========== */              \
@@ -528,9 +819,16 @@ typedef struct {
         .push_task_stack_size = 8192,                       \
         .pull_task_caps = 0,                                \
         .push_task_caps = 0,                                \
+        .sched_profile = NULL,                              \
         /* ========== 缓冲区配置 ========== */              \
         .websocket_buffer_size = 8192,                      \
         .ring_buffer_size = 2 * 1024 * 1024,                \
+        .ws_rx_queue_size = 256 * 1024,                     \
+        .ws_rx_block_ms = 200,                              \
+        /* ========== 连接管理 ========== */                \
+        .reconnect_min_ms = 500,                            \
+        .reconnect_max_ms = 30000,                          \
+        .idle_close_ms = 0,                                 \
     }
 
 // 默认配置（WiFi模式）
@@ -603,10 +901,26 @@ esp_err_t coze_chat_deinit(coze_chat_handle_t handle);
  */
 esp_err_t coze_chat_send_audio_data(coze_chat_handle_t handle, char *data, int len);
 
+/**
+ * @brief 输入人声状态（驱动上行静音门）
+ *
+ * @details 在 AFE 的 VAD 开始/结束事件中调用（按键模式在按下/松开时调用）；
+ *          开启 uplink_vad_gate 时，无人声且拖尾结束后的音频不再发送，
+ *          人声开始时先补发 uplink_preroll_ms 的预录音频
+ *
+ * @param handle Coze聊天句柄
+ * @param speech true 人声开始，false 人声结束
+ * @return esp_err_t
+ *         - ESP_OK: 成功
+ *         - ESP_ERR_INVALID_ARG: 参数无效（handle为NULL）
+ */
+esp_err_t coze_chat_set_voice_activity(coze_chat_handle_t handle, bool speech);
+
 /**
  * @brief 发送音频完成信号（NORMAL_MODE必须）
  *
- * @details 在NORMAL_MODE模式下，用户必须调用此函数通知服务器音频发送完成
+ * @details 在NORMAL_MODE模式下，用户必须调用此函数通知服务器音频发送完成；
+ *          服务器VAD与语义VAD由服务器判断说话结束，此时直接返回 ESP_OK 不发送
  *
  * @param handle Coze聊天句柄
  * @return esp_err_t
@@ -627,6 +941,122 @@ esp_err_t coze_chat_send_audio_complete(coze_chat_handle_t handle);
  */
 esp_err_t coze_chat_send_audio_cancel(coze_chat_handle_t handle);
 
+/**
+ * @brief 打断当前回复（barge-in）
+ *
+ * @details 用户在机器人说话时开口（本地VAD开始或唤醒词）时调用：
+ *          立即丢弃待播的Opus包和播放缓冲区中的PCM，发送 conversation.chat.cancel，
+ *          此后属于被取消对话的 conversation.audio.delta 一律丢弃。
+ *          从触发到播放缓冲区清空、到取消消息发出的耗时分别记录（见 coze_chat_get_barge_in_stats）并打印。
+ *
+ * @param handle Coze聊天句柄
+ * @param trigger_us 触发时刻（esp_timer_get_time），0 表示当前时刻
+ * @return esp_err_t
+ *         - ESP_OK: 已打断
+ *         - ESP_ERR_INVALID_ARG: 参数无效（handle为NULL）
+ *         - ESP_ERR_INVALID_STATE: 当前没有正在进行的回复，无需打断
+ *         - ESP_FAIL: 本地已停止播放，但取消消息发送失败
+ */
+esp_err_t coze_chat_interrupt(coze_chat_handle_t handle, int64_t trigger_us);
+
+/**
+ * @brief 预连接（唤醒词/按键时调用）
+ *
+ * @details 连接已断开（空闲断开或正在退避等待重连）时立即建连，跳过剩余退避时间；
+ *          已连接时只刷新空闲计时。会话就绪时打印从触发到就绪的耗时。
+ *          重连沿用之前的 conversation_id，服务器端对话上下文不丢失。
+ *
+ * @param handle Coze聊天句柄
+ * @param trigger_us 触发时刻（esp_timer_get_time），0 表示当前时刻
+ * @return esp_err_t
+ *         - ESP_OK: 已在线或已开始建连
+ *         - ESP_ERR_INVALID_ARG: 参数无效（handle为NULL）
+ *         - ESP_ERR_INVALID_STATE: 未调用 coze_chat_start 或已停止
+ *         - ESP_FAIL: 建连启动失败（已安排退避重连）
+ */
+esp_err_t coze_chat_prewarm(coze_chat_handle_t handle, int64_t trigger_us);
+
+/**
+ * @brief 获取连接统计
+ *
+ * @param handle Coze聊天句柄
+ * @param stats 输出统计
+ * @return esp_err_t
+ *         - ESP_OK: 成功
+ *         - ESP_ERR_INVALID_ARG: 参数无效
+ */
+esp_err_t coze_chat_get_conn_stats(coze_chat_handle_t handle, coze_conn_stats_t *stats);
+
+/**
+ * @brief 获取上行统计
+ *
+ * @details 包含发送耗时、积压、码率自适应档位和静音门节省量；可用于观察弱网下的降档行为
+ *
+ * @param handle Coze聊天句柄
+ * @param stats 输出统计
+ * @return esp_err_t
+ *         - ESP_OK: 成功
+ *         - ESP_ERR_INVALID_ARG: 参数无效
+ */
+esp_err_t coze_chat_get_uplink_stats(coze_chat_handle_t handle, coze_uplink_stats_t *stats);
+
+/**
+ * @brief 获取下行统计
+ *
+ * @details 包含接收队列丢弃、下行丢包补偿与播放欠载；可用于压测时核对丢弃位置
+ *
+ * @param handle Coze聊天句柄
+ * @param stats 输出统计
+ * @return esp_err_t
+ *         - ESP_OK: 成功
+ *         - ESP_ERR_INVALID_ARG: 参数无效
+ */
+esp_err_t coze_chat_get_downlink_stats(coze_chat_handle_t handle, coze_downlink_stats_t *stats);
+
+/**
+ * @brief 获取打断统计
+ *
+ * @details 分阶段记录触发到本地静音、到取消消息发出、到服务器确认的耗时，用于定位打断延迟
+ *
+ * @param handle Coze聊天句柄
+ * @param stats 输出统计
+ * @return esp_err_t
+ *         - ESP_OK: 成功
+ *         - ESP_ERR_INVALID_ARG: 参数无效
+ */
+esp_err_t coze_chat_get_barge_in_stats(coze_chat_handle_t handle, coze_barge_in_stats_t *stats);
+
+/**
+ * @brief 获取最近一轮回复的统计
+ *
+ * @details 每轮结束时更新，同时打印到日志；可用于对比服务器语音与文本+本地TTS两种模式的下行流量
+ *
+ * @param handle Coze聊天句柄
+ * @param stats 输出统计
+ * @return esp_err_t
+ *         - ESP_OK: 成功
+ *         - ESP_ERR_INVALID_ARG: 参数无效
+ *         - ESP_ERR_NOT_FOUND: 尚无已结束的回复
+ */
+esp_err_t coze_chat_get_turn_stats(coze_chat_handle_t handle, coze_turn_stats_t *stats);
+
+/**
+ * @brief 注册服务器下行事件处理函数
+ *
+ * @details 每个事件一个处理函数，重复注册覆盖之前的，handler 为 NULL 时注销。
+ *          与 event_callback 并存：event_callback 只有粗粒度事件，处理函数可拿到回复ID、识别文本、错误详情等。
+ *
+ * @param handle Coze聊天句柄
+ * @param event 事件
+ * @param handler 处理函数
+ * @param ctx 用户上下文
+ * @return esp_err_t
+ *         - ESP_OK: 成功
+ *         - ESP_ERR_INVALID_ARG: 参数无效
+ */
+esp_err_t coze_chat_register_event_handler(coze_chat_handle_t handle, coze_server_event_t event,
+                                           coze_server_event_handler_t handler, void *ctx);
+
 /**
  * @brief 获取ML307 modem句柄（用于OTA等其他功能）
  *
@@ -0,0 +1,128 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\components\xn_coze_chat\coze_event_table.h
+ * @Description: Coze 下行事件表 - event_type 字符串到 coze_server_event_t 的编译期映射
+ *
+ * 表按 event_type 的字节序排好，编译期检查有序、无重复、覆盖全部事件；
+ * 查找为二分（19 项最多 5 次比较），直接作用于接收缓冲区中的字符串片段，无堆分配。
+ */
+
+#pragma once
+
+#include "coze_chat.h"
+#include <stddef.h>
+#include <string_view>
+
+/**
+ * @brief 事件表项
+ */
+struct coze_event_entry_t {
+    std::string_view name;      ///< event_type
+    coze_server_event_t event;  ///< 事件
+    bool quiet;                 ///< 高频事件，不打印事件类型日志
+};
+
+/**
+ * @brief 事件表（按 name 字节序排列）
+ */
+inline constexpr coze_event_entry_t COZE_EVENT_TABLE[] = {
+    { "chat.created",                             COZE_SERVER_EVENT_CHAT_CREATED,                false },
+    { "chat.updated",                             COZE_SERVER_EVENT_CHAT_UPDATED,                false },
+    { "conversation.audio.completed",             COZE_SERVER_EVENT_AUDIO_COMPLETED,             false },
+    { "conversation.audio.delta",                 COZE_SERVER_EVENT_AUDIO_DELTA,                 true  },
+    { "conversation.audio.sentence_start",        COZE_SERVER_EVENT_AUDIO_SENTENCE_START,        false },
+    { "conversation.audio_transcript.completed",  COZE_SERVER_EVENT_TRANSCRIPT_COMPLETED,        false },
+    { "conversation.audio_transcript.update",     COZE_SERVER_EVENT_TRANSCRIPT_UPDATE,           true  },
+    { "conversation.chat.canceled",               COZE_SERVER_EVENT_CONVERSATION_CHAT_CANCELED,  false },
+    { "conversation.chat.completed",              COZE_SERVER_EVENT_CONVERSATION_CHAT_COMPLETED, false },
+    { "conversation.chat.created",                COZE_SERVER_EVENT_CONVERSATION_CHAT_CREATED,   false },
+    { "conversation.chat.failed",                 COZE_SERVER_EVENT_CONVERSATION_CHAT_FAILED,    false },
+    { "conversation.cleared",                     COZE_SERVER_EVENT_CONVERSATION_CLEARED,        false },
+    { "conversation.message.completed",           COZE_SERVER_EVENT_MESSAGE_COMPLETED,           false },
+    { "conversation.message.delta",               COZE_SERVER_EVENT_MESSAGE_DELTA,               true  },
+    { "error",                                    COZE_SERVER_EVENT_ERROR,                       false },
+    { "input_audio_buffer.cleared",               COZE_SERVER_EVENT_INPUT_AUDIO_CLEARED,         false },
+    { "input_audio_buffer.completed",             COZE_SERVER_EVENT_INPUT_AUDIO_COMPLETED,       false },
+    { "input_audio_buffer.speech_started",        COZE_SERVER_EVENT_SPEECH_STARTED,              false },
+    { "input_audio_buffer.speech_stopped",        COZE_SERVER_EVENT_SPEECH_STOPPED,              false },
+};
+
+inline constexpr size_t COZE_EVENT_COUNT = sizeof(COZE_EVENT_TABLE) / sizeof(COZE_EVENT_TABLE[0]);
+
+namespace coze_event_detail {
+
+constexpr bool table_sorted()
+{
+    for (size_t i = 1; i < COZE_EVENT_COUNT; i++) {
+        if (!(COZE_EVENT_TABLE[i - 1].name < COZE_EVENT_TABLE[i].name)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool table_covers_all()
+{
+    for (int e = 0; e < COZE_SERVER_EVENT_MAX; e++) {
+        int found = 0;
+        for (size_t i = 0; i < COZE_EVENT_COUNT; i++) {
+            found += (COZE_EVENT_TABLE[i].event == e);
+        }
+        if (found != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace coze_event_detail
+
+static_assert(coze_event_detail::table_sorted(), "COZE_EVENT_TABLE 必须按 event_type 字节序排列且无重复");
+static_assert(COZE_EVENT_COUNT == COZE_SERVER_EVENT_MAX, "COZE_EVENT_TABLE 与 coze_server_event_t 数量不一致");
+static_assert(coze_event_detail::table_covers_all(), "每个 coze_server_event_t 必须在 COZE_EVENT_TABLE 中恰好出现一次");
+
+/**
+ * @brief 按 event_type 查找事件表项
+ *
+ * @param name event_type（无需 '\0' 结尾）
+ * @return 表项，未知事件返回 nullptr
+ */
+constexpr const coze_event_entry_t *coze_event_lookup(std::string_view name)
+{
+    size_t lo = 0;
+    size_t hi = COZE_EVENT_COUNT;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        int cmp = COZE_EVENT_TABLE[mid].name.compare(name);
+        if (cmp == 0) {
+            return &COZE_EVENT_TABLE[mid];
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 事件对应的 event_type 字符串
+ *
+ * @return event_type，无效事件返回空串
+ */
+constexpr std::string_view coze_event_name(coze_server_event_t event)
+{
+    for (size_t i = 0; i < COZE_EVENT_COUNT; i++) {
+        if (COZE_EVENT_TABLE[i].event == event) {
+            return COZE_EVENT_TABLE[i].name;
+        }
+    }
+    return {};
+}
+
+static_assert(coze_event_lookup("conversation.audio.delta")->event == COZE_SERVER_EVENT_AUDIO_DELTA);
+static_assert(coze_event_lookup("conversation.audio") == nullptr);
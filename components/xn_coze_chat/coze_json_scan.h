@@ -0,0 +1,97 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\components\xn_coze_chat\coze_json_scan.h
+ * @Description: 原始 JSON 缓冲区字段扫描 - 高频消息（音频增量）快速路径使用，不构建 cJSON
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * @brief 在原始JSON缓冲区中查找字符串字段（不分配内存、不构建DOM）
+ * 
+ * 按 "key" : "value" 形式扫描，返回值在缓冲区中的起止位置（不含引号，未反转义）。
+ * 只用于结构固定的高频消息，键名不区分嵌套层级，取第一个匹配。
+ * 
+ * @param json JSON缓冲区（无需 '\0' 结尾）
+ * @param len 缓冲区长度
+ * @param key 字段名
+ * @param value 输出：值起始地址
+ * @param value_len 输出：值长度
+ * @return true 找到字符串类型的字段
+ */
+inline bool json_scan_string(const char *json, size_t len, const char *key,
+                             const char **value, size_t *value_len)
+{
+    const size_t key_len = strlen(key);
+    const char *end = json + len;
+    const char *p = json;
+
+    while (p < end) {
+        p = (const char *)memchr(p, '"', end - p);
+        if (!p || (size_t)(end - p) < key_len + 2) {
+            return false;
+        }
+        // 跳过字符串内部的转义引号
+        if (p > json && p[-1] == '\\') {
+            p++;
+            continue;
+        }
+        if (memcmp(p + 1, key, key_len) != 0 || p[key_len + 1] != '"') {
+            p++;
+            continue;
+        }
+
+        const char *v = p + key_len + 2;
+        while (v < end && (*v == ' ' || *v == '\t' || *v == '\r' || *v == '\n')) v++;
+        if (v >= end || *v != ':') {
+            p++;
+            continue;
+        }
+        v++;
+        while (v < end && (*v == ' ' || *v == '\t' || *v == '\r' || *v == '\n')) v++;
+        if (v >= end || *v != '"') {
+            return false;  // 值不是字符串
+        }
+
+        const char *start = ++v;
+        while (v < end && *v != '"') {
+            v += (*v == '\\') ? 2 : 1;
+        }
+        if (v >= end) {
+            return false;
+        }
+        *value = start;
+        *value_len = v - start;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 查找字符串字段并复制为 '\0' 结尾的字符串（调用方提供缓冲区，不分配内存）
+ * 
+ * @param json JSON缓冲区（无需 '\0' 结尾）
+ * @param len 缓冲区长度
+ * @param key 字段名
+ * @param buf 输出缓冲区
+ * @param size 输出缓冲区大小
+ * @return const char* 成功返回 buf；字段不存在、含转义字符或放不下时返回 NULL
+ */
+inline const char *json_scan_copy(const char *json, size_t len, const char *key, char *buf, size_t size)
+{
+    const char *value = NULL;
+    size_t value_len = 0;
+    if (!json_scan_string(json, len, key, &value, &value_len) ||
+        value_len >= size || memchr(value, '\\', value_len)) {
+        return NULL;
+    }
+    memcpy(buf, value, value_len);
+    buf[value_len] = '\0';
+    return buf;
+}
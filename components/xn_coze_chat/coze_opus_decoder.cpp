@@ -16,8 +16,6 @@ static const char *TAG = "OPUS_DECODER";
  */
 CozeOpusDecoder::CozeOpusDecoder(int sample_rate, int channels)
     : decoder_(nullptr)
-    , pcm_buffer_(nullptr)
-    , pcm_buffer_size_(0)
     , sample_rate_(sample_rate)
     , channels_(channels)
 {
@@ -36,16 +34,6 @@ CozeOpusDecoder::CozeOpusDecoder(int sample_rate, int channels)
         return;
     }
     
-    // 分配PCM缓冲区 (60ms @ 48kHz * 2 channels = 5760 samples)
-    pcm_buffer_size_ = 5760 * channels;
-    pcm_buffer_ = (int16_t *)malloc(pcm_buffer_size_ * sizeof(int16_t));
-    if (!pcm_buffer_) {
-        ESP_LOGE(TAG, "分配PCM缓冲区失败");
-        esp_opus_dec_close(decoder_);
-        decoder_ = nullptr;
-        return;
-    }
-    
     ESP_LOGI(TAG, "✅ Opus解码器初始化成功 (采样率: %dHz, 声道: %d)", sample_rate, channels);
 }
 
@@ -59,11 +47,6 @@ CozeOpusDecoder::~CozeOpusDecoder()
         decoder_ = nullptr;
     }
     
-    if (pcm_buffer_) {
-        free(pcm_buffer_);
-        pcm_buffer_ = nullptr;
-    }
-    
     ESP_LOGI(TAG, "Opus解码器已销毁");
 }
 
@@ -73,26 +56,63 @@ CozeOpusDecoder::~CozeOpusDecoder()
 esp_err_t CozeOpusDecoder::Decode(const uint8_t *opus_data, size_t opus_len,
                                   int16_t *pcm_out, size_t max_samples,
                                   size_t *decoded_samples)
+{
+    if (!opus_data || opus_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    return DecodeRaw(opus_data, opus_len, false, pcm_out, max_samples, decoded_samples);
+}
+
+/**
+ * @brief 丢包隐藏：不提供数据，由解码器按上一帧外推
+ */
+esp_err_t CozeOpusDecoder::Conceal(int16_t *pcm_out, size_t max_samples, size_t *decoded_samples)
+{
+    return DecodeRaw(NULL, 0, true, pcm_out, max_samples, decoded_samples);
+}
+
+/**
+ * @brief 带内FEC恢复：以恢复模式解码下一包，取出其中携带的前一帧冗余
+ */
+esp_err_t CozeOpusDecoder::DecodeFec(const uint8_t *next_data, size_t next_len,
+                                     int16_t *pcm_out, size_t max_samples,
+                                     size_t *decoded_samples)
+{
+    if (!next_data || next_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    return DecodeRaw(next_data, next_len, true, pcm_out, max_samples, decoded_samples);
+}
+
+/**
+ * @brief 调用底层解码，直接输出到调用方缓冲区（无中间缓冲、无复制）
+ */
+esp_err_t CozeOpusDecoder::DecodeRaw(const uint8_t *data, size_t len, bool recover,
+                                     int16_t *pcm_out, size_t max_samples,
+                                     size_t *decoded_samples)
 {
     if (!decoder_) {
         ESP_LOGE(TAG, "Opus解码器未初始化");
         return ESP_ERR_INVALID_STATE;
     }
     
-    if (!opus_data || opus_len == 0 || !pcm_out || max_samples == 0 || !decoded_samples) {
+    if (!pcm_out || max_samples == 0 || !decoded_samples) {
         return ESP_ERR_INVALID_ARG;
     }
     
     // 准备输入数据
     esp_audio_dec_in_raw_t raw_data = {};
-    raw_data.buffer = (uint8_t *)opus_data;
-    raw_data.len = (int)opus_len;
+    raw_data.buffer = (uint8_t *)data;
+    raw_data.len = (int)len;
     raw_data.consumed = 0;
+    raw_data.frame_recover = recover ? ESP_AUDIO_DEC_RECOVERY_PLC : ESP_AUDIO_DEC_RECOVERY_NONE;
     
-    // 准备输出缓冲区
+    // 输出缓冲区即调用方缓冲区（可能是播放缓冲区中的预留区域）
     esp_audio_dec_out_frame_t frame_data = {};
-    frame_data.buffer = (uint8_t *)pcm_buffer_;
-    frame_data.len = (int)(pcm_buffer_size_ * sizeof(int16_t));
+    frame_data.buffer = (uint8_t *)pcm_out;
+    frame_data.len = (int)(max_samples * sizeof(int16_t));
     frame_data.needed_size = 0;
     
     // 解码信息
@@ -100,29 +120,23 @@ esp_err_t CozeOpusDecoder::Decode(const uint8_t *opus_data, size_t opus_len,
     
     // 调用解码
     esp_audio_err_t ret = esp_opus_dec_decode(decoder_, &raw_data, &frame_data, &dec_info);
+    *decoded_samples = 0;
     
+    if (ret == ESP_AUDIO_ERR_BUFF_NOT_ENOUGH) {
+        // 整帧放不下：不截断（截断会丢掉帧尾且让时长统计失真），由调用方按需要的大小重新分配
+        ESP_LOGW(TAG, "输出缓冲区不足: 需要 %d 样本, 只有 %d 样本",
+                 (int)(frame_data.needed_size / sizeof(int16_t)), (int)max_samples);
+        return ESP_ERR_INVALID_SIZE;
+    }
     if (ret != ESP_AUDIO_ERR_OK) {
-        ESP_LOGW(TAG, "Opus解码失败: %d", ret);
-        *decoded_samples = 0;
+        ESP_LOGW(TAG, "Opus%s失败: %d", recover ? "丢包恢复" : "解码", ret);
         return ESP_FAIL;
     }
     
-    // 计算实际解码的样本数
-    size_t total_samples = frame_data.len / sizeof(int16_t);
-    
-    // 复制到输出缓冲区
-    if (total_samples > max_samples) {
-        // ⚠️ 屏蔽高频日志：每个音频包都打印会导致UART溢出
-        // ESP_LOGW(TAG, "输出缓冲区太小: 需要%d样本, 只有%d样本", (int)total_samples, (int)max_samples);
-        total_samples = max_samples;
-    }
-    
-    memcpy(pcm_out, pcm_buffer_, total_samples * sizeof(int16_t));
-    *decoded_samples = total_samples;
+    *decoded_samples = frame_data.decoded_size / sizeof(int16_t);
     
     // ⚠️ 屏蔽高频日志
-    // ESP_LOGI(TAG, "Opus解码成功: %d字节 → %d样本", (int)opus_len, (int)*decoded_samples);
+    // ESP_LOGI(TAG, "Opus解码成功: %d字节 → %d样本", (int)len, (int)*decoded_samples);
     
     return ESP_OK;
 }
-
@@ -33,14 +33,37 @@ public:
      * @param opus_data Opus编码数据
      * @param opus_len Opus数据长度
      * @param pcm_out PCM输出缓冲区
-     * @param max_samples 最大样本数
+     * @param max_samples 最大样本数（需容纳一整帧）
      * @param decoded_samples 实际解码样本数
-     * @return esp_err_t
+     * @return esp_err_t ESP_ERR_INVALID_SIZE 表示输出缓冲区放不下整帧
      */
     esp_err_t Decode(const uint8_t *opus_data, size_t opus_len,
                      int16_t *pcm_out, size_t max_samples,
                      size_t *decoded_samples);
 
+    /**
+     * @brief 丢包隐藏（PLC）：为丢失的一帧生成替代音频
+     * @param pcm_out PCM输出缓冲区
+     * @param max_samples 最大样本数
+     * @param decoded_samples 实际生成样本数
+     * @return esp_err_t
+     */
+    esp_err_t Conceal(int16_t *pcm_out, size_t max_samples, size_t *decoded_samples);
+
+    /**
+     * @brief 用下一包携带的带内FEC恢复丢失的前一帧（下一包无FEC时退化为PLC）
+     * @param next_data 丢失帧之后的Opus包
+     * @param next_len 数据长度
+     * @param pcm_out PCM输出缓冲区
+     * @param max_samples 最大样本数
+     * @param decoded_samples 实际恢复样本数
+     * @return esp_err_t
+     * @note 之后仍需用 Decode() 正常解码 next_data 本身
+     */
+    esp_err_t DecodeFec(const uint8_t *next_data, size_t next_len,
+                        int16_t *pcm_out, size_t max_samples,
+                        size_t *decoded_samples);
+
     /**
      * @brief 检查解码器是否就绪
      * @return bool
@@ -60,9 +83,14 @@ public:
     int GetChannels() const { return channels_; }
 
 private:
+    /**
+     * @brief 调用底层解码（recover 为 true 时做丢包恢复，data 为 NULL 即 PLC）
+     */
+    esp_err_t DecodeRaw(const uint8_t *data, size_t len, bool recover,
+                        int16_t *pcm_out, size_t max_samples,
+                        size_t *decoded_samples);
+
     void *decoder_;          ///< Opus解码器句柄
-    int16_t *pcm_buffer_;    ///< PCM缓冲区
-    size_t pcm_buffer_size_; ///< PCM缓冲区大小
     int sample_rate_;        ///< 采样率
     int channels_;           ///< 声道数
 };
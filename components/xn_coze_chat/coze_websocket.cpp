@@ -8,13 +8,33 @@
 
 #include "coze_websocket.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_transport_ssl.h"
+#include "sdkconfig.h"
 #include <cstring>
 
 static const char *TAG = "COZE_WS";
 
+#define COZE_WS_CLOSE_TIMEOUT_MS    1000    // 主动断开时等待关闭握手的上限
+#define COZE_WS_SEND_TIMEOUT_MS     3000    // 发送任务单条消息写入超时
+#define COZE_WS_CONTROL_DEPTH       8       // 控制队列深度
+#define COZE_WS_CONTROL_WAIT_MS     100     // 控制队列满时调用方最多等待
+#define COZE_WS_DATA_DEPTH          16      // 音频/有序队列默认深度
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+#define COZE_WS_SESSION_TICKETS     1       // 复用 TLS 会话票据
+#else
+#define COZE_WS_SESSION_TICKETS     0
+#endif
+
 CozeWebSocket::CozeWebSocket()
-    : client_(nullptr)
+    : client_(nullptr), ssl_(nullptr), connect_start_us_(0), last_connect_ms_(0),
+      task_priority_(0), task_stack_size_(0), rx_buf_(nullptr), rx_len_(0),
+      control_q_(nullptr), data_q_(nullptr), send_task_{}, data_depth_(COZE_WS_DATA_DEPTH),
+      send_running_(false)
 {
+    send_sched_ = *xn_sched_get(NULL, XN_TASK_WS_SEND);
 }
 
 CozeWebSocket::~CozeWebSocket()
@@ -27,27 +47,78 @@ void CozeWebSocket::SetHeader(const char* key, const char* value)
     headers_[key] = value;
 }
 
+void CozeWebSocket::SetTaskConfig(int priority, int stack_size)
+{
+    task_priority_ = priority;
+    task_stack_size_ = stack_size;
+}
+
+void CozeWebSocket::SetSendQueue(const xn_task_sched_t *sched, size_t data_depth)
+{
+    if (sched) {
+        send_sched_ = *sched;
+    }
+    if (data_depth > 0) {
+        data_depth_ = data_depth;
+    }
+}
+
 bool CozeWebSocket::Connect(const std::string& url)
 {
-    if (client_) {
-        ESP_LOGW(TAG, "WebSocket已连接，先关闭旧连接");
+    if (client_ && url != url_) {
+        ESP_LOGW(TAG, "服务器地址变化，销毁旧客户端");
         Close();
     }
     
+    // 复用已有客户端：TLS 传输与会话票据保留，只重新建连
+    if (client_) {
+        if (esp_websocket_client_is_connected(client_)) {
+            return true;
+        }
+        connect_start_us_ = esp_timer_get_time();
+        esp_err_t ret = esp_websocket_client_start(client_);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "WebSocket重连启动失败: %s", esp_err_to_name(ret));
+            return false;
+        }
+        ESP_LOGI(TAG, "WebSocket重连中（复用TLS会话）");
+        return true;
+    }
+    
+    url_ = url;
+    
     // 配置WebSocket客户端（参考ESP-IDF官方文档）
     esp_websocket_client_config_t ws_cfg = {};
-    ws_cfg.uri = url.c_str();
+    ws_cfg.uri = url_.c_str();
     
     // 缓冲区配置
     ws_cfg.buffer_size = 16384;                     // 接收缓冲区16KB
     
+    // 客户端任务配置（0 表示使用组件默认值）
+    if (task_priority_ > 0) {
+        ws_cfg.task_prio = task_priority_;
+    }
+    if (task_stack_size_ > 0) {
+        ws_cfg.task_stack = task_stack_size_;
+    }
+    
     // WebSocket心跳配置（官方推荐）
     ws_cfg.ping_interval_sec = 10;                  // 每10秒发送Ping（防止服务器超时断开）
     ws_cfg.disable_pingpong_discon = false;         // Ping超时后自动断开重连
     
     // 网络超时配置
     ws_cfg.network_timeout_ms = 10000;              // 网络操作超时10秒
-    ws_cfg.reconnect_timeout_ms = 10000;            // 重连间隔10秒
+    ws_cfg.disable_auto_reconnect = true;           // 断线后由上层按退避策略重连
+    
+    // 外部 TLS 传输：客户端存续期间每次建连都复用同一传输，带上次的会话票据
+    // （ws:// 明文地址仅用于本地模拟服务器，由客户端自建 TCP 传输）
+    ssl_ = url_.compare(0, 6, "wss://") == 0 ? esp_transport_ssl_init() : nullptr;
+    if (ssl_) {
+#if COZE_WS_SESSION_TICKETS
+        esp_transport_ssl_session_tickets_enable(ssl_);
+#endif
+        ws_cfg.ext_transport = ssl_;
+    }
     
     // TCP KeepAlive配置（底层TCP连接保活）
     ws_cfg.keep_alive_enable = true;                // 启用TCP KeepAlive
@@ -62,6 +133,13 @@ bool CozeWebSocket::Connect(const std::string& url)
         return false;
     }
     
+    if (!StartSender()) {
+        esp_websocket_client_destroy(client_);
+        client_ = nullptr;
+        ssl_ = nullptr;
+        return false;
+    }
+    
     // 注册事件处理器
     esp_websocket_register_events(client_, WEBSOCKET_EVENT_ANY, 
                                   websocket_event_handler, this);
@@ -72,44 +150,265 @@ bool CozeWebSocket::Connect(const std::string& url)
     }
     
     // 启动连接
+    connect_start_us_ = esp_timer_get_time();
     esp_err_t ret = esp_websocket_client_start(client_);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "WebSocket启动失败: %s", esp_err_to_name(ret));
+        StopSender();
         esp_websocket_client_destroy(client_);
         client_ = nullptr;
+        ssl_ = nullptr;
         return false;
     }
     
-    ESP_LOGI(TAG, "WebSocket连接成功 (Ping=%ds, KeepAlive=%d/%d/%d)", 
+    ESP_LOGI(TAG, "WebSocket连接成功 (Ping=%ds, KeepAlive=%d/%d/%d, 会话票据%s)", 
              ws_cfg.ping_interval_sec, ws_cfg.keep_alive_idle, 
-             ws_cfg.keep_alive_interval, ws_cfg.keep_alive_count);
+             ws_cfg.keep_alive_interval, ws_cfg.keep_alive_count,
+             COZE_WS_SESSION_TICKETS ? "开启" : "关闭");
     return true;
 }
 
 bool CozeWebSocket::Send(const std::string& message)
 {
-    if (!client_ || !esp_websocket_client_is_connected(client_)) {
+    return Send(message.c_str(), message.length());
+}
+
+bool CozeWebSocket::Send(const char *data, size_t len)
+{
+    return Enqueue(control_q_, data, len, 0, COZE_WS_CONTROL_WAIT_MS);
+}
+
+bool CozeWebSocket::SendOrdered(const std::string& message)
+{
+    return Enqueue(data_q_, message.c_str(), message.length(), 0, COZE_WS_CONTROL_WAIT_MS);
+}
+
+bool CozeWebSocket::SendAudio(const char *data, size_t len, uint32_t max_age_ms)
+{
+    int64_t deadline_us = max_age_ms > 0 ? esp_timer_get_time() + (int64_t)max_age_ms * 1000 : 0;
+    return Enqueue(data_q_, data, len, deadline_us, max_age_ms > 0 ? max_age_ms : COZE_WS_CONTROL_WAIT_MS);
+}
+
+void CozeWebSocket::DropAudio()
+{
+    DrainQueue(data_q_);
+}
+
+/**
+ * @brief 原子地把计数提高到 value（多个任务同时更新最大值）
+ */
+static void atomic_store_max(std::atomic<uint32_t> &target, uint32_t value)
+{
+    uint32_t cur = target.load(std::memory_order_relaxed);
+    while (value > cur && !target.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+    }
+}
+
+void CozeWebSocket::GetSendStats(SendStats *stats) const
+{
+    const SendCounters &c = send_stats_;
+    stats->sent = c.sent.load(std::memory_order_relaxed);
+    stats->send_fail = c.send_fail.load(std::memory_order_relaxed);
+    stats->dropped_expired = c.dropped_expired.load(std::memory_order_relaxed);
+    stats->dropped_full = c.dropped_full.load(std::memory_order_relaxed);
+    stats->dropped_closed = c.dropped_closed.load(std::memory_order_relaxed);
+    stats->data_depth_max = c.data_depth_max.load(std::memory_order_relaxed);
+    stats->latency_us_avg = c.latency_us_avg.load(std::memory_order_relaxed);
+    stats->latency_us_max = c.latency_us_max.load(std::memory_order_relaxed);
+    stats->write_us_avg = c.write_us_avg.load(std::memory_order_relaxed);
+    stats->batch_max = c.batch_max.load(std::memory_order_relaxed);
+    stats->control_depth = control_q_ ? uxQueueMessagesWaiting(control_q_) : 0;
+    stats->data_depth = data_q_ ? uxQueueMessagesWaiting(data_q_) : 0;
+}
+
+/**
+ * @brief 复制消息入队并唤醒发送任务
+ * 
+ * 队列满时最多等待 wait_ms（音频即其截止时间，形成对上行任务的背压），仍满则丢弃。
+ */
+bool CozeWebSocket::Enqueue(QueueHandle_t queue, const char *data, size_t len, int64_t deadline_us, uint32_t wait_ms)
+{
+    if (!queue || !send_running_ || !esp_websocket_client_is_connected(client_)) {
         ESP_LOGE(TAG, "WebSocket未连接");
         return false;
     }
     
-    int ret = esp_websocket_client_send_text(client_, message.c_str(), 
-                                             message.length(), portMAX_DELAY);
+    SendItem *item = (SendItem *)heap_caps_malloc(sizeof(SendItem) + len, MALLOC_CAP_SPIRAM);
+    if (!item) {
+        ESP_LOGE(TAG, "发送缓冲分配失败: %d 字节", (int)len);
+        return false;
+    }
+    item->enqueue_us = esp_timer_get_time();
+    item->deadline_us = deadline_us;
+    item->len = len;
+    memcpy(item + 1, data, len);
+    
+    if (xQueueSend(queue, &item, pdMS_TO_TICKS(wait_ms)) != pdTRUE) {
+        heap_caps_free(item);
+        send_stats_.dropped_full.fetch_add(1, std::memory_order_relaxed);
+        ESP_LOGW(TAG, "⚠️ 发送队列已满，丢弃 %d 字节", (int)len);
+        return false;
+    }
+    
+    if (queue == data_q_) {
+        atomic_store_max(send_stats_.data_depth_max, (uint32_t)uxQueueMessagesWaiting(data_q_));
+    }
+    xTaskNotifyGive(send_task_.handle);
+    return true;
+}
+
+/**
+ * @brief 发送一条消息（发送任务中调用），过期音频直接丢弃
+ */
+void CozeWebSocket::SendItemNow(SendItem *item)
+{
+    int64_t now = esp_timer_get_time();
+    if (item->deadline_us > 0 && now > item->deadline_us) {
+        send_stats_.dropped_expired.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (!esp_websocket_client_is_connected(client_)) {
+        send_stats_.dropped_closed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    
+    int ret = esp_websocket_client_send_text(client_, (const char *)(item + 1), item->len,
+                                             pdMS_TO_TICKS(COZE_WS_SEND_TIMEOUT_MS));
+    int64_t done = esp_timer_get_time();
     if (ret < 0) {
+        send_stats_.send_fail.fetch_add(1, std::memory_order_relaxed);
         ESP_LOGE(TAG, "发送消息失败");
-        return false;
+        return;
+    }
+    
+    // 滑动平均（1/8），只有发送任务写
+    SendCounters *st = &send_stats_;
+    uint32_t latency_us = (uint32_t)(done - item->enqueue_us);
+    uint32_t write_us = (uint32_t)(done - now);
+    uint32_t sent = st->sent.load(std::memory_order_relaxed);
+    uint32_t latency_avg = st->latency_us_avg.load(std::memory_order_relaxed);
+    uint32_t write_avg = st->write_us_avg.load(std::memory_order_relaxed);
+    st->latency_us_avg.store(sent ? latency_avg - latency_avg / 8 + latency_us / 8 : latency_us,
+                             std::memory_order_relaxed);
+    st->write_us_avg.store(sent ? write_avg - write_avg / 8 + write_us / 8 : write_us,
+                           std::memory_order_relaxed);
+    atomic_store_max(st->latency_us_max, latency_us);
+    st->sent.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CozeWebSocket::DrainQueue(QueueHandle_t queue)
+{
+    SendItem *item;
+    while (queue && xQueueReceive(queue, &item, 0) == pdTRUE) {
+        heap_caps_free(item);
+        send_stats_.dropped_closed.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief 发送任务：每取一条前先看控制队列，控制消息总是插在音频之前
+ */
+void CozeWebSocket::send_task(void *arg)
+{
+    CozeWebSocket *self = static_cast<CozeWebSocket *>(arg);
+    
+    while (self->send_running_) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(200));
+        
+        uint32_t batch = 0;
+        SendItem *item;
+        while (self->send_running_ &&
+               (xQueueReceive(self->control_q_, &item, 0) == pdTRUE ||
+                xQueueReceive(self->data_q_, &item, 0) == pdTRUE)) {
+            self->SendItemNow(item);
+            heap_caps_free(item);
+            batch++;
+        }
+        atomic_store_max(self->send_stats_.batch_max, batch);
     }
     
-    // ESP_LOGI(TAG, "发送消息成功: %d字节", ret);
+    vTaskDelete(NULL);
+}
+
+bool CozeWebSocket::StartSender()
+{
+    control_q_ = xQueueCreate(COZE_WS_CONTROL_DEPTH, sizeof(SendItem *));
+    data_q_ = xQueueCreate(data_depth_, sizeof(SendItem *));
+    send_running_ = true;
+    if (!control_q_ || !data_q_ ||
+        xn_task_create(&send_task_, &send_sched_, send_task, "coze_ws_send", this) != ESP_OK) {
+        ESP_LOGE(TAG, "创建发送任务失败");
+        StopSender();
+        return false;
+    }
+    ESP_LOGI(TAG, "发送任务已启动 (音频队列 %d 条, 优先级 %d)", (int)data_depth_, send_sched_.priority);
     return true;
 }
 
+void CozeWebSocket::StopSender()
+{
+    bool joined = true;
+    if (send_task_.handle) {
+        send_running_ = false;
+        xTaskNotifyGive(send_task_.handle);
+        joined = xn_task_join(&send_task_, COZE_WS_SEND_TIMEOUT_MS + 500) == ESP_OK;
+    }
+    send_running_ = false;
+    
+    if (!joined) {
+        // 发送任务是被强制删除的，可能停在取出一半的队列操作中：队列和其中的消息不再碰，宁可泄漏
+        ESP_LOGE(TAG, "❌ 发送任务未能自行退出，发送队列 (%d+%d 条) 不释放",
+                 control_q_ ? (int)uxQueueMessagesWaiting(control_q_) : 0,
+                 data_q_ ? (int)uxQueueMessagesWaiting(data_q_) : 0);
+        control_q_ = nullptr;
+        data_q_ = nullptr;
+        return;
+    }
+    
+    DrainQueue(control_q_);
+    DrainQueue(data_q_);
+    if (control_q_) {
+        vQueueDelete(control_q_);
+        control_q_ = nullptr;
+    }
+    if (data_q_) {
+        vQueueDelete(data_q_);
+        data_q_ = nullptr;
+    }
+}
+
+bool CozeWebSocket::IsConnected() const
+{
+    return client_ && esp_websocket_client_is_connected(client_);
+}
+
+void CozeWebSocket::Disconnect()
+{
+    if (!client_) {
+        return;
+    }
+    
+    // close/stop 返回时客户端任务已退出，之后才能安全地丢弃接收中的消息（rx_buf_ 只由该任务写入）
+    if (!esp_websocket_client_is_connected(client_) ||
+        esp_websocket_client_close(client_, pdMS_TO_TICKS(COZE_WS_CLOSE_TIMEOUT_MS)) != ESP_OK) {
+        esp_websocket_client_stop(client_);  // 正在建连或关闭失败：中止（未启动时直接返回）
+    }
+    AbortMessage();
+    
+    // 未发出的消息属于上一次连接，不再发送
+    DrainQueue(control_q_);
+    DrainQueue(data_q_);
+    ESP_LOGI(TAG, "WebSocket已断开（保留TLS会话）");
+}
+
 void CozeWebSocket::Close()
 {
     if (client_) {
-        esp_websocket_client_close(client_, portMAX_DELAY);
-        esp_websocket_client_destroy(client_);
+        Disconnect();
+        StopSender();
+        esp_websocket_client_destroy(client_);  // 同时销毁外部 TLS 传输
         client_ = nullptr;
+        ssl_ = nullptr;
         ESP_LOGI(TAG, "WebSocket已关闭");
     }
 }
@@ -134,6 +433,22 @@ void CozeWebSocket::OnError(std::function<void(int)> callback)
     on_error_ = callback;
 }
 
+void CozeWebSocket::OnMessage(std::function<char *(size_t, bool)> acquire,
+                              std::function<void(char *, size_t, bool)> commit)
+{
+    on_acquire_ = acquire;
+    on_commit_ = commit;
+}
+
+void CozeWebSocket::AbortMessage()
+{
+    if (rx_buf_ && on_commit_) {
+        on_commit_(rx_buf_, 0, false);
+    }
+    rx_buf_ = nullptr;
+    rx_len_ = 0;
+}
+
 void CozeWebSocket::websocket_event_handler(void *handler_args, esp_event_base_t base, 
                                                 int32_t event_id, void *event_data)
 {
@@ -142,20 +457,46 @@ void CozeWebSocket::websocket_event_handler(void *handler_args, esp_event_base_t
     
     switch (event_id) {
         case WEBSOCKET_EVENT_CONNECTED:
-            ESP_LOGI(TAG, "✅ WebSocket已连接");
+            self->last_connect_ms_ = (uint32_t)((esp_timer_get_time() - self->connect_start_us_) / 1000);
+            ESP_LOGI(TAG, "✅ WebSocket已连接 (建连 %lu ms)", self->last_connect_ms_);
             if (self->on_connected_) {
                 self->on_connected_();
             }
             break;
             
         case WEBSOCKET_EVENT_DISCONNECTED:
+        case WEBSOCKET_EVENT_CLOSED:
             ESP_LOGW(TAG, "WebSocket已断开");
+            self->AbortMessage();
             if (self->on_disconnected_) {
                 self->on_disconnected_();
             }
             break;
             
         case WEBSOCKET_EVENT_DATA:
+            // 零拷贝接收：分片直接写入接收方提供的整条消息缓冲区
+            if (self->on_acquire_ && data && (data->op_code == 0x01 || data->op_code == 0x02)) {
+                if (data->payload_offset == 0) {
+                    self->AbortMessage();  // 上一条未收齐
+                    self->rx_buf_ = self->on_acquire_(data->payload_len, data->op_code == 0x02);
+                    self->rx_len_ = data->payload_len;
+                }
+                
+                if (self->rx_buf_ && data->data_len > 0 &&
+                    (size_t)(data->payload_offset + data->data_len) <= self->rx_len_) {
+                    memcpy(self->rx_buf_ + data->payload_offset, data->data_ptr, data->data_len);
+                }
+                
+                if (data->payload_offset + data->data_len >= data->payload_len) {
+                    if (self->rx_buf_) {
+                        self->on_commit_(self->rx_buf_, self->rx_len_, true);
+                    }
+                    self->rx_buf_ = nullptr;
+                    self->rx_len_ = 0;
+                }
+                break;
+            }
+            
             if (data && data->data_ptr && data->data_len > 0) {
                 bool is_binary = (data->op_code == 0x02);
                 
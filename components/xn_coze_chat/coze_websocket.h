@@ -8,41 +8,149 @@
 #pragma once
 
 #include "esp_websocket_client.h"
+#include "esp_transport.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "xn_task_sched.h"
+#include <atomic>
 #include <functional>
 #include <map>
 #include <string>
 
 /**
  * @brief WebSocket 客户端
+ *
+ * 客户端与底层 TLS 传输在首次 Connect 时创建，Disconnect 后保留，
+ * 再次 Connect 直接重启同一客户端：启用 CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS 时
+ * 复用上次握手得到的会话票据，省去完整 TLS 握手。
+ * 不使用客户端内置的固定间隔重连，断线后由上层决定何时重连。
+ *
+ * 发送全部经过独立的发送任务，调用方只做入队，不会被慢速 TCP 窗口阻塞：
+ * - 控制消息（Send）优先于音频，插队发送；
+ * - 有序消息（SendOrdered）与音频同一队列，保证排在之前入队的音频之后（如 input_audio_buffer.complete）；
+ * - 音频（SendAudio）带截止时间，发送任务取出时已过期则丢弃；队列满时调用方最多等待到截止时间（背压）。
+ * 发送任务每次唤醒连续发完所有就绪消息，突发的小消息只唤醒一次。
  */
 class CozeWebSocket
 {
 public:
+    /**
+     * @brief 发送队列统计
+     */
+    struct SendStats {
+        uint32_t sent;              ///< 已发送消息数
+        uint32_t send_fail;         ///< 发送失败数
+        uint32_t dropped_expired;   ///< 过期丢弃的音频消息数
+        uint32_t dropped_full;      ///< 队列满丢弃的消息数
+        uint32_t dropped_closed;    ///< 断开时丢弃的消息数
+        uint32_t control_depth;     ///< 当前控制队列深度
+        uint32_t data_depth;        ///< 当前音频/有序队列深度
+        uint32_t data_depth_max;    ///< 音频/有序队列最大深度
+        uint32_t latency_us_avg;    ///< 入队到发出的耗时滑动平均
+        uint32_t latency_us_max;    ///< 入队到发出的最大耗时
+        uint32_t write_us_avg;      ///< 单条消息写入 socket 的耗时滑动平均
+        uint32_t batch_max;         ///< 单次唤醒连续发送的最大消息数
+    };
+
     CozeWebSocket();
     ~CozeWebSocket();
 
     void SetHeader(const char *key, const char *value);
+    void SetTaskConfig(int priority, int stack_size);
+    void SetSendQueue(const xn_task_sched_t *sched, size_t data_depth);  ///< 发送任务调度与音频队列深度（Connect 前调用）
     bool Connect(const std::string &url);
-    bool Send(const std::string &message);
-    void Close();
+    bool Send(const std::string &message);              ///< 控制消息（优先）
+    bool Send(const char *data, size_t len);            ///< 控制消息（优先）
+    bool SendOrdered(const std::string &message);       ///< 排在已入队音频之后
+    bool SendAudio(const char *data, size_t len, uint32_t max_age_ms);  ///< 音频：超过 max_age_ms 未发出即丢弃
+    void DropAudio();           ///< 丢弃尚未发出的音频/有序消息
+    void GetSendStats(SendStats *stats) const;
+    void Disconnect();          ///< 断开连接，保留客户端与 TLS 会话供下次 Connect 复用
+    void Close();               ///< 断开并销毁客户端
+    bool IsConnected() const;
+    uint32_t LastConnectMs() const { return last_connect_ms_; }   ///< 最近一次建连耗时（TCP+TLS+升级）
 
     void OnConnected(std::function<void()> callback);
     void OnDisconnected(std::function<void()> callback);
     void OnData(std::function<void(const char *, size_t, bool binary)> callback);
     void OnError(std::function<void(int)> callback);
 
+    /**
+     * @brief 零拷贝接收：消息开始时按整条长度申请缓冲区，各分片直接写入，收齐后提交
+     *
+     * 设置后文本/二进制消息不再经过 OnData 和内部分片缓冲区。
+     * acquire 返回 nullptr 表示丢弃该消息；commit 的 complete=false 表示消息未收齐
+     * （连接断开或被新消息打断），接收方只需回收缓冲区。
+     */
+    void OnMessage(std::function<char *(size_t len, bool binary)> acquire,
+                   std::function<void(char *buf, size_t len, bool complete)> commit);
+
 private:
     esp_websocket_client_handle_t client_;
+    esp_transport_handle_t ssl_;     // 外部 TLS 传输（随客户端销毁）
+    std::string url_;
+    int64_t connect_start_us_;
+    uint32_t last_connect_ms_;
     std::map<std::string, std::string> headers_;
+    int task_priority_;
+    int task_stack_size_;
 
     std::function<void()> on_connected_;
     std::function<void()> on_disconnected_;
     std::function<void(const char *, size_t, bool)> on_data_;
     std::function<void(int)> on_error_;
 
-    // 消息分片缓冲区（用于拼接分片消息）
+    // 消息分片缓冲区（用于拼接分片消息，仅 OnData 模式）
     std::string fragment_buffer_;
 
+    // 零拷贝接收（OnMessage 模式）
+    std::function<char *(size_t, bool)> on_acquire_;
+    std::function<void(char *, size_t, bool)> on_commit_;
+    char *rx_buf_;               // 当前消息缓冲区
+    size_t rx_len_;              // 当前消息总长度
+
+    void AbortMessage();
+    
+    // 发送队列（队列元素为 SendItem*，消息体紧随其后，PSRAM 分配）
+    struct SendItem {
+        int64_t enqueue_us;
+        int64_t deadline_us;     // 0 表示不过期
+        size_t len;
+    };
+    QueueHandle_t control_q_;
+    QueueHandle_t data_q_;
+    xn_task_t send_task_;
+    xn_task_sched_t send_sched_;
+    size_t data_depth_;
+    volatile bool send_running_;
+    
+    /**
+     * @brief 发送统计计数
+     * 
+     * Enqueue/DrainQueue 在调用方任务中更新，其余在发送任务中更新，均为原子操作；
+     * 滑动平均只由发送任务写，快照中各字段之间不保证同一时刻。
+     */
+    struct SendCounters {
+        std::atomic<uint32_t> sent{0};
+        std::atomic<uint32_t> send_fail{0};
+        std::atomic<uint32_t> dropped_expired{0};
+        std::atomic<uint32_t> dropped_full{0};
+        std::atomic<uint32_t> dropped_closed{0};
+        std::atomic<uint32_t> data_depth_max{0};
+        std::atomic<uint32_t> latency_us_avg{0};
+        std::atomic<uint32_t> latency_us_max{0};
+        std::atomic<uint32_t> write_us_avg{0};
+        std::atomic<uint32_t> batch_max{0};
+    };
+    SendCounters send_stats_;
+    
+    bool StartSender();
+    void StopSender();
+    bool Enqueue(QueueHandle_t queue, const char *data, size_t len, int64_t deadline_us, uint32_t wait_ms);
+    void SendItemNow(SendItem *item);
+    void DrainQueue(QueueHandle_t queue);
+    static void send_task(void *arg);
+
     static void websocket_event_handler(void *handler_args, esp_event_base_t base,
                                         int32_t event_id, void *event_data);
 };
@@ -1,65 +1,133 @@
 /*
  * @Author: AI Assistant
- * @Description: Opus数据缓冲区实现 - 使用环形缓冲区
+ * @Description: Opus数据缓冲区实现 - 单生产者/单消费者无锁变长记录环形缓冲区
  */
 
 #include "opus_buffer.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdatomic.h>
 #include <string.h>
+#include <stdbool.h>
 
 static const char *TAG = "OPUS_BUFFER";
 
+#define OPUS_REC_ALIGN  4           ///< 记录对齐
+#define OPUS_REC_WRAP   0xFFFF      ///< 环绕标记：读端遇到后回到起点
+
 /**
- * @brief Opus包头（存储包大小）
+ * @brief Opus包头
  */
 typedef struct {
-    uint16_t size;  ///< 包大小（字节）
+    uint16_t size;      ///< 包大小（字节），或 OPUS_REC_WRAP
+    uint16_t dur_100us; ///< 包时长（0.1ms，由TOC解析）
 } opus_packet_header_t;
 
 /**
  * @brief Opus缓冲区结构体
- * 
- * 环形缓冲区设计：
- * [header1|data1][header2|data2]...[headerN|dataN]
- * 
- * 每个包 = 2字节头（大小） + 实际数据
+ *
+ * 变长记录环形缓冲区设计：
+ * [header1|data1|pad][header2|data2|pad]...[WRAP]
+ *
+ * 每个包按实际大小占用空间，记录总是连续存放；尾部放不下时写环绕标记
+ * （剩余不足一个包头时读端隐式环绕）从头开始，被跳过的尾部计入占用直到读端越过。
+ * head 只由生产者推进、tail 只由消费者推进，均为原子变量，读写两端无锁；
+ * head == tail 表示空，写入永远不会让 head 追上 tail。
  */
 typedef struct opus_buffer_s {
     uint8_t *buffer;                ///< 缓冲区（PSRAM）
     size_t buffer_size;             ///< 缓冲区总大小（字节）
-    size_t capacity;                ///< 最大包数
     size_t max_packet_size;         ///< 单包最大大小
-    
-    volatile size_t write_pos;      ///< 写位置
-    volatile size_t read_pos;       ///< 读位置
-    volatile size_t count;          ///< 当前包数
-    
-    SemaphoreHandle_t mutex;        ///< 互斥锁
-    SemaphoreHandle_t data_sem;     ///< 数据可用信号量
+    uint32_t pcm_byte_rate;         ///< PCM 每秒字节数，0 表示 Opus 包
+
+    atomic_size_t head;             ///< 已发布的写位置（生产者）
+    atomic_size_t tail;             ///< 已消费的读位置（消费者）
+
+    // 生产者私有
+    size_t resv_pos;                ///< 预留记录起点
+    bool resv_wrapped;              ///< 预留时发生了环绕
+    bool reserved;                  ///< 已预留未提交
+
+    // 计数（生产者加，消费者减）
+    atomic_uint written;            ///< 已发布包数
+    atomic_uint consumed;           ///< 已消费包数
+    atomic_uint queued_100us;       ///< 队列中音频时长（0.1ms）
+    size_t peak_bytes;              ///< 占用峰值（生产者维护）
+
+    atomic_bool clear_req;          ///< 清空请求（由消费者执行）
+    _Atomic(TaskHandle_t) consumer; ///< 阻塞等待中的消费者任务（任务通知唤醒）
 } opus_buffer_t;
 
+static inline size_t rec_size(size_t len)
+{
+    return (sizeof(opus_packet_header_t) + len + OPUS_REC_ALIGN - 1) & ~(size_t)(OPUS_REC_ALIGN - 1);
+}
+
+static inline size_t used_bytes(const opus_buffer_t *buf, size_t head, size_t tail)
+{
+    return (head + buf->buffer_size - tail) % buf->buffer_size;
+}
+
+/**
+ * @brief 按 TOC 字节计算 Opus 包时长（RFC 6716 3.1）
+ *
+ * @return 时长（0.1ms），无法解析返回 0
+ */
+static uint16_t opus_packet_duration(const uint8_t *data, size_t len)
+{
+    if (len < 1) {
+        return 0;
+    }
+
+    uint8_t config = data[0] >> 3;
+    uint16_t frame_100us;
+    if (config < 12) {
+        static const uint16_t silk[4] = {100, 200, 400, 600};      // SILK: 10/20/40/60ms
+        frame_100us = silk[config & 3];
+    } else if (config < 16) {
+        frame_100us = (config & 1) ? 200 : 100;                     // Hybrid: 10/20ms
+    } else {
+        static const uint16_t celt[4] = {25, 50, 100, 200};         // CELT: 2.5/5/10/20ms
+        frame_100us = celt[config & 3];
+    }
+
+    uint16_t frames;
+    switch (data[0] & 3) {
+    case 0:  frames = 1; break;
+    case 3:  frames = (len >= 2) ? (data[1] & 0x3F) : 0; break;
+    default: frames = 2; break;
+    }
+    return frame_100us * frames;
+}
+
 opus_buffer_handle_t opus_buffer_create(const opus_buffer_config_t *config)
 {
-    if (!config || config->capacity == 0 || config->max_packet_size == 0) {
+    if (!config || config->max_packet_size == 0 || config->max_packet_size >= OPUS_REC_WRAP ||
+        config->buffer_size < 4 * rec_size(config->max_packet_size)) {
         ESP_LOGE(TAG, "无效的配置参数");
         return NULL;
     }
-    
+
     opus_buffer_t *buf = (opus_buffer_t *)malloc(sizeof(opus_buffer_t));
     if (!buf) {
         ESP_LOGE(TAG, "缓冲区句柄分配失败");
         return NULL;
     }
     memset(buf, 0, sizeof(opus_buffer_t));
-    
-    // 计算缓冲区大小：容量 × (头大小 + 数据大小)
-    buf->capacity = config->capacity;
+
+    buf->buffer_size = config->buffer_size & ~(size_t)(OPUS_REC_ALIGN - 1);
     buf->max_packet_size = config->max_packet_size;
-    buf->buffer_size = config->capacity * (sizeof(opus_packet_header_t) + config->max_packet_size);
-    
+    buf->pcm_byte_rate = config->pcm_byte_rate;
+    atomic_init(&buf->head, 0);
+    atomic_init(&buf->tail, 0);
+    atomic_init(&buf->written, 0);
+    atomic_init(&buf->consumed, 0);
+    atomic_init(&buf->queued_100us, 0);
+    atomic_init(&buf->clear_req, false);
+    atomic_init(&buf->consumer, NULL);
+
     // 分配缓冲区（PSRAM）
     buf->buffer = (uint8_t *)heap_caps_malloc(buf->buffer_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     if (!buf->buffer) {
@@ -67,105 +135,199 @@ opus_buffer_handle_t opus_buffer_create(const opus_buffer_config_t *config)
         free(buf);
         return NULL;
     }
-    
-    // 创建互斥锁
-    buf->mutex = xSemaphoreCreateMutex();
-    if (!buf->mutex) {
-        ESP_LOGE(TAG, "互斥锁创建失败");
-        heap_caps_free(buf->buffer);
-        free(buf);
-        return NULL;
-    }
-    
-    // 创建信号量
-    buf->data_sem = xSemaphoreCreateBinary();
-    if (!buf->data_sem) {
-        ESP_LOGE(TAG, "信号量创建失败");
-        vSemaphoreDelete(buf->mutex);
-        heap_caps_free(buf->buffer);
-        free(buf);
-        return NULL;
-    }
-    
+
     ESP_LOGI(TAG, "✅ Opus缓冲区创建成功");
-    ESP_LOGI(TAG, "  容量: %d 包", (int)buf->capacity);
     ESP_LOGI(TAG, "  单包最大: %d 字节", (int)buf->max_packet_size);
-    ESP_LOGI(TAG, "  总大小: %.1f KB (PSRAM)", buf->buffer_size / 1024.0f);
-    
+    ESP_LOGI(TAG, "  总大小: %.1f KB (PSRAM，按包实际大小占用)", buf->buffer_size / 1024.0f);
+
     return buf;
 }
 
 void opus_buffer_destroy(opus_buffer_handle_t buffer)
 {
     if (!buffer) return;
-    
-    if (buffer->mutex) {
-        vSemaphoreDelete(buffer->mutex);
-    }
-    if (buffer->data_sem) {
-        vSemaphoreDelete(buffer->data_sem);
-    }
+
     if (buffer->buffer) {
         heap_caps_free(buffer->buffer);
     }
     free(buffer);
-    
+
     ESP_LOGI(TAG, "Opus缓冲区已销毁");
 }
 
+esp_err_t opus_buffer_reserve(opus_buffer_handle_t buffer, uint8_t **slot, size_t *slot_size)
+{
+    if (!buffer || !slot) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // 按最大包长预留连续空间，提交时按实际长度收缩
+    size_t need = rec_size(buffer->max_packet_size);
+    size_t h = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    size_t t = atomic_load_explicit(&buffer->tail, memory_order_acquire);
+
+    if (h >= t) {
+        // 尾部空间：写满到末尾时 head 回到 0，此时 tail 不能为 0
+        if (h + need < buffer->buffer_size || (h + need == buffer->buffer_size && t > 0)) {
+            buffer->resv_pos = h;
+            buffer->resv_wrapped = false;
+        } else if (need < t) {
+            buffer->resv_pos = 0;
+            buffer->resv_wrapped = true;
+        } else {
+            return ESP_ERR_NO_MEM;  // 缓冲区满
+        }
+    } else if (need < t - h) {
+        buffer->resv_pos = h;
+        buffer->resv_wrapped = false;
+    } else {
+        return ESP_ERR_NO_MEM;  // 缓冲区满
+    }
+
+    *slot = buffer->buffer + buffer->resv_pos + sizeof(opus_packet_header_t);
+    if (slot_size) {
+        *slot_size = buffer->max_packet_size;
+    }
+    buffer->reserved = true;
+
+    return ESP_OK;
+}
+
+/**
+ * @brief 发布预留槽位中的记录（len 为 0 时为丢包标记）
+ */
+static esp_err_t commit_record(opus_buffer_t *buffer, size_t len)
+{
+    if (len > buffer->max_packet_size) {
+        ESP_LOGE(TAG, "包大小超过限制: %d > %d", (int)len, (int)buffer->max_packet_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (!buffer->reserved) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t h = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+
+    // 尾部放不下时留下环绕标记（不足一个包头时读端隐式环绕）
+    if (buffer->resv_wrapped && buffer->buffer_size - h >= sizeof(opus_packet_header_t)) {
+        opus_packet_header_t wrap = { .size = OPUS_REC_WRAP, .dur_100us = 0 };
+        memcpy(buffer->buffer + h, &wrap, sizeof(wrap));
+    }
+
+    // 写入包头（大小、时长）
+    uint8_t *rec = buffer->buffer + buffer->resv_pos;
+    opus_packet_header_t header = {
+        .size = (uint16_t)len,
+        .dur_100us = buffer->pcm_byte_rate ? (uint16_t)((uint64_t)len * 10000 / buffer->pcm_byte_rate)
+                                           : opus_packet_duration(rec + sizeof(header), len),
+    };
+    memcpy(rec, &header, sizeof(header));
+
+    // 无锁发布：包内容先于 head 对消费者可见
+    size_t next = (buffer->resv_pos + rec_size(len)) % buffer->buffer_size;
+    atomic_fetch_add_explicit(&buffer->queued_100us, header.dur_100us, memory_order_relaxed);
+    atomic_fetch_add_explicit(&buffer->written, 1, memory_order_relaxed);
+    atomic_store(&buffer->head, next);
+    buffer->reserved = false;
+
+    size_t used = used_bytes(buffer, next, atomic_load_explicit(&buffer->tail, memory_order_relaxed));
+    if (used > buffer->peak_bytes) {
+        buffer->peak_bytes = used;
+    }
+
+    // 通知等待中的消费者
+    TaskHandle_t consumer = atomic_load(&buffer->consumer);
+    if (consumer) {
+        xTaskNotifyGive(consumer);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t opus_buffer_commit(opus_buffer_handle_t buffer, size_t len)
+{
+    if (!buffer || len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return commit_record(buffer, len);
+}
+
+esp_err_t opus_buffer_mark_loss(opus_buffer_handle_t buffer)
+{
+    if (!buffer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t *slot = NULL;
+    esp_err_t ret = opus_buffer_reserve(buffer, &slot, NULL);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // 空记录：不计入缓冲时长，读端取到长度为 0 的包
+    return commit_record(buffer, 0);
+}
+
 esp_err_t opus_buffer_write(opus_buffer_handle_t buffer, const uint8_t *data, size_t len)
 {
     if (!buffer || !data || len == 0) {
         return ESP_ERR_INVALID_ARG;
     }
-    
+
     if (len > buffer->max_packet_size) {
         ESP_LOGE(TAG, "包大小超过限制: %d > %d", (int)len, (int)buffer->max_packet_size);
         return ESP_ERR_INVALID_SIZE;
     }
-    
-    if (xSemaphoreTake(buffer->mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
+
+    uint8_t *slot = NULL;
+    esp_err_t ret = opus_buffer_reserve(buffer, &slot, NULL);
+    if (ret != ESP_OK) {
+        return ret;
     }
-    
-    // 检查是否有空间
-    if (buffer->count >= buffer->capacity) {
-        xSemaphoreGive(buffer->mutex);
-        return ESP_ERR_NO_MEM;  // 缓冲区满
+
+    memcpy(slot, data, len);
+    return opus_buffer_commit(buffer, len);
+}
+
+/**
+ * @brief 取出 tail 处的记录位置（处理环绕），调用前须确认非空
+ */
+static size_t consumer_peek(opus_buffer_t *buffer, size_t r, opus_packet_header_t *header)
+{
+    if (buffer->buffer_size - r < sizeof(*header)) {
+        r = 0;
+    } else {
+        memcpy(header, buffer->buffer + r, sizeof(*header));
+        if (header->size == OPUS_REC_WRAP) {
+            r = 0;
+        }
     }
-    
-    // 写入包头（大小）
-    opus_packet_header_t header = { .size = (uint16_t)len };
-    size_t header_size = sizeof(opus_packet_header_t);
-    
-    // 检查是否需要环绕
-    size_t packet_total_size = header_size + len;
-    if (buffer->write_pos + packet_total_size > buffer->buffer_size) {
-        // 环绕到开头
-        buffer->write_pos = 0;
-    }
-    
-    // 写入头
-    memcpy(buffer->buffer + buffer->write_pos, &header, header_size);
-    buffer->write_pos += header_size;
-    
-    // 写入数据
-    memcpy(buffer->buffer + buffer->write_pos, data, len);
-    buffer->write_pos += len;
-    
-    // 更新计数
-    buffer->count++;
-    
-    xSemaphoreGive(buffer->mutex);
-    
-    // 通知有数据可读
-    xSemaphoreGive(buffer->data_sem);
-    
-    return ESP_OK;
+    memcpy(header, buffer->buffer + r, sizeof(*header));
+    return r;
+}
+
+/**
+ * @brief 消费者执行清空：逐包越过，保持计数一致
+ */
+static void consumer_drain(opus_buffer_t *buffer)
+{
+    size_t r = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+    size_t h = atomic_load_explicit(&buffer->head, memory_order_acquire);
+
+    while (r != h) {
+        opus_packet_header_t header;
+        r = consumer_peek(buffer, r, &header);
+        r = (r + rec_size(header.size)) % buffer->buffer_size;
+        atomic_fetch_sub_explicit(&buffer->queued_100us, header.dur_100us, memory_order_relaxed);
+        atomic_fetch_add_explicit(&buffer->consumed, 1, memory_order_relaxed);
+    }
+    atomic_store_explicit(&buffer->tail, r, memory_order_release);
 }
 
-esp_err_t opus_buffer_read(opus_buffer_handle_t buffer, 
-                           uint8_t *out, 
+esp_err_t opus_buffer_read(opus_buffer_handle_t buffer,
+                           uint8_t *out,
                            size_t max_len,
                            size_t *actual_len,
                            uint32_t timeout_ms)
@@ -173,73 +335,125 @@ esp_err_t opus_buffer_read(opus_buffer_handle_t buffer,
     if (!buffer || !out || !actual_len) {
         return ESP_ERR_INVALID_ARG;
     }
-    
-    // 等待数据（如果缓冲区为空）
-    if (buffer->count == 0 && timeout_ms > 0) {
-        if (xSemaphoreTake(buffer->data_sem, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
-            return ESP_ERR_TIMEOUT;
-        }
-    }
-    
-    if (xSemaphoreTake(buffer->mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
+
+    if (atomic_exchange(&buffer->clear_req, false)) {
+        consumer_drain(buffer);
     }
-    
-    // 检查是否有数据
-    if (buffer->count == 0) {
-        xSemaphoreGive(buffer->mutex);
-        return ESP_ERR_NOT_FOUND;
+
+    size_t r = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+
+    // 空：登记为等待者后再检查一次，避免与生产者发布交错时丢失唤醒
+    if (r == atomic_load(&buffer->head)) {
+        if (timeout_ms == 0) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        atomic_store(&buffer->consumer, xTaskGetCurrentTaskHandle());
+        if (r == atomic_load(&buffer->head)) {
+            ulTaskNotifyTake(pdTRUE, timeout_ms == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+        }
+        atomic_store(&buffer->consumer, NULL);
+
+        if (atomic_exchange(&buffer->clear_req, false)) {
+            consumer_drain(buffer);
+            r = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+        }
+        if (r == atomic_load(&buffer->head)) {
+            return ESP_ERR_TIMEOUT;  // 超时或被 opus_buffer_wake 唤醒
+        }
     }
-    
+
     // 读取包头
     opus_packet_header_t header;
-    size_t header_size = sizeof(opus_packet_header_t);
-    
-    // 检查是否需要环绕
-    if (buffer->read_pos + header_size > buffer->buffer_size) {
-        buffer->read_pos = 0;
-    }
-    
-    memcpy(&header, buffer->buffer + buffer->read_pos, header_size);
-    buffer->read_pos += header_size;
-    
+    r = consumer_peek(buffer, r, &header);
+
     // 检查输出缓冲区大小
     if (header.size > max_len) {
         ESP_LOGE(TAG, "输出缓冲区太小: %d > %d", header.size, (int)max_len);
-        xSemaphoreGive(buffer->mutex);
         return ESP_ERR_INVALID_SIZE;
     }
-    
-    // 检查是否需要环绕
-    if (buffer->read_pos + header.size > buffer->buffer_size) {
-        buffer->read_pos = 0;
-    }
-    
+
     // 读取数据
-    memcpy(out, buffer->buffer + buffer->read_pos, header.size);
-    buffer->read_pos += header.size;
-    
+    memcpy(out, buffer->buffer + r + sizeof(header), header.size);
     *actual_len = header.size;
-    buffer->count--;
-    
-    xSemaphoreGive(buffer->mutex);
-    
+
+    atomic_fetch_sub_explicit(&buffer->queued_100us, header.dur_100us, memory_order_relaxed);
+    atomic_fetch_add_explicit(&buffer->consumed, 1, memory_order_relaxed);
+    atomic_store_explicit(&buffer->tail, (r + rec_size(header.size)) % buffer->buffer_size,
+                          memory_order_release);
+
     return ESP_OK;
 }
 
+static inline bool consumer_ready(opus_buffer_t *buffer, uint32_t min_ms)
+{
+    return atomic_load_explicit(&buffer->tail, memory_order_relaxed) != atomic_load(&buffer->head) &&
+           atomic_load(&buffer->queued_100us) / 10 >= min_ms;
+}
+
+esp_err_t opus_buffer_wait(opus_buffer_handle_t buffer, uint32_t min_ms, uint32_t timeout_ms)
+{
+    if (!buffer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (atomic_exchange(&buffer->clear_req, false)) {
+        consumer_drain(buffer);
+    }
+
+    if (consumer_ready(buffer, min_ms)) {
+        return ESP_OK;
+    }
+
+    // 同 opus_buffer_read：先登记再检查，避免丢失提交通知
+    atomic_store(&buffer->consumer, xTaskGetCurrentTaskHandle());
+    if (!consumer_ready(buffer, min_ms)) {
+        ulTaskNotifyTake(pdTRUE, timeout_ms == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+    }
+    atomic_store(&buffer->consumer, NULL);
+
+    if (atomic_exchange(&buffer->clear_req, false)) {
+        consumer_drain(buffer);
+    }
+    return consumer_ready(buffer, min_ms) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
 size_t opus_buffer_get_count(opus_buffer_handle_t buffer)
 {
     if (!buffer) {
         return 0;
     }
-    
-    size_t count = 0;
-    if (xSemaphoreTake(buffer->mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        count = buffer->count;
-        xSemaphoreGive(buffer->mutex);
+
+    return atomic_load(&buffer->written) - atomic_load(&buffer->consumed);
+}
+
+uint32_t opus_buffer_get_duration_ms(opus_buffer_handle_t buffer)
+{
+    if (!buffer) {
+        return 0;
+    }
+
+    return atomic_load(&buffer->queued_100us) / 10;
+}
+
+void opus_buffer_get_stats(opus_buffer_handle_t buffer, opus_buffer_stats_t *stats)
+{
+    if (!buffer || !stats) return;
+
+    stats->packets = opus_buffer_get_count(buffer);
+    stats->duration_ms = opus_buffer_get_duration_ms(buffer);
+    stats->used_bytes = used_bytes(buffer, atomic_load(&buffer->head), atomic_load(&buffer->tail));
+    stats->peak_bytes = buffer->peak_bytes;
+    stats->buffer_size = buffer->buffer_size;
+}
+
+void opus_buffer_wake(opus_buffer_handle_t buffer)
+{
+    if (!buffer) return;
+
+    TaskHandle_t consumer = atomic_load(&buffer->consumer);
+    if (consumer) {
+        xTaskNotifyGive(consumer);
     }
-    
-    return count;
 }
 
 esp_err_t opus_buffer_clear(opus_buffer_handle_t buffer)
@@ -247,17 +461,10 @@ esp_err_t opus_buffer_clear(opus_buffer_handle_t buffer)
     if (!buffer) {
         return ESP_ERR_INVALID_ARG;
     }
-    
-    if (xSemaphoreTake(buffer->mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
-    }
-    
-    buffer->read_pos = 0;
-    buffer->write_pos = 0;
-    buffer->count = 0;
-    
-    xSemaphoreGive(buffer->mutex);
-    
+
+    // 读端无锁，清空交给消费者在下一次读取时执行
+    atomic_store(&buffer->clear_req, true);
+    opus_buffer_wake(buffer);
+
     return ESP_OK;
 }
-
@@ -3,9 +3,9 @@
  * @Description: Opus数据缓冲区 - 使用环形缓冲区存储Opus包
  * 
  * 功能：
- * - 缓冲压缩的Opus数据包（节省内存）
- * - 提供生产者-消费者模式
- * - 自动内存管理
+ * - 缓冲压缩的Opus数据包（按包实际大小占用，节省内存）
+ * - 单生产者/单消费者，读写两端无锁，消费者通过任务通知阻塞等待
+ * - 按包数和音频时长（毫秒）报告占用
  */
 
 #pragma once
@@ -27,10 +27,22 @@ typedef struct opus_buffer_s *opus_buffer_handle_t;
  * @brief Opus缓冲区配置
  */
 typedef struct {
-    size_t capacity;        ///< 缓冲区容量（包数）
+    size_t buffer_size;     ///< 缓冲区大小（字节），至少 4 个最大包
     size_t max_packet_size; ///< 单个包的最大大小（字节）
+    uint32_t pcm_byte_rate; ///< 非 0 时包为原始 PCM，按每秒字节数计算时长；0 表示 Opus 包，按 TOC 计算
 } opus_buffer_config_t;
 
+/**
+ * @brief Opus缓冲区占用统计
+ */
+typedef struct {
+    size_t packets;         ///< 队列中的包数
+    uint32_t duration_ms;   ///< 队列中的音频时长（按包TOC或PCM字节率计算）
+    size_t used_bytes;      ///< 当前占用字节（含环绕跳过的尾部）
+    size_t peak_bytes;      ///< 占用峰值
+    size_t buffer_size;     ///< 缓冲区大小
+} opus_buffer_stats_t;
+
 /**
  * @brief 创建Opus缓冲区
  * 
@@ -58,15 +70,51 @@ void opus_buffer_destroy(opus_buffer_handle_t buffer);
  */
 esp_err_t opus_buffer_write(opus_buffer_handle_t buffer, const uint8_t *data, size_t len);
 
+/**
+ * @brief 预留一个包槽位，由调用者直接写入包数据（零拷贝写入）
+ * 
+ * 按 max_packet_size 预留连续空间，写入完成后调用 opus_buffer_commit() 按实际长度提交；
+ * 未提交前再次预留返回同一槽位。仅支持单生产者。
+ * 
+ * @param buffer 缓冲区句柄
+ * @param slot 输出：槽位数据地址
+ * @param slot_size 输出：槽位可写大小（即 max_packet_size）
+ * @return esp_err_t ESP_OK成功，ESP_ERR_NO_MEM缓冲区满
+ */
+esp_err_t opus_buffer_reserve(opus_buffer_handle_t buffer, uint8_t **slot, size_t *slot_size);
+
+/**
+ * @brief 提交预留槽位中的包
+ * 
+ * @param buffer 缓冲区句柄
+ * @param len 实际写入的包长度
+ * @return esp_err_t ESP_OK成功，ESP_ERR_INVALID_STATE未预留
+ */
+esp_err_t opus_buffer_commit(opus_buffer_handle_t buffer, size_t len);
+
+/**
+ * @brief 写入丢包标记（按顺序占据一个包的位置）
+ * 
+ * 接收端丢弃了某个包时写入，解码端读到长度为 0 的包即知道此处缺一帧，
+ * 可以做丢包隐藏或用下一包的 FEC 恢复。
+ * 
+ * @param buffer 缓冲区句柄
+ * @return esp_err_t ESP_OK成功，ESP_ERR_NO_MEM缓冲区满
+ */
+esp_err_t opus_buffer_mark_loss(opus_buffer_handle_t buffer);
+
 /**
  * @brief 从缓冲区读取Opus包
  * 
  * @param buffer 缓冲区句柄
  * @param out 输出缓冲区
  * @param max_len 输出缓冲区大小
- * @param actual_len 实际读取的数据长度
- * @param timeout_ms 超时时间（毫秒），0表示不阻塞
- * @return esp_err_t ESP_OK成功，ESP_ERR_TIMEOUT超时
+ * @param actual_len 实际读取的数据长度（0 表示丢包标记，见 opus_buffer_mark_loss()）
+ * @param timeout_ms 超时时间（毫秒），0表示不阻塞，portMAX_DELAY表示一直等待
+ * @return esp_err_t ESP_OK成功，ESP_ERR_NOT_FOUND无数据（不阻塞时），
+ *         ESP_ERR_TIMEOUT超时或被 opus_buffer_wake() 唤醒
+ * 
+ * @note 仅支持单消费者，阻塞等待使用调用任务的任务通知
  */
 esp_err_t opus_buffer_read(opus_buffer_handle_t buffer, 
                            uint8_t *out, 
@@ -74,6 +122,21 @@ esp_err_t opus_buffer_read(opus_buffer_handle_t buffer,
                            size_t *actual_len,
                            uint32_t timeout_ms);
 
+/**
+ * @brief 等待缓冲的音频达到指定时长（不取出数据）
+ * 
+ * 条件不满足时阻塞到下一次有包提交、被 opus_buffer_wake() 唤醒或超时，
+ * 返回后由调用者决定是否继续等待。
+ * 
+ * @param buffer 缓冲区句柄
+ * @param min_ms 需要的最短音频时长（毫秒），0表示非空即可
+ * @param timeout_ms 超时时间（毫秒），portMAX_DELAY表示一直等待
+ * @return esp_err_t ESP_OK条件满足，ESP_ERR_TIMEOUT尚未满足
+ * 
+ * @note 仅由消费者调用，与 opus_buffer_read() 共用任务通知
+ */
+esp_err_t opus_buffer_wait(opus_buffer_handle_t buffer, uint32_t min_ms, uint32_t timeout_ms);
+
 /**
  * @brief 获取缓冲区中的包数量
  * 
@@ -82,9 +145,34 @@ esp_err_t opus_buffer_read(opus_buffer_handle_t buffer,
  */
 size_t opus_buffer_get_count(opus_buffer_handle_t buffer);
 
+/**
+ * @brief 获取缓冲区中的音频时长
+ * 
+ * @param buffer 缓冲区句柄
+ * @return uint32_t 时长（毫秒）
+ */
+uint32_t opus_buffer_get_duration_ms(opus_buffer_handle_t buffer);
+
+/**
+ * @brief 获取缓冲区占用统计
+ * 
+ * @param buffer 缓冲区句柄
+ * @param stats 输出统计
+ */
+void opus_buffer_get_stats(opus_buffer_handle_t buffer, opus_buffer_stats_t *stats);
+
+/**
+ * @brief 唤醒阻塞在 opus_buffer_read() 中的消费者（用于停止解码任务）
+ * 
+ * @param buffer 缓冲区句柄
+ */
+void opus_buffer_wake(opus_buffer_handle_t buffer);
+
 /**
  * @brief 清空缓冲区
  * 
+ * 读端无锁，清空由消费者在下一次读取时执行（阻塞中的消费者会被唤醒）。
+ * 
  * @param buffer 缓冲区句柄
  * @return esp_err_t ESP_OK成功
  */
@@ -0,0 +1,184 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\components\xn_coze_chat\sim\esp_opus_sim.c
+ * @Description: Opus 编解码主机仿真 - 只保留包长与时长，不做真实压缩
+ *
+ * 编码：按码率输出 CBR 包，首字节为合法 TOC（宽带 SILK，20/40/60ms 单帧，
+ *       更长时为 code 3 多帧），DTX 开启且整帧静音时只输出 TOC。
+ * 解码：按 TOC 解析时长输出等长静音，真实服务器录制的 Opus 包同样适用；
+ *       PLC 补齐上一包的时长。
+ */
+#include "encoder/impl/esp_opus_enc.h"
+#include "esp_opus_dec.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_TOC_WB_20MS     9       ///< TOC config：SILK 宽带 20ms
+#define SIM_DTX_PEAK        64      ///< 低于该峰值的帧视为静音
+
+typedef struct {
+    esp_opus_enc_config_t cfg;
+    uint32_t frame_bytes;           // 每帧 PCM 字节数
+} sim_opus_enc_t;
+
+typedef struct {
+    esp_opus_dec_cfg_t cfg;
+    uint32_t last_samples;          // 上一包样本数（PLC 用）
+} sim_opus_dec_t;
+
+esp_audio_err_t esp_opus_enc_open(void *cfg, uint32_t cfg_sz, void **enc_hd)
+{
+    if (!cfg || cfg_sz < sizeof(esp_opus_enc_config_t) || !enc_hd) {
+        return ESP_AUDIO_ERR_INVALID_PARAMETER;
+    }
+    sim_opus_enc_t *enc = (sim_opus_enc_t *)calloc(1, sizeof(sim_opus_enc_t));
+    if (!enc) {
+        return ESP_AUDIO_ERR_FAIL;
+    }
+    enc->cfg = *(esp_opus_enc_config_t *)cfg;
+    enc->frame_bytes = enc->cfg.sample_rate * (uint32_t)enc->cfg.frame_duration / 1000 *
+                       enc->cfg.channel * (enc->cfg.bits_per_sample / 8);
+    *enc_hd = enc;
+    return ESP_AUDIO_ERR_OK;
+}
+
+esp_audio_err_t esp_opus_enc_process(void *enc_hd, esp_audio_enc_in_frame_t *in_frame, esp_audio_enc_out_frame_t *out_frame)
+{
+    sim_opus_enc_t *enc = (sim_opus_enc_t *)enc_hd;
+    if (!enc || !in_frame || !out_frame || in_frame->len < enc->frame_bytes) {
+        return ESP_AUDIO_ERR_INVALID_PARAMETER;
+    }
+
+    int ms = (int)enc->cfg.frame_duration;
+    int frames = ms / 20;
+    uint32_t bytes = (uint32_t)enc->cfg.bitrate * (uint32_t)ms / 8000;
+    if (bytes < 3) {
+        bytes = 3;
+    }
+
+    if (enc->cfg.enable_dtx) {
+        const int16_t *pcm = (const int16_t *)in_frame->buffer;
+        int peak = 0;
+        for (uint32_t i = 0; i < enc->frame_bytes / 2; i++) {
+            int v = abs(pcm[i]);
+            if (v > peak) peak = v;
+        }
+        if (peak < SIM_DTX_PEAK) {
+            bytes = 1;
+        }
+    }
+    if (out_frame->len < bytes) {
+        return ESP_AUDIO_ERR_BUFF_NOT_ENOUGH;
+    }
+
+    memset(out_frame->buffer, 0, bytes);
+    if (frames <= 3) {
+        out_frame->buffer[0] = (uint8_t)(((SIM_TOC_WB_20MS + frames - 1) << 3) | 0);
+    } else {
+        out_frame->buffer[0] = (uint8_t)((SIM_TOC_WB_20MS << 3) | 3);
+        if (bytes > 1) {
+            out_frame->buffer[1] = (uint8_t)frames;
+        }
+    }
+    out_frame->encoded_bytes = bytes;
+    return ESP_AUDIO_ERR_OK;
+}
+
+void esp_opus_enc_close(void *enc_hd)
+{
+    free(enc_hd);
+}
+
+esp_audio_err_t esp_opus_dec_open(void *cfg, uint32_t cfg_sz, void **dec_hd)
+{
+    if (!cfg || cfg_sz < sizeof(esp_opus_dec_cfg_t) || !dec_hd) {
+        return ESP_AUDIO_ERR_INVALID_PARAMETER;
+    }
+    sim_opus_dec_t *dec = (sim_opus_dec_t *)calloc(1, sizeof(sim_opus_dec_t));
+    if (!dec) {
+        return ESP_AUDIO_ERR_FAIL;
+    }
+    dec->cfg = *(esp_opus_dec_cfg_t *)cfg;
+    dec->last_samples = dec->cfg.sample_rate / 50;
+    *dec_hd = dec;
+    return ESP_AUDIO_ERR_OK;
+}
+
+/**
+ * @brief 按 TOC 计算包时长（微秒）
+ */
+static uint32_t sim_packet_us(const uint8_t *data, uint32_t len)
+{
+    static const uint32_t silk_us[4] = {10000, 20000, 40000, 60000};
+    static const uint32_t hybrid_us[2] = {10000, 20000};
+    static const uint32_t celt_us[4] = {2500, 5000, 10000, 20000};
+
+    uint8_t config = data[0] >> 3;
+    uint32_t frame_us = config < 12 ? silk_us[config & 3] :
+                        config < 16 ? hybrid_us[config & 1] : celt_us[config & 3];
+    uint32_t count;
+    switch (data[0] & 3) {
+    case 0:
+        count = 1;
+        break;
+    case 1:
+    case 2:
+        count = 2;
+        break;
+    default:
+        count = len > 1 ? (data[1] & 0x3F) : 0;
+        break;
+    }
+    return frame_us * count;
+}
+
+esp_audio_err_t esp_opus_dec_decode(void *dec_hd, esp_audio_dec_in_raw_t *raw, esp_audio_dec_out_frame_t *frame,
+                                    esp_audio_dec_info_t *dec_info)
+{
+    sim_opus_dec_t *dec = (sim_opus_dec_t *)dec_hd;
+    if (!dec || !raw || !frame) {
+        return ESP_AUDIO_ERR_INVALID_PARAMETER;
+    }
+
+    uint32_t samples;
+    if (raw->frame_recover == ESP_AUDIO_DEC_RECOVERY_PLC && (!raw->buffer || raw->len == 0)) {
+        samples = dec->last_samples;
+    } else {
+        if (!raw->buffer || raw->len == 0) {
+            return ESP_AUDIO_ERR_DATA_LACK;
+        }
+        samples = (uint32_t)((uint64_t)sim_packet_us(raw->buffer, raw->len) * dec->cfg.sample_rate / 1000000);
+        if (samples == 0) {
+            return ESP_AUDIO_ERR_FAIL;
+        }
+        raw->consumed = raw->len;
+        if (raw->frame_recover == ESP_AUDIO_DEC_RECOVERY_NONE) {
+            dec->last_samples = samples;
+        }
+    }
+
+    uint32_t bytes = samples * dec->cfg.channel * sizeof(int16_t);
+    if (frame->len < bytes) {
+        frame->needed_size = bytes;
+        return ESP_AUDIO_ERR_BUFF_NOT_ENOUGH;
+    }
+    memset(frame->buffer, 0, bytes);
+    frame->decoded_size = bytes;
+    frame->len = bytes;
+    if (dec_info) {
+        dec_info->sample_rate = dec->cfg.sample_rate;
+        dec_info->channel = dec->cfg.channel;
+        dec_info->bits_per_sample = 16;
+        dec_info->frame_size = (uint16_t)bytes;
+    }
+    return ESP_AUDIO_ERR_OK;
+}
+
+esp_audio_err_t esp_opus_dec_close(void *dec_hd)
+{
+    free(dec_hd);
+    return ESP_AUDIO_ERR_OK;
+}
@@ -0,0 +1,65 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\components\xn_coze_chat\sim\include\encoder\impl\esp_opus_enc.h
+ * @Description: 主机仿真用 Opus 编码器接口（esp_audio_codec 同名子集，esp_audio_codec 没有主机库）
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_opus_dec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    ESP_OPUS_ENC_FRAME_DURATION_20_MS = 20,
+    ESP_OPUS_ENC_FRAME_DURATION_40_MS = 40,
+    ESP_OPUS_ENC_FRAME_DURATION_60_MS = 60,
+    ESP_OPUS_ENC_FRAME_DURATION_80_MS = 80,
+    ESP_OPUS_ENC_FRAME_DURATION_100_MS = 100,
+    ESP_OPUS_ENC_FRAME_DURATION_120_MS = 120,
+} esp_opus_enc_frame_duration_t;
+
+typedef enum {
+    ESP_OPUS_ENC_APPLICATION_VOIP = 0,
+    ESP_OPUS_ENC_APPLICATION_AUDIO,
+    ESP_OPUS_ENC_APPLICATION_LOWDELAY,
+} esp_opus_enc_application_t;
+
+typedef struct {
+    uint32_t sample_rate;
+    uint8_t channel;
+    uint8_t bits_per_sample;
+    int bitrate;
+    esp_opus_enc_frame_duration_t frame_duration;
+    esp_opus_enc_application_t application_mode;
+    int complexity;
+    bool enable_fec;
+    bool enable_dtx;
+    bool enable_vbr;
+} esp_opus_enc_config_t;
+
+typedef struct {
+    uint8_t *buffer;
+    uint32_t len;
+} esp_audio_enc_in_frame_t;
+
+typedef struct {
+    uint8_t *buffer;
+    uint32_t len;
+    uint32_t encoded_bytes;
+    uint64_t pts;
+} esp_audio_enc_out_frame_t;
+
+esp_audio_err_t esp_opus_enc_open(void *cfg, uint32_t cfg_sz, void **enc_hd);
+esp_audio_err_t esp_opus_enc_process(void *enc_hd, esp_audio_enc_in_frame_t *in_frame, esp_audio_enc_out_frame_t *out_frame);
+void esp_opus_enc_close(void *enc_hd);
+
+#ifdef __cplusplus
+}
+#endif
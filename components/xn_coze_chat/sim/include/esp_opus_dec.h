@@ -0,0 +1,71 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\components\xn_coze_chat\sim\include\esp_opus_dec.h
+ * @Description: 主机仿真用 Opus 解码器接口（esp_audio_codec 同名子集，esp_audio_codec 没有主机库）
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int esp_audio_err_t;
+
+#define ESP_AUDIO_ERR_OK                0
+#define ESP_AUDIO_ERR_FAIL              -1
+#define ESP_AUDIO_ERR_INVALID_PARAMETER -3
+#define ESP_AUDIO_ERR_BUFF_NOT_ENOUGH   -5
+#define ESP_AUDIO_ERR_DATA_LACK         -6
+
+typedef enum {
+    ESP_AUDIO_DEC_RECOVERY_NONE = 0,
+    ESP_AUDIO_DEC_RECOVERY_PLC = 1,
+} esp_audio_dec_recovery_t;
+
+typedef struct {
+    uint8_t *buffer;
+    uint32_t len;
+    uint32_t consumed;
+    esp_audio_dec_recovery_t frame_recover;
+} esp_audio_dec_in_raw_t;
+
+typedef struct {
+    uint8_t *buffer;
+    uint32_t len;
+    uint32_t needed_size;
+    uint32_t decoded_size;
+} esp_audio_dec_out_frame_t;
+
+typedef struct {
+    uint32_t sample_rate;
+    uint8_t channel;
+    uint8_t bits_per_sample;
+    uint32_t bitrate;
+    uint16_t frame_size;
+} esp_audio_dec_info_t;
+
+typedef enum {
+    ESP_OPUS_DEC_FRAME_DURATION_INVALID = -1,
+} esp_opus_dec_frame_duration_t;
+
+typedef struct {
+    uint32_t sample_rate;
+    uint8_t channel;
+    esp_opus_dec_frame_duration_t frame_duration;
+    bool self_delimited;
+} esp_opus_dec_cfg_t;
+
+esp_audio_err_t esp_opus_dec_open(void *cfg, uint32_t cfg_sz, void **dec_hd);
+esp_audio_err_t esp_opus_dec_decode(void *dec_hd, esp_audio_dec_in_raw_t *raw, esp_audio_dec_out_frame_t *frame,
+                                    esp_audio_dec_info_t *dec_info);
+esp_audio_err_t esp_opus_dec_close(void *dec_hd);
+
+#ifdef __cplusplus
+}
+#endif
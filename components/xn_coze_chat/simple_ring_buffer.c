@@ -190,3 +190,12 @@ void simple_ring_buffer_clear(simple_ring_buffer_handle_t rb)
     }
 }
 
+
+void simple_ring_buffer_wake(simple_ring_buffer_handle_t rb)
+{
+    if (!rb) {
+        return;
+    }
+
+    xSemaphoreGive(rb->data_sem);
+}
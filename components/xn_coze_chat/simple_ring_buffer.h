@@ -80,6 +80,15 @@ size_t simple_ring_buffer_available(simple_ring_buffer_handle_t rb);
  */
 void simple_ring_buffer_clear(simple_ring_buffer_handle_t rb);
 
+/**
+ * @brief 唤醒阻塞在读取上的任务
+ * 
+ * 读取方立即返回（无数据时返回 0），用于停止读取任务时不必等满读取超时。
+ * 
+ * @param rb 缓冲区句柄
+ */
+void simple_ring_buffer_wake(simple_ring_buffer_handle_t rb);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,311 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\components\xn_coze_chat\ws_msg_queue.c
+ * @Description: WebSocket 接收消息队列实现 - 变长记录环形区，原子发布，丢弃/阻塞策略
+ */
+
+#include "ws_msg_queue.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdatomic.h>
+#include <string.h>
+
+static const char *TAG = "WS_MSG_QUEUE";
+
+#define WS_MSG_REC_ALIGN    4               ///< 记录对齐
+#define WS_MSG_REC_WRAP     0xFFFFFFFFu     ///< 环绕标记：读端遇到后回到起点
+
+/**
+ * @brief 记录头
+ */
+typedef struct {
+    uint32_t len;                   ///< 消息长度，或 WS_MSG_REC_WRAP
+} ws_msg_rec_hdr_t;
+
+/**
+ * @brief 消息队列结构体
+ *
+ * 记录区：[hdr|data|'\0'|pad][hdr|data|'\0'|pad]...[WRAP]
+ * 记录总是连续存放，尾部放不下时写环绕标记（剩余不足一个记录头时读端隐式环绕）从头开始。
+ * head 只由生产者推进、tail 只由消费者推进，head == tail 表示空，写入永远不会让 head 追上 tail。
+ */
+typedef struct ws_msg_queue_s {
+    uint8_t *buffer;                ///< 记录区（PSRAM）
+    size_t size;                    ///< 记录区大小
+    size_t max_len;                 ///< 单条消息最大长度
+    ws_msg_queue_policy_t policy;   ///< 队列满策略
+    uint32_t block_timeout_ms;      ///< 阻塞等待上限
+
+    atomic_size_t head;             ///< 已发布的写位置（生产者）
+    atomic_size_t tail;             ///< 已释放的读位置（消费者）
+
+    // 生产者私有
+    char *resv_buf;                 ///< 当前预留的数据地址
+    size_t resv_pos;                ///< 当前预留的记录起点
+    bool resv_wrapped;              ///< 预留时发生了环绕
+
+    // 消费者私有
+    size_t cons_next;               ///< 当前消息释放后的读位置
+
+    SemaphoreHandle_t data_sem;     ///< 有新消息
+    SemaphoreHandle_t space_sem;    ///< 有空间释放
+
+    // 统计
+    atomic_uint committed;
+    atomic_uint released;
+    uint32_t dropped;
+    uint32_t blocked;
+    size_t peak_bytes;
+} ws_msg_queue_t;
+
+static inline size_t rec_size(size_t len)
+{
+    return (sizeof(ws_msg_rec_hdr_t) + len + 1 + WS_MSG_REC_ALIGN - 1) & ~(size_t)(WS_MSG_REC_ALIGN - 1);
+}
+
+static inline size_t used_bytes(ws_msg_queue_t *q, size_t head, size_t tail)
+{
+    return (head + q->size - tail) % q->size;
+}
+
+ws_msg_queue_handle_t ws_msg_queue_create(const ws_msg_queue_config_t *config)
+{
+    if (!config || config->size < 1024) {
+        ESP_LOGE(TAG, "无效的配置参数");
+        return NULL;
+    }
+
+    ws_msg_queue_t *q = (ws_msg_queue_t *)calloc(1, sizeof(ws_msg_queue_t));
+    if (!q) {
+        ESP_LOGE(TAG, "句柄分配失败");
+        return NULL;
+    }
+
+    q->size = config->size & ~(size_t)(WS_MSG_REC_ALIGN - 1);
+    // 队列为空时无论读写位置在哪，不超过一半的记录总能放下
+    size_t min_size = (config->min_msg_len + WS_MSG_REC_ALIGN * 2 + sizeof(ws_msg_rec_hdr_t)) * 2;
+    if (q->size < min_size) {
+        ESP_LOGW(TAG, "⚠️ 记录区 %d 字节放不下 %d 字节的消息，增大到 %d 字节",
+                 (int)q->size, (int)config->min_msg_len, (int)min_size);
+        q->size = min_size;
+    }
+    q->max_len = q->size / 2 - WS_MSG_REC_ALIGN * 2 - sizeof(ws_msg_rec_hdr_t);
+    q->policy = config->policy;
+    q->block_timeout_ms = config->block_timeout_ms;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->committed, 0);
+    atomic_init(&q->released, 0);
+
+    q->buffer = (uint8_t *)heap_caps_malloc(q->size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    q->data_sem = xSemaphoreCreateBinary();
+    q->space_sem = xSemaphoreCreateBinary();
+
+    if (!q->buffer || !q->data_sem || !q->space_sem) {
+        ESP_LOGE(TAG, "资源分配失败: %d bytes", (int)q->size);
+        ws_msg_queue_destroy(q);
+        return NULL;
+    }
+
+    ESP_LOGI(TAG, "✅ 消息队列创建成功: %.1f KB PSRAM, 单条最大 %d 字节, 满时%s",
+             q->size / 1024.0f, (int)q->max_len,
+             q->policy == WS_MSG_QUEUE_BLOCK ? "阻塞" : "丢弃新消息");
+    return q;
+}
+
+void ws_msg_queue_destroy(ws_msg_queue_handle_t queue)
+{
+    if (!queue) return;
+
+    if (queue->data_sem) {
+        vSemaphoreDelete(queue->data_sem);
+    }
+    if (queue->space_sem) {
+        vSemaphoreDelete(queue->space_sem);
+    }
+    if (queue->buffer) {
+        heap_caps_free(queue->buffer);
+    }
+    free(queue);
+}
+
+/**
+ * @brief 尝试预留 need 字节的连续空间
+ */
+static bool try_reserve(ws_msg_queue_t *q, size_t need)
+{
+    size_t h = atomic_load_explicit(&q->head, memory_order_relaxed);
+    size_t t = atomic_load_explicit(&q->tail, memory_order_acquire);
+
+    if (h >= t) {
+        // 尾部空间：写满到末尾时 head 回到 0，此时 tail 不能为 0
+        if (h + need < q->size || (h + need == q->size && t > 0)) {
+            q->resv_pos = h;
+            q->resv_wrapped = false;
+            return true;
+        }
+        // 环绕到起点
+        if (need < t) {
+            q->resv_pos = 0;
+            q->resv_wrapped = true;
+            return true;
+        }
+        return false;
+    }
+
+    if (need < t - h) {
+        q->resv_pos = h;
+        q->resv_wrapped = false;
+        return true;
+    }
+    return false;
+}
+
+char *ws_msg_queue_acquire(ws_msg_queue_handle_t queue, size_t len)
+{
+    if (!queue) {
+        return NULL;
+    }
+
+    if (len > queue->max_len) {
+        queue->dropped++;
+        ESP_LOGE(TAG, "❌ 消息过大: %d > %d 字节，已丢弃", (int)len, (int)queue->max_len);
+        return NULL;
+    }
+
+    size_t need = rec_size(len);
+    if (!try_reserve(queue, need)) {
+        if (queue->policy == WS_MSG_QUEUE_BLOCK && queue->block_timeout_ms > 0) {
+            queue->blocked++;
+            TickType_t start = xTaskGetTickCount();
+            TickType_t limit = pdMS_TO_TICKS(queue->block_timeout_ms);
+            bool ok = false;
+            while (!ok) {
+                TickType_t waited = xTaskGetTickCount() - start;
+                if (waited >= limit || xSemaphoreTake(queue->space_sem, limit - waited) != pdTRUE) {
+                    break;
+                }
+                ok = try_reserve(queue, need);
+            }
+            if (!ok) {
+                ok = try_reserve(queue, need);
+            }
+            if (!ok) {
+                queue->dropped++;
+                ESP_LOGW(TAG, "⚠️ 等待 %lu ms 仍无空间，丢弃消息 %d 字节 (累计丢弃 %lu)",
+                         queue->block_timeout_ms, (int)len, queue->dropped);
+                return NULL;
+            }
+        } else {
+            queue->dropped++;
+            ESP_LOGW(TAG, "⚠️ 队列满，丢弃消息 %d 字节 (累计丢弃 %lu)", (int)len, queue->dropped);
+            return NULL;
+        }
+    }
+
+    queue->resv_buf = (char *)(queue->buffer + queue->resv_pos + sizeof(ws_msg_rec_hdr_t));
+    return queue->resv_buf;
+}
+
+esp_err_t ws_msg_queue_commit(ws_msg_queue_handle_t queue, char *buf, size_t len)
+{
+    if (!queue || !buf || buf != queue->resv_buf || len > queue->max_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t h = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+    // 尾部放不下时留下环绕标记（不足一个记录头时读端隐式环绕）
+    if (queue->resv_wrapped && queue->size - h >= sizeof(ws_msg_rec_hdr_t)) {
+        ws_msg_rec_hdr_t wrap = { .len = WS_MSG_REC_WRAP };
+        memcpy(queue->buffer + h, &wrap, sizeof(wrap));
+    }
+
+    ws_msg_rec_hdr_t hdr = { .len = (uint32_t)len };
+    memcpy(queue->buffer + queue->resv_pos, &hdr, sizeof(hdr));
+    buf[len] = '\0';
+
+    // 原子发布：记录内容先于 head 对消费者可见
+    size_t next = (queue->resv_pos + rec_size(len)) % queue->size;
+    atomic_store_explicit(&queue->head, next, memory_order_release);
+    queue->resv_buf = NULL;
+    atomic_fetch_add_explicit(&queue->committed, 1, memory_order_relaxed);
+
+    size_t used = used_bytes(queue, next, atomic_load_explicit(&queue->tail, memory_order_relaxed));
+    if (used > queue->peak_bytes) {
+        queue->peak_bytes = used;
+    }
+
+    xSemaphoreGive(queue->data_sem);
+    return ESP_OK;
+}
+
+void ws_msg_queue_abort(ws_msg_queue_handle_t queue, char *buf)
+{
+    if (!queue || buf != queue->resv_buf) return;
+
+    // 未发布的预留不占用任何空间
+    queue->resv_buf = NULL;
+}
+
+esp_err_t ws_msg_queue_receive(ws_msg_queue_handle_t queue, ws_msg_t *msg, uint32_t timeout_ms)
+{
+    if (!queue || !msg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t r = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    while (r == atomic_load_explicit(&queue->head, memory_order_acquire)) {
+        if (xSemaphoreTake(queue->data_sem, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    // 处理环绕
+    ws_msg_rec_hdr_t hdr;
+    if (queue->size - r < sizeof(hdr)) {
+        r = 0;
+    } else {
+        memcpy(&hdr, queue->buffer + r, sizeof(hdr));
+        if (hdr.len == WS_MSG_REC_WRAP) {
+            r = 0;
+        }
+    }
+
+    memcpy(&hdr, queue->buffer + r, sizeof(hdr));
+    msg->data = (char *)(queue->buffer + r + sizeof(hdr));
+    msg->len = hdr.len;
+    queue->cons_next = (r + rec_size(hdr.len)) % queue->size;
+    return ESP_OK;
+}
+
+void ws_msg_queue_release(ws_msg_queue_handle_t queue, const ws_msg_t *msg)
+{
+    if (!queue || !msg) return;
+
+    atomic_store_explicit(&queue->tail, queue->cons_next, memory_order_release);
+    atomic_fetch_add_explicit(&queue->released, 1, memory_order_relaxed);
+
+    if (queue->policy == WS_MSG_QUEUE_BLOCK) {
+        xSemaphoreGive(queue->space_sem);
+    }
+}
+
+void ws_msg_queue_get_stats(ws_msg_queue_handle_t queue, ws_msg_queue_stats_t *stats)
+{
+    if (!queue || !stats) return;
+
+    uint32_t committed = atomic_load(&queue->committed);
+    stats->committed = committed;
+    stats->dropped = queue->dropped;
+    stats->blocked = queue->blocked;
+    stats->pending = committed - atomic_load(&queue->released);
+    stats->used_bytes = used_bytes(queue, atomic_load(&queue->head), atomic_load(&queue->tail));
+    stats->peak_bytes = queue->peak_bytes;
+}
@@ -0,0 +1,143 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\components\xn_coze_chat\ws_msg_queue.h
+ * @Description: WebSocket 接收消息队列 - 连续内存中的变长记录，单生产者/单消费者
+ *
+ * 接收流程（每条消息只复制一次，无堆分配）：
+ *   WebSocket 任务：acquire(整条消息长度) → 各分片 memcpy 到记录 → commit（原子发布）
+ *   解析任务：    receive(取得记录指针) → 原地解析 → release
+ *
+ * 记录按实际长度占用空间，队列满时按策略丢弃新消息或阻塞等待，
+ * 已发布的消息不会被覆盖，不存在长度与数据错位的问题。
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 消息队列句柄（不透明类型）
+ */
+typedef struct ws_msg_queue_s *ws_msg_queue_handle_t;
+
+/**
+ * @brief 队列满时的处理策略
+ */
+typedef enum {
+    WS_MSG_QUEUE_DROP_NEWEST = 0,   ///< 立即丢弃新消息
+    WS_MSG_QUEUE_BLOCK,             ///< 阻塞生产者等待空间（超时后丢弃），对端由 TCP 流控减速
+} ws_msg_queue_policy_t;
+
+/**
+ * @brief 消息队列配置
+ */
+typedef struct {
+    size_t size;                    ///< 记录区大小（字节），单条消息最大约为其一半
+    ws_msg_queue_policy_t policy;   ///< 队列满时的策略
+    uint32_t block_timeout_ms;      ///< BLOCK 策略的最长等待时间
+    size_t min_msg_len;             ///< 必须能容纳的单条消息长度（0 不限制），size 不够时自动增大
+} ws_msg_queue_config_t;
+
+/**
+ * @brief 消息（解析任务取得的只读视图）
+ */
+typedef struct {
+    char *data;                     ///< 消息数据（以 '\0' 结尾），release 前有效
+    size_t len;                     ///< 消息长度
+} ws_msg_t;
+
+/**
+ * @brief 队列统计
+ */
+typedef struct {
+    uint32_t committed;             ///< 已发布消息数
+    uint32_t dropped;               ///< 丢弃消息数（队列满或消息过大）
+    uint32_t blocked;               ///< 生产者因队列满而等待的次数
+    size_t pending;                 ///< 待解析消息数
+    size_t used_bytes;              ///< 当前占用字节
+    size_t peak_bytes;              ///< 占用峰值
+} ws_msg_queue_stats_t;
+
+/**
+ * @brief 创建消息队列（记录区在 PSRAM 中一次性分配）
+ *
+ * @param config 配置参数
+ * @return ws_msg_queue_handle_t 句柄，失败返回 NULL
+ */
+ws_msg_queue_handle_t ws_msg_queue_create(const ws_msg_queue_config_t *config);
+
+/**
+ * @brief 销毁消息队列
+ *
+ * @param queue 句柄
+ */
+void ws_msg_queue_destroy(ws_msg_queue_handle_t queue);
+
+/**
+ * @brief 为一条新消息预留记录（生产者）
+ *
+ * 同一时刻只能有一条未提交的预留。
+ *
+ * @param queue 句柄
+ * @param len 整条消息长度
+ * @return char* 记录写入地址，空间不足（按策略处理后）或消息过大返回 NULL（消息被丢弃）
+ */
+char *ws_msg_queue_acquire(ws_msg_queue_handle_t queue, size_t len);
+
+/**
+ * @brief 发布已写满的记录，交给解析任务
+ *
+ * @param queue 句柄
+ * @param buf acquire 返回的地址
+ * @param len 消息长度（须与 acquire 一致）
+ * @return esp_err_t ESP_OK 成功
+ */
+esp_err_t ws_msg_queue_commit(ws_msg_queue_handle_t queue, char *buf, size_t len);
+
+/**
+ * @brief 放弃已预留的记录（消息未收齐，例如连接中断）
+ *
+ * @param queue 句柄
+ * @param buf acquire 返回的地址
+ */
+void ws_msg_queue_abort(ws_msg_queue_handle_t queue, char *buf);
+
+/**
+ * @brief 取出最早发布的消息（消费者）
+ *
+ * @param queue 句柄
+ * @param msg 输出消息视图
+ * @param timeout_ms 等待超时
+ * @return esp_err_t ESP_OK 成功，ESP_ERR_TIMEOUT 超时
+ */
+esp_err_t ws_msg_queue_receive(ws_msg_queue_handle_t queue, ws_msg_t *msg, uint32_t timeout_ms);
+
+/**
+ * @brief 归还已处理完的消息，释放其空间
+ *
+ * @param queue 句柄
+ * @param msg receive 取得的消息
+ */
+void ws_msg_queue_release(ws_msg_queue_handle_t queue, const ws_msg_t *msg);
+
+/**
+ * @brief 获取队列统计
+ *
+ * @param queue 句柄
+ * @param stats 输出统计
+ */
+void ws_msg_queue_get_stats(ws_msg_queue_handle_t queue, ws_msg_queue_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
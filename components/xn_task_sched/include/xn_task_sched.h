@@ -0,0 +1,136 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\components\xn_task_sched\include\xn_task_sched.h
+ * @Description: 音频/网络任务调度档案 - 统一分配各任务的核心、优先级与栈位置
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define XN_TASK_CORE_ANY    (-1)        ///< 不绑定核心
+
+/** 任务栈位置 */
+typedef enum {
+    XN_TASK_STACK_INTERNAL = 0,         ///< 内部 RAM（访问快，容量紧张）
+    XN_TASK_STACK_PSRAM,                ///< PSRAM（TCB 仍在内部 RAM）
+} xn_task_stack_t;
+
+/** 受调度档案管理的任务 */
+typedef enum {
+    XN_TASK_AUDIO_MGR = 0,              ///< audio_mgr 状态机任务
+    XN_TASK_PLAYBACK,                   ///< playback 播放任务
+    XN_TASK_AFE_FEED,                   ///< AFE Feed 任务
+    XN_TASK_AFE_FETCH,                  ///< AFE Fetch 任务
+    XN_TASK_BUTTON,                     ///< 按键任务
+    XN_TASK_OPUS_DECODE,                ///< opus_decode 下行解码任务
+    XN_TASK_COZE_PARSER,                ///< coze_parser JSON 解析任务
+    XN_TASK_AUDIO_UPLINK,               ///< audio_uplink 上行编码/发送任务
+    XN_TASK_WEBSOCKET,                  ///< esp_websocket_client 收发任务
+    XN_TASK_TTS_SYNTH,                  ///< tts_synth 本地 TTS 合成任务
+    XN_TASK_WS_SEND,                    ///< coze_ws_send WebSocket 发送队列任务
+    XN_TASK_ID_MAX,
+} xn_task_id_t;
+
+/** 单个任务的调度参数 */
+typedef struct {
+    int8_t core;                        ///< 运行核心（0/1，XN_TASK_CORE_ANY 不绑定）
+    uint8_t priority;                   ///< 任务优先级
+    uint32_t stack_size;                ///< 栈大小（字节）
+    xn_task_stack_t stack;              ///< 栈位置
+} xn_task_sched_t;
+
+/** 调度档案：每个任务一组参数 */
+typedef struct {
+    const char *name;                   ///< 档案名称
+    xn_task_sched_t task[XN_TASK_ID_MAX]; ///< 各任务调度参数
+} xn_sched_profile_t;
+
+/** 内置预设档案 */
+typedef enum {
+    XN_SCHED_PRESET_BALANCED = 0,       ///< 均衡（默认）：与原先各模块写死的参数一致
+    // 以下两个预设只调整核心与优先级（按任务职责推定，尚未在实机上测量验证），栈大小与位置同 balanced
+    XN_SCHED_PRESET_LOW_LATENCY,        ///< 低延迟：音频路径优先级高于网络，解码与播放同核
+    XN_SCHED_PRESET_WIFI_HEAVY,         ///< WiFi 繁忙：实时音频集中到 CPU1，网络侧任务与 WiFi 共用 CPU0
+    XN_SCHED_PRESET_MAX,
+} xn_sched_preset_t;
+
+/** 由调度档案创建的任务（记录静态任务的 TCB 与栈，用于退出后释放） */
+typedef struct {
+    TaskHandle_t handle;                ///< 任务句柄
+    StaticTask_t *tcb;                  ///< 任务控制块（内部 RAM）
+    StackType_t *stack;                 ///< 任务栈（按档案放在内部 RAM 或 PSRAM）
+} xn_task_t;
+
+/**
+ * @brief 获取内置预设档案
+ * @param preset 预设
+ * @return 档案指针，预设无效时返回均衡档案
+ */
+const xn_sched_profile_t *xn_sched_get_preset(xn_sched_preset_t preset);
+
+/**
+ * @brief 按名称查找内置预设（"balanced"/"low-latency"/"wifi-heavy"）
+ * @param name 名称
+ * @return 档案指针，未找到返回 NULL
+ */
+const xn_sched_profile_t *xn_sched_find_preset(const char *name);
+
+/**
+ * @brief 获取某任务的调度参数
+ * @param profile 调度档案（NULL 使用均衡档案）
+ * @param id 任务标识
+ * @return 调度参数
+ */
+const xn_task_sched_t *xn_sched_get(const xn_sched_profile_t *profile, xn_task_id_t id);
+
+/**
+ * @brief 按调度参数创建任务
+ * 
+ * 统一使用静态任务（xTaskCreateStaticPinnedToCore）：TCB 分配在内部 RAM，
+ * 栈按调度参数分配在内部 RAM 或 PSRAM，由 xn_task_join 在任务退出后释放。
+ * 
+ * @param task 输出任务信息
+ * @param sched 调度参数
+ * @param fn 任务函数
+ * @param name 任务名称
+ * @param arg 任务参数
+ * @return ESP_OK 成功，ESP_ERR_NO_MEM 内存不足
+ */
+esp_err_t xn_task_create(xn_task_t *task, const xn_task_sched_t *sched,
+                         TaskFunction_t fn, const char *name, void *arg);
+
+/**
+ * @brief 等待任务退出并释放其 TCB 与栈
+ * 
+ * 任务应已被通知退出（自行 vTaskDelete(NULL)）；超时仍未退出则强制删除。
+ * 强制删除时任务可能正停在任意位置（持有锁、取出一半的队列项等），
+ * 调用方据返回值决定其共享资源能否安全释放。
+ * 
+ * @param task 任务信息
+ * @param timeout_ms 等待超时（毫秒），0 表示直接删除
+ * @return ESP_OK 任务已自行退出（或无任务），ESP_ERR_TIMEOUT 超时后被强制删除
+ */
+esp_err_t xn_task_join(xn_task_t *task, uint32_t timeout_ms);
+
+/**
+ * @brief 打印各任务实际 CPU 占用（自上次调用以来，基于 uxTaskGetSystemState）
+ * 
+ * 需开启 CONFIG_FREERTOS_USE_TRACE_FACILITY 与 CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS。
+ * 首次调用以启动时刻为基准。
+ */
+void xn_sched_dump_cpu_usage(void);
+
+#ifdef __cplusplus
+}
+#endif
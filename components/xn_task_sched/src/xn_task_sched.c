@@ -0,0 +1,257 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\components\xn_task_sched\src\xn_task_sched.c
+ * @Description: 音频/网络任务调度档案实现
+ */
+#include "xn_task_sched.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+static const char *TAG = "TASK_SCHED";
+
+#define XN_SCHED_MAX_TRACKED    48      ///< CPU 占用统计最多跟踪的任务数
+#define XN_TASK_JOIN_POLL_MS    10      ///< 等待任务退出的轮询间隔
+#define XN_TASK_CLEANUP_MS      20      ///< 任务删除后留给 IDLE 任务清理的时间
+
+/*
+ * 预设说明（双核 ESP32-S3，WiFi/LwIP 任务默认在 CPU0，优先级 18~23）：
+ * - balanced：各模块原先写死的参数，AFE Feed/播放在 CPU1，Fetch/解码/解析在 CPU0。
+ * - low-latency：播放、AFE、解码优先级高于所有网络任务，解码移到 CPU1 与播放同核；
+ *   适合信号稳定、追求首包与打断响应的场景。
+ * - wifi-heavy：Feed/Fetch/播放全部集中到 CPU1，CPU0 只留网络侧任务（有缓冲，可容忍抖动），
+ *   避免 WiFi 突发占用 CPU0 导致 AFE 环形缓冲溢出。
+ * 栈大小与栈位置三个预设相同，均沿用各模块原有数值（没有栈高水位测量数据，不做改动）；
+ * 预设之间只有核心与优先级不同，low-latency 与 wifi-heavy 的取值按任务职责推定，未经实机测量。
+ * 切换预设后用 xn_sched_dump_cpu_usage()（同时打印 CPU 占用与栈余量）在实机上核对并调整。
+ */
+static const xn_sched_profile_t s_presets[XN_SCHED_PRESET_MAX] = {
+    [XN_SCHED_PRESET_BALANCED] = {
+        .name = "balanced",
+        .task = {
+            [XN_TASK_AUDIO_MGR]    = { 0,                7, 6 * 1024,  XN_TASK_STACK_INTERNAL },
+            [XN_TASK_PLAYBACK]     = { 1,                7, 5 * 1024,  XN_TASK_STACK_INTERNAL },
+            [XN_TASK_AFE_FEED]     = { 1,                8, 10 * 1024, XN_TASK_STACK_INTERNAL },
+            [XN_TASK_AFE_FETCH]    = { 0,                8, 10 * 1024, XN_TASK_STACK_INTERNAL },
+            [XN_TASK_BUTTON]       = { XN_TASK_CORE_ANY, 4, 4 * 1024,  XN_TASK_STACK_PSRAM },
+            [XN_TASK_OPUS_DECODE]  = { 0,                5, 8 * 1024,  XN_TASK_STACK_PSRAM },
+            [XN_TASK_COZE_PARSER]  = { 0,                6, 16 * 1024, XN_TASK_STACK_PSRAM },
+            [XN_TASK_AUDIO_UPLINK] = { XN_TASK_CORE_ANY, 6, 24 * 1024, XN_TASK_STACK_INTERNAL },
+            [XN_TASK_WEBSOCKET]    = { XN_TASK_CORE_ANY, 5, 4 * 1024,  XN_TASK_STACK_INTERNAL },
+            [XN_TASK_TTS_SYNTH]    = { 0,                5, 8 * 1024,  XN_TASK_STACK_PSRAM },
+            [XN_TASK_WS_SEND]      = { XN_TASK_CORE_ANY, 6, 6 * 1024,  XN_TASK_STACK_INTERNAL },
+        },
+    },
+    [XN_SCHED_PRESET_LOW_LATENCY] = {
+        .name = "low-latency",
+        .task = {
+            [XN_TASK_AUDIO_MGR]    = { 0,                7,  6 * 1024,  XN_TASK_STACK_INTERNAL },
+            [XN_TASK_PLAYBACK]     = { 1,                10, 5 * 1024,  XN_TASK_STACK_INTERNAL },
+            [XN_TASK_AFE_FEED]     = { 1,                9,  10 * 1024, XN_TASK_STACK_INTERNAL },
+            [XN_TASK_AFE_FETCH]    = { 0,                9,  10 * 1024, XN_TASK_STACK_INTERNAL },
+            [XN_TASK_BUTTON]       = { XN_TASK_CORE_ANY, 4,  4 * 1024,  XN_TASK_STACK_PSRAM },
+            [XN_TASK_OPUS_DECODE]  = { 1,                8,  8 * 1024,  XN_TASK_STACK_PSRAM },
+            [XN_TASK_COZE_PARSER]  = { 0,                7,  16 * 1024, XN_TASK_STACK_PSRAM },
+            [XN_TASK_AUDIO_UPLINK] = { 1,                7,  24 * 1024, XN_TASK_STACK_INTERNAL },
+            [XN_TASK_WEBSOCKET]    = { XN_TASK_CORE_ANY, 6,  4 * 1024,  XN_TASK_STACK_INTERNAL },
+            [XN_TASK_TTS_SYNTH]    = { 1,                8,  8 * 1024,  XN_TASK_STACK_PSRAM },
+            [XN_TASK_WS_SEND]      = { XN_TASK_CORE_ANY, 6,  6 * 1024,  XN_TASK_STACK_INTERNAL },
+        },
+    },
+    [XN_SCHED_PRESET_WIFI_HEAVY] = {
+        .name = "wifi-heavy",
+        .task = {
+            [XN_TASK_AUDIO_MGR]    = { 0,                7, 6 * 1024,  XN_TASK_STACK_INTERNAL },
+            [XN_TASK_PLAYBACK]     = { 1,                8, 5 * 1024,  XN_TASK_STACK_INTERNAL },
+            [XN_TASK_AFE_FEED]     = { 1,                9, 10 * 1024, XN_TASK_STACK_INTERNAL },
+            [XN_TASK_AFE_FETCH]    = { 1,                8, 10 * 1024, XN_TASK_STACK_INTERNAL },
+            [XN_TASK_BUTTON]       = { XN_TASK_CORE_ANY, 4, 4 * 1024,  XN_TASK_STACK_PSRAM },
+            [XN_TASK_OPUS_DECODE]  = { 0,                5, 8 * 1024,  XN_TASK_STACK_PSRAM },
+            [XN_TASK_COZE_PARSER]  = { 0,                5, 16 * 1024, XN_TASK_STACK_PSRAM },
+            [XN_TASK_AUDIO_UPLINK] = { 0,                5, 24 * 1024, XN_TASK_STACK_INTERNAL },
+            [XN_TASK_WEBSOCKET]    = { XN_TASK_CORE_ANY, 5, 4 * 1024,  XN_TASK_STACK_INTERNAL },
+            [XN_TASK_TTS_SYNTH]    = { 1,                5, 8 * 1024,  XN_TASK_STACK_PSRAM },
+            [XN_TASK_WS_SEND]      = { 0,                5, 6 * 1024,  XN_TASK_STACK_INTERNAL },
+        },
+    },
+};
+
+const xn_sched_profile_t *xn_sched_get_preset(xn_sched_preset_t preset)
+{
+    if (preset >= XN_SCHED_PRESET_MAX) {
+        return &s_presets[XN_SCHED_PRESET_BALANCED];
+    }
+    return &s_presets[preset];
+}
+
+const xn_sched_profile_t *xn_sched_find_preset(const char *name)
+{
+    if (!name) {
+        return NULL;
+    }
+    for (int i = 0; i < XN_SCHED_PRESET_MAX; i++) {
+        if (strcmp(s_presets[i].name, name) == 0) {
+            return &s_presets[i];
+        }
+    }
+    return NULL;
+}
+
+const xn_task_sched_t *xn_sched_get(const xn_sched_profile_t *profile, xn_task_id_t id)
+{
+    if (!profile) {
+        profile = &s_presets[XN_SCHED_PRESET_BALANCED];
+    }
+    if (id >= XN_TASK_ID_MAX) {
+        id = XN_TASK_AUDIO_MGR;
+    }
+    return &profile->task[id];
+}
+
+esp_err_t xn_task_create(xn_task_t *task, const xn_task_sched_t *sched,
+                         TaskFunction_t fn, const char *name, void *arg)
+{
+    if (!task || !sched || !fn) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(task, 0, sizeof(*task));
+
+    // 统一使用静态任务：TCB 固定在内部 RAM，栈按档案放置，退出后可由 xn_task_join 安全回收
+    uint32_t stack_caps = (sched->stack == XN_TASK_STACK_PSRAM)
+                          ? (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+                          : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    task->tcb = (StaticTask_t *)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    task->stack = (StackType_t *)heap_caps_malloc(sched->stack_size, stack_caps);
+    if (!task->tcb || !task->stack) {
+        ESP_LOGE(TAG, "❌ 任务 %s 内存分配失败（栈 %" PRIu32 " 字节）", name, sched->stack_size);
+        heap_caps_free(task->tcb);
+        heap_caps_free(task->stack);
+        memset(task, 0, sizeof(*task));
+        return ESP_ERR_NO_MEM;
+    }
+
+    BaseType_t core = (sched->core == XN_TASK_CORE_ANY) ? tskNO_AFFINITY : sched->core;
+    task->handle = xTaskCreateStaticPinnedToCore(fn, name, sched->stack_size / sizeof(StackType_t),
+                                                 arg, sched->priority, task->stack, task->tcb, core);
+    if (!task->handle) {
+        ESP_LOGE(TAG, "❌ 任务 %s 创建失败", name);
+        heap_caps_free(task->tcb);
+        heap_caps_free(task->stack);
+        memset(task, 0, sizeof(*task));
+        return ESP_FAIL;
+    }
+
+    ESP_LOGD(TAG, "任务 %s: 核心 %d, 优先级 %d, 栈 %" PRIu32 " 字节（%s）", name, sched->core,
+             sched->priority, sched->stack_size,
+             sched->stack == XN_TASK_STACK_PSRAM ? "PSRAM" : "内部RAM");
+    return ESP_OK;
+}
+
+esp_err_t xn_task_join(xn_task_t *task, uint32_t timeout_ms)
+{
+    if (!task || !task->handle) {
+        return ESP_OK;
+    }
+
+    // 等待任务自行退出
+    uint32_t waited = 0;
+    while (eTaskGetState(task->handle) != eDeleted && waited < timeout_ms) {
+        vTaskDelay(pdMS_TO_TICKS(XN_TASK_JOIN_POLL_MS));
+        waited += XN_TASK_JOIN_POLL_MS;
+    }
+
+    esp_err_t ret = ESP_OK;
+    if (eTaskGetState(task->handle) != eDeleted) {
+        ret = ESP_ERR_TIMEOUT;
+        if (timeout_ms > 0) {
+            ESP_LOGW(TAG, "任务 %s 未在 %" PRIu32 "ms 内退出，强制删除", pcTaskGetName(task->handle), timeout_ms);
+        }
+        vTaskDelete(task->handle);
+    }
+
+    // 自删除的任务由 IDLE 任务完成清理，之后才能释放 TCB 与栈
+    vTaskDelay(pdMS_TO_TICKS(XN_TASK_CLEANUP_MS));
+    heap_caps_free(task->tcb);
+    heap_caps_free(task->stack);
+    memset(task, 0, sizeof(*task));
+    return ret;
+}
+
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+
+/** 上次采样的任务运行时间 */
+typedef struct {
+    TaskHandle_t handle;
+    configRUN_TIME_COUNTER_TYPE runtime;
+} xn_sched_sample_t;
+
+static xn_sched_sample_t s_last[XN_SCHED_MAX_TRACKED];
+static int s_last_count = 0;
+static configRUN_TIME_COUNTER_TYPE s_last_total = 0;
+
+static configRUN_TIME_COUNTER_TYPE xn_sched_last_runtime(TaskHandle_t handle)
+{
+    for (int i = 0; i < s_last_count; i++) {
+        if (s_last[i].handle == handle) {
+            return s_last[i].runtime;
+        }
+    }
+    return 0;
+}
+
+void xn_sched_dump_cpu_usage(void)
+{
+    UBaseType_t count = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t *status = (TaskStatus_t *)heap_caps_malloc(count * sizeof(TaskStatus_t),
+                                                            MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!status) {
+        ESP_LOGE(TAG, "CPU 占用统计内存不足");
+        return;
+    }
+
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    count = uxTaskGetSystemState(status, count, &total);
+    configRUN_TIME_COUNTER_TYPE elapsed = total - s_last_total;
+    if (elapsed == 0) {
+        elapsed = 1;
+    }
+
+    // CPU% 为占单核的百分比（双核合计最高 200%）
+    ESP_LOGI(TAG, "======== 任务 CPU 占用（%" PRIu32 " ms）========", (uint32_t)(elapsed / 1000));
+    ESP_LOGI(TAG, "%-16s %4s %4s %7s %8s", "任务", "核心", "优先级", "CPU%", "栈余量");
+    for (UBaseType_t i = 0; i < count; i++) {
+        configRUN_TIME_COUNTER_TYPE delta = status[i].ulRunTimeCounter - xn_sched_last_runtime(status[i].xHandle);
+        BaseType_t core = xTaskGetCoreID(status[i].xHandle);
+        char core_str[4];
+        snprintf(core_str, sizeof(core_str), "%s", core == tskNO_AFFINITY ? "-" : (core == 0 ? "0" : "1"));
+        ESP_LOGI(TAG, "%-16s %4s %4u %6.1f%% %8u",
+                 status[i].pcTaskName, core_str, (unsigned)status[i].uxCurrentPriority,
+                 (double)delta * 100.0 / (double)elapsed,
+                 (unsigned)status[i].usStackHighWaterMark);
+    }
+
+    // 保存本次采样作为下次的基准
+    s_last_count = 0;
+    for (UBaseType_t i = 0; i < count && s_last_count < XN_SCHED_MAX_TRACKED; i++) {
+        s_last[s_last_count].handle = status[i].xHandle;
+        s_last[s_last_count].runtime = status[i].ulRunTimeCounter;
+        s_last_count++;
+    }
+    s_last_total = total;
+
+    heap_caps_free(status);
+}
+
+#else
+
+void xn_sched_dump_cpu_usage(void)
+{
+    ESP_LOGW(TAG, "未开启 CONFIG_FREERTOS_USE_TRACE_FACILITY / CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS");
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -128,6 +129,28 @@ void xn_tts_set_speed(xn_tts_handle_t handle, uint8_t speed);
  */
 uint8_t xn_tts_get_speed(xn_tts_handle_t handle);
 
+/**
+ * @brief 检查文本能否由当前音色朗读
+ * 
+ * 支持汉字、阿拉伯数字与标点/空白（标点不发音）；英文字母、表情符号等其他字符视为无法朗读。
+ * 
+ * @param text UTF-8 文本
+ * @param len 文本长度（字节）
+ * @return true 全部可朗读
+ */
+bool xn_tts_text_supported(const char *text, size_t len);
+
+/**
+ * @brief 统计文本中的发音字符数（汉字、数字、字母，不含标点与空白）
+ * 
+ * 用于在不同来源的同一段文本之间对齐朗读进度（标点、空白的差异不影响计数）。
+ * 
+ * @param text UTF-8 文本
+ * @param len 文本长度（字节）
+ * @return 发音字符数
+ */
+size_t xn_tts_count_units(const char *text, size_t len);
+
 /**
  * @brief 反初始化TTS模块
  * 
@@ -0,0 +1,146 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\components\xn_tts\include\xn_tts_stream.h
+ * @Description: 流式文本朗读 - 文本边到达边按分句合成，适合大模型逐字返回的回复
+ *
+ * 数据流：
+ *   调用方：feed(文本片段) → 按标点切分为分句 → 分句队列
+ *   合成任务：取分句 → xn_tts 合成 → PCM 回调（回调阻塞即按播放速度节流）
+ */
+
+#ifndef XN_TTS_STREAM_H
+#define XN_TTS_STREAM_H
+
+#include "xn_tts.h"
+#include "xn_task_sched.h"
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define XN_TTS_STREAM_CLAUSE_MAX    120     /*!< 单个分句最大字节数（约40个汉字），超出时在字符边界强制切分 */
+
+/**
+ * @brief 流式朗读句柄
+ */
+typedef struct xn_tts_stream_s *xn_tts_stream_handle_t;
+
+/**
+ * @brief 流式朗读配置
+ */
+typedef struct {
+    uint8_t speed;                      /*!< 语速: 0(最慢) - 5(最快) */
+    xn_tts_audio_callback_t callback;   /*!< PCM 输出回调（16kHz 单声道），返回 false 中止当前分句 */
+    void *user_ctx;                     /*!< 回调的用户上下文 */
+    uint32_t queue_clauses;             /*!< 分句队列长度 */
+    const xn_task_sched_t *task_sched;  /*!< 合成任务调度参数（NULL 使用均衡预设） */
+} xn_tts_stream_config_t;
+
+/**
+ * @brief 流式朗读统计
+ */
+typedef struct {
+    uint32_t clauses;                   /*!< 已入队的分句数 */
+    uint32_t spoken_clauses;            /*!< 已合成完毕的分句数 */
+    uint32_t unsupported;               /*!< 含无法朗读内容而拒绝的分句数 */
+    uint32_t dropped;                   /*!< 队列满丢弃的分句数 */
+    uint32_t spoken_units;              /*!< 本轮已合成完毕的发音字符数（见 xn_tts_count_units） */
+    uint32_t first_pcm_ms;              /*!< 本轮首个分句入队到首个 PCM 输出的耗时 */
+    uint32_t synth_ms;                  /*!< 累计合成耗时（含回调阻塞） */
+} xn_tts_stream_stats_t;
+
+/**
+ * @brief 默认配置
+ */
+#define XN_TTS_STREAM_DEFAULT_CONFIG()  \
+    {                                   \
+        .speed = 3,                     \
+        .callback = NULL,               \
+        .user_ctx = NULL,               \
+        .queue_clauses = 16,            \
+        .task_sched = NULL,             \
+    }
+
+/**
+ * @brief 创建流式朗读（初始化 TTS 引擎并启动合成任务）
+ *
+ * @param config 配置
+ * @return xn_tts_stream_handle_t 句柄，失败返回 NULL
+ */
+xn_tts_stream_handle_t xn_tts_stream_create(const xn_tts_stream_config_t *config);
+
+/**
+ * @brief 销毁流式朗读
+ *
+ * @param stream 句柄
+ */
+void xn_tts_stream_destroy(xn_tts_stream_handle_t stream);
+
+/**
+ * @brief 开始新一轮文本（丢弃上一轮未成句的残余文本，清零本轮进度），不影响正在朗读的分句
+ *
+ * @param stream 句柄
+ */
+void xn_tts_stream_begin(xn_tts_stream_handle_t stream);
+
+/**
+ * @brief 送入一段文本（可在任意位置断开，含半个 UTF-8 字符）
+ *
+ * 遇到句末/分句标点即切出一个分句入队朗读。
+ * 含无法朗读内容的分句不入队，返回 ESP_ERR_NOT_SUPPORTED，后续文本仍可继续送入。
+ *
+ * @param stream 句柄
+ * @param text 文本片段
+ * @param len 长度（字节）
+ * @return esp_err_t
+ *         - ESP_OK: 成功
+ *         - ESP_ERR_NOT_SUPPORTED: 有分句含无法朗读的内容，已跳过
+ *         - ESP_ERR_NO_MEM: 队列满，有分句被丢弃
+ */
+esp_err_t xn_tts_stream_feed(xn_tts_stream_handle_t stream, const char *text, size_t len);
+
+/**
+ * @brief 本轮文本结束，剩余不完整的分句也入队朗读
+ *
+ * @param stream 句柄
+ * @return esp_err_t 同 xn_tts_stream_feed
+ */
+esp_err_t xn_tts_stream_finish(xn_tts_stream_handle_t stream);
+
+/**
+ * @brief 立即停止：丢弃队列中的分句并中止正在合成的分句
+ *
+ * 可在任意任务中调用；返回时合成任务已不再调用 PCM 回调（最多等待一次回调的时长）。
+ *
+ * @param stream 句柄
+ */
+void xn_tts_stream_stop(xn_tts_stream_handle_t stream);
+
+/**
+ * @brief 是否有待朗读或正在朗读的分句
+ *
+ * @param stream 句柄
+ * @return true 正在朗读
+ */
+bool xn_tts_stream_is_busy(xn_tts_stream_handle_t stream);
+
+/**
+ * @brief 获取统计信息
+ *
+ * @param stream 句柄
+ * @param stats 输出统计
+ */
+void xn_tts_stream_get_stats(xn_tts_stream_handle_t stream, xn_tts_stream_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // XN_TTS_STREAM_H
@@ -0,0 +1,209 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\components\xn_tts\src\sim\xn_tts_sim.c
+ * @Description: TTS 主机仿真 - esp-tts 只有 Xtensa/RISC-V 预编译库，主机上按发音字符数生成等长提示音
+ *
+ * 每个发音字符约 200ms（语速每档缩短 10%），以 20ms 为块经回调送出，
+ * 用于在主机上驱动文本回复模式的分句、合成任务与播放背压。
+ */
+#include "xn_tts.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "XN_TTS_SIM";
+
+#define SIM_UNIT_MS         200     ///< 每个发音字符的时长（语速 0）
+#define SIM_CHUNK_MS        20      ///< 每次回调的块长
+#define SIM_TONE_PERIOD     32      ///< 提示音周期（样本），16kHz 下 500Hz
+#define SIM_TONE_AMPLITUDE  2000
+
+typedef struct {
+    xn_tts_config_t config;
+    int16_t *chunk;                 // 一块 PCM
+    int chunk_samples;
+    int remain_samples;             // 异步模式剩余样本
+    int phase;                      // 提示音相位
+    volatile bool is_playing;
+} xn_tts_sim_t;
+
+xn_tts_config_t xn_tts_get_default_config(void)
+{
+    xn_tts_config_t config = {
+        .speed = 0,
+        .sample_rate = 16000,
+        .callback = NULL,
+        .user_ctx = NULL,
+    };
+    return config;
+}
+
+xn_tts_handle_t xn_tts_init(const xn_tts_config_t *config)
+{
+    if (config == NULL) {
+        ESP_LOGE(TAG, "Config is NULL");
+        return NULL;
+    }
+
+    xn_tts_sim_t *ctx = (xn_tts_sim_t *)calloc(1, sizeof(xn_tts_sim_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    ctx->config = *config;
+    ctx->chunk_samples = (int)(config->sample_rate * SIM_CHUNK_MS / 1000);
+    ctx->chunk = (int16_t *)malloc(ctx->chunk_samples * sizeof(int16_t));
+    if (ctx->chunk == NULL) {
+        free(ctx);
+        return NULL;
+    }
+    ESP_LOGI(TAG, "TTS 仿真已初始化 (%d Hz)", (int)config->sample_rate);
+    return (xn_tts_handle_t)ctx;
+}
+
+/**
+ * @brief 文本对应的合成时长（样本数）
+ */
+static int sim_text_samples(const xn_tts_sim_t *ctx, size_t units)
+{
+    int unit_ms = SIM_UNIT_MS * (10 - ctx->config.speed) / 10;
+    return (int)(units * unit_ms * ctx->config.sample_rate / 1000);
+}
+
+/**
+ * @brief 拼音按空白分隔的音节数
+ */
+static size_t sim_pinyin_units(const char *pinyin)
+{
+    size_t units = 0;
+    bool in_word = false;
+    for (const char *p = pinyin; *p; p++) {
+        bool space = (*p == ' ' || *p == '\t');
+        if (!space && !in_word) {
+            units++;
+        }
+        in_word = !space;
+    }
+    return units;
+}
+
+static int sim_fill_chunk(xn_tts_sim_t *ctx, int samples)
+{
+    if (samples > ctx->chunk_samples) {
+        samples = ctx->chunk_samples;
+    }
+    for (int i = 0; i < samples; i++) {
+        ctx->chunk[i] = (ctx->phase++ % SIM_TONE_PERIOD) < SIM_TONE_PERIOD / 2 ? SIM_TONE_AMPLITUDE : -SIM_TONE_AMPLITUDE;
+    }
+    return samples;
+}
+
+static int sim_speak(xn_tts_sim_t *ctx, size_t units)
+{
+    int remain = sim_text_samples(ctx, units);
+    ctx->is_playing = true;
+    while (ctx->is_playing && remain > 0) {
+        int n = sim_fill_chunk(ctx, remain);
+        remain -= n;
+        if (ctx->config.callback != NULL && !ctx->config.callback(ctx->chunk, n, ctx->config.user_ctx)) {
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    ctx->is_playing = false;
+    return 0;
+}
+
+int xn_tts_speak_chinese(xn_tts_handle_t handle, const char *text)
+{
+    if (handle == NULL || text == NULL) {
+        return -1;
+    }
+    return sim_speak((xn_tts_sim_t *)handle, xn_tts_count_units(text, strlen(text)));
+}
+
+int xn_tts_speak_pinyin(xn_tts_handle_t handle, const char *pinyin)
+{
+    if (handle == NULL || pinyin == NULL) {
+        return -1;
+    }
+    return sim_speak((xn_tts_sim_t *)handle, sim_pinyin_units(pinyin));
+}
+
+int xn_tts_start_chinese(xn_tts_handle_t handle, const char *text)
+{
+    if (handle == NULL || text == NULL) {
+        return -1;
+    }
+    xn_tts_sim_t *ctx = (xn_tts_sim_t *)handle;
+    ctx->remain_samples = sim_text_samples(ctx, xn_tts_count_units(text, strlen(text)));
+    ctx->is_playing = true;
+    return 0;
+}
+
+int xn_tts_start_pinyin(xn_tts_handle_t handle, const char *pinyin)
+{
+    if (handle == NULL || pinyin == NULL) {
+        return -1;
+    }
+    xn_tts_sim_t *ctx = (xn_tts_sim_t *)handle;
+    ctx->remain_samples = sim_text_samples(ctx, sim_pinyin_units(pinyin));
+    ctx->is_playing = true;
+    return 0;
+}
+
+int xn_tts_get_audio_stream(xn_tts_handle_t handle, int16_t **data, int *len)
+{
+    if (handle == NULL || data == NULL || len == NULL) {
+        return -1;
+    }
+    xn_tts_sim_t *ctx = (xn_tts_sim_t *)handle;
+    if (!ctx->is_playing || ctx->remain_samples <= 0) {
+        ctx->is_playing = false;
+        *data = NULL;
+        *len = 0;
+        return 1;
+    }
+    *len = sim_fill_chunk(ctx, ctx->remain_samples);
+    ctx->remain_samples -= *len;
+    *data = ctx->chunk;
+    return 0;
+}
+
+void xn_tts_stop(xn_tts_handle_t handle)
+{
+    if (handle == NULL) {
+        return;
+    }
+    xn_tts_sim_t *ctx = (xn_tts_sim_t *)handle;
+    ctx->is_playing = false;
+    ctx->remain_samples = 0;
+}
+
+void xn_tts_set_speed(xn_tts_handle_t handle, uint8_t speed)
+{
+    if (handle == NULL) {
+        return;
+    }
+    ((xn_tts_sim_t *)handle)->config.speed = speed > 5 ? 5 : speed;
+}
+
+uint8_t xn_tts_get_speed(xn_tts_handle_t handle)
+{
+    return handle ? ((xn_tts_sim_t *)handle)->config.speed : 0;
+}
+
+void xn_tts_deinit(xn_tts_handle_t handle)
+{
+    if (handle == NULL) {
+        return;
+    }
+    xn_tts_sim_t *ctx = (xn_tts_sim_t *)handle;
+    xn_tts_stop(handle);
+    free(ctx->chunk);
+    free(ctx);
+}
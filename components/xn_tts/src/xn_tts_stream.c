@@ -0,0 +1,362 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\components\xn_tts\src\xn_tts_stream.c
+ * @Description: 流式文本朗读实现 - 分句切分、分句队列、合成任务
+ */
+
+#include "xn_tts_stream.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "XN_TTS_STREAM";
+
+#define XN_TTS_SOFT_SPLIT_MIN   12      // 逗号类标点处切分的最小分句长度（字节，约4个汉字），避免过碎
+#define XN_TTS_STOP_WAIT_MS     500     // stop 等待合成任务退出回调的上限
+#define XN_TTS_STOP_POLL_MS     5       // stop 轮询间隔
+
+/**
+ * @brief 分句队列项
+ */
+typedef struct {
+    uint32_t gen;                               // 入队时的停止代数，stop 后旧分句作废
+    char text[XN_TTS_STREAM_CLAUSE_MAX + 1];    // 分句文本（'\0' 结尾）
+} xn_tts_clause_t;
+
+/**
+ * @brief 流式朗读结构体
+ */
+typedef struct xn_tts_stream_s {
+    xn_tts_handle_t tts;                // TTS 引擎
+    xn_tts_stream_config_t config;      // 配置
+    QueueHandle_t queue;                // 分句队列
+
+    xn_task_t task;                     // 合成任务
+    volatile bool running;              // 合成任务运行标志
+    volatile uint32_t gen;              // 停止代数（stop 递增）
+    volatile uint32_t speaking_gen;     // 正在合成的分句所属代数
+    volatile bool speaking;             // 合成任务正在合成分句
+
+    // 调用方（送入文本的任务）私有
+    char pending[XN_TTS_STREAM_CLAUSE_MAX + 4]; // 未成句的文本
+    size_t pending_len;
+    int64_t round_start_us;             // 本轮首个分句入队时刻
+    bool first_pcm;                     // 本轮是否已输出首个 PCM
+
+    // 统计
+    uint32_t clauses;
+    uint32_t spoken_clauses;
+    uint32_t unsupported;
+    uint32_t dropped;
+    uint32_t spoken_units;
+    uint32_t first_pcm_ms;
+    uint64_t synth_us;
+} xn_tts_stream_t;
+
+/**
+ * @brief TTS 引擎的 PCM 回调：作废的分句立即中止，否则转给用户回调
+ */
+static bool stream_pcm_callback(const int16_t *data, int len, void *user_ctx)
+{
+    xn_tts_stream_t *stream = (xn_tts_stream_t *)user_ctx;
+
+    if (stream->speaking_gen != stream->gen || !stream->running) {
+        return false;
+    }
+
+    if (!stream->first_pcm) {
+        stream->first_pcm = true;
+        stream->first_pcm_ms = (uint32_t)((esp_timer_get_time() - stream->round_start_us) / 1000);
+        ESP_LOGI(TAG, "🔊 首句出声: %lu ms", stream->first_pcm_ms);
+    }
+
+    return stream->config.callback ? stream->config.callback(data, len, stream->config.user_ctx) : true;
+}
+
+/**
+ * @brief 合成任务：逐个取出分句合成，PCM 由回调输出
+ */
+static void tts_synth_task(void *arg)
+{
+    xn_tts_stream_t *stream = (xn_tts_stream_t *)arg;
+    xn_tts_clause_t clause;
+
+    ESP_LOGI(TAG, "🚀 合成任务启动");
+
+    while (stream->running) {
+        if (xQueueReceive(stream->queue, &clause, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        // 先置忙再检查代数，stop 递增代数后等待 speaking 清零即可确保不再输出
+        stream->speaking = true;
+        if (!stream->running || clause.gen != stream->gen) {
+            stream->speaking = false;
+            continue;
+        }
+        stream->speaking_gen = clause.gen;
+
+        int64_t t0 = esp_timer_get_time();
+        int ret = xn_tts_speak_chinese(stream->tts, clause.text);
+        stream->synth_us += esp_timer_get_time() - t0;
+
+        if (ret == 0 && clause.gen == stream->gen) {
+            stream->spoken_clauses++;
+            stream->spoken_units += (uint32_t)xn_tts_count_units(clause.text, strlen(clause.text));
+        }
+        stream->speaking = false;
+    }
+
+    ESP_LOGI(TAG, "合成任务退出");
+    vTaskDelete(NULL);
+}
+
+xn_tts_stream_handle_t xn_tts_stream_create(const xn_tts_stream_config_t *config)
+{
+    if (!config || !config->callback || config->queue_clauses == 0) {
+        ESP_LOGE(TAG, "无效的配置参数");
+        return NULL;
+    }
+
+    xn_tts_stream_t *stream = (xn_tts_stream_t *)calloc(1, sizeof(xn_tts_stream_t));
+    if (!stream) {
+        ESP_LOGE(TAG, "句柄分配失败");
+        return NULL;
+    }
+    memcpy(&stream->config, config, sizeof(xn_tts_stream_config_t));
+
+    xn_tts_config_t tts_cfg = xn_tts_get_default_config();
+    tts_cfg.speed = config->speed;
+    tts_cfg.callback = stream_pcm_callback;
+    tts_cfg.user_ctx = stream;
+
+    stream->tts = xn_tts_init(&tts_cfg);
+    stream->queue = xQueueCreate(config->queue_clauses, sizeof(xn_tts_clause_t));
+    if (!stream->tts || !stream->queue) {
+        ESP_LOGE(TAG, "TTS 引擎或分句队列创建失败");
+        xn_tts_stream_destroy(stream);
+        return NULL;
+    }
+
+    stream->running = true;
+    const xn_task_sched_t *sched = config->task_sched ? config->task_sched
+                                                      : xn_sched_get(NULL, XN_TASK_TTS_SYNTH);
+    if (xn_task_create(&stream->task, sched, tts_synth_task, "tts_synth", stream) != ESP_OK) {
+        ESP_LOGE(TAG, "创建合成任务失败");
+        stream->running = false;
+        xn_tts_stream_destroy(stream);
+        return NULL;
+    }
+
+    ESP_LOGI(TAG, "✅ 流式朗读创建成功: 语速 %d, 分句队列 %lu 句 × %d 字节",
+             config->speed, config->queue_clauses, XN_TTS_STREAM_CLAUSE_MAX);
+    return stream;
+}
+
+void xn_tts_stream_destroy(xn_tts_stream_handle_t stream)
+{
+    if (!stream) return;
+
+    if (stream->task.handle) {
+        // 作废队列中的分句，再送一个空分句唤醒合成任务
+        stream->running = false;
+        stream->gen++;
+        xQueueReset(stream->queue);
+        xn_tts_clause_t wake = { .gen = stream->gen, .text = "" };
+        xQueueSend(stream->queue, &wake, 0);
+        xn_task_join(&stream->task, XN_TTS_STOP_WAIT_MS);
+    }
+
+    if (stream->queue) {
+        vQueueDelete(stream->queue);
+    }
+    if (stream->tts) {
+        xn_tts_deinit(stream->tts);
+    }
+    free(stream);
+}
+
+void xn_tts_stream_begin(xn_tts_stream_handle_t stream)
+{
+    if (!stream) return;
+
+    stream->pending_len = 0;
+    stream->round_start_us = 0;
+    stream->first_pcm = false;
+    stream->spoken_units = 0;
+}
+
+/**
+ * @brief 把未成句的文本作为一个分句入队
+ */
+static esp_err_t stream_emit_clause(xn_tts_stream_t *stream)
+{
+    const char *text = stream->pending;
+    size_t len = stream->pending_len;
+    stream->pending_len = 0;
+
+    // 去掉首尾空白
+    while (len > 0 && (*text == ' ' || *text == '\n' || *text == '\r' || *text == '\t')) {
+        text++;
+        len--;
+    }
+    while (len > 0 && (text[len - 1] == ' ' || text[len - 1] == '\n' ||
+                       text[len - 1] == '\r' || text[len - 1] == '\t')) {
+        len--;
+    }
+
+    // 只有标点的片段不发音，直接丢弃
+    if (len == 0 || xn_tts_count_units(text, len) == 0) {
+        return ESP_OK;
+    }
+
+    if (!xn_tts_text_supported(text, len)) {
+        stream->unsupported++;
+        ESP_LOGW(TAG, "⚠️ 分句含无法朗读的内容，跳过: %.*s", (int)len, text);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    xn_tts_clause_t clause;
+    clause.gen = stream->gen;
+    memcpy(clause.text, text, len);
+    clause.text[len] = '\0';
+
+    if (xQueueSend(stream->queue, &clause, 0) != pdTRUE) {
+        stream->dropped++;
+        ESP_LOGW(TAG, "⚠️ 分句队列满，丢弃 (累计 %lu 句)", stream->dropped);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (stream->round_start_us == 0) {
+        stream->round_start_us = esp_timer_get_time();
+    }
+    stream->clauses++;
+    return ESP_OK;
+}
+
+/**
+ * @brief 未成句文本是否以分句标点结尾
+ *
+ * 句末标点（。！？；换行等）总是切分；逗号类标点在分句已有一定长度时才切分。
+ * 英文 '.' ',' 前一个字符是数字时不切分（小数、千分位）。
+ */
+static bool stream_at_clause_end(const xn_tts_stream_t *stream)
+{
+    static const char *const HARD[] = { "。", "！", "？", "；", "…" };
+    static const char *const SOFT[] = { "，", "、", "：" };
+
+    const char *p = stream->pending;
+    size_t n = stream->pending_len;
+    char last = p[n - 1];
+
+    if (last == '\n' || last == '!' || last == '?' || last == ';') {
+        return true;
+    }
+    if (last == '.' || last == ',') {
+        bool after_digit = n >= 2 && p[n - 2] >= '0' && p[n - 2] <= '9';
+        return !after_digit && (last == '.' || n >= XN_TTS_SOFT_SPLIT_MIN);
+    }
+    if ((uint8_t)last < 0x80 || n < 3) {
+        return false;
+    }
+
+    // 多字节标点均为 3 字节 UTF-8
+    const char *tail = p + n - 3;
+    for (size_t i = 0; i < sizeof(HARD) / sizeof(HARD[0]); i++) {
+        if (memcmp(tail, HARD[i], 3) == 0) {
+            return true;
+        }
+    }
+    for (size_t i = 0; i < sizeof(SOFT) / sizeof(SOFT[0]); i++) {
+        if (memcmp(tail, SOFT[i], 3) == 0) {
+            return n >= XN_TTS_SOFT_SPLIT_MIN;
+        }
+    }
+    return false;
+}
+
+esp_err_t xn_tts_stream_feed(xn_tts_stream_handle_t stream, const char *text, size_t len)
+{
+    if (!stream || (!text && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t result = ESP_OK;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = (uint8_t)text[i];
+
+        // 过长时在字符起始处强制切分（不拆开 UTF-8 字符）
+        if ((c & 0xC0) != 0x80 && stream->pending_len >= XN_TTS_STREAM_CLAUSE_MAX) {
+            esp_err_t ret = stream_emit_clause(stream);
+            if (ret != ESP_OK) {
+                result = ret;
+            }
+        }
+        if (stream->pending_len >= sizeof(stream->pending)) {
+            continue;  // 理论上不会出现：单个字符不超过 4 字节
+        }
+
+        stream->pending[stream->pending_len++] = (char)c;
+
+        // 字符完整后再判断是否到达分句标点
+        bool char_complete = (i + 1 == len) || (((uint8_t)text[i + 1] & 0xC0) != 0x80);
+        if (char_complete && stream_at_clause_end(stream)) {
+            esp_err_t ret = stream_emit_clause(stream);
+            if (ret != ESP_OK) {
+                result = ret;
+            }
+        }
+    }
+    return result;
+}
+
+esp_err_t xn_tts_stream_finish(xn_tts_stream_handle_t stream)
+{
+    if (!stream) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return stream->pending_len > 0 ? stream_emit_clause(stream) : ESP_OK;
+}
+
+void xn_tts_stream_stop(xn_tts_stream_handle_t stream)
+{
+    if (!stream) return;
+
+    // 递增代数：队列中和正在合成的分句全部作废
+    stream->gen++;
+    xQueueReset(stream->queue);
+
+    for (uint32_t waited = 0; stream->speaking && waited < XN_TTS_STOP_WAIT_MS; waited += XN_TTS_STOP_POLL_MS) {
+        vTaskDelay(pdMS_TO_TICKS(XN_TTS_STOP_POLL_MS));
+    }
+    if (stream->speaking) {
+        ESP_LOGW(TAG, "⚠️ 等待合成任务停止超时");
+    }
+}
+
+bool xn_tts_stream_is_busy(xn_tts_stream_handle_t stream)
+{
+    if (!stream) return false;
+
+    return stream->speaking || uxQueueMessagesWaiting(stream->queue) > 0;
+}
+
+void xn_tts_stream_get_stats(xn_tts_stream_handle_t stream, xn_tts_stream_stats_t *stats)
+{
+    if (!stream || !stats) return;
+
+    stats->clauses = stream->clauses;
+    stats->spoken_clauses = stream->spoken_clauses;
+    stats->unsupported = stream->unsupported;
+    stats->dropped = stream->dropped;
+    stats->spoken_units = stream->spoken_units;
+    stats->first_pcm_ms = stream->first_pcm_ms;
+    stats->synth_ms = (uint32_t)(stream->synth_us / 1000);
+}
@@ -0,0 +1,125 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\components\xn_tts\src\xn_tts_text.c
+ * @Description: 文本朗读能力判断 - 与合成引擎无关，设备与主机仿真共用
+ */
+#include "xn_tts.h"
+#include <stdint.h>
+
+/**
+ * @brief 字符分类（朗读能力判断）
+ */
+typedef enum {
+    XN_TTS_CHAR_SILENT = 0,     // 标点、空白：不发音
+    XN_TTS_CHAR_SPOKEN,         // 汉字、数字：可朗读
+    XN_TTS_CHAR_UNSUPPORTED,    // 字母、表情等：音色无法朗读
+} xn_tts_char_class_t;
+
+/**
+ * @brief 解码一个 UTF-8 字符
+ * 
+ * @return 字符占用的字节数（非法或截断的序列按 1 字节处理，码点记为 0xFFFD）
+ */
+static size_t utf8_next(const uint8_t *s, size_t len, uint32_t *cp)
+{
+    uint8_t c = s[0];
+    size_t n = c < 0x80 ? 1 : (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 0;
+    if (n == 0 || n > len) {
+        *cp = 0xFFFD;
+        return 1;
+    }
+    if (n == 1) {
+        *cp = c;
+        return 1;
+    }
+
+    uint32_t v = c & (0x7F >> n);
+    for (size_t i = 1; i < n; i++) {
+        if ((s[i] & 0xC0) != 0x80) {
+            *cp = 0xFFFD;
+            return 1;
+        }
+        v = (v << 6) | (s[i] & 0x3F);
+    }
+    *cp = v;
+    return n;
+}
+
+static xn_tts_char_class_t classify_char(uint32_t cp)
+{
+    if (cp < 0x80) {
+        if (cp >= '0' && cp <= '9') return XN_TTS_CHAR_SPOKEN;
+        if ((cp | 0x20) >= 'a' && (cp | 0x20) <= 'z') return XN_TTS_CHAR_UNSUPPORTED;
+        return XN_TTS_CHAR_SILENT;
+    }
+    if ((cp >= 0x4E00 && cp <= 0x9FFF) || (cp >= 0x3400 && cp <= 0x4DBF)) {
+        return XN_TTS_CHAR_SPOKEN;      // CJK 统一汉字（含扩展A）
+    }
+    if (cp >= 0xFF10 && cp <= 0xFF19) {
+        return XN_TTS_CHAR_SPOKEN;      // 全角数字
+    }
+    if ((cp >= 0x2000 && cp <= 0x206F) ||   // 通用标点（引号、破折号、省略号）
+        (cp >= 0x3000 && cp <= 0x303F) ||   // CJK 标点
+        (cp >= 0xFF00 && cp <= 0xFF0F) || (cp >= 0xFF1A && cp <= 0xFF20) ||
+        (cp >= 0xFF3B && cp <= 0xFF40) || (cp >= 0xFF5B && cp <= 0xFF65) ||
+        cp == 0x00A0 || cp == 0x00B7 || cp == 0xFEFF) {
+        return XN_TTS_CHAR_SILENT;
+    }
+    return XN_TTS_CHAR_UNSUPPORTED;
+}
+
+/**
+ * @brief 检查文本能否由当前音色朗读
+ * 
+ * @param text UTF-8 文本
+ * @param len 文本长度（字节）
+ * @return true 全部可朗读
+ */
+bool xn_tts_text_supported(const char *text, size_t len)
+{
+    if (text == NULL) {
+        return false;
+    }
+
+    const uint8_t *p = (const uint8_t *)text;
+    while (len > 0) {
+        uint32_t cp;
+        size_t n = utf8_next(p, len, &cp);
+        if (classify_char(cp) == XN_TTS_CHAR_UNSUPPORTED) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief 统计文本中的发音字符数
+ * 
+ * @param text UTF-8 文本
+ * @param len 文本长度（字节）
+ * @return 发音字符数（无法朗读的字母、表情同样计入，服务器语音会读出它们）
+ */
+size_t xn_tts_count_units(const char *text, size_t len)
+{
+    if (text == NULL) {
+        return 0;
+    }
+
+    size_t units = 0;
+    const uint8_t *p = (const uint8_t *)text;
+    while (len > 0) {
+        uint32_t cp;
+        size_t n = utf8_next(p, len, &cp);
+        if (classify_char(cp) != XN_TTS_CHAR_SILENT) {
+            units++;
+        }
+        p += n;
+        len -= n;
+    }
+    return units;
+}
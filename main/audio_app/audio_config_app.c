@@ -68,12 +68,17 @@ void audio_config_app_build(audio_mgr_config_t *cfg,
     cfg->vad_config.vad_mode = 2;             // VAD 模式 2（中等灵敏度）
     cfg->vad_config.min_speech_ms = 200;      // 最小语音持续时间 200ms
     cfg->vad_config.min_silence_ms = 400;     // 最小静音持续时间 400ms
+    cfg->vad_config.preroll_ms = 400;         // 预录 400ms，避免丢失语音开头
 
     // ========== AFE（音频前端处理）配置 ==========
     cfg->afe_config.aec_enabled = true;       // 启用回声消除（AEC）
     cfg->afe_config.ns_enabled = true;        // 启用降噪（NS）
     cfg->afe_config.agc_enabled = true;       // 启用自动增益控制（AGC）
     cfg->afe_config.afe_mode = 1;             // AFE 模式：高质量
+    cfg->afe_config.dynamic_profile = true;   // 空闲时仅跑唤醒词+VAD，对话时再开 AEC/NS/AGC
+
+    // ========== 任务调度配置 ==========
+    cfg->sched_profile = xn_sched_get_preset(AUDIO_APP_SCHED_PRESET);
 
     // ========== 回调配置 ==========
     cfg->event_callback = event_cb;           // 设置事件回调函数
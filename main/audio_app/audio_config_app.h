@@ -1,11 +1,22 @@
 #pragma once
 
 #include "audio_manager.h"
+#include "xn_task_sched.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief 音频/网络任务调度预设（audio_manager 与 coze_chat 共用）
+ *
+ * XN_SCHED_PRESET_BALANCED / XN_SCHED_PRESET_LOW_LATENCY / XN_SCHED_PRESET_WIFI_HEAVY
+ */
+#define AUDIO_APP_SCHED_PRESET          XN_SCHED_PRESET_BALANCED
+
+/** 任务 CPU 占用打印周期（毫秒），0 关闭 */
+#define AUDIO_APP_CPU_DUMP_INTERVAL_MS  30000
+
 /**
  * @brief 填充音频管理器配置
  *
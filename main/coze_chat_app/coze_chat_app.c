@@ -20,6 +20,7 @@
 
 #include "coze_chat.h"
 #include "audio_manager.h"
+#include "audio_config_app.h"
 // #include "lottie_manager.h"
 
 static const char *TAG = "COZE_CHAT_APP";
@@ -102,6 +103,11 @@ static void coze_event_callback(coze_chat_event_t event, char *data, void *ctx)
         // 字幕事件（显示 Coze 返回的文字）
         break;
 
+    case COZE_CHAT_EVENT_CHAT_INTERRUPTED:
+        // 播放缓冲区已由 pcm_sink.clear 清空
+        ESP_LOGI(TAG, "🛑 Coze回复已打断");
+        break;
+
     case COZE_CHAT_EVENT_CHAT_CUSTOMER_DATA:
         // 自定义数据事件
         if (data) {
@@ -116,11 +122,9 @@ static void coze_event_callback(coze_chat_event_t event, char *data, void *ctx)
 }
 
 /**
- * @brief Coze音频数据回调函数（带流控）
- *
- * 接收Coze组件返回的音频数据（已解码的PCM格式），带流控地送到播放器
+ * @brief Coze音频数据回调函数
  *
- * ⚠️ 注意：组件已在内部完成 Opus → PCM 解码，这里收到的是PCM数据！
+ * 未设置 PCM 直写目标时使用：接收组件解码后的PCM，写入播放器
  *
  * @param data 音频数据指针（PCM格式，int16_t，16kHz单声道）
  * @param len 数据长度（字节数，需除以2得到样本数）
@@ -133,28 +137,31 @@ static void coze_audio_callback(char *data, int len, void *ctx)
         return;
     }
 
-    // 组件已解码为PCM，len是字节数，样本数 = len / sizeof(int16_t) = len / 2
-    size_t samples = len / sizeof(int16_t);
+    audio_manager_play_audio((int16_t *)data, len / sizeof(int16_t));
+}
 
-    // ✅ 流控机制：检查播放缓冲区可用空间，避免溢出
-    size_t free_space = audio_manager_get_playback_free_space();
-    
-    // 如果剩余空间不足，延迟发送（自适应）
-    // 阈值：保留至少 32K样本（2秒）的缓冲空间
-    const size_t MIN_FREE_SPACE = 32 * 1024;  // 32K样本 = 2秒 @ 16kHz
-    
-    if (free_space < MIN_FREE_SPACE) {
-        // 计算需要延迟的时间：让播放器消耗一些数据
-        // 延迟时间 = 当前包大小的播放时长
-        uint32_t delay_ms = (samples * 1000) / 16000;  // 样本数 → 毫秒
-        
-        ESP_LOGD(TAG, "🔒 播放缓冲区空间不足(%zu样本)，延迟%ums", 
-                 free_space, delay_ms);
-        
-        vTaskDelay(pdMS_TO_TICKS(delay_ms));
-    }
+/**
+ * @brief 下行PCM直写：在播放缓冲区中预留空间（空间不足时阻塞到播放器消费）
+ */
+static size_t coze_pcm_reserve(int16_t **ptr, size_t samples, uint32_t timeout_ms, void *ctx)
+{
+    return audio_manager_playback_reserve(ptr, samples, timeout_ms);
+}
 
-    audio_manager_play_audio((int16_t *)data, samples);
+/**
+ * @brief 下行PCM直写：提交已解码写入的样本
+ */
+static esp_err_t coze_pcm_commit(size_t samples, void *ctx)
+{
+    return audio_manager_playback_commit(samples);
+}
+
+/**
+ * @brief 下行PCM直写：打断时丢弃播放缓冲区中未播放的PCM
+ */
+static void coze_pcm_clear(void *ctx)
+{
+    audio_manager_clear_playback_buffer();
 }
 
 /**
@@ -215,6 +222,14 @@ esp_err_t coze_chat_app_init(void)
     chat_config.uplink_audio_type = COZE_CHAT_AUDIO_TYPE_OPUS;  // ✅ 启用Opus上行
     chat_config.downlink_audio_type = COZE_CHAT_AUDIO_TYPE_OPUS;
 
+    // 回复模式：服务器语音（默认）；改为文本+本地TTS时下行只有文本，
+    // 含英文/表情等本地无法朗读的内容时本轮自动回退到服务器语音
+    // chat_config.reply_mode = COZE_REPLY_MODE_TEXT_TTS;
+    // chat_config.tts_speed = 3;
+
+    // 连接管理：空闲 60 秒后断开，唤醒/按键时预连接（TLS 会话复用，重连更快）
+    // chat_config.idle_close_ms = 60000;
+
     // WebSocket 缓冲区配置（按键模式不需要太大）
     chat_config.websocket_buffer_size = 8192;  // 8KB（按键模式足够）
 
@@ -225,9 +240,15 @@ esp_err_t coze_chat_app_init(void)
     // 使用内部 RAM（更快的栈操作，JSON解析任务优先使用内部RAM）
     chat_config.pull_task_caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
     chat_config.push_task_caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    // 任务核心/优先级与音频管理器使用同一调度预设
+    chat_config.sched_profile = xn_sched_get_preset(AUDIO_APP_SCHED_PRESET);
 
     // 回调函数（⚠️ 必须设置 ws_event_callback 防止空指针）
     chat_config.audio_callback = coze_audio_callback;
+    // 下行Opus直接解码进播放缓冲区，由播放速度背压（少一次拷贝，无需估算延时）
+    chat_config.pcm_sink.reserve = coze_pcm_reserve;
+    chat_config.pcm_sink.commit = coze_pcm_commit;
+    chat_config.pcm_sink.clear = coze_pcm_clear;  // 打断（barge-in）时立即静音
     chat_config.event_callback = coze_event_callback;
     chat_config.ws_event_callback = coze_ws_event_callback;  // ⚠️ 关键：防止崩溃
 
@@ -39,11 +39,15 @@ static void app_wifi_event_cb(wifi_manage_state_t state)
             // } else {
             //     ESP_LOGE(TAG, "Coze chat init failed on WiFi connect");
             // }
+        } else if (coze_chat_get_handle()) {
+            // 网络恢复：跳过退避等待，立即重连
+            coze_chat_prewarm(coze_chat_get_handle(), 0);
         }
         break;
 
     case WIFI_MANAGE_STATE_DISCONNECTED:
     case WIFI_MANAGE_STATE_CONNECT_FAILED:
+        // 断网时组件自行按退避重连，无需反初始化
         // if (s_coze_started) {
         //     ESP_LOGI(TAG, "WiFi disconnected, deinit Coze chat");
         //     coze_chat_app_deinit();
@@ -100,15 +104,27 @@ static void audio_event_cb(const audio_mgr_event_t *event, void *user_ctx)
 
     switch (event->type) {
     case AUDIO_MGR_EVENT_VAD_START:
-        // VAD检测到语音开始
-        ESP_LOGI(TAG, "VAD start, begin capture");
+    case AUDIO_MGR_EVENT_WAKEUP_DETECTED: {
+        // 用户开口：机器人正在说话时立即打断（barge-in），否则开始新一轮采集
+        ESP_LOGI(TAG, "%s, begin capture", event->type == AUDIO_MGR_EVENT_VAD_START ? "VAD start" : "wake word");
+        coze_chat_handle_t handle = coze_chat_get_handle();
+        if (handle) {
+            if (event->type == AUDIO_MGR_EVENT_WAKEUP_DETECTED) {
+                coze_chat_prewarm(handle, event->timestamp_us);  // 空闲断开后提前建连
+            } else {
+                coze_chat_set_voice_activity(handle, true);      // 打开上行静音门（含预录）
+            }
+            coze_chat_interrupt(handle, event->timestamp_us);
+        }
         break;
+    }
 
     case AUDIO_MGR_EVENT_VAD_END: {
         // VAD检测到语音结束，通知 Coze 结束一轮语音输入
         ESP_LOGI(TAG, "VAD end, send audio complete to Coze");
         coze_chat_handle_t handle = coze_chat_get_handle();
         if (handle) {
+            coze_chat_set_voice_activity(handle, false);         // 拖尾后关闭上行静音门
             coze_chat_send_audio_complete(handle);
         }
         break;
@@ -127,6 +143,17 @@ static void audio_event_cb(const audio_mgr_event_t *event, void *user_ctx)
     case AUDIO_MGR_EVENT_BUTTON_TRIGGER:
         // 按键触发录音
         ESP_LOGI(TAG, "button trigger, force capture");
+        if (coze_chat_get_handle()) {
+            coze_chat_prewarm(coze_chat_get_handle(), event->timestamp_us);
+            coze_chat_set_voice_activity(coze_chat_get_handle(), true);  // 按住期间全部上行
+        }
+        break;
+
+    case AUDIO_MGR_EVENT_BUTTON_RELEASE:
+        ESP_LOGI(TAG, "button release");
+        if (coze_chat_get_handle()) {
+            coze_chat_set_voice_activity(coze_chat_get_handle(), false);
+        }
         break;
 
     default:
@@ -176,4 +203,10 @@ void app_main(void)
     
     // 测试TTS组件
     tts_test_init_and_play();
+
+    // 周期打印各任务实际 CPU 占用，用于核对调度预设
+    while (AUDIO_APP_CPU_DUMP_INTERVAL_MS > 0) {
+        vTaskDelay(pdMS_TO_TICKS(AUDIO_APP_CPU_DUMP_INTERVAL_MS));
+        xn_sched_dump_cpu_usage();
+    }
 }
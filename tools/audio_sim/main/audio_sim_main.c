@@ -0,0 +1,191 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-02
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-02
+ * @FilePath: \xn_esp32_audio\tools\audio_sim\main\audio_sim_main.c
+ * @Description: audio_manager 主机仿真 - WAV 输入驱动完整管线并输出性能统计
+ *
+ * 通过环境变量配置：
+ *   AUDIO_SIM_MIC       麦克风输入 WAV（16bit/16kHz/单声道，必填）
+ *   AUDIO_SIM_OUT       扬声器输出 WAV（可选）
+ *   AUDIO_SIM_SPEED     倍速，1=实时，0=尽快（默认 0）
+ *   AUDIO_SIM_VAD       桩 AFE 能量 VAD 门限（默认 500）
+ *   AUDIO_SIM_SCRIPT    按键脚本，音频时间轴毫秒，如 "1000:press,1300:release"
+ *   AUDIO_SIM_LOOPBACK  1=每句话结束后回放录到的音频（默认 1），用于驱动播放与回采路径
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "audio_manager.h"
+#include "audio_sim.h"
+
+static const char *TAG = "audio_sim";
+
+#define SIM_SAMPLE_RATE       16000
+#define SIM_LOOPBACK_SAMPLES  (SIM_SAMPLE_RATE * 10)    ///< 回放缓冲最多 10 秒
+#define SIM_SCRIPT_MAX        32
+#define SIM_REPORT_MS         1000
+
+typedef struct {
+    uint32_t at_ms;             ///< 音频时间轴上的触发时刻
+    bool pressed;               ///< 按下/松开
+} sim_script_step_t;
+
+static sim_script_step_t s_script[SIM_SCRIPT_MAX];
+static int s_script_len = 0;
+
+static int16_t *s_loop_buf = NULL;
+static volatile size_t s_loop_len = 0;
+static bool s_loopback = true;
+
+static uint32_t s_vad_start_count = 0;
+static uint32_t s_vad_end_count = 0;
+static uint32_t s_button_count = 0;
+
+static int env_int(const char *name, int def)
+{
+    const char *v = getenv(name);
+    return v ? atoi(v) : def;
+}
+
+/**
+ * @brief 解析按键脚本 "ms:press,ms:release,..."
+ */
+static void sim_parse_script(const char *text)
+{
+    while (text && *text && s_script_len < SIM_SCRIPT_MAX) {
+        char action[16] = {0};
+        unsigned at = 0;
+        if (sscanf(text, "%u:%15[a-z]", &at, action) != 2) {
+            ESP_LOGW(TAG, "无法解析按键脚本: %s", text);
+            return;
+        }
+        s_script[s_script_len].at_ms = at;
+        s_script[s_script_len].pressed = (strcmp(action, "press") == 0);
+        s_script_len++;
+
+        text = strchr(text, ',');
+        if (text) text++;
+    }
+}
+
+static void sim_record_cb(const int16_t *pcm, size_t samples, void *user_ctx)
+{
+    (void)user_ctx;
+    if (!s_loopback || !s_loop_buf) {
+        return;
+    }
+    size_t room = SIM_LOOPBACK_SAMPLES - s_loop_len;
+    if (samples > room) samples = room;
+    memcpy(s_loop_buf + s_loop_len, pcm, samples * sizeof(int16_t));
+    s_loop_len += samples;
+}
+
+static void sim_event_cb(const audio_mgr_event_t *event, void *user_ctx)
+{
+    (void)user_ctx;
+    switch (event->type) {
+    case AUDIO_MGR_EVENT_VAD_START:
+        s_vad_start_count++;
+        break;
+    case AUDIO_MGR_EVENT_VAD_END:
+        s_vad_end_count++;
+        // 一句话结束：把录到的音频送回播放器，驱动播放与回采路径
+        if (s_loopback && s_loop_len > 0) {
+            audio_manager_play_audio(s_loop_buf, s_loop_len);
+            s_loop_len = 0;
+        }
+        break;
+    case AUDIO_MGR_EVENT_BUTTON_TRIGGER:
+        s_button_count++;
+        break;
+    default:
+        break;
+    }
+}
+
+static void sim_report(const char *title)
+{
+    audio_mgr_pipeline_stats_t p = {0};
+    audio_mgr_afe_stats_t a = {0};
+    audio_manager_get_pipeline_stats(&p);
+    audio_manager_get_afe_stats(&a);
+
+    printf("---- %s ----\n", title);
+    printf("audio_ms=%" PRIu64 " afe_latency_ms=%" PRIu32 " record_samples=%" PRIu64 " spk_samples=%" PRIu64 "\n",
+           p.mic_samples * 1000 / SIM_SAMPLE_RATE, p.afe_latency_ms, p.record_samples, audio_sim_speaker_samples());
+    printf("playback depth=%zu peak=%zu dropped=%" PRIu64 " | reference depth=%zu peak=%zu dropped=%" PRIu64 "\n",
+           p.playback_depth, p.playback_peak, p.playback_dropped,
+           p.reference_depth, p.reference_peak, p.reference_dropped);
+    printf("state=%d vad_start=%" PRIu32 " vad_end=%" PRIu32 " button=%" PRIu32 " profile=%d switches=%" PRIu32 "\n",
+           audio_manager_get_state(), s_vad_start_count, s_vad_end_count, s_button_count,
+           a.current, a.switch_count);
+}
+
+void app_main(void)
+{
+    audio_sim_io_config_t io = AUDIO_SIM_DEFAULT_IO_CONFIG();
+    io.mic_wav_path = getenv("AUDIO_SIM_MIC");
+    io.speaker_wav_path = getenv("AUDIO_SIM_OUT");
+    io.speed = env_int("AUDIO_SIM_SPEED", 0);
+    io.vad_threshold = (int16_t)env_int("AUDIO_SIM_VAD", io.vad_threshold);
+    s_loopback = env_int("AUDIO_SIM_LOOPBACK", 1) != 0;
+    sim_parse_script(getenv("AUDIO_SIM_SCRIPT"));
+
+    if (!io.mic_wav_path) {
+        ESP_LOGE(TAG, "请通过 AUDIO_SIM_MIC 指定输入 WAV");
+        exit(1);
+    }
+    audio_sim_set_io(&io);
+
+    if (s_loopback) {
+        s_loop_buf = (int16_t *)malloc(SIM_LOOPBACK_SAMPLES * sizeof(int16_t));
+    }
+
+    audio_mgr_config_t cfg = AUDIO_MANAGER_DEFAULT_CONFIG();
+    cfg.wakeup_config.enabled = false;
+    cfg.event_callback = sim_event_cb;
+
+    if (audio_manager_init(&cfg) != ESP_OK) {
+        ESP_LOGE(TAG, "audio_manager 初始化失败");
+        exit(1);
+    }
+    audio_manager_set_record_callback(sim_record_cb, NULL);
+    audio_manager_start_playback();
+    audio_manager_start();
+
+    int next_step = 0;
+    uint64_t next_report_ms = SIM_REPORT_MS;
+
+    while (true) {
+        audio_mgr_pipeline_stats_t p = {0};
+        audio_manager_get_pipeline_stats(&p);
+        uint64_t audio_ms = p.mic_samples * 1000 / SIM_SAMPLE_RATE;
+
+        while (next_step < s_script_len && audio_ms >= s_script[next_step].at_ms) {
+            audio_sim_button_set(s_script[next_step].pressed);
+            next_step++;
+        }
+
+        if (audio_ms >= next_report_ms) {
+            sim_report("progress");
+            next_report_ms += SIM_REPORT_MS;
+        }
+
+        if (audio_sim_mic_finished() && p.playback_depth == 0 &&
+            !audio_manager_is_recording()) {
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    sim_report("final");
+    audio_manager_deinit();
+    free(s_loop_buf);
+    exit(0);
+}
@@ -0,0 +1,118 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\tools\base64_bench\main\base64_bench_main.cpp
+ * @Description: Base64 解码微基准 - 下行 Opus 包的解码开销
+ *
+ * 先校验：1~299 字节的随机数据经 mbedtls 编码后，base64_decode_to 与 mbedtls_base64_decode
+ * 的输出逐字节一致；目标缓冲区比解码结果小时返回 ESP_ERR_INVALID_SIZE。
+ * 再计时：同一个 Opus 包（默认 160 字节，约 60ms 语音）反复解码，输出每包耗时。
+ *
+ * 通过环境变量配置：
+ *   COZE_BENCH_PACKET   计时用的包长（字节，默认 160，最大 512）
+ *   COZE_BENCH_ROUNDS   每种实现的解码次数（默认 2000000）
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "mbedtls/base64.h"
+#include "base64_codec.h"
+
+#define BENCH_DEFAULT_PACKET    160
+#define BENCH_DEFAULT_ROUNDS    2000000
+#define BENCH_CHECK_MAX         300
+#define BENCH_PACKET_MAX        512
+
+static uint32_t s_seed = 12345;
+
+static void fill_random(uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        s_seed = s_seed * 1103515245u + 12345u;
+        buf[i] = (uint8_t)(s_seed >> 16);
+    }
+}
+
+/**
+ * @brief 逐长度与 mbedtls 对比解码结果
+ */
+static bool check_against_mbedtls(void)
+{
+    uint8_t raw[BENCH_CHECK_MAX];
+    unsigned char enc[BENCH_CHECK_MAX * 2];
+    uint8_t a[BENCH_PACKET_MAX];
+    uint8_t b[BENCH_PACKET_MAX];
+
+    for (size_t n = 1; n < BENCH_CHECK_MAX; n++) {
+        size_t enc_len = 0;
+        fill_random(raw, n);
+        mbedtls_base64_encode(enc, sizeof(enc), &enc_len, raw, n);
+
+        size_t a_len = 0;
+        size_t b_len = 0;
+        esp_err_t ret = base64_decode_to((const char *)enc, enc_len, a, sizeof(a), &a_len);
+        int mret = mbedtls_base64_decode(b, sizeof(b), &b_len, enc, enc_len);
+        if (ret != ESP_OK || mret != 0 || a_len != b_len || memcmp(a, b, a_len) != 0) {
+            printf("❌ %zu 字节: 解码结果与 mbedtls 不一致 (ret=%d, mbedtls=%d, %zu/%zu 字节)\n",
+                   n, ret, mret, a_len, b_len);
+            return false;
+        }
+        if (base64_decode_to((const char *)enc, enc_len, a, n - 1, &a_len) != ESP_ERR_INVALID_SIZE) {
+            printf("❌ %zu 字节: 目标缓冲区不足时未返回 ESP_ERR_INVALID_SIZE\n", n);
+            return false;
+        }
+    }
+    return true;
+}
+
+extern "C" void app_main(void)
+{
+    const char *packet_env = getenv("COZE_BENCH_PACKET");
+    const char *rounds_env = getenv("COZE_BENCH_ROUNDS");
+    int packet_len = packet_env ? atoi(packet_env) : BENCH_DEFAULT_PACKET;
+    int rounds = rounds_env ? atoi(rounds_env) : BENCH_DEFAULT_ROUNDS;
+    if (packet_len <= 0 || packet_len > BENCH_PACKET_MAX) {
+        packet_len = BENCH_DEFAULT_PACKET;
+    }
+    if (rounds <= 0) {
+        rounds = BENCH_DEFAULT_ROUNDS;
+    }
+
+    if (!check_against_mbedtls()) {
+        return;
+    }
+    printf("✅ 1~%d 字节与 mbedtls 解码结果一致\n", BENCH_CHECK_MAX - 1);
+
+    uint8_t raw[BENCH_PACKET_MAX];
+    unsigned char enc[BENCH_PACKET_MAX * 2];
+    uint8_t out[BENCH_PACKET_MAX];
+    size_t enc_len = 0;
+    size_t out_len = 0;
+    volatile uint32_t sink = 0;
+    fill_random(raw, packet_len);
+    mbedtls_base64_encode(enc, sizeof(enc), &enc_len, raw, packet_len);
+
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++) {
+        base64_decode_to((const char *)enc, enc_len, out, sizeof(out), &out_len);
+        sink = sink + out[i & 63];
+    }
+    int64_t table_us = esp_timer_get_time() - t0;
+
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++) {
+        mbedtls_base64_decode(out, sizeof(out), &out_len, enc, enc_len);
+        sink = sink + out[i & 63];
+    }
+    int64_t mbedtls_us = esp_timer_get_time() - t0;
+
+    printf("📊 %d 字节 Opus 包（Base64 %zu 字符），各解码 %d 次\n", packet_len, enc_len, rounds);
+    printf("   base64_decode_to:      %7.1f ns/包\n", table_us * 1000.0 / rounds);
+    printf("   mbedtls_base64_decode: %7.1f ns/包\n", mbedtls_us * 1000.0 / rounds);
+    printf("   加速比: %.1fx\n", table_us > 0 ? (double)mbedtls_us / table_us : 0.0);
+}
@@ -0,0 +1,238 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\tools\coze_dispatch_bench\main\coze_dispatch_bench_main.cpp
+ * @Description: 下行事件分发微基准 - 按 event_type 选择处理函数的开销
+ *
+ * 对比两种分发方式（只计 event_type → 处理函数这一步，不含 JSON 解析）：
+ *   旧：复制为 std::string，先做 3 次高频事件比较决定是否打日志，再按 if-else 链逐个比较
+ *   新：coze_event_lookup 在有序常量表上二分查找，按事件下标调用处理函数表
+ *
+ * 通过环境变量配置：
+ *   COZE_BENCH_SESSION  消息序列（tools/coze_mock record 录制的 JSONL，可选）；
+ *                       默认使用内置混合：音频增量 60%、文本增量 30%、识别中间值 5%、其余事件 5%
+ *   COZE_BENCH_ROUNDS   重复遍历消息序列的次数（默认 2000）
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <array>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "esp_timer.h"
+#include "coze_event_table.h"
+
+#define BENCH_DEFAULT_ROUNDS    2000
+
+static uint32_t s_hits[COZE_SERVER_EVENT_MAX + 1];
+
+static void bench_on_event(coze_server_event_t event)
+{
+    s_hits[event]++;
+}
+
+/**
+ * @brief 旧实现：std::string + 线性比较（与原 handle_coze_message 的比较顺序一致）
+ */
+static void dispatch_linear(const char *type)
+{
+    std::string event_type = type;
+
+    static volatile bool log_enabled = false;
+    if (event_type != "conversation.message.delta" &&
+        event_type != "conversation.audio.delta" &&
+        event_type != "conversation.audio_transcript.update") {
+        log_enabled = !log_enabled;
+    }
+
+    if (event_type == "chat.created") bench_on_event(COZE_SERVER_EVENT_CHAT_CREATED);
+    else if (event_type == "chat.updated") bench_on_event(COZE_SERVER_EVENT_CHAT_UPDATED);
+    else if (event_type == "conversation.chat.created") bench_on_event(COZE_SERVER_EVENT_CONVERSATION_CHAT_CREATED);
+    else if (event_type == "conversation.audio.delta") bench_on_event(COZE_SERVER_EVENT_AUDIO_DELTA);
+    else if (event_type == "input_audio_buffer.speech_started") bench_on_event(COZE_SERVER_EVENT_SPEECH_STARTED);
+    else if (event_type == "input_audio_buffer.speech_stopped") bench_on_event(COZE_SERVER_EVENT_SPEECH_STOPPED);
+    else if (event_type == "input_audio_buffer.completed") bench_on_event(COZE_SERVER_EVENT_INPUT_AUDIO_COMPLETED);
+    else if (event_type == "conversation.message.delta") bench_on_event(COZE_SERVER_EVENT_MESSAGE_DELTA);
+    else if (event_type == "conversation.message.completed") bench_on_event(COZE_SERVER_EVENT_MESSAGE_COMPLETED);
+    else if (event_type == "conversation.audio.completed") bench_on_event(COZE_SERVER_EVENT_AUDIO_COMPLETED);
+    else if (event_type == "conversation.chat.completed") bench_on_event(COZE_SERVER_EVENT_CONVERSATION_CHAT_COMPLETED);
+    else if (event_type == "conversation.chat.failed") bench_on_event(COZE_SERVER_EVENT_CONVERSATION_CHAT_FAILED);
+    else if (event_type == "conversation.audio.sentence_start") bench_on_event(COZE_SERVER_EVENT_AUDIO_SENTENCE_START);
+    else if (event_type == "conversation.audio_transcript.update") bench_on_event(COZE_SERVER_EVENT_TRANSCRIPT_UPDATE);
+    else if (event_type == "conversation.audio_transcript.completed") bench_on_event(COZE_SERVER_EVENT_TRANSCRIPT_COMPLETED);
+    else if (event_type == "conversation.chat.canceled") bench_on_event(COZE_SERVER_EVENT_CONVERSATION_CHAT_CANCELED);
+    else if (event_type == "input_audio_buffer.cleared") bench_on_event(COZE_SERVER_EVENT_INPUT_AUDIO_CLEARED);
+    else if (event_type == "conversation.cleared") bench_on_event(COZE_SERVER_EVENT_CONVERSATION_CLEARED);
+    else if (event_type == "error") bench_on_event(COZE_SERVER_EVENT_ERROR);
+    else bench_on_event(COZE_SERVER_EVENT_MAX);
+}
+
+typedef void (*bench_handler_fn)(void);
+
+template <coze_server_event_t E>
+static void bench_handler(void)
+{
+    bench_on_event(E);
+}
+
+template <size_t... I>
+static constexpr auto make_handlers(std::index_sequence<I...>)
+{
+    return std::array<bench_handler_fn, sizeof...(I)>{ bench_handler<(coze_server_event_t)I>... };
+}
+
+static constexpr auto s_handlers = make_handlers(std::make_index_sequence<COZE_SERVER_EVENT_MAX>());
+
+/**
+ * @brief 新实现：有序常量表二分查找 + 处理函数表
+ */
+static void dispatch_table(std::string_view type)
+{
+    const coze_event_entry_t *entry = coze_event_lookup(type);
+    if (!entry) {
+        bench_on_event(COZE_SERVER_EVENT_MAX);
+        return;
+    }
+    static volatile bool log_enabled = false;
+    if (!entry->quiet) {
+        log_enabled = !log_enabled;
+    }
+    s_handlers[entry->event]();
+}
+
+/**
+ * @brief 从一行 JSON 中取出 event_type 的值（录制文件中只需要这一个字段）
+ */
+static bool extract_event_type(const char *line, std::string *out)
+{
+    const char *p = strstr(line, "\"event_type\"");
+    if (!p) {
+        return false;
+    }
+    p = strchr(p + 12, ':');
+    if (!p) {
+        return false;
+    }
+    p++;
+    while (*p == ' ') p++;
+    if (*p != '"') {
+        return false;
+    }
+    const char *end = strchr(++p, '"');
+    if (!end) {
+        return false;
+    }
+    out->assign(p, end - p);
+    return true;
+}
+
+static size_t load_session(const char *path, std::vector<std::string> *mix)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("❌ 无法打开 %s\n", path);
+        return 0;
+    }
+    char *line = NULL;
+    size_t cap = 0;
+    std::string type;
+    while (getline(&line, &cap, f) > 0) {
+        if (extract_event_type(line, &type)) {
+            mix->push_back(type);
+        }
+    }
+    free(line);
+    fclose(f);
+    return mix->size();
+}
+
+/**
+ * @brief 内置混合：按一轮语音回复的典型比例生成，顺序用固定种子打散
+ */
+static void build_default_mix(std::vector<std::string> *mix)
+{
+    static const struct {
+        const char *type;
+        int count;
+    } weights[] = {
+        { "conversation.audio.delta",                 600 },
+        { "conversation.message.delta",               300 },
+        { "conversation.audio_transcript.update",      50 },
+        { "conversation.audio.sentence_start",         20 },
+        { "input_audio_buffer.speech_started",          3 },
+        { "input_audio_buffer.speech_stopped",          3 },
+        { "input_audio_buffer.completed",               3 },
+        { "conversation.audio_transcript.completed",    3 },
+        { "conversation.chat.created",                  3 },
+        { "conversation.message.completed",             3 },
+        { "conversation.audio.completed",               3 },
+        { "conversation.chat.completed",                3 },
+        { "chat.updated",                               1 },
+        { "error",                                      1 },
+        { "conversation.unknown_event",                 1 },
+    };
+    for (const auto &w : weights) {
+        for (int i = 0; i < w.count; i++) {
+            mix->push_back(w.type);
+        }
+    }
+    uint32_t seed = 12345;
+    for (size_t i = mix->size() - 1; i > 0; i--) {
+        seed = seed * 1103515245u + 12345u;
+        size_t j = (seed >> 8) % (i + 1);
+        std::swap((*mix)[i], (*mix)[j]);
+    }
+}
+
+extern "C" void app_main(void)
+{
+    std::vector<std::string> mix;
+    const char *session = getenv("COZE_BENCH_SESSION");
+    const char *rounds_env = getenv("COZE_BENCH_ROUNDS");
+    int rounds = rounds_env ? atoi(rounds_env) : BENCH_DEFAULT_ROUNDS;
+    if (rounds <= 0) {
+        rounds = BENCH_DEFAULT_ROUNDS;
+    }
+
+    if (session && load_session(session, &mix) > 0) {
+        printf("📂 录制消息序列: %s (%zu 条)\n", session, mix.size());
+    } else {
+        build_default_mix(&mix);
+        printf("📂 内置消息混合 (%zu 条)\n", mix.size());
+    }
+
+    // 两种实现的分发结果必须一致
+    uint32_t expect[COZE_SERVER_EVENT_MAX + 1];
+    for (const auto &t : mix) dispatch_linear(t.c_str());
+    memcpy(expect, s_hits, sizeof(expect));
+    memset(s_hits, 0, sizeof(s_hits));
+    for (const auto &t : mix) dispatch_table(t);
+    if (memcmp(expect, s_hits, sizeof(expect)) != 0) {
+        printf("❌ 两种实现的分发结果不一致\n");
+        return;
+    }
+
+    const uint64_t total = (uint64_t)mix.size() * rounds;
+
+    int64_t t0 = esp_timer_get_time();
+    for (int r = 0; r < rounds; r++) {
+        for (const auto &t : mix) dispatch_linear(t.c_str());
+    }
+    int64_t linear_us = esp_timer_get_time() - t0;
+
+    t0 = esp_timer_get_time();
+    for (int r = 0; r < rounds; r++) {
+        for (const auto &t : mix) dispatch_table(t);
+    }
+    int64_t table_us = esp_timer_get_time() - t0;
+
+    printf("📊 %" PRIu64 " 条消息\n", total);
+    printf("   std::string 线性比较: %7.1f ns/条\n", linear_us * 1000.0 / total);
+    printf("   有序常量表二分查找:   %7.1f ns/条\n", table_us * 1000.0 / total);
+    printf("   加速比: %.1fx\n", table_us > 0 ? (double)linear_us / table_us : 0.0);
+}
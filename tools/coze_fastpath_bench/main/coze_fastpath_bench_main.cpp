@@ -0,0 +1,266 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\tools\coze_fastpath_bench\main\coze_fastpath_bench_main.cpp
+ * @Description: 音频增量快速路径微基准 - conversation.audio.delta 从收到整条消息到得到 Opus 包的开销
+ *
+ * 对比两种处理方式（都到 Base64 解码出 Opus 包为止，不含 Opus 缓冲/解码）：
+ *   旧：复制为 std::string → cJSON_ParseWithLength → event_type 复制为 std::string 比较
+ *       → 取 data.content → base64_decode_to → cJSON_Delete
+ *   新：json_scan_string 取 event_type → coze_event_lookup → json_scan_string 取 content
+ *       → 检查转义 → base64_decode_to（与 handle_audio_delta_fast 相同）
+ *
+ * 输出每种方式的消息吞吐（条/s、MB/s）和每条消息的堆分配次数
+ * （cJSON 分配经 cJSON_InitHooks 计数，C++ 分配经全局 operator new 计数）。
+ *
+ * 通过环境变量配置：
+ *   COZE_BENCH_SESSION  消息来源（tools/coze_mock record 录制的 JSONL，可选，只取音频增量）；
+ *                       默认生成 200 条 Coze 格式的音频增量，Opus 包 80~160 字节
+ *   COZE_BENCH_ROUNDS   重复遍历消息的次数（默认 500）
+ *   COZE_BENCH_PATHS    all（默认）或 fast（只测快速路径）
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "esp_timer.h"
+#include "cJSON.h"
+#include "base64_codec.h"
+#include "coze_event_table.h"
+#include "coze_json_scan.h"
+
+#define BENCH_DEFAULT_ROUNDS    500
+#define BENCH_DEFAULT_MSGS      200
+#define BENCH_PACKET_MAX        512
+
+static size_t s_allocs;
+
+static void *count_malloc(size_t size)
+{
+    s_allocs++;
+    return malloc(size);
+}
+
+void *operator new(size_t size)
+{
+    s_allocs++;
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+static uint8_t s_packet[BENCH_PACKET_MAX];
+static size_t s_packet_bytes;
+
+/**
+ * @brief 旧实现：std::string 副本 + cJSON DOM（与 user-031 之前的 handle_coze_message 一致）
+ */
+static bool process_dom(const char *json, size_t len)
+{
+    std::string message(json, len);
+    cJSON *root = cJSON_ParseWithLength(message.c_str(), message.size());
+    if (!root) {
+        return false;
+    }
+    bool ok = false;
+    cJSON *event_type_item = cJSON_GetObjectItem(root, "event_type");
+    if (event_type_item && cJSON_IsString(event_type_item)) {
+        std::string event_type = event_type_item->valuestring;
+        if (event_type == "conversation.audio.delta") {
+            cJSON *data = cJSON_GetObjectItem(root, "data");
+            cJSON *content = data ? cJSON_GetObjectItem(data, "content") : NULL;
+            size_t out_len = 0;
+            if (content && cJSON_IsString(content) &&
+                base64_decode_to(content->valuestring, strlen(content->valuestring),
+                                 s_packet, sizeof(s_packet), &out_len) == ESP_OK) {
+                s_packet_bytes += out_len;
+                ok = true;
+            }
+        }
+    }
+    cJSON_Delete(root);
+    return ok;
+}
+
+/**
+ * @brief 新实现：原始缓冲区扫描（与 handle_audio_delta_fast 一致）
+ */
+static bool process_fast(const char *json, size_t len)
+{
+    const char *type = NULL;
+    size_t type_len = 0;
+    if (!json_scan_string(json, len, "event_type", &type, &type_len)) {
+        return false;
+    }
+    const coze_event_entry_t *entry = coze_event_lookup(std::string_view(type, type_len));
+    if (!entry || entry->event != COZE_SERVER_EVENT_AUDIO_DELTA) {
+        return false;
+    }
+    const char *content = NULL;
+    size_t content_len = 0;
+    if (!json_scan_string(json, len, "content", &content, &content_len) ||
+        memchr(content, '\\', content_len)) {
+        return false;
+    }
+    size_t out_len = 0;
+    if (base64_decode_to(content, content_len, s_packet, sizeof(s_packet), &out_len) != ESP_OK) {
+        return false;
+    }
+    s_packet_bytes += out_len;
+    return true;
+}
+
+/**
+ * @brief 从录制行中取出 event 对象的原文（record 模式下 event 是每行最后一个字段）
+ */
+static bool extract_event(const char *line, std::string *out)
+{
+    const char *p = strstr(line, "\"event\"");
+    if (!p) {
+        return false;
+    }
+    p = strchr(p + 7, '{');
+    const char *end = strrchr(line, '}');
+    if (!p || !end || end <= p) {
+        return false;
+    }
+    // end 指向外层对象的 '}'，再往前找 event 对象自己的 '}'
+    while (end > p && *--end != '}') {
+    }
+    if (end <= p) {
+        return false;
+    }
+    out->assign(p, end - p + 1);
+    return out->find("\"conversation.audio.delta\"") != std::string::npos;
+}
+
+static size_t load_session(const char *path, std::vector<std::string> *msgs)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("❌ 无法打开 %s\n", path);
+        return 0;
+    }
+    char *line = NULL;
+    size_t cap = 0;
+    std::string event;
+    while (getline(&line, &cap, f) > 0) {
+        if (extract_event(line, &event)) {
+            msgs->push_back(event);
+        }
+    }
+    free(line);
+    fclose(f);
+    return msgs->size();
+}
+
+/**
+ * @brief 生成 Coze 格式的音频增量（字段顺序、长度与服务器下发的一致，内容用固定种子填充）
+ */
+static void build_default_msgs(std::vector<std::string> *msgs)
+{
+    uint32_t seed = 12345;
+    uint8_t packet[160];
+    char b64[256];
+    char json[768];
+    for (int i = 0; i < BENCH_DEFAULT_MSGS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        size_t packet_len = 80 + (seed >> 8) % 81;
+        for (size_t k = 0; k < packet_len; k++) {
+            seed = seed * 1103515245u + 12345u;
+            packet[k] = (uint8_t)(seed >> 16);
+        }
+        size_t b64_len = 0;
+        base64_encode_to(packet, packet_len, b64, sizeof(b64), &b64_len);
+        snprintf(json, sizeof(json),
+                 "{\"id\":\"7446668538246561%04d\",\"event_type\":\"conversation.audio.delta\","
+                 "\"data\":{\"id\":\"7446668538246561827\",\"role\":\"assistant\",\"type\":\"answer\","
+                 "\"content\":\"%.*s\",\"content_type\":\"audio\",\"chat_id\":\"7446668538246545443\","
+                 "\"conversation_id\":\"7446668538246529059\",\"section_id\":\"7446668538246529060\"},"
+                 "\"detail\":{\"logid\":\"20241210152726467C48D89D6DB2F3\"}}",
+                 i, (int)b64_len, b64);
+        msgs->push_back(json);
+    }
+}
+
+typedef bool (*bench_process_fn)(const char *json, size_t len);
+
+static void run_path(const char *name, bench_process_fn fn,
+                     const std::vector<std::string> &msgs, int rounds, size_t total_bytes)
+{
+    // 预热并校验：每条消息都必须得到 Opus 包
+    s_packet_bytes = 0;
+    for (const auto &m : msgs) {
+        if (!fn(m.data(), m.size())) {
+            printf("❌ %s: 消息处理失败: %.80s...\n", name, m.c_str());
+            return;
+        }
+    }
+    const size_t packet_bytes = s_packet_bytes;
+
+    s_allocs = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (int r = 0; r < rounds; r++) {
+        for (const auto &m : msgs) {
+            fn(m.data(), m.size());
+        }
+    }
+    int64_t us = esp_timer_get_time() - t0;
+
+    const double total = (double)msgs.size() * rounds;
+    const double sec = us > 0 ? us / 1e6 : 1e-6;
+    printf("   %-22s %9.0f 条/s  %7.1f MB/s  %5.2f 次分配/条  (Opus %zu 字节/轮)\n",
+           name, total / sec, total_bytes * (double)rounds / sec / 1e6,
+           s_allocs / total, packet_bytes);
+}
+
+extern "C" void app_main(void)
+{
+    std::vector<std::string> msgs;
+    const char *session = getenv("COZE_BENCH_SESSION");
+    const char *rounds_env = getenv("COZE_BENCH_ROUNDS");
+    const char *paths = getenv("COZE_BENCH_PATHS");
+    int rounds = rounds_env ? atoi(rounds_env) : BENCH_DEFAULT_ROUNDS;
+    if (rounds <= 0) {
+        rounds = BENCH_DEFAULT_ROUNDS;
+    }
+    const bool run_dom = !paths || strcmp(paths, "fast") != 0;
+
+    if (session && load_session(session, &msgs) > 0) {
+        printf("📂 录制音频增量: %s (%zu 条)\n", session, msgs.size());
+    } else {
+        build_default_msgs(&msgs);
+        printf("📂 生成音频增量 (%zu 条)\n", msgs.size());
+    }
+
+    size_t total_bytes = 0;
+    for (const auto &m : msgs) {
+        total_bytes += m.size();
+    }
+    printf("📊 平均 %zu 字节/条，%d 轮\n", total_bytes / msgs.size(), rounds);
+
+    if (run_dom) {
+        cJSON_Hooks hooks = { count_malloc, free };
+        cJSON_InitHooks(&hooks);
+        run_path("std::string + cJSON", process_dom, msgs, rounds, total_bytes);
+    }
+    run_path("原始缓冲区扫描", process_fast, msgs, rounds, total_bytes);
+}
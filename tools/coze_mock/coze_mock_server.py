@@ -0,0 +1,635 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+@Author: 星年 && jixingnian@gmail.com
+@Date: 2025-12-04
+@LastEditors: xingnian jixingnian@gmail.com
+@LastEditTime: 2025-12-04
+@FilePath: \\xn_esp32_audio\\tools\\coze_mock\\coze_mock_server.py
+@Description: Coze 实时语音协议本地模拟服务器 - 压测 coze_chat 时替代 ws.coze.cn
+
+只依赖 Python 3.8+ 标准库。设备或 tools/coze_sim 把 server_url 指向
+ws://<主机>:8765/v1/chat 即可。
+
+模式：
+  serve   模拟服务器：应答 chat.update / input_audio_buffer.* / conversation.chat.cancel，
+          每轮回复流式下发 conversation.message.delta 与 conversation.audio.delta
+          （合成回复，或 --session 回放录制的会话）
+  record  录制代理：转发到真实服务器（--upstream），把下行事件按相对
+          input_audio_buffer.complete 的时间写入 --out，供 serve --session 回放
+
+链路注入（仅 serve，作用于下行）：
+  --speed N      回放/合成倍速，1 为实时，0 为尽快
+  --delay MS     固定单向时延
+  --jitter MS    额外随机时延（0~MS，保持顺序，与 TCP 一致）
+  --loss PCT     按百分比丢弃 conversation.audio.delta（模拟服务端丢帧）
+  --fragment N   每条消息按 N 字节拆成 WebSocket 分片
+
+每轮结束打印一行指标，退出时打印汇总；--metrics 另存为 JSONL。
+
+示例：
+  python3 coze_mock_server.py serve --reply-ms 4000 --jitter 80 --loss 2 --fragment 1400
+  python3 coze_mock_server.py record --upstream wss://ws.coze.cn/v1/chat --out session.jsonl
+  python3 coze_mock_server.py serve --session session.jsonl --speed 4
+"""
+
+import argparse
+import asyncio
+import base64
+import hashlib
+import json
+import os
+import random
+import signal
+import ssl
+import struct
+import sys
+import time
+import urllib.parse
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+OP_CONT = 0x0
+OP_TEXT = 0x1
+OP_BINARY = 0x2
+OP_CLOSE = 0x8
+OP_PING = 0x9
+OP_PONG = 0xA
+
+DEFAULT_REPLY_TEXT = "你好，我是本地模拟服务器。这是一段用于压测的流式回复，包含文本增量与音频增量。"
+
+
+def now_ms():
+    return time.monotonic() * 1000.0
+
+
+# ========== WebSocket 帧读写 ==========
+
+class WsClosed(Exception):
+    pass
+
+
+async def ws_read_message(reader, writer, mask_out=False):
+    """读取一条完整消息（拼接分片，自动应答 ping），返回 (opcode, payload)"""
+    message = bytearray()
+    message_op = None
+    while True:
+        head = await reader.readexactly(2)
+        fin = head[0] & 0x80
+        op = head[0] & 0x0F
+        masked = head[1] & 0x80
+        length = head[1] & 0x7F
+        if length == 126:
+            length = struct.unpack("!H", await reader.readexactly(2))[0]
+        elif length == 127:
+            length = struct.unpack("!Q", await reader.readexactly(8))[0]
+        key = await reader.readexactly(4) if masked else None
+        data = bytearray(await reader.readexactly(length))
+        if key:
+            for i in range(length):
+                data[i] ^= key[i & 3]
+
+        if op == OP_PING:
+            ws_write_frame(writer, OP_PONG, bytes(data), mask=mask_out)
+            continue
+        if op == OP_PONG:
+            continue
+        if op == OP_CLOSE:
+            raise WsClosed()
+        if op != OP_CONT:
+            message_op = op
+            message = bytearray()
+        message += data
+        if fin:
+            return message_op, bytes(message)
+
+
+def ws_write_frame(writer, op, payload, fin=True, mask=False):
+    head = bytearray([(0x80 if fin else 0) | op])
+    mask_bit = 0x80 if mask else 0
+    n = len(payload)
+    if n < 126:
+        head.append(mask_bit | n)
+    elif n < 65536:
+        head.append(mask_bit | 126)
+        head += struct.pack("!H", n)
+    else:
+        head.append(mask_bit | 127)
+        head += struct.pack("!Q", n)
+    if mask:
+        key = os.urandom(4)
+        head += key
+        payload = bytes(b ^ key[i & 3] for i, b in enumerate(payload))
+    writer.write(bytes(head) + payload)
+
+
+def ws_write_message(writer, text, fragment=0, mask=False):
+    """写一条文本消息，fragment>0 时拆成多个分片，返回帧数"""
+    data = text.encode("utf-8")
+    if fragment <= 0 or len(data) <= fragment:
+        ws_write_frame(writer, OP_TEXT, data, mask=mask)
+        return 1
+    frames = 0
+    for off in range(0, len(data), fragment):
+        chunk = data[off:off + fragment]
+        last = off + fragment >= len(data)
+        ws_write_frame(writer, OP_TEXT if off == 0 else OP_CONT, chunk, fin=last, mask=mask)
+        frames += 1
+    return frames
+
+
+async def ws_server_handshake(reader, writer):
+    """服务端握手，返回 (path, headers)"""
+    request = await reader.readuntil(b"\r\n\r\n")
+    lines = request.decode("latin-1").split("\r\n")
+    path = lines[0].split(" ")[1]
+    headers = {}
+    for line in lines[1:]:
+        if ":" in line:
+            k, v = line.split(":", 1)
+            headers[k.strip().lower()] = v.strip()
+    accept = base64.b64encode(hashlib.sha1((headers["sec-websocket-key"] + WS_GUID).encode()).digest()).decode()
+    writer.write(("HTTP/1.1 101 Switching Protocols\r\n"
+                  "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                  "Sec-WebSocket-Accept: %s\r\n\r\n" % accept).encode())
+    await writer.drain()
+    return path, headers
+
+
+async def ws_client_connect(url, headers):
+    """客户端握手（record 模式连上游），返回 (reader, writer)"""
+    u = urllib.parse.urlsplit(url)
+    secure = u.scheme == "wss"
+    port = u.port or (443 if secure else 80)
+    ctx = ssl.create_default_context() if secure else None
+    reader, writer = await asyncio.open_connection(u.hostname, port, ssl=ctx)
+    key = base64.b64encode(os.urandom(16)).decode()
+    path = u.path + ("?" + u.query if u.query else "")
+    extra = "".join("%s: %s\r\n" % (k, v) for k, v in headers.items())
+    writer.write(("GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                  "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n%s\r\n" %
+                  (path, u.hostname, key, extra)).encode())
+    await writer.drain()
+    response = await reader.readuntil(b"\r\n\r\n")
+    status = response.split(b"\r\n", 1)[0]
+    if b" 101 " not in status:
+        raise ConnectionError("上游握手失败: %s" % status.decode("latin-1"))
+    return reader, writer
+
+
+# ========== 指标 ==========
+
+class TurnMetrics:
+    def __init__(self, conn_id, turn):
+        self.conn = conn_id
+        self.turn = turn
+        self.uplink_messages = 0
+        self.uplink_audio_bytes = 0
+        self.uplink_first_ms = None
+        self.complete_ms = None
+        self.first_audio_ms = None
+        self.last_audio_ms = None
+        self.audio_sent = 0
+        self.audio_dropped = 0
+        self.audio_bytes = 0
+        self.text_sent = 0
+        self.messages_sent = 0
+        self.bytes_sent = 0
+        self.frames_sent = 0
+        self.canceled = False
+
+    def report(self):
+        def span(a, b):
+            return round(b - a, 1) if a is not None and b is not None else None
+        return {
+            "conn": self.conn,
+            "turn": self.turn,
+            "uplink_messages": self.uplink_messages,
+            "uplink_audio_bytes": self.uplink_audio_bytes,
+            "uplink_span_ms": span(self.uplink_first_ms, self.complete_ms),
+            "ttfa_ms": span(self.complete_ms, self.first_audio_ms),
+            "audio_span_ms": span(self.first_audio_ms, self.last_audio_ms),
+            "audio_sent": self.audio_sent,
+            "audio_dropped": self.audio_dropped,
+            "audio_bytes": self.audio_bytes,
+            "text_sent": self.text_sent,
+            "messages_sent": self.messages_sent,
+            "bytes_sent": self.bytes_sent,
+            "frames_sent": self.frames_sent,
+            "canceled": self.canceled,
+        }
+
+
+class MetricsLog:
+    def __init__(self, path):
+        self.turns = []
+        self.file = open(path, "a", encoding="utf-8") if path else None
+
+    def add(self, metrics):
+        r = metrics.report()
+        self.turns.append(r)
+        print("📊 conn=%d turn=%d 上行 %d 条/%d 字节 | 首包 %s ms | 音频 %d 条 (丢弃 %d) %d 字节, 跨度 %s ms | "
+              "文本 %d 条 | 下行 %d 条 %d 帧 %d 字节%s" %
+              (r["conn"], r["turn"], r["uplink_messages"], r["uplink_audio_bytes"], r["ttfa_ms"],
+               r["audio_sent"], r["audio_dropped"], r["audio_bytes"], r["audio_span_ms"],
+               r["text_sent"], r["messages_sent"], r["frames_sent"], r["bytes_sent"],
+               " (已取消)" if r["canceled"] else ""), flush=True)
+        if self.file:
+            self.file.write(json.dumps(r, ensure_ascii=False) + "\n")
+            self.file.flush()
+
+    def summary(self):
+        if not self.turns:
+            print("📊 汇总: 无完成的轮次")
+            return
+        ttfa = sorted(t["ttfa_ms"] for t in self.turns if t["ttfa_ms"] is not None)
+
+        def pct(p):
+            return ttfa[min(len(ttfa) - 1, int(len(ttfa) * p))] if ttfa else None
+        sent = sum(t["audio_sent"] for t in self.turns)
+        dropped = sum(t["audio_dropped"] for t in self.turns)
+        print("📊 汇总: %d 轮, 首包 p50=%s p90=%s max=%s ms, 音频 %d 条 丢弃 %d 条, 下行 %d 字节, 取消 %d 轮" %
+              (len(self.turns), pct(0.5), pct(0.9), ttfa[-1] if ttfa else None, sent, dropped,
+               sum(t["bytes_sent"] for t in self.turns), sum(1 for t in self.turns if t["canceled"])),
+              flush=True)
+
+
+# ========== 回复来源 ==========
+
+def opus_packet(bitrate, frame_ms):
+    """与主机仿真编解码一致的 CBR 包：宽带 SILK TOC，超过 60ms 用 code 3 多帧"""
+    size = max(3, bitrate * frame_ms // 8000)
+    frames = max(1, frame_ms // 20)
+    packet = bytearray(size)
+    if frames <= 3:
+        packet[0] = (9 + frames - 1) << 3
+    else:
+        packet[0] = (9 << 3) | 3
+        packet[1] = frames
+    return bytes(packet)
+
+
+def synth_reply(args, audio_cfg):
+    """合成一轮回复：返回 [(t_ms, event_type, data)]，音频按帧长均匀排布"""
+    events = []
+    frame_ms = audio_cfg["frame_ms"]
+    text = args.reply_text
+    audio_frames = max(1, args.reply_ms // frame_ms)
+    t0 = args.think_ms
+    if audio_cfg["codec"] == "pcm":
+        payload = bytes(audio_cfg["sample_rate"] * frame_ms // 1000 * 2)
+    else:
+        payload = opus_packet(audio_cfg["bitrate"], frame_ms)
+    content = base64.b64encode(payload).decode()
+
+    # 文本按字均匀铺在音频时长内，略早于对应语音
+    for i, ch in enumerate(text):
+        t = t0 + i * args.reply_ms / max(1, len(text)) * 0.8
+        events.append((t, "conversation.message.delta", {"role": "assistant", "type": "answer", "content": ch}))
+    for i in range(audio_frames):
+        events.append((t0 + i * frame_ms, "conversation.audio.delta", {"role": "assistant", "type": "answer",
+                                                                       "content": content}))
+    events.sort(key=lambda e: e[0])
+    end = t0 + audio_frames * frame_ms
+    events.append((end, "conversation.message.completed", {"role": "assistant", "type": "answer",
+                                                            "content": text}))
+    events.append((end, "conversation.audio.completed", {}))
+    return events
+
+
+def load_session(path):
+    """读取录制的会话：按 turn 分组，每组 [(t_ms, event_type, data)]"""
+    turns = {}
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            rec = json.loads(line)
+            ev = rec["event"]
+            turns.setdefault(rec.get("turn", 0), []).append((rec["t_ms"], ev.get("event_type"), ev.get("data", {})))
+    return [sorted(v, key=lambda e: e[0]) for _, v in sorted(turns.items())]
+
+
+# ========== 模拟服务器会话 ==========
+
+class MockSession:
+    def __init__(self, server, conn_id, reader, writer, query):
+        self.server = server
+        self.args = server.args
+        self.conn_id = conn_id
+        self.reader = reader
+        self.writer = writer
+        self.bot_id = query.get("bot_id", ["bot"])[0]
+        self.conversation_id = "conv_%d_%d" % (int(time.time()), conn_id)
+        self.audio_cfg = {"codec": "opus", "bitrate": 16000, "sample_rate": 16000, "frame_ms": 60}
+        self.server_vad = False
+        self.vad_silence_ms = 500
+        self.speaking = False
+        self.vad_timer = None
+        self.turn = 0
+        self.metrics = None
+        self.reply_task = None
+        self.chat_id = None
+        self.out_q = asyncio.Queue()
+        self.release_ms = 0.0
+        self.sender = None
+
+    # ----- 下行：时延/抖动/丢弃/分片 -----
+
+    def emit(self, event_type, data, metrics=None):
+        msg = {"id": "evt_%d" % random.getrandbits(48), "event_type": event_type, "data": data}
+        if metrics and event_type == "conversation.audio.delta" and random.random() * 100 < self.args.loss:
+            metrics.audio_dropped += 1
+            return
+        delay = self.args.delay + (random.uniform(0, self.args.jitter) if self.args.jitter > 0 else 0)
+        self.release_ms = max(self.release_ms, now_ms() + delay)
+        self.out_q.put_nowait((self.release_ms, event_type, json.dumps(msg, ensure_ascii=False), metrics))
+
+    async def send_loop(self):
+        while True:
+            release, event_type, text, metrics = await self.out_q.get()
+            wait = (release - now_ms()) / 1000.0
+            if wait > 0:
+                await asyncio.sleep(wait)
+            frames = ws_write_message(self.writer, text, self.args.fragment)
+            await self.writer.drain()
+            if metrics:
+                size = len(text.encode("utf-8"))
+                metrics.messages_sent += 1
+                metrics.frames_sent += frames
+                metrics.bytes_sent += size
+                if event_type == "conversation.audio.delta":
+                    t = now_ms()
+                    metrics.audio_sent += 1
+                    metrics.audio_bytes += size
+                    metrics.last_audio_ms = t
+                    if metrics.first_audio_ms is None:
+                        metrics.first_audio_ms = t
+                elif event_type == "conversation.message.delta":
+                    metrics.text_sent += 1
+                elif event_type in ("conversation.chat.completed", "conversation.chat.canceled"):
+                    # 本轮最后一条消息已发出
+                    self.server.metrics.add(metrics)
+
+    # ----- 上行事件 -----
+
+    def on_chat_update(self, data):
+        out = data.get("output_audio") or {}
+        codec = out.get("codec")
+        if codec == "opus":
+            oc = out.get("opus_config", {})
+            self.audio_cfg.update(codec="opus", bitrate=oc.get("bitrate", 16000),
+                                  sample_rate=oc.get("sample_rate", 16000), frame_ms=oc.get("frame_size_ms", 60))
+        elif codec == "pcm":
+            pc = out.get("pcm_config", {})
+            self.audio_cfg.update(codec="pcm", sample_rate=pc.get("sample_rate", 16000),
+                                  frame_ms=pc.get("frame_size_ms", 60))
+        td = (data.get("turn_detection") or {})
+        if td:
+            self.server_vad = td.get("type") == "server_vad"
+            self.vad_silence_ms = td.get("silence_duration_ms", self.vad_silence_ms)
+        self.emit("chat.updated", data)
+
+    def turn_metrics(self):
+        if self.metrics is None:
+            self.turn += 1
+            self.metrics = TurnMetrics(self.conn_id, self.turn)
+        return self.metrics
+
+    def on_append(self, data):
+        m = self.turn_metrics()
+        m.uplink_messages += 1
+        m.uplink_audio_bytes += len(base64.b64decode(data.get("delta", "")))
+        if m.uplink_first_ms is None:
+            m.uplink_first_ms = now_ms()
+        if self.server_vad:
+            if not self.speaking:
+                self.speaking = True
+                self.emit("input_audio_buffer.speech_started", {})
+                if self.reply_task and not self.reply_task.done():
+                    self.cancel_reply()
+            if self.vad_timer:
+                self.vad_timer.cancel()
+            self.vad_timer = asyncio.get_event_loop().call_later(self.vad_silence_ms / 1000.0, self.on_vad_end)
+
+    def on_vad_end(self):
+        self.speaking = False
+        self.emit("input_audio_buffer.speech_stopped", {})
+        self.on_complete()
+
+    def on_complete(self):
+        m = self.turn_metrics()
+        m.complete_ms = now_ms()
+        self.metrics = None
+        self.emit("input_audio_buffer.completed", {})
+        if self.reply_task and not self.reply_task.done():
+            self.cancel_reply()
+        self.reply_task = asyncio.ensure_future(self.reply(m))
+
+    def cancel_reply(self):
+        self.reply_task.cancel()
+
+    async def reply(self, m):
+        self.chat_id = "chat_%d" % random.getrandbits(48)
+        ids = {"id": self.chat_id, "conversation_id": self.conversation_id, "bot_id": self.bot_id}
+        if self.server.session_turns:
+            events = self.server.next_session_turn()
+        else:
+            events = synth_reply(self.args, self.audio_cfg)
+        speed = self.args.speed
+        start = now_ms()
+        try:
+            self.emit("conversation.chat.created", dict(ids, status="created"), m)
+            for t, event_type, data in events:
+                # 轮次边界与上行确认由模拟服务器自己发出，录制中的同类事件跳过
+                if event_type in ("conversation.chat.created", "conversation.chat.completed",
+                                  "conversation.chat.failed", "conversation.chat.canceled",
+                                  "chat.created", "chat.updated") or event_type.startswith("input_audio_buffer."):
+                    continue
+                if speed > 0:
+                    wait = (start + t / speed - now_ms()) / 1000.0
+                    if wait > 0:
+                        await asyncio.sleep(wait)
+                payload = dict(data)
+                payload.update(chat_id=self.chat_id, conversation_id=self.conversation_id)
+                self.emit(event_type, payload, m)
+            self.emit("conversation.chat.completed", dict(ids, status="completed"), m)
+        except asyncio.CancelledError:
+            m.canceled = True
+            self.emit("conversation.chat.canceled", dict(ids, status="canceled"), m)
+
+    async def run(self):
+        self.sender = asyncio.ensure_future(self.send_loop())
+        self.emit("chat.created", {})
+        try:
+            while True:
+                op, payload = await ws_read_message(self.reader, self.writer)
+                if op != OP_TEXT:
+                    continue
+                msg = json.loads(payload)
+                event_type = msg.get("event_type")
+                data = msg.get("data") or {}
+                if event_type == "chat.update":
+                    self.on_chat_update(data)
+                elif event_type == "input_audio_buffer.append":
+                    self.on_append(data)
+                elif event_type == "input_audio_buffer.complete":
+                    if self.vad_timer:
+                        self.vad_timer.cancel()
+                        self.vad_timer = None
+                    self.speaking = False
+                    self.on_complete()
+                elif event_type == "input_audio_buffer.clear":
+                    self.metrics = None
+                    self.emit("input_audio_buffer.cleared", {})
+                elif event_type == "conversation.chat.cancel":
+                    if self.reply_task and not self.reply_task.done():
+                        self.cancel_reply()
+                elif event_type == "conversation.clear":
+                    self.emit("conversation.cleared", {})
+                else:
+                    print("⚠️ conn=%d 未处理的事件: %s" % (self.conn_id, event_type), flush=True)
+        finally:
+            if self.reply_task:
+                self.reply_task.cancel()
+            if self.vad_timer:
+                self.vad_timer.cancel()
+            self.sender.cancel()
+
+
+class MockServer:
+    def __init__(self, args):
+        self.args = args
+        self.conn_count = 0
+        self.metrics = MetricsLog(args.metrics)
+        self.session_turns = load_session(args.session) if args.session else []
+        self.session_index = 0
+
+    def next_session_turn(self):
+        turn = self.session_turns[self.session_index % len(self.session_turns)]
+        self.session_index += 1
+        return turn
+
+    async def handle(self, reader, writer):
+        self.conn_count += 1
+        conn_id = self.conn_count
+        try:
+            path, _ = await ws_server_handshake(reader, writer)
+            query = urllib.parse.parse_qs(urllib.parse.urlsplit(path).query)
+            print("🔗 conn=%d 已连接 %s" % (conn_id, path), flush=True)
+            await MockSession(self, conn_id, reader, writer, query).run()
+        except (WsClosed, asyncio.IncompleteReadError, ConnectionError):
+            pass
+        finally:
+            writer.close()
+            print("🔌 conn=%d 已断开" % conn_id, flush=True)
+
+
+# ========== 录制代理 ==========
+
+class RecordProxy:
+    def __init__(self, args):
+        self.args = args
+        self.out = open(args.out, "a", encoding="utf-8")
+        self.turn = 0
+
+    async def handle(self, reader, writer):
+        try:
+            path, headers = await ws_server_handshake(reader, writer)
+            query = urllib.parse.urlsplit(path).query
+            url = self.args.upstream + ("?" + query if query else "")
+            fwd = {k: headers[k.lower()] for k in ("Authorization", "User-Agent") if k.lower() in headers}
+            up_reader, up_writer = await ws_client_connect(url, fwd)
+            print("🔗 已连接上游 %s" % self.args.upstream, flush=True)
+        except (asyncio.IncompleteReadError, ConnectionError, OSError) as e:
+            print("❌ 代理建连失败: %s" % e, flush=True)
+            writer.close()
+            return
+
+        state = {"t0": now_ms(), "turn": None}
+
+        async def uplink():
+            while True:
+                op, payload = await ws_read_message(reader, writer)
+                if op == OP_TEXT:
+                    ev = json.loads(payload).get("event_type")
+                    if ev == "input_audio_buffer.complete":
+                        state["t0"] = now_ms()
+                        state["turn"] = self.turn
+                        self.turn += 1
+                ws_write_frame(up_writer, op, payload, mask=True)
+                await up_writer.drain()
+
+        async def downlink():
+            while True:
+                op, payload = await ws_read_message(up_reader, up_writer, mask_out=True)
+                ws_write_frame(writer, op, payload)
+                await writer.drain()
+                if op == OP_TEXT and state["turn"] is not None:
+                    rec = {"turn": state["turn"], "t_ms": round(now_ms() - state["t0"], 1),
+                           "event": json.loads(payload)}
+                    self.out.write(json.dumps(rec, ensure_ascii=False) + "\n")
+                    self.out.flush()
+
+        tasks = [asyncio.ensure_future(uplink()), asyncio.ensure_future(downlink())]
+        await asyncio.wait(tasks, return_when=asyncio.FIRST_COMPLETED)
+        for t in tasks:
+            t.cancel()
+        writer.close()
+        up_writer.close()
+        print("🔌 代理连接结束，已录制 %d 轮" % self.turn, flush=True)
+
+
+# ========== 入口 ==========
+
+def main():
+    parser = argparse.ArgumentParser(description="Coze 实时语音协议本地模拟服务器")
+    sub = parser.add_subparsers(dest="mode", required=True)
+
+    serve = sub.add_parser("serve", help="模拟服务器")
+    serve.add_argument("--host", default="0.0.0.0")
+    serve.add_argument("--port", type=int, default=8765)
+    serve.add_argument("--session", help="回放录制的会话（record 模式输出），按轮循环")
+    serve.add_argument("--reply-ms", type=int, default=3000, help="合成回复的语音时长")
+    serve.add_argument("--reply-text", default=DEFAULT_REPLY_TEXT, help="合成回复的文本")
+    serve.add_argument("--think-ms", type=int, default=300, help="合成回复的首包前等待")
+    serve.add_argument("--speed", type=float, default=1.0, help="倍速，0 为尽快")
+    serve.add_argument("--delay", type=float, default=0.0, help="下行固定时延 ms")
+    serve.add_argument("--jitter", type=float, default=0.0, help="下行随机时延上限 ms")
+    serve.add_argument("--loss", type=float, default=0.0, help="音频增量丢弃百分比")
+    serve.add_argument("--fragment", type=int, default=0, help="分片大小（字节），0 不分片")
+    serve.add_argument("--metrics", help="每轮指标追加写入的 JSONL 文件")
+    serve.add_argument("--seed", type=int, help="随机种子（抖动/丢弃可复现）")
+
+    record = sub.add_parser("record", help="录制代理")
+    record.add_argument("--host", default="0.0.0.0")
+    record.add_argument("--port", type=int, default=8765)
+    record.add_argument("--upstream", default="wss://ws.coze.cn/v1/chat")
+    record.add_argument("--out", required=True, help="录制输出 JSONL")
+
+    args = parser.parse_args()
+    if getattr(args, "seed", None) is not None:
+        random.seed(args.seed)
+
+    app = MockServer(args) if args.mode == "serve" else RecordProxy(args)
+    loop = asyncio.new_event_loop()
+    asyncio.set_event_loop(loop)
+    server = loop.run_until_complete(asyncio.start_server(app.handle, args.host, args.port))
+    print("🚀 %s 监听 ws://%s:%d/v1/chat" % (args.mode, args.host, args.port), flush=True)
+
+    stop = asyncio.Event()
+    for sig in (signal.SIGINT, signal.SIGTERM):
+        try:
+            loop.add_signal_handler(sig, stop.set)
+        except NotImplementedError:
+            pass
+    loop.run_until_complete(stop.wait())
+    server.close()
+    if args.mode == "serve":
+        app.metrics.summary()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,320 @@
+/*
+ * @Author: 星年 && jixingnian@gmail.com
+ * @Date: 2025-12-04
+ * @LastEditors: xingnian jixingnian@gmail.com
+ * @LastEditTime: 2025-12-04
+ * @FilePath: \xn_esp32_audio\tools\coze_sim\main\coze_sim_main.c
+ * @Description: coze_chat 主机仿真 - 连接本地模拟服务器跑多轮对话并输出端到端指标
+ *
+ * 通过环境变量配置：
+ *   COZE_SIM_URL       服务器地址（默认 ws://127.0.0.1:8765/v1/chat，见 tools/coze_mock）
+ *   COZE_SIM_MIC       每轮上行的麦克风 WAV（16bit/16kHz/单声道，可选，默认 1.5 秒 440Hz 提示音）
+ *   COZE_SIM_TURNS     对话轮数（默认 5）
+ *   COZE_SIM_SPEED     上行倍速，1=实时，0=尽快（默认 1）
+ *   COZE_SIM_REPLY     回复模式 audio/text（默认 audio）
+ *   COZE_SIM_PROFILE   调度预设 balanced/low-latency/wifi-heavy（默认 balanced）
+ *   COZE_SIM_PLAY_MS   虚拟播放缓冲容量（默认 500ms），按实时速度消耗，满时对下行背压
+ *   COZE_SIM_DOWNLINK  下行编码 opus/pcm（默认 opus）
+ *   COZE_SIM_PCM_RATE  PCM 下行向服务器请求的采样率（默认与输出相同，不同时本地重采样）
+ *
+ * 每轮输出：首包时延（提交音频到首帧 PCM 写入播放缓冲）、解析吞吐、上下行丢弃计数、
+ * 每秒音频的解码耗时（decode_us_per_s，比较 Opus 与 PCM 下行的CPU开销）。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "coze_chat.h"
+
+static const char *TAG = "coze_sim";
+
+#define SIM_SAMPLE_RATE     16000
+#define SIM_CHUNK_MS        20
+#define SIM_CHUNK_SAMPLES   (SIM_SAMPLE_RATE * SIM_CHUNK_MS / 1000)
+#define SIM_TONE_MS         1500
+#define SIM_SINK_SAMPLES    5760            ///< 单次预留上限（与解码缓冲一致）
+#define SIM_READY_TIMEOUT_MS  10000
+#define SIM_TURN_TIMEOUT_MS   30000
+
+static int16_t *s_mic = NULL;
+static size_t s_mic_samples = 0;
+static int s_speed = 1;
+
+// 虚拟播放缓冲：已写入但按实时速度尚未“播放”的样本
+static int16_t s_sink_buf[SIM_SINK_SAMPLES];
+static int64_t s_play_us = 0;               ///< 缓冲内音频播完的时刻
+static int s_play_cap_ms = 500;
+static volatile int64_t s_first_pcm_us = 0;
+static volatile uint64_t s_pcm_samples = 0;
+
+static volatile bool s_ready = false;
+static volatile bool s_turn_done = false;
+
+typedef struct {
+    uint32_t turns;
+    uint32_t ttfa_ms_sum;
+    uint32_t ttfa_ms_max;
+    uint32_t ttfa_missing;
+    uint64_t bytes;
+    uint64_t process_us;
+} sim_summary_t;
+
+static int env_int(const char *name, int def)
+{
+    const char *v = getenv(name);
+    return v ? atoi(v) : def;
+}
+
+/**
+ * @brief 读取 16bit 单声道 WAV（跳过 data 之前的所有块）
+ */
+static bool sim_load_wav(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        ESP_LOGE(TAG, "无法打开 %s", path);
+        return false;
+    }
+    uint8_t riff[12];
+    if (fread(riff, 1, 12, f) != 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        ESP_LOGE(TAG, "不是 WAV 文件: %s", path);
+        fclose(f);
+        return false;
+    }
+    uint8_t hdr[8];
+    while (fread(hdr, 1, 8, f) == 8) {
+        uint32_t size = hdr[4] | (hdr[5] << 8) | (hdr[6] << 16) | ((uint32_t)hdr[7] << 24);
+        if (memcmp(hdr, "data", 4) == 0) {
+            s_mic = (int16_t *)malloc(size);
+            s_mic_samples = s_mic ? fread(s_mic, 1, size, f) / sizeof(int16_t) : 0;
+            fclose(f);
+            return s_mic_samples > 0;
+        }
+        fseek(f, (size + 1) & ~1u, SEEK_CUR);
+    }
+    fclose(f);
+    ESP_LOGE(TAG, "WAV 缺少 data 块: %s", path);
+    return false;
+}
+
+static void sim_make_tone(void)
+{
+    s_mic_samples = SIM_SAMPLE_RATE * SIM_TONE_MS / 1000;
+    s_mic = (int16_t *)malloc(s_mic_samples * sizeof(int16_t));
+    for (size_t i = 0; i < s_mic_samples; i++) {
+        s_mic[i] = (int16_t)(6000 * sin(2 * M_PI * 440 * i / SIM_SAMPLE_RATE));
+    }
+}
+
+static size_t sim_sink_reserve(int16_t **ptr, size_t samples, uint32_t timeout_ms, void *ctx)
+{
+    (void)ctx;
+    if (samples > SIM_SINK_SAMPLES) {
+        samples = SIM_SINK_SAMPLES;
+    }
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    int64_t need_us = (int64_t)samples * 1000000 / SIM_SAMPLE_RATE;
+    while (true) {
+        int64_t now = esp_timer_get_time();
+        int64_t buffered_us = s_play_us > now ? s_play_us - now : 0;
+        if (buffered_us + need_us <= (int64_t)s_play_cap_ms * 1000) {
+            break;
+        }
+        if (now >= deadline) {
+            return 0;
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    *ptr = s_sink_buf;
+    return samples;
+}
+
+static esp_err_t sim_sink_commit(size_t samples, void *ctx)
+{
+    (void)ctx;
+    int64_t now = esp_timer_get_time();
+    if (s_first_pcm_us == 0) {
+        s_first_pcm_us = now;
+    }
+    if (s_play_us < now) {
+        s_play_us = now;
+    }
+    s_play_us += (int64_t)samples * 1000000 / SIM_SAMPLE_RATE;
+    s_pcm_samples += samples;
+    return ESP_OK;
+}
+
+static void sim_sink_clear(void *ctx)
+{
+    (void)ctx;
+    s_play_us = 0;
+}
+
+static void sim_event_cb(coze_chat_event_t event, char *data, void *ctx)
+{
+    (void)data;
+    (void)ctx;
+    switch (event) {
+    case COZE_CHAT_EVENT_CHAT_UPDATE:
+        s_ready = true;
+        break;
+    case COZE_CHAT_EVENT_CHAT_COMPLETED:
+    case COZE_CHAT_EVENT_CHAT_ERROR:
+    case COZE_CHAT_EVENT_CHAT_INTERRUPTED:
+        s_turn_done = true;
+        break;
+    default:
+        break;
+    }
+}
+
+static bool sim_wait(volatile bool *flag, uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; !*flag && waited < timeout_ms; waited += 10) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return *flag;
+}
+
+/**
+ * @brief 跑一轮：按倍速送完麦克风音频、提交，等回复结束
+ */
+static void sim_run_turn(coze_chat_handle_t chat, int turn, sim_summary_t *sum)
+{
+    s_turn_done = false;
+    s_first_pcm_us = 0;
+
+    coze_chat_set_voice_activity(chat, true);
+    int64_t start = esp_timer_get_time();
+    for (size_t off = 0; off < s_mic_samples; off += SIM_CHUNK_SAMPLES) {
+        size_t n = s_mic_samples - off < SIM_CHUNK_SAMPLES ? s_mic_samples - off : SIM_CHUNK_SAMPLES;
+        coze_chat_send_audio_data(chat, (char *)(s_mic + off), (int)(n * sizeof(int16_t)));
+        if (s_speed > 0) {
+            int64_t due = start + (int64_t)(off + n) * 1000000 / SIM_SAMPLE_RATE / s_speed;
+            int64_t wait_us = due - esp_timer_get_time();
+            if (wait_us > 1000) {
+                vTaskDelay(pdMS_TO_TICKS(wait_us / 1000));
+            }
+        }
+    }
+    coze_chat_set_voice_activity(chat, false);
+    int64_t complete_us = esp_timer_get_time();
+    coze_chat_send_audio_complete(chat);
+
+    bool done = sim_wait(&s_turn_done, SIM_TURN_TIMEOUT_MS);
+    // 等虚拟播放缓冲放完，下一轮不与本轮播放重叠
+    while (s_play_us > esp_timer_get_time()) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    coze_turn_stats_t ts = {0};
+    coze_uplink_stats_t us = {0};
+    coze_downlink_stats_t ds = {0};
+    coze_chat_get_turn_stats(chat, &ts);
+    coze_chat_get_uplink_stats(chat, &us);
+    coze_chat_get_downlink_stats(chat, &ds);
+
+    int64_t first = s_first_pcm_us;
+    uint32_t ttfa_ms = first > complete_us ? (uint32_t)((first - complete_us) / 1000) : 0;
+    uint32_t kbps = ts.process_us ? (uint32_t)((uint64_t)ts.bytes_total * 1000 / ts.process_us) : 0;
+
+    printf("---- turn %d%s ----\n", turn, done ? "" : " (超时)");
+    printf("ttfa_ms=%" PRIu32 " reply_ms=%" PRIu32 " messages=%" PRIu32 " bytes=%" PRIu32
+           " process_us=%" PRIu32 " parse_kB_s=%" PRIu32 "\n",
+           ttfa_ms, ts.duration_ms, ts.messages, ts.bytes_total, ts.process_us, kbps);
+    printf("uplink messages=%" PRIu32 " queue_max=%" PRIu32 " queue_ms_avg=%" PRIu32
+           " dropped_expired=%" PRIu32 " dropped_full=%" PRIu32 " bitrate=%d\n",
+           us.messages, us.queue_depth_max, us.queue_ms_avg, us.dropped_expired, us.dropped_full, us.bitrate);
+    printf("downlink rx=%" PRIu32 " rx_dropped=%" PRIu32 " packets=%" PRIu32 " lost=%" PRIu32 " plc=%" PRIu32
+           " underruns=%" PRIu32 " buffer_full=%" PRIu32 " played_ms=%" PRIu32 " decode_us_per_s=%" PRIu32 "\n",
+           ds.rx_messages, ds.rx_dropped, ds.packets, ds.lost_frames, ds.plc_frames,
+           ds.underruns, ds.buffer_full, ds.played_ms, ds.decode_us_per_s);
+
+    sum->turns++;
+    if (first > complete_us) {
+        sum->ttfa_ms_sum += ttfa_ms;
+        if (ttfa_ms > sum->ttfa_ms_max) {
+            sum->ttfa_ms_max = ttfa_ms;
+        }
+    } else {
+        sum->ttfa_missing++;
+    }
+    sum->bytes += ts.bytes_total;
+    sum->process_us += ts.process_us;
+}
+
+void app_main(void)
+{
+    const char *url = getenv("COZE_SIM_URL");
+    const char *mic = getenv("COZE_SIM_MIC");
+    const char *reply = getenv("COZE_SIM_REPLY");
+    const char *profile = getenv("COZE_SIM_PROFILE");
+    const char *downlink = getenv("COZE_SIM_DOWNLINK");
+    int turns = env_int("COZE_SIM_TURNS", 5);
+    s_speed = env_int("COZE_SIM_SPEED", 1);
+    s_play_cap_ms = env_int("COZE_SIM_PLAY_MS", s_play_cap_ms);
+
+    if (mic) {
+        if (!sim_load_wav(mic)) {
+            exit(1);
+        }
+    } else {
+        sim_make_tone();
+    }
+
+    coze_chat_config_t cfg = COZE_CHAT_DEFAULT_CONFIG();
+    cfg.bot_id = "mock_bot";
+    cfg.access_token = "mock_token";
+    cfg.user_id = "coze_sim";
+    cfg.server_url = url ? url : "ws://127.0.0.1:8765/v1/chat";
+    cfg.event_callback = sim_event_cb;
+    cfg.pcm_sink.reserve = sim_sink_reserve;
+    cfg.pcm_sink.commit = sim_sink_commit;
+    cfg.pcm_sink.clear = sim_sink_clear;
+    if (reply && strcmp(reply, "text") == 0) {
+        cfg.reply_mode = COZE_REPLY_MODE_TEXT_TTS;
+    }
+    if (downlink && strcmp(downlink, "pcm") == 0) {
+        cfg.downlink_audio_type = COZE_CHAT_AUDIO_TYPE_PCM;
+        cfg.pcm_server_sample_rate = env_int("COZE_SIM_PCM_RATE", 0);
+    }
+    if (profile) {
+        cfg.sched_profile = xn_sched_find_preset(profile);
+    }
+
+    coze_chat_handle_t chat = NULL;
+    if (coze_chat_init(&cfg, &chat) != ESP_OK || coze_chat_start(chat) != ESP_OK) {
+        ESP_LOGE(TAG, "coze_chat 启动失败");
+        exit(1);
+    }
+    if (!sim_wait(&s_ready, SIM_READY_TIMEOUT_MS)) {
+        ESP_LOGE(TAG, "会话未就绪（%s）", cfg.server_url);
+        exit(1);
+    }
+
+    coze_conn_stats_t cs = {0};
+    coze_chat_get_conn_stats(chat, &cs);
+    printf("connect_ms=%" PRIu32 " ready_ms=%" PRIu32 "\n", cs.connect_ms_last, cs.ready_ms_last);
+
+    sim_summary_t sum = {0};
+    for (int i = 1; i <= turns; i++) {
+        sim_run_turn(chat, i, &sum);
+    }
+
+    uint32_t measured = sum.turns - sum.ttfa_missing;
+    printf("---- summary ----\n");
+    printf("turns=%" PRIu32 " ttfa_ms_avg=%" PRIu32 " ttfa_ms_max=%" PRIu32 " no_audio=%" PRIu32
+           " parse_kB_s=%" PRIu64 " pcm_ms=%" PRIu64 "\n",
+           sum.turns, measured ? sum.ttfa_ms_sum / measured : 0, sum.ttfa_ms_max, sum.ttfa_missing,
+           sum.process_us ? sum.bytes * 1000 / sum.process_us : 0, s_pcm_samples * 1000 / SIM_SAMPLE_RATE);
+
+    coze_chat_stop(chat);
+    coze_chat_deinit(chat);
+    free(s_mic);
+    exit(0);
+}